@@ -0,0 +1,1797 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../src/affinity.h"
+#include "../src/compiled.h"
+#include "../src/dispatch.h"
+#include "../src/image.h"
+#include "../src/lighttree.h"
+#include "../src/material.h"
+#include "../src/mesh.h"
+#include "../src/query.h"
+#include "../src/raysort.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include "../src/server.h"
+#include "../src/sphere.h"
+#include "../src/temporal.h"
+#include "../src/utils.h"
+#include "perfcount.h"
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Benchmarks of the renderer's building blocks. Each section prints a short
+ * report; `vibe_bench` runs them all, `vibe_bench NAME...` only those named. */
+
+#define BENCH_DATA_DIR "bench/data" /* default --data: reference images, results */
+
+typedef struct {
+    const char *obj;   /* optional OBJ mesh used instead of generated geometry */
+    const char *data;  /* directory of stored reference images and results */
+    perf_counters_t counters;
+    int have_counters;
+} bench_options_t;
+
+/* Monotonic time in seconds */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Set-associative LRU cache model with 64-byte lines (256 KB, 8-way: a
+ * typical per-core L2), used when hardware counters are unavailable */
+#define SIM_LINE 64
+#define SIM_SETS 512
+#define SIM_WAYS 8
+
+typedef struct {
+    uintptr_t tags[SIM_SETS][SIM_WAYS];
+    uint64_t used[SIM_SETS][SIM_WAYS];
+    uint64_t clock;
+    uint64_t misses;
+} sim_cache_t;
+
+/* Read size bytes at p through the model */
+static void sim_touch(sim_cache_t *c, const void *p, size_t size) {
+    uintptr_t first = (uintptr_t)p / SIM_LINE;
+    uintptr_t last = ((uintptr_t)p + size - 1) / SIM_LINE;
+    for (uintptr_t line = first; line <= last; line++) {
+        int set = (int)(line % SIM_SETS);
+        int victim = 0;
+        c->clock++;
+        for (int w = 0; w < SIM_WAYS; w++) {
+            if (c->tags[set][w] == line + 1) {
+                c->used[set][w] = c->clock;
+                goto next;
+            }
+            if (c->used[set][w] < c->used[set][victim]) victim = w;
+        }
+        c->misses++;
+        c->tags[set][victim] = line + 1;
+        c->used[set][victim] = c->clock;
+    next:;
+    }
+}
+
+/* mesh_hit with the scalar triangle test, feeding node, index and vertex
+ * reads to the cache model */
+static int sim_mesh_hit(const mesh_t *mesh, const ray_t r, double *t_hit,
+                        sim_cache_t *cache) {
+    tri_ray_t tr = tri_ray_prepare(r);
+    vec3_t inv_dir = vec3(1.0 / r.direction.e[0], 1.0 / r.direction.e[1],
+                          1.0 / r.direction.e[2]);
+    double closest = INFINITY;
+    int hit = 0;
+    int stack[96];
+    int sp = 0;
+    int index = 0;
+    while (mesh->node_count > 0) {
+        const mesh_node_t *node = &mesh->nodes[index];
+        sim_touch(cache, node, sizeof(*node));
+        aabb_t box = {vec3(node->min[0], node->min[1], node->min[2]),
+                      vec3(node->max[0], node->max[1], node->max[2])};
+        if (aabb_hit(&box, r.origin, inv_dir, 0.001, closest)) {
+            if (node->count > 0) {
+                for (uint32_t i = node->start; i < node->start + node->count; i++) {
+                    const uint32_t *tri = &mesh->indices[3 * (size_t)i];
+                    sim_touch(cache, tri, 3 * sizeof(uint32_t));
+                    for (int k = 0; k < 3; k++) {
+                        sim_touch(cache, &mesh->positions[3 * (size_t)tri[k]], 3 * sizeof(float));
+                    }
+                    double t;
+                    if (triangle_intersect(&tr, &mesh->positions[3 * (size_t)tri[0]],
+                                           &mesh->positions[3 * (size_t)tri[1]],
+                                           &mesh->positions[3 * (size_t)tri[2]], 0.001,
+                                           closest, &t)) {
+                        closest = t;
+                        hit = 1;
+                    }
+                }
+            } else {
+                int first = index + 1;
+                int second = (int)node->start;
+                if (r.direction.e[node->axis] < 0.0) {
+                    first = (int)node->start;
+                    second = index + 1;
+                }
+                stack[sp++] = second;
+                index = first;
+                continue;
+            }
+        }
+        if (sp == 0) break;
+        index = stack[--sp];
+    }
+    *t_hit = closest;
+    return hit;
+}
+
+/* Rolling heightfield of 2 * n * n triangles over [-size, size]^2 */
+static mesh_t *make_terrain(int n, double size, const material_t *mat) {
+    int verts = (n + 1) * (n + 1);
+    float *positions = malloc(3 * (size_t)verts * sizeof(float));
+    uint32_t *indices = malloc(6 * (size_t)n * n * sizeof(uint32_t));
+    if (!positions || !indices) {
+        free(positions);
+        free(indices);
+        return NULL;
+    }
+    for (int z = 0; z <= n; z++) {
+        for (int x = 0; x <= n; x++) {
+            double px = size * (2.0 * x / n - 1.0);
+            double pz = size * (2.0 * z / n - 1.0);
+            float *p = &positions[3 * ((size_t)z * (n + 1) + x)];
+            p[0] = (float)px;
+            p[1] = (float)(0.8 * sin(0.7 * px) * cos(0.5 * pz) + 0.15 * sin(3.1 * px + 2.3 * pz));
+            p[2] = (float)pz;
+        }
+    }
+    uint32_t *idx = indices;
+    for (int z = 0; z < n; z++) {
+        for (int x = 0; x < n; x++) {
+            uint32_t a = (uint32_t)(z * (n + 1) + x);
+            uint32_t b = a + (uint32_t)n + 1;
+            *idx++ = a;
+            *idx++ = b;
+            *idx++ = a + 1;
+            *idx++ = a + 1;
+            *idx++ = b;
+            *idx++ = b + 1;
+        }
+    }
+    return mesh_create(positions, verts, indices, 2 * n * n, mat);
+}
+
+#define SORT_WIDTH 640
+#define SORT_HEIGHT 360
+#define SORT_BOUNCES 3
+#define SORT_BATCH 65536
+#define SORT_REPEATS 3
+#define SORT_TERRAIN 1024 /* 2M triangles, about 80 MB with the BVH */
+
+/* Ray range [start, start + count) traced as one batch */
+typedef struct {
+    int start;
+    int count;
+} batch_range_t;
+
+/* Secondary rays as a batched renderer sees them: a frame's first hits in
+ * pixel order spawn diffuse bounces, whose hits spawn the next wave, and so on.
+ * Each wave is cut into batches. Returns the ray count and fills ranges. */
+static int make_secondary_rays(const scene_t *scene, ray_t *rays, batch_range_t *ranges,
+                               int *range_count) {
+    camera_t camera = scene_camera(scene, (double)SORT_WIDTH / SORT_HEIGHT);
+    int n = 0, wave_start = 0;
+    *range_count = 0;
+    random_seed(1);
+
+    for (int y = 0; y < SORT_HEIGHT; y++) {
+        for (int x = 0; x < SORT_WIDTH; x++) {
+            ray_t r = camera_get_ray(&camera, (x + random_double()) / (SORT_WIDTH - 1),
+                                     (SORT_HEIGHT - 1 - y + random_double()) / (SORT_HEIGHT - 1));
+            hit_record_t rec = {0};
+            if (scene_hit(scene, r, 0.001, INFINITY, &rec)) {
+                rays[n++] = ray(rec.point, vec3_add(rec.normal, random_unit_vector()));
+            }
+        }
+    }
+    for (int bounce = 0; bounce < SORT_BOUNCES; bounce++) {
+        int wave_end = n;
+        for (int start = wave_start; start < wave_end; start += SORT_BATCH) {
+            int count = wave_end - start < SORT_BATCH ? wave_end - start : SORT_BATCH;
+            ranges[(*range_count)++] = (batch_range_t){start, count};
+        }
+        if (bounce == SORT_BOUNCES - 1) break;
+        for (int i = wave_start; i < wave_end; i++) {
+            hit_record_t rec = {0};
+            if (scene_hit(scene, rays[i], 0.001, INFINITY, &rec)) {
+                rays[n++] = ray(rec.point, vec3_add(rec.normal, random_unit_vector()));
+            }
+        }
+        wave_start = wave_end;
+    }
+    return n;
+}
+
+/* Trace order of a batch: generation order, or sorted by coherence key.
+ * keys and order hold 2 * SORT_BATCH entries. */
+static void batch_order(const ray_t *first, int count, int sort, uint64_t *keys,
+                        uint32_t *order) {
+    for (int i = 0; i < count; i++) order[i] = (uint32_t)i;
+    if (!sort) return;
+
+    aabb_t bounds = aabb_empty();
+    for (int i = 0; i < count; i++) bounds = aabb_extend(bounds, first[i].origin);
+    for (int i = 0; i < count; i++) keys[i] = ray_sort_key(&first[i], &bounds);
+    ray_sort(keys, order, count, keys + SORT_BATCH, order + SORT_BATCH);
+}
+
+/* Trace every batch, optionally sorting each one first */
+static void trace_batches(const scene_t *scene, const ray_t *rays,
+                          const batch_range_t *ranges, int range_count, int sort) {
+#pragma omp parallel
+    {
+        uint64_t *keys = malloc(2 * SORT_BATCH * sizeof(uint64_t));
+        uint32_t *order = malloc(2 * SORT_BATCH * sizeof(uint32_t));
+#pragma omp for schedule(dynamic, 1)
+        for (int b = 0; b < range_count; b++) {
+            if (!keys || !order) continue;
+            const ray_t *first = rays + ranges[b].start;
+            batch_order(first, ranges[b].count, sort, keys, order);
+            for (int i = 0; i < ranges[b].count; i++) {
+                hit_record_t rec;
+                scene_hit(scene, first[order[i]], 0.001, INFINITY, &rec);
+            }
+        }
+        free(keys);
+        free(order);
+    }
+}
+
+/* Cache misses per ray of the cache model over all batches */
+static double simulate_batches(const mesh_t *mesh, const ray_t *rays, int n,
+                               const batch_range_t *ranges, int range_count, int sort) {
+    sim_cache_t *cache = calloc(1, sizeof(sim_cache_t));
+    uint64_t *keys = malloc(2 * SORT_BATCH * sizeof(uint64_t));
+    uint32_t *order = malloc(2 * SORT_BATCH * sizeof(uint32_t));
+    double result = -1.0;
+    if (cache && keys && order) {
+        for (int b = 0; b < range_count; b++) {
+            const ray_t *first = rays + ranges[b].start;
+            batch_order(first, ranges[b].count, sort, keys, order);
+            for (int i = 0; i < ranges[b].count; i++) {
+                double t;
+                sim_mesh_hit(mesh, first[order[i]], &t, cache);
+            }
+        }
+        result = (double)cache->misses / n;
+    }
+    free(cache);
+    free(keys);
+    free(order);
+    return result;
+}
+
+/* Secondary-ray sorting on a mesh far larger than the caches: tracing time
+ * and cache misses, unsorted vs sorted */
+static int bench_sort(bench_options_t *opts) {
+    scene_t *scene = scene_create();
+    const material_t *mat =
+        scene ? scene_add_material(scene, lambertian_create(vec3(0.5, 0.5, 0.5))) : NULL;
+    mesh_t *mesh = NULL;
+    if (mat) {
+        mesh = opts->obj ? mesh_load_obj(opts->obj, mat) : make_terrain(SORT_TERRAIN, 40.0, mat);
+    }
+    size_t max_rays = (size_t)SORT_WIDTH * SORT_HEIGHT * SORT_BOUNCES;
+    ray_t *rays = malloc(max_rays * sizeof(ray_t));
+    batch_range_t *ranges = malloc((max_rays / SORT_BATCH + SORT_BOUNCES) * sizeof(batch_range_t));
+    if (!mesh || !rays || !ranges) {
+        fprintf(stderr, "Error: could not build the sort benchmark mesh\n");
+        mesh_destroy(mesh);
+        scene_destroy(scene);
+        free(rays);
+        free(ranges);
+        return -1;
+    }
+    hittable_list_add(scene->world, mesh_to_hittable(mesh));
+    scene_finalize(scene);
+
+    /* Look at the mesh from above one side */
+    aabb_t box;
+    bvh_bounding_box(scene->bvh, &box);
+    vec3_t extent = vec3_sub(box.max, box.min);
+    scene->lookat = aabb_centroid(box);
+    scene->lookfrom = vec3_add(scene->lookat, vec3(0.0, 0.25 * vec3_length(extent),
+                                                   0.6 * vec3_length(extent)));
+    scene->vfov = 40.0;
+    scene->aperture = 0.0;
+
+    int range_count;
+    int n = make_secondary_rays(scene, rays, ranges, &range_count);
+    printf("== sort: %d secondary rays (%d bounces) on a %d-triangle mesh, batches of %d ==\n",
+           n, SORT_BOUNCES, mesh->triangle_count, SORT_BATCH);
+    printf("%-9s %10s %10s %16s %16s\n", "order", "time (s)", "Mrays/s", "model misses/ray",
+           "hw misses/ray");
+
+    double model[2], hardware[2];
+    for (int sort = 0; sort <= 1; sort++) {
+        double best = INFINITY;
+        uint64_t misses = 0;
+        for (int rep = 0; rep < SORT_REPEATS; rep++) {
+            perf_counters_start(&opts->counters);
+            double start = now_seconds();
+            trace_batches(scene, rays, ranges, range_count, sort);
+            double elapsed = now_seconds() - start;
+            uint64_t m, refs;
+            perf_counters_stop(&opts->counters, &m, &refs);
+            if (elapsed < best) {
+                best = elapsed;
+                misses = m;
+            }
+        }
+        model[sort] = simulate_batches(mesh, rays, n, ranges, range_count, sort);
+        hardware[sort] = (double)misses / n;
+
+        char hw[32] = "n/a";
+        if (opts->have_counters) snprintf(hw, sizeof(hw), "%.2f", hardware[sort]);
+        printf("%-9s %10.3f %10.2f %16.2f %16s\n", sort ? "sorted" : "unsorted", best,
+               n / best * 1e-6, model[sort], hw);
+    }
+
+    printf("miss reduction: model %.1f%%", 100.0 * (1.0 - model[1] / model[0]));
+    if (opts->have_counters && hardware[0] > 0.0) {
+        printf(", hardware %.1f%%", 100.0 * (1.0 - hardware[1] / hardware[0]));
+    } else {
+        printf(", hardware counters unavailable");
+    }
+    printf("\n\n");
+
+    free(rays);
+    free(ranges);
+    scene_destroy(scene);
+    return 0;
+}
+
+#define AFFINITY_WIDTH 320
+#define AFFINITY_HEIGHT 180
+#define AFFINITY_SPP 8
+
+/* Render time of the showcase frame with the current thread placement */
+static double time_frame(const scene_t *scene, const camera_t *camera) {
+    render_settings_t settings = {
+        .width = AFFINITY_WIDTH,
+        .height = AFFINITY_HEIGHT,
+        .samples_per_pixel = AFFINITY_SPP,
+        .max_depth = 16,
+        .seed = 1,
+    };
+    accum_t *accum = accum_create(AFFINITY_WIDTH, AFFINITY_HEIGHT);
+    if (!accum) return -1.0;
+    render_rect_t full = {0, 0, AFFINITY_WIDTH, AFFINITY_HEIGHT};
+    double start = now_seconds();
+    render_region(scene, camera, &settings, full, 0, AFFINITY_SPP, accum);
+    double elapsed = now_seconds() - start;
+    accum_destroy(accum);
+    return elapsed;
+}
+
+/* Scaling of the showcase render under each thread placement policy, from
+ * one thread up to every placement the policy makes */
+static int bench_affinity(bench_options_t *opts) {
+    (void)opts;
+    cpu_topology_t *topo = topology_detect();
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    if (!topo || !scene) {
+        fprintf(stderr, "Error: could not set up the affinity benchmark\n");
+        topology_destroy(topo);
+        scene_destroy(scene);
+        return -1;
+    }
+    camera_t camera = scene_camera(scene, (double)AFFINITY_WIDTH / AFFINITY_HEIGHT);
+
+    printf("== affinity: %dx%d, %d spp on %d cpus, %d cores, %d NUMA nodes ==\n",
+           AFFINITY_WIDTH, AFFINITY_HEIGHT, AFFINITY_SPP, topo->cpu_count, topo->core_count,
+           topo->node_count);
+    printf("%-9s %8s %10s %9s %11s\n", "policy", "threads", "time (s)", "speedup",
+           "efficiency");
+
+    int status = 0;
+    for (int p = AFFINITY_NONE; p <= AFFINITY_CORES && status == 0; p++) {
+        int most = affinity_apply(topo, (affinity_policy_t)p, 0);
+        double single = 0.0;
+        for (int threads = 1; most > 0; threads = threads * 2 < most ? threads * 2 : most) {
+            if (affinity_apply(topo, (affinity_policy_t)p, threads) != threads) break;
+            double elapsed = time_frame(scene, &camera);
+            if (elapsed < 0.0) {
+                status = -1;
+                break;
+            }
+            if (threads == 1) single = elapsed;
+            printf("%-9s %8d %10.3f %9.2f %10.0f%%\n", affinity_name((affinity_policy_t)p),
+                   threads, elapsed, single / elapsed, 100.0 * single / elapsed / threads);
+            if (threads == most) break;
+        }
+        if (most < 0) printf("%-9s pinning failed\n", affinity_name((affinity_policy_t)p));
+    }
+    printf("\n");
+
+    affinity_apply(topo, AFFINITY_NONE, 0);
+    topology_destroy(topo);
+    scene_destroy(scene);
+    return status;
+}
+
+#define KERNEL_WIDTH 160
+#define KERNEL_HEIGHT 120
+#define KERNEL_SPP 8
+#define KERNEL_RUNS 3
+
+/* Camera samples per second of a showcase scene, best of KERNEL_RUNS */
+static double kernel_rate(const char *name) {
+    scene_t *scene = scene_create_named(name, SCENE_DEFAULT_SEED);
+    accum_t *accum = accum_create(KERNEL_WIDTH, KERNEL_HEIGHT);
+    if (!scene || !accum) {
+        scene_destroy(scene);
+        accum_destroy(accum);
+        return -1.0;
+    }
+    camera_t camera = scene_camera(scene, (double)KERNEL_WIDTH / KERNEL_HEIGHT);
+    render_settings_t settings = {.width = KERNEL_WIDTH, .height = KERNEL_HEIGHT,
+                                  .samples_per_pixel = KERNEL_SPP, .max_depth = 50,
+                                  .seed = SCENE_DEFAULT_SEED};
+    render_rect_t full = {0, 0, KERNEL_WIDTH, KERNEL_HEIGHT};
+    double best = 0.0;
+    for (int run = 0; run < KERNEL_RUNS; run++) {
+        accum_clear(accum);
+        double start = now_seconds();
+        render_region(scene, &camera, &settings, full, 0, KERNEL_SPP, accum);
+        double elapsed = now_seconds() - start;
+        if (run == 0 || elapsed < best) best = elapsed;
+    }
+    accum_destroy(accum);
+    scene_destroy(scene);
+    return (double)KERNEL_WIDTH * KERNEL_HEIGHT * KERNEL_SPP / best;
+}
+
+/* Throughput of the intersection and scatter kernels at the ISA level this
+ * machine dispatches to; compare builds with OPTIONS=-DKERNEL_CLONES=0 or
+ * OPTIONS=-DVEC3_SIMD=1 (see dispatch.h and vec3.h) */
+static int bench_kernels(bench_options_t *opts) {
+    (void)opts;
+    static const char *const scenes[] = {"random", "forest"};
+    printf("== kernels: %dx%d, %d spp, %s kernels, %s vec3 ==\n", KERNEL_WIDTH,
+           KERNEL_HEIGHT, KERNEL_SPP, dispatch_level(), VEC3_SIMD ? "4-lane" : "scalar");
+    printf("%-9s %14s\n", "scene", "samples/s");
+    for (int i = 0; i < 2; i++) {
+        double rate = kernel_rate(scenes[i]);
+        if (rate < 0.0) {
+            fprintf(stderr, "Error: could not set up scene '%s'\n", scenes[i]);
+            return -1;
+        }
+        printf("%-9s %14.0f\n", scenes[i], rate);
+    }
+    printf("\n");
+    return 0;
+}
+
+#define THUMB_COUNT 40
+#define THUMB_WIDTH 96
+#define THUMB_HEIGHT 64
+#define THUMB_SPP 4
+#define THUMB_TERRAIN 256 /* 131k-triangle OBJ loaded by every job */
+
+/* Write a terrain mesh as an OBJ file; returns 0 on success */
+static int write_terrain_obj(const char *path, int n) {
+    material_t dummy = {0};
+    mesh_t *mesh = make_terrain(n, 4.0, &dummy);
+    FILE *f = mesh ? fopen(path, "w") : NULL;
+    if (!f) {
+        mesh_destroy(mesh);
+        return -1;
+    }
+    for (int i = 0; i < mesh->vertex_count; i++) {
+        const float *p = &mesh->positions[3 * i];
+        fprintf(f, "v %.5f %.5f %.5f\n", p[0], p[1] - 1.0, p[2]);
+    }
+    for (int i = 0; i < mesh->triangle_count; i++) {
+        const uint32_t *t = &mesh->indices[3 * i];
+        fprintf(f, "f %u %u %u\n", t[0] + 1, t[1] + 1, t[2] + 1);
+    }
+    int failed = ferror(f);
+    if (fclose(f) != 0) failed = 1;
+    mesh_destroy(mesh);
+    return failed ? -1 : 0;
+}
+
+typedef struct {
+    const char *address;
+    int status;
+} bench_server_t;
+
+static void *run_server(void *arg) {
+    bench_server_t *bs = arg;
+    server_options_t opts = {.address = bs->address};
+    bs->status = server_run(&opts);
+    return NULL;
+}
+
+/* Thumbnails per second: one scene build (with an OBJ load) per image, as
+ * when launching a process per job, against jobs sent to a daemon with a
+ * warm scene cache */
+static int bench_daemon(bench_options_t *opts) {
+    char obj[64];
+    snprintf(obj, sizeof(obj), "/tmp/vibe_bench_%d.obj", (int)getpid());
+    const char *obj_path = opts->obj ? opts->obj : obj;
+    if (!opts->obj && write_terrain_obj(obj, THUMB_TERRAIN) != 0) {
+        fprintf(stderr, "Error: could not write %s\n", obj);
+        return -1;
+    }
+    vibe_settings_t settings;
+    vibe_settings_default(&settings);
+    settings.width = THUMB_WIDTH;
+    settings.height = THUMB_HEIGHT;
+    settings.samples_per_pixel = THUMB_SPP;
+    settings.max_depth = 8;
+    char output[64];
+    snprintf(output, sizeof(output), "/tmp/vibe_bench_%d.ppm", (int)getpid());
+
+    double *rgb = malloc(THUMB_WIDTH * THUMB_HEIGHT * 3 * sizeof(double));
+    if (!rgb) return -1;
+    printf("== daemon: %d thumbnails of %dx%d, %d spp, showcase scene with %s ==\n",
+           THUMB_COUNT, THUMB_WIDTH, THUMB_HEIGHT, THUMB_SPP, obj_path);
+
+    vibe_scene_desc_t desc = {.name = "random", .obj_path = obj_path};
+    double start = now_seconds();
+    for (int i = 0; i < THUMB_COUNT; i++) {
+        vibe_scene_t *scene = vibe_scene_load(&desc);
+        vibe_view_t view;
+        if (!scene) break;
+        vibe_scene_view(scene, &view);
+        vibe_render(scene, &view, &settings, rgb);
+        vibe_write_ppm(output, rgb, THUMB_WIDTH, THUMB_HEIGHT);
+        vibe_scene_destroy(scene);
+    }
+    double cold = now_seconds() - start;
+    free(rgb);
+
+    char address[64];
+    snprintf(address, sizeof(address), "unix:/tmp/vibe_bench_%d.sock", (int)getpid());
+    bench_server_t bs = {address, -1};
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, run_server, &bs) != 0) return -1;
+
+    server_job_t job = {.settings = settings};
+    strcpy(job.scene, "random");
+    snprintf(job.obj_path, sizeof(job.obj_path), "%s", obj_path);
+    strcpy(job.output, output);
+    int status = 0;
+    double warm = 0.0;
+    for (int i = -1; i < THUMB_COUNT && status == 0; i++) {
+        if (i == 0) start = now_seconds(); /* the first job only warms the cache */
+        job.default_view = 1;
+        status = server_submit(address, &job, NULL, NULL, NULL);
+    }
+    warm = now_seconds() - start;
+    server_shutdown(address);
+    pthread_join(thread, NULL);
+    remove(output);
+    if (!opts->obj) remove(obj);
+
+    printf("%-22s %10s %12s\n", "mode", "time (s)", "images/s");
+    printf("%-22s %10.3f %12.1f\n", "scene per image", cold, THUMB_COUNT / cold);
+    printf("%-22s %10.3f %12.1f\n", "daemon, warm cache", warm, THUMB_COUNT / warm);
+    printf("\n");
+    return status == 0 && bs.status == 0 ? 0 : -1;
+}
+
+#define GUIDE_WIDTH 64
+#define GUIDE_HEIGHT 48
+#define GUIDE_REFERENCE_SPP 384
+
+/* Render the room at spp, guided or not; returns the seconds taken */
+static double room_render(const scene_t *scene, const camera_t *camera, int spp, int guided,
+                          unsigned int seed, accum_t *out) {
+    render_settings_t settings = {.width = GUIDE_WIDTH, .height = GUIDE_HEIGHT,
+                                  .samples_per_pixel = spp, .max_depth = 50, .seed = seed};
+    render_rect_t full = {0, 0, GUIDE_WIDTH, GUIDE_HEIGHT};
+    accum_clear(out);
+    double start = now_seconds();
+    if (guided) {
+        render_progressive(scene, camera, &settings, full, 1, 0, out);
+    } else {
+        render_region(scene, camera, &settings, full, 0, spp, out);
+    }
+    return now_seconds() - start;
+}
+
+/* Root mean square luminance difference of two images over rect */
+static double luminance_rmse(const accum_t *a, const accum_t *b, render_rect_t rect) {
+    double error = 0.0;
+    for (int y = rect.y0; y < rect.y1; y++) {
+        for (int x = rect.x0; x < rect.x1; x++) {
+            vec3_t p = accum_pixel_mean(&a->pixels[y * a->width + x]);
+            vec3_t q = accum_pixel_mean(&b->pixels[y * b->width + x]);
+            double d = 0.2126 * (p.e[0] - q.e[0]) + 0.7152 * (p.e[1] - q.e[1]) +
+                       0.0722 * (p.e[2] - q.e[2]);
+            error += d * d;
+        }
+    }
+    return sqrt(error / ((rect.x1 - rect.x0) * (rect.y1 - rect.y0)));
+}
+
+/* Error against a high-sample reference of the room scene, lit only through
+ * a skylight, with and without path guiding. Efficiency is 1 / (error^2 x
+ * time) relative to unguided rendering at the same sample count: above 1,
+ * guiding reaches a given error sooner. */
+static int bench_guiding(bench_options_t *opts) {
+    (void)opts;
+    scene_t *scene = scene_create_room(0);
+    accum_t *reference = accum_create(GUIDE_WIDTH, GUIDE_HEIGHT);
+    accum_t *image = accum_create(GUIDE_WIDTH, GUIDE_HEIGHT);
+    if (!scene || !reference || !image) {
+        fprintf(stderr, "Error: could not set up the room scene\n");
+        scene_destroy(scene);
+        accum_destroy(reference);
+        accum_destroy(image);
+        return -1;
+    }
+    camera_t camera = scene_camera(scene, (double)GUIDE_WIDTH / GUIDE_HEIGHT);
+    printf("== guiding: room %dx%d, reference %d spp unguided ==\n", GUIDE_WIDTH,
+           GUIDE_HEIGHT, GUIDE_REFERENCE_SPP);
+    room_render(scene, &camera, GUIDE_REFERENCE_SPP, 0, 99, reference);
+
+    static const int spps[] = {16, 64};
+    render_rect_t full = {0, 0, GUIDE_WIDTH, GUIDE_HEIGHT};
+    printf("%-9s %5s %9s %9s %11s\n", "mode", "spp", "seconds", "rmse", "efficiency");
+    for (int i = 0; i < 2; i++) {
+        double plain_time = room_render(scene, &camera, spps[i], 0, SCENE_DEFAULT_SEED, image);
+        double plain_error = luminance_rmse(image, reference, full);
+        double guided_time = room_render(scene, &camera, spps[i], 1, SCENE_DEFAULT_SEED, image);
+        double guided_error = luminance_rmse(image, reference, full);
+        printf("%-9s %5d %9.2f %9.4f %11.2f\n", "unguided", spps[i], plain_time, plain_error,
+               1.0);
+        printf("%-9s %5d %9.2f %9.4f %11.2f\n", "guided", spps[i], guided_time, guided_error,
+               plain_error * plain_error * plain_time /
+                   (guided_error * guided_error * guided_time));
+    }
+    printf("\n");
+    accum_destroy(reference);
+    accum_destroy(image);
+    scene_destroy(scene);
+    return 0;
+}
+
+#define CAUSTIC_WIDTH 80
+#define CAUSTIC_HEIGHT 60
+#define CAUSTIC_REFERENCE_SPP 1024
+#define CAUSTIC_PHOTONS 10000
+
+/* Render the glass scene at spp with photons per pass (0: plain path
+ * tracing); returns the seconds taken */
+static double glass_render(const scene_t *scene, const camera_t *camera, int spp, int photons,
+                           unsigned int seed, accum_t *out) {
+    render_settings_t settings = {.width = CAUSTIC_WIDTH, .height = CAUSTIC_HEIGHT,
+                                  .samples_per_pixel = spp, .max_depth = 50, .seed = seed};
+    render_rect_t full = {0, 0, CAUSTIC_WIDTH, CAUSTIC_HEIGHT};
+    accum_clear(out);
+    double start = now_seconds();
+    render_progressive(scene, camera, &settings, full, 0, photons, out);
+    return now_seconds() - start;
+}
+
+/* Error against a high-sample path-traced reference of the glass scene, where
+ * the floor under the canopy is lit mostly through a hanging glass ball, with
+ * and without caustic photon maps: over the whole frame and over the caustic
+ * the ball casts. Efficiency is as in the guiding section, over the whole
+ * frame. */
+static int bench_caustics(bench_options_t *opts) {
+    (void)opts;
+    scene_t *scene = scene_create_glass(0);
+    accum_t *reference = accum_create(CAUSTIC_WIDTH, CAUSTIC_HEIGHT);
+    accum_t *image = accum_create(CAUSTIC_WIDTH, CAUSTIC_HEIGHT);
+    if (!scene || !reference || !image) {
+        fprintf(stderr, "Error: could not set up the glass scene\n");
+        scene_destroy(scene);
+        accum_destroy(reference);
+        accum_destroy(image);
+        return -1;
+    }
+    camera_t camera = scene_camera(scene, (double)CAUSTIC_WIDTH / CAUSTIC_HEIGHT);
+    printf("== caustics: glass %dx%d, reference %d spp path traced, %d photons per pass ==\n",
+           CAUSTIC_WIDTH, CAUSTIC_HEIGHT, CAUSTIC_REFERENCE_SPP, CAUSTIC_PHOTONS);
+    glass_render(scene, &camera, CAUSTIC_REFERENCE_SPP, 0, 99, reference);
+
+    static const int spps[] = {16, 64};
+    render_rect_t full = {0, 0, CAUSTIC_WIDTH, CAUSTIC_HEIGHT};
+    render_rect_t caustic = {CAUSTIC_WIDTH * 2 / 5, CAUSTIC_HEIGHT * 29 / 60,
+                             CAUSTIC_WIDTH * 3 / 5, CAUSTIC_HEIGHT * 2 / 3};
+    printf("%-9s %5s %9s %9s %12s %11s\n", "mode", "spp", "seconds", "rmse", "caustic rmse",
+           "efficiency");
+    for (int i = 0; i < 2; i++) {
+        double plain_time = glass_render(scene, &camera, spps[i], 0, SCENE_DEFAULT_SEED, image);
+        double plain_error = luminance_rmse(image, reference, full);
+        double plain_caustic = luminance_rmse(image, reference, caustic);
+        double photon_time = glass_render(scene, &camera, spps[i], CAUSTIC_PHOTONS,
+                                          SCENE_DEFAULT_SEED, image);
+        double photon_error = luminance_rmse(image, reference, full);
+        double photon_caustic = luminance_rmse(image, reference, caustic);
+        printf("%-9s %5d %9.2f %9.4f %12.4f %11.2f\n", "paths", spps[i], plain_time,
+               plain_error, plain_caustic, 1.0);
+        printf("%-9s %5d %9.2f %9.4f %12.4f %11.2f\n", "photons", spps[i], photon_time,
+               photon_error, photon_caustic,
+               plain_error * plain_error * plain_time /
+                   (photon_error * photon_error * photon_time));
+    }
+    printf("\n");
+    accum_destroy(reference);
+    accum_destroy(image);
+    scene_destroy(scene);
+    return 0;
+}
+
+#define EDIT_WIDTH 160
+#define EDIT_HEIGHT 90
+#define EDIT_SPP 64
+
+/* Time to bring a frame of the showcase scene up to date after one sphere's
+ * material changes, re-rendering only the pixels whose paths touched it,
+ * against rendering the frame again. Also the cost of recording footprints
+ * in the first render. */
+static int bench_edit(bench_options_t *opts) {
+    (void)opts;
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    footprint_t *footprint = footprint_create(EDIT_WIDTH, EDIT_HEIGHT);
+    accum_t *frame = accum_create(EDIT_WIDTH, EDIT_HEIGHT);
+    if (!scene || !footprint || !frame) {
+        fprintf(stderr, "Error: could not set up the edit benchmark\n");
+        scene_destroy(scene);
+        footprint_destroy(footprint);
+        accum_destroy(frame);
+        return -1;
+    }
+    camera_t camera = scene_camera(scene, (double)EDIT_WIDTH / EDIT_HEIGHT);
+    render_settings_t settings = {.width = EDIT_WIDTH, .height = EDIT_HEIGHT,
+                                  .samples_per_pixel = EDIT_SPP, .max_depth = 50,
+                                  .seed = SCENE_DEFAULT_SEED};
+    render_rect_t full = {0, 0, EDIT_WIDTH, EDIT_HEIGHT};
+
+    double start = now_seconds();
+    render_region(scene, &camera, &settings, full, 0, EDIT_SPP, frame);
+    double plain = now_seconds() - start;
+    settings.footprint = footprint;
+    accum_clear(frame);
+    start = now_seconds();
+    render_region(scene, &camera, &settings, full, 0, EDIT_SPP, frame);
+    double recorded = now_seconds() - start;
+
+    printf("== edit: showcase %dx%d, %d spp ==\n", EDIT_WIDTH, EDIT_HEIGHT, EDIT_SPP);
+    printf("%-26s %9s %9s\n", "render", "seconds", "pixels");
+    printf("%-26s %9.2f %8.1f%%\n", "full frame", plain, 100.0);
+    printf("%-26s %9.2f %8.1f%%\n", "full frame, footprints", recorded, 100.0);
+
+    /* The large diffuse sphere, the glass one, then a small sphere */
+    int objects[] = {scene->world->count - 3, scene->world->count - 2, 1};
+    const char *names[] = {"edit large diffuse sphere", "edit large glass sphere",
+                           "edit small sphere"};
+    const material_t *gold = scene_add_material(scene, metal_create(vec3(0.9, 0.7, 0.3), 0.1));
+    for (int i = 0; i < 3; i++) {
+        sphere_t *sphere = scene->world->objects[objects[i]].data;
+        sphere->material = gold;
+        start = now_seconds();
+        int redone = render_edit(scene, &camera, &settings, &objects[i], 1, frame);
+        double seconds = now_seconds() - start;
+        printf("%-26s %9.2f %8.1f%%\n", names[i], seconds,
+               100.0 * redone / (EDIT_WIDTH * EDIT_HEIGHT));
+    }
+    printf("\n");
+    footprint_destroy(footprint);
+    accum_destroy(frame);
+    scene_destroy(scene);
+    return 0;
+}
+
+#define COMPILED_WIDTH 160
+#define COMPILED_HEIGHT 90
+#define COMPILED_SPP 16
+#define COMPILED_RUNS 3
+
+/* The renderer vibe_scenec specialized to one scene (COMPILED_SCENE in the
+ * Makefile) against the generic renderer on the same scene, best of
+ * COMPILED_RUNS each; the two images must be identical */
+static int bench_compiled(bench_options_t *opts) {
+    (void)opts;
+    scene_t *scene = scene_create_named(compiled_scene_name, compiled_scene_seed);
+    accum_t *generic = accum_create(COMPILED_WIDTH, COMPILED_HEIGHT);
+    accum_t *compiled = accum_create(COMPILED_WIDTH, COMPILED_HEIGHT);
+    if (!scene || !generic || !compiled) {
+        fprintf(stderr, "Error: could not set up the compiled benchmark\n");
+        scene_destroy(scene);
+        accum_destroy(generic);
+        accum_destroy(compiled);
+        return -1;
+    }
+    double aspect = (double)COMPILED_WIDTH / COMPILED_HEIGHT;
+    camera_t camera = scene_camera(scene, aspect);
+    camera_t compiled_cam = compiled_camera(aspect);
+    render_settings_t settings = {.width = COMPILED_WIDTH, .height = COMPILED_HEIGHT,
+                                  .samples_per_pixel = COMPILED_SPP, .max_depth = 50,
+                                  .seed = SCENE_DEFAULT_SEED};
+    render_rect_t full = {0, 0, COMPILED_WIDTH, COMPILED_HEIGHT};
+
+    double generic_best = 0.0, compiled_best = 0.0;
+    for (int run = 0; run < COMPILED_RUNS; run++) {
+        accum_clear(generic);
+        double start = now_seconds();
+        render_region(scene, &camera, &settings, full, 0, COMPILED_SPP, generic);
+        double elapsed = now_seconds() - start;
+        if (run == 0 || elapsed < generic_best) generic_best = elapsed;
+
+        accum_clear(compiled);
+        start = now_seconds();
+        compiled_render(&compiled_cam, &settings, full, 0, COMPILED_SPP, compiled);
+        elapsed = now_seconds() - start;
+        if (run == 0 || elapsed < compiled_best) compiled_best = elapsed;
+    }
+    int identical = memcmp(generic->pixels, compiled->pixels,
+                           (size_t)COMPILED_WIDTH * COMPILED_HEIGHT * sizeof(accum_pixel_t)) == 0;
+
+    printf("== compiled: %s %dx%d, %d spp ==\n", compiled_scene_name, COMPILED_WIDTH,
+           COMPILED_HEIGHT, COMPILED_SPP);
+    printf("%-10s %9s %9s\n", "renderer", "seconds", "speedup");
+    printf("%-10s %9.3f %8.2fx\n", "generic", generic_best, 1.0);
+    printf("%-10s %9.3f %8.2fx\n", "compiled", compiled_best, generic_best / compiled_best);
+    printf("images %s\n\n", identical ? "identical" : "DIFFER");
+    accum_destroy(generic);
+    accum_destroy(compiled);
+    scene_destroy(scene);
+    return identical ? 0 : -1;
+}
+
+#define FLY_WIDTH 160
+#define FLY_HEIGHT 90
+#define FLY_FRAMES 8
+#define FLY_DEGREES 1.0 /* camera turn per frame */
+#define FLY_SPP 32
+#define FLY_REFERENCE_SPP 512
+
+/* Camera of frame f of a flythrough turning about the showcase's look-at point */
+static camera_t fly_camera(const scene_t *scene, int f) {
+    double a = FLY_DEGREES * f * PI / 180.0;
+    vec3_t d = vec3_sub(scene->lookfrom, scene->lookat);
+    vec3_t from = vec3_add(scene->lookat, vec3(d.e[0] * cos(a) + d.e[2] * sin(a), d.e[1],
+                                               d.e[2] * cos(a) - d.e[0] * sin(a)));
+    return camera_create(from, scene->lookat, scene->vup, scene->vfov,
+                         (double)FLY_WIDTH / FLY_HEIGHT, scene->aperture, scene->focus_dist);
+}
+
+/* Luminance RMS error of linear RGB triples against a reference frame */
+static double rgb_rmse(const double *rgb, const accum_t *reference) {
+    double error = 0.0;
+    int pixels = reference->width * reference->height;
+    for (int i = 0; i < pixels; i++) {
+        vec3_t q = accum_pixel_mean(&reference->pixels[i]);
+        double d = 0.2126 * (rgb[3 * i] - q.e[0]) + 0.7152 * (rgb[3 * i + 1] - q.e[1]) +
+                   0.0722 * (rgb[3 * i + 2] - q.e[2]);
+        error += d * d;
+    }
+    return sqrt(error / pixels);
+}
+
+/* A flythrough of the showcase scene rendered from scratch every frame
+ * against temporal reuse with a few fresh samples where history holds:
+ * time for the sequence, mean samples traced per pixel and frame, and the
+ * error of the last frame against a high-sample reference */
+static int bench_temporal(bench_options_t *opts) {
+    (void)opts;
+    static const int fresh[] = {2, 4, 8};
+    int pixels = FLY_WIDTH * FLY_HEIGHT;
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    accum_t *reference = accum_create(FLY_WIDTH, FLY_HEIGHT);
+    accum_t *frame = accum_create(FLY_WIDTH, FLY_HEIGHT);
+    double *rgb = malloc((size_t)pixels * 3 * sizeof(double));
+    if (!scene || !reference || !frame || !rgb) {
+        fprintf(stderr, "Error: could not set up the temporal benchmark\n");
+        scene_destroy(scene);
+        accum_destroy(reference);
+        accum_destroy(frame);
+        free(rgb);
+        return -1;
+    }
+    render_settings_t settings = {.width = FLY_WIDTH, .height = FLY_HEIGHT,
+                                  .samples_per_pixel = FLY_SPP, .max_depth = 50,
+                                  .seed = SCENE_DEFAULT_SEED};
+    render_rect_t full = {0, 0, FLY_WIDTH, FLY_HEIGHT};
+    camera_t last = fly_camera(scene, FLY_FRAMES - 1);
+    render_region(scene, &last, &settings, full, 1 << 20, (1 << 20) + FLY_REFERENCE_SPP,
+                  reference);
+
+    printf("== temporal: showcase %dx%d, %d frames turning %.1f deg, %d spp ==\n", FLY_WIDTH,
+           FLY_HEIGHT, FLY_FRAMES, FLY_DEGREES, FLY_SPP);
+    printf("%-12s %9s %9s %9s %9s\n", "frames", "seconds", "spp", "reused", "rmse");
+    double start = now_seconds();
+    for (int f = 0; f < FLY_FRAMES; f++) {
+        camera_t camera = fly_camera(scene, f);
+        accum_clear(frame);
+        render_region(scene, &camera, &settings, full, f * FLY_SPP, (f + 1) * FLY_SPP, frame);
+    }
+    double seconds = now_seconds() - start;
+    for (int i = 0; i < pixels; i++) {
+        vec3_t mean = accum_pixel_mean(&frame->pixels[i]);
+        for (int c = 0; c < 3; c++) rgb[3 * i + c] = mean.e[c];
+    }
+    printf("%-12s %9.2f %9.1f %8.0f%% %9.4f\n", "from scratch", seconds, (double)FLY_SPP, 0.0,
+           rgb_rmse(rgb, reference));
+
+    for (int k = 0; k < 3; k++) {
+        temporal_t *temporal = temporal_create(FLY_WIDTH, FLY_HEIGHT);
+        temporal_options_t options = {.fresh_spp = fresh[k], .max_history = 4 * FLY_SPP};
+        temporal_stats_t stats;
+        long samples = 0, reused = 0;
+        start = now_seconds();
+        for (int f = 0; f < FLY_FRAMES && temporal; f++) {
+            camera_t camera = fly_camera(scene, f);
+            temporal_render(temporal, scene, &camera, &settings, &options, rgb, &stats);
+            samples += stats.samples;
+            reused += stats.reused;
+        }
+        seconds = now_seconds() - start;
+        temporal_destroy(temporal);
+        char name[32];
+        snprintf(name, sizeof(name), "reuse %d spp", fresh[k]);
+        printf("%-12s %9.2f %9.1f %8.0f%% %9.4f\n", name, seconds,
+               (double)samples / ((double)pixels * FLY_FRAMES),
+               100.0 * reused / ((double)pixels * FLY_FRAMES), rgb_rmse(rgb, reference));
+    }
+    printf("\n");
+    free(rgb);
+    accum_destroy(frame);
+    accum_destroy(reference);
+    scene_destroy(scene);
+    return 0;
+}
+
+#define ENV_WIDTH 160
+#define ENV_HEIGHT 90
+#define ENV_SPP 16
+#define ENV_REFERENCE_SPP 512
+#define ENV_MAP_WIDTH 512
+#define ENV_MAP_HEIGHT 256
+
+/* Luminance RMS error after Reinhard tone mapping, L / (1 + L), so that a
+ * few pixels seeing the sun in a mirror do not drown the rest */
+static double tonemapped_rmse(const accum_t *a, const accum_t *b) {
+    double error = 0.0;
+    int pixels = a->width * a->height;
+    for (int i = 0; i < pixels; i++) {
+        vec3_t p = accum_pixel_mean(&a->pixels[i]);
+        vec3_t q = accum_pixel_mean(&b->pixels[i]);
+        double lp = 0.2126 * p.e[0] + 0.7152 * p.e[1] + 0.0722 * p.e[2];
+        double lq = 0.2126 * q.e[0] + 0.7152 * q.e[1] + 0.0722 * q.e[2];
+        double d = lp / (1.0 + lp) - lq / (1.0 + lq);
+        error += d * d;
+    }
+    return sqrt(error / pixels);
+}
+
+/* A clear sky map: a bright sun of about one degree 35 degrees up, a blue
+ * gradient above the horizon and dim ground below it */
+static envmap_t *sun_sky_map(void) {
+    float *rgb = malloc((size_t)ENV_MAP_WIDTH * ENV_MAP_HEIGHT * 3 * sizeof(float));
+    if (!rgb) return NULL;
+    double sun_theta = (90.0 - 35.0) * PI / 180.0, sun_phi = -0.6;
+    vec3_t sun = vec3(sin(sun_theta) * cos(sun_phi), cos(sun_theta),
+                      sin(sun_theta) * sin(sun_phi));
+    for (int y = 0; y < ENV_MAP_HEIGHT; y++) {
+        double theta = PI * (y + 0.5) / ENV_MAP_HEIGHT;
+        for (int x = 0; x < ENV_MAP_WIDTH; x++) {
+            double phi = 2.0 * PI * (x + 0.5) / ENV_MAP_WIDTH - PI;
+            vec3_t d = vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+            double haze = 1.0 - d.e[1];
+            vec3_t c = d.e[1] > 0.0 ? vec3(0.3 + 0.2 * haze, 0.45 + 0.15 * haze, 0.8)
+                                    : vec3(0.1, 0.09, 0.08);
+            if (vec3_dot(d, sun) > cos(PI / 180.0)) c = vec3(5000.0, 4600.0, 4000.0);
+            float *texel = &rgb[3 * ((size_t)y * ENV_MAP_WIDTH + x)];
+            for (int k = 0; k < 3; k++) texel[k] = (float)c.e[k];
+        }
+    }
+    envmap_t *env = envmap_create(ENV_MAP_WIDTH, ENV_MAP_HEIGHT, rgb);
+    free(rgb);
+    return env;
+}
+
+/* Samples [s0, s1) of every pixel traced as ray_color does: the
+ * environment is only found by bounces that happen to escape toward it */
+static void render_bounces_only(const scene_t *scene, const camera_t *camera,
+                                const render_settings_t *settings, int s0, int s1,
+                                accum_t *out) {
+    int width = settings->width, height = settings->height;
+    #pragma omp parallel for schedule(dynamic, 100)
+    for (int idx = 0; idx < width * height; idx++) {
+        int x = idx % width, y = idx / width;
+        vec3_t sum = vec3(0.0, 0.0, 0.0);
+        for (int s = s0; s < s1; s++) {
+            random_seed(sample_seed(settings->seed, (uint64_t)idx, s));
+            double u = (x + random_double()) / (width - 1);
+            double v = (height - 1 - y + random_double()) / (height - 1);
+            sum = vec3_add(sum, ray_color(camera_get_ray(camera, u, v), scene,
+                                          settings->max_depth));
+        }
+        /* Stored as a one-sample mean so accum_pixel_mean reads it back */
+        accum_pixel_t *p = &out->pixels[idx];
+        for (int c = 0; c < 3; c++) {
+            p->sum[c] = (uint64_t)(sum.e[c] / (s1 - s0) * (1 << ACCUM_FRACTION_BITS) + 0.5);
+        }
+        p->samples = 1;
+    }
+}
+
+/* The showcase scene lit by a sun-and-sky environment map: bounces alone
+ * against sampling the map at diffuse hits combined with the bounces by
+ * multiple importance sampling, at the same samples per pixel. Efficiency
+ * is 1 / (error^2 x time) relative to bounces alone. */
+static int bench_environment(bench_options_t *opts) {
+    (void)opts;
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    envmap_t *env = sun_sky_map();
+    accum_t *reference = accum_create(ENV_WIDTH, ENV_HEIGHT);
+    accum_t *image = accum_create(ENV_WIDTH, ENV_HEIGHT);
+    if (!scene || !env || !reference || !image) {
+        fprintf(stderr, "Error: could not set up the environment benchmark\n");
+        scene_destroy(scene);
+        envmap_destroy(env);
+        accum_destroy(reference);
+        accum_destroy(image);
+        return -1;
+    }
+    scene_set_environment(scene, env);
+    camera_t camera = scene_camera(scene, (double)ENV_WIDTH / ENV_HEIGHT);
+    render_settings_t settings = {.width = ENV_WIDTH, .height = ENV_HEIGHT,
+                                  .samples_per_pixel = ENV_SPP, .max_depth = 50,
+                                  .seed = SCENE_DEFAULT_SEED};
+    render_rect_t full = {0, 0, ENV_WIDTH, ENV_HEIGHT};
+    render_region(scene, &camera, &settings, full, 1 << 20, (1 << 20) + ENV_REFERENCE_SPP,
+                  reference);
+
+    double start = now_seconds();
+    render_bounces_only(scene, &camera, &settings, 0, ENV_SPP, image);
+    double plain_time = now_seconds() - start;
+    double plain_error = luminance_rmse(image, reference, full);
+    double plain_mapped = tonemapped_rmse(image, reference);
+    accum_clear(image);
+    start = now_seconds();
+    render_region(scene, &camera, &settings, full, 0, ENV_SPP, image);
+    double mis_time = now_seconds() - start;
+    double mis_error = luminance_rmse(image, reference, full);
+    double mis_mapped = tonemapped_rmse(image, reference);
+
+    printf("== environment: showcase %dx%d under a %dx%d sun and sky map, %d spp ==\n",
+           ENV_WIDTH, ENV_HEIGHT, ENV_MAP_WIDTH, ENV_MAP_HEIGHT, ENV_SPP);
+    printf("%-14s %9s %9s %11s %13s %11s\n", "lighting", "seconds", "rmse", "efficiency",
+           "mapped rmse", "efficiency");
+    printf("%-14s %9.2f %9.4f %11.2f %13.4f %11.2f\n", "bounces only", plain_time, plain_error,
+           1.0, plain_mapped, 1.0);
+    double cost = plain_time / mis_time;
+    printf("%-14s %9.2f %9.4f %11.2f %13.4f %11.2f\n\n", "map + MIS", mis_time, mis_error,
+           plain_error * plain_error / (mis_error * mis_error) * cost, mis_mapped,
+           plain_mapped * plain_mapped / (mis_mapped * mis_mapped) * cost);
+    accum_destroy(reference);
+    accum_destroy(image);
+    scene_destroy(scene);
+    return 0;
+}
+
+#define GRID_RAYS 1000000
+#define GRID_BUILDS 3
+
+/* A showcase-like field: ground, a jittered n x n lattice of 0.2-radius
+ * spheres one unit apart, and three large spheres in the middle */
+static scene_t *make_field(int n) {
+    scene_t *scene = scene_create();
+    const material_t *ground =
+        scene ? scene_add_material(scene, lambertian_create(vec3(0.5, 0.5, 0.5))) : NULL;
+    const material_t *small =
+        scene ? scene_add_material(scene, lambertian_create(vec3(0.4, 0.3, 0.2))) : NULL;
+    if (!ground || !small) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    hittable_list_add(scene->world,
+                      sphere_to_hittable(sphere_create(vec3(0, -1000, 0), 1000, ground)));
+    random_seed(11);
+    for (int a = 0; a < n; a++) {
+        for (int b = 0; b < n; b++) {
+            vec3_t center = vec3(a - n / 2 + 0.9 * random_double(), 0.2,
+                                 b - n / 2 + 0.9 * random_double());
+            hittable_list_add(scene->world, sphere_to_hittable(sphere_create(center, 0.2, small)));
+        }
+    }
+    for (int k = -1; k <= 1; k++) {
+        hittable_list_add(scene->world,
+                          sphere_to_hittable(sphere_create(vec3(4.0 * k, 1, 0), 1.0, small)));
+    }
+    if (scene_finalize(scene) != 0) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    return scene;
+}
+
+/* Seconds to trace rays through the scene's structure, counting hits */
+static double trace_rays(const scene_t *scene, const ray_t *rays, int count, long *hits) {
+    long found = 0;
+    double start = now_seconds();
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(+ : found)
+    for (int i = 0; i < count; i++) {
+        hit_record_t rec;
+        found += scene_hit(scene, rays[i], 0.001, INFINITY, &rec);
+    }
+    *hits = found;
+    return now_seconds() - start;
+}
+
+/* Uniform grid against BVH over the showcase and larger jittered sphere
+ * fields: build time (best of GRID_BUILDS) and closest-hit rays per second
+ * for camera-like rays from above the field and bounce-like rays leaving
+ * random points just over it */
+static int bench_grid(bench_options_t *opts) {
+    (void)opts;
+    static const int sides[] = {0, 100, 316, 1000}; /* 0: the showcase scene */
+    ray_t *rays = malloc(GRID_RAYS * sizeof(ray_t));
+    if (!rays) return -1;
+    printf("== grid: %d rays, half from above the field, half bounces off it ==\n",
+           GRID_RAYS);
+    printf("%-10s %9s %6s %10s %10s %12s\n", "scene", "objects", "accel", "build ms",
+           "Mrays/s", "hit rays");
+    int status = 0;
+    for (size_t k = 0; k < sizeof(sides) / sizeof(sides[0]) && status == 0; k++) {
+        int n = sides[k];
+        scene_t *scene = n ? make_field(n) : scene_create_random(SCENE_DEFAULT_SEED);
+        if (!scene) {
+            status = -1;
+            break;
+        }
+        double half = n ? n / 2.0 : 11.0;
+        random_seed(3);
+        for (int i = 0; i < GRID_RAYS; i++) {
+            vec3_t origin = vec3(random_double_range(-half, half), 0.0,
+                                 random_double_range(-half, half));
+            vec3_t dir = random_unit_vector();
+            if (i % 2 == 0) {
+                origin.e[1] = 0.2 * half + 2.0;
+                dir.e[1] = -fabs(dir.e[1]) - 0.5;
+            } else {
+                origin.e[1] = random_double_range(0.01, 0.6);
+                dir.e[1] = fabs(dir.e[1]);
+            }
+            rays[i] = ray_timed(origin, dir, 0.0);
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), n ? "field %d" : "showcase", n);
+        for (int accel = SCENE_ACCEL_BVH; accel <= SCENE_ACCEL_GRID; accel++) {
+            double build = INFINITY;
+            for (int b = 0; b < GRID_BUILDS; b++) {
+                double start = now_seconds();
+                if (scene_set_accelerator(scene, (scene_accel_t)accel) != 0) status = -1;
+                build = fmin(build, now_seconds() - start);
+            }
+            long hits = 0;
+            double seconds = status == 0 ? trace_rays(scene, rays, GRID_RAYS, &hits) : 0.0;
+            printf("%-10s %9d %6s %10.2f %10.2f %12ld\n", name, scene->world->count,
+                   accel == SCENE_ACCEL_GRID ? "grid" : "bvh", build * 1e3,
+                   GRID_RAYS / seconds * 1e-6, hits);
+        }
+        scene_destroy(scene);
+    }
+    printf("\n");
+    free(rays);
+    return status;
+}
+
+#define CONVERGENCE_WIDTH 64
+#define CONVERGENCE_HEIGHT 48
+#define CONVERGENCE_MAX_SPP 128
+#define CONVERGENCE_TARGET 0.01    /* relMSE whose time to reach is reported */
+#define CONVERGENCE_EPSILON 0.01   /* keeps relMSE finite on black reference pixels */
+#define CONVERGENCE_REFERENCE_SEED 99
+#define CONVERGENCE_POINTS 8       /* spp 1, 2, 4, ..., CONVERGENCE_MAX_SPP */
+
+/* A scene of the convergence suite */
+typedef struct {
+    const char *name;
+    int reference_spp;
+} convergence_scene_t;
+
+/* Point of an error-versus-time curve */
+typedef struct {
+    int spp;
+    double seconds;
+    double rmse;
+    double relmse;
+} convergence_point_t;
+
+/* Luminance RMSE and relMSE (squared error over squared reference, plus
+ * CONVERGENCE_EPSILON) of an image against linear RGB reference triples */
+static void reference_error(const accum_t *image, const float *reference, double *rmse,
+                            double *relmse) {
+    int pixels = image->width * image->height;
+    double squared = 0.0, relative = 0.0;
+    for (int i = 0; i < pixels; i++) {
+        vec3_t p = accum_pixel_mean(&image->pixels[i]);
+        const float *q = &reference[3 * i];
+        double lum = 0.2126 * q[0] + 0.7152 * q[1] + 0.0722 * q[2];
+        double d = 0.2126 * (p.e[0] - q[0]) + 0.7152 * (p.e[1] - q[1]) +
+                   0.0722 * (p.e[2] - q[2]);
+        squared += d * d;
+        relative += d * d / (lum * lum + CONVERGENCE_EPSILON);
+    }
+    *rmse = sqrt(squared / pixels);
+    *relmse = relative / pixels;
+}
+
+/* Reference image of a suite scene: read from the data directory, or
+ * rendered and stored there the first time. Returns NULL on failure. */
+static float *load_reference(const char *data, const convergence_scene_t *entry,
+                             const scene_t *scene, const camera_t *camera) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s_%dx%d_%dspp.pfm", data, entry->name, CONVERGENCE_WIDTH,
+             CONVERGENCE_HEIGHT, entry->reference_spp);
+    int width, height;
+    float *rgb = image_read_pfm(path, &width, &height);
+    if (rgb && width == CONVERGENCE_WIDTH && height == CONVERGENCE_HEIGHT) return rgb;
+    free(rgb);
+
+    printf("rendering reference %s (%d spp, once)...\n", path, entry->reference_spp);
+    fflush(stdout);
+    int pixels = CONVERGENCE_WIDTH * CONVERGENCE_HEIGHT;
+    accum_t *accum = accum_create(CONVERGENCE_WIDTH, CONVERGENCE_HEIGHT);
+    rgb = malloc((size_t)pixels * 3 * sizeof(float));
+    if (!accum || !rgb) {
+        accum_destroy(accum);
+        free(rgb);
+        return NULL;
+    }
+    render_settings_t settings = {.width = CONVERGENCE_WIDTH, .height = CONVERGENCE_HEIGHT,
+                                  .samples_per_pixel = entry->reference_spp, .max_depth = 50,
+                                  .seed = CONVERGENCE_REFERENCE_SEED};
+    render_region(scene, camera, &settings,
+                  (render_rect_t){0, 0, CONVERGENCE_WIDTH, CONVERGENCE_HEIGHT}, 0,
+                  entry->reference_spp, accum);
+    for (int i = 0; i < pixels; i++) {
+        vec3_t c = accum_pixel_mean(&accum->pixels[i]);
+        for (int k = 0; k < 3; k++) rgb[3 * i + k] = (float)c.e[k];
+    }
+    accum_destroy(accum);
+    mkdir(data, 0755);
+    if (image_write_pfm(path, rgb, CONVERGENCE_WIDTH, CONVERGENCE_HEIGHT) != 0) {
+        fprintf(stderr, "Warning: could not store %s\n", path);
+    }
+    return rgb;
+}
+
+/* Seconds a curve first reaches target error, interpolated log-log between
+ * the points around it; negative if it never does */
+static double time_to_target(const convergence_point_t *curve, int count, double target) {
+    if (curve[0].relmse <= target) return curve[0].seconds;
+    for (int i = 1; i < count; i++) {
+        if (curve[i].relmse > target) continue;
+        double a = log(curve[i - 1].relmse / target) / log(curve[i - 1].relmse / curve[i].relmse);
+        return exp(log(curve[i - 1].seconds) +
+                   a * (log(curve[i].seconds) - log(curve[i - 1].seconds)));
+    }
+    return -1.0;
+}
+
+/* Error against stored high-sample references as samples accumulate, for
+ * scenes that stress direct light (showcase), indirect light through a
+ * skylight (room) and caustics (glass). Each curve adds samples in doubling
+ * ranges, so its times are those of renders at 1, 2, 4, ... spp. The time to
+ * reach CONVERGENCE_TARGET relMSE summarises quality per second in one
+ * number per scene; lower is better. Reference noise is included in the
+ * error, at 1/8 or less of the final point's. Everything is also written as
+ * JSON to convergence.json in the data directory. */
+static int bench_convergence(bench_options_t *opts) {
+    static const convergence_scene_t suite[] = {
+        {"random", 2048},
+        {"room", 1024},
+        {"glass", 2048},
+    };
+    const int count = (int)(sizeof(suite) / sizeof(suite[0]));
+    char json_path[4096];
+    snprintf(json_path, sizeof(json_path), "%s/convergence.json", opts->data);
+    printf("== convergence: %dx%d, relMSE target %g ==\n", CONVERGENCE_WIDTH,
+           CONVERGENCE_HEIGHT, CONVERGENCE_TARGET);
+
+    convergence_point_t curves[3][CONVERGENCE_POINTS];
+    double targets[3];
+    accum_t *image = accum_create(CONVERGENCE_WIDTH, CONVERGENCE_HEIGHT);
+    int status = image ? 0 : -1;
+    for (int k = 0; k < count && status == 0; k++) {
+        scene_t *scene = scene_create_named(suite[k].name, 0);
+        camera_t camera = scene_camera(scene, (double)CONVERGENCE_WIDTH / CONVERGENCE_HEIGHT);
+        float *reference = scene ? load_reference(opts->data, &suite[k], scene, &camera) : NULL;
+        if (!reference) {
+            fprintf(stderr, "Error: no reference for %s\n", suite[k].name);
+            scene_destroy(scene);
+            status = -1;
+            break;
+        }
+
+        render_settings_t settings = {.width = CONVERGENCE_WIDTH, .height = CONVERGENCE_HEIGHT,
+                                      .samples_per_pixel = CONVERGENCE_MAX_SPP,
+                                      .max_depth = 50, .seed = SCENE_DEFAULT_SEED};
+        render_rect_t full = {0, 0, CONVERGENCE_WIDTH, CONVERGENCE_HEIGHT};
+        accum_clear(image);
+        double seconds = 0.0;
+        for (int i = 0, s0 = 0; i < CONVERGENCE_POINTS; i++) {
+            int s1 = 1 << i;
+            double start = now_seconds();
+            render_region(scene, &camera, &settings, full, s0, s1, image);
+            seconds += now_seconds() - start;
+            convergence_point_t *point = &curves[k][i];
+            point->spp = s1;
+            point->seconds = seconds;
+            reference_error(image, reference, &point->rmse, &point->relmse);
+            s0 = s1;
+        }
+        targets[k] = time_to_target(curves[k], CONVERGENCE_POINTS, CONVERGENCE_TARGET);
+
+        printf("%-8s %5s %9s %9s %9s\n", suite[k].name, "spp", "seconds", "rmse", "relmse");
+        for (int i = 0; i < CONVERGENCE_POINTS; i++) {
+            printf("%-8s %5d %9.3f %9.4f %9.5f\n", "", curves[k][i].spp, curves[k][i].seconds,
+                   curves[k][i].rmse, curves[k][i].relmse);
+        }
+        if (targets[k] >= 0.0) {
+            printf("%-8s time to target: %.3f s\n", "", targets[k]);
+        } else {
+            printf("%-8s time to target: not reached by %d spp\n", "", CONVERGENCE_MAX_SPP);
+        }
+        free(reference);
+        scene_destroy(scene);
+    }
+    accum_destroy(image);
+
+    FILE *json = status == 0 ? fopen(json_path, "w") : NULL;
+    if (json) {
+        fprintf(json, "{\n  \"width\": %d,\n  \"height\": %d,\n  \"target_relmse\": %g,\n"
+                      "  \"scenes\": [\n", CONVERGENCE_WIDTH, CONVERGENCE_HEIGHT,
+                CONVERGENCE_TARGET);
+        for (int k = 0; k < count; k++) {
+            fprintf(json, "    {\n      \"name\": \"%s\",\n      \"reference_spp\": %d,\n"
+                          "      \"curve\": [\n", suite[k].name, suite[k].reference_spp);
+            for (int i = 0; i < CONVERGENCE_POINTS; i++) {
+                const convergence_point_t *p = &curves[k][i];
+                fprintf(json, "        {\"spp\": %d, \"seconds\": %.6f, \"rmse\": %.6g, "
+                              "\"relmse\": %.6g}%s\n", p->spp, p->seconds, p->rmse,
+                        p->relmse, i + 1 < CONVERGENCE_POINTS ? "," : "");
+            }
+            if (targets[k] >= 0.0) {
+                fprintf(json, "      ],\n      \"time_to_target\": %.6f\n", targets[k]);
+            } else {
+                fprintf(json, "      ],\n      \"time_to_target\": null\n");
+            }
+            fprintf(json, "    }%s\n", k + 1 < count ? "," : "");
+        }
+        fprintf(json, "  ]\n}\n");
+        if (fclose(json) == 0) printf("wrote %s\n", json_path);
+    } else if (status == 0) {
+        fprintf(stderr, "Warning: could not write %s\n", json_path);
+    }
+    printf("\n");
+    return status;
+}
+
+#define LIGHTS_WIDTH 64
+#define LIGHTS_HEIGHT 48
+#define LIGHTS_SPP 4
+#define LIGHTS_RUNS 16
+#define LIGHTS_PROBES 16 /* rays per pixel side when masking */
+
+/* Whether pixel (x, y) of a pinhole camera sees anything but diffuse
+ * surfaces (a light, or one reflected in metal or glass) through a grid of
+ * rays fine enough to catch the smallest lights */
+static int pixel_not_diffuse(const scene_t *scene, const camera_t *camera, int x, int y) {
+    int j = LIGHTS_HEIGHT - 1 - y;
+    for (int a = 0; a <= LIGHTS_PROBES; a++) {
+        for (int b = 0; b <= LIGHTS_PROBES; b++) {
+            ray_t r = camera_get_ray(camera, (x + (double)a / LIGHTS_PROBES) / (LIGHTS_WIDTH - 1),
+                                     (j + (double)b / LIGHTS_PROBES) / (LIGHTS_HEIGHT - 1));
+            hit_record_t rec = {0};
+            if (scene_hit(scene, r, 0.001, INFINITY, &rec) && !rec.material->diffuse) return 1;
+        }
+    }
+    return 0;
+}
+
+/* Noise of a frame rendered at spp: the per-pixel variance over runs seeds
+ * relative to the squared mean, summed over the pixels not masked out */
+static double frame_noise(const scene_t *scene, const camera_t *camera,
+                          const unsigned char *masked, int runs, int spp, double *seconds) {
+    size_t pixels = (size_t)LIGHTS_WIDTH * LIGHTS_HEIGHT;
+    double *sum = calloc(pixels, sizeof(double));
+    double *squares = calloc(pixels, sizeof(double));
+    accum_t *image = accum_create(LIGHTS_WIDTH, LIGHTS_HEIGHT);
+    *seconds = 0.0;
+    if (!sum || !squares || !image) {
+        free(sum);
+        free(squares);
+        accum_destroy(image);
+        return -1.0;
+    }
+    render_settings_t settings = {.width = LIGHTS_WIDTH, .height = LIGHTS_HEIGHT,
+                                  .samples_per_pixel = spp, .max_depth = 50};
+    render_rect_t full = {0, 0, LIGHTS_WIDTH, LIGHTS_HEIGHT};
+    double start = now_seconds();
+    for (int k = 0; k < runs; k++) {
+        settings.seed = SCENE_DEFAULT_SEED + k;
+        accum_clear(image);
+        render_region(scene, camera, &settings, full, 0, spp, image);
+        for (size_t i = 0; i < pixels; i++) {
+            vec3_t c = accum_pixel_mean(&image->pixels[i]);
+            double y = 0.2126 * c.e[0] + 0.7152 * c.e[1] + 0.0722 * c.e[2];
+            sum[i] += y;
+            squares[i] += y * y;
+        }
+    }
+    *seconds = (now_seconds() - start) / runs;
+    double variance = 0.0, power = 0.0;
+    for (size_t i = 0; i < pixels; i++) {
+        if (masked[i]) continue;
+        double mean = sum[i] / runs;
+        variance += fmax(0.0, squares[i] / runs - mean * mean) * runs / (runs - 1);
+        power += mean * mean;
+    }
+    free(sum);
+    free(squares);
+    accum_destroy(image);
+    return power > 0.0 ? variance / power : 0.0;
+}
+
+/* Many lights: the night showcase with 10 to 10,000 emissive spheres sharing
+ * the same total area and power. Sampling the light tree at diffuse hits
+ * should keep the noise about flat as the lights multiply; the same frames
+ * with paths that find the lights only by hitting them show what the tree
+ * buys. Noise is the relative variance of a LIGHTS_SPP frame over
+ * LIGHTS_RUNS seeds, over the pixels that see diffuse surfaces only
+ * (anti-aliasing the lights themselves is noisy whatever picks them). Light
+ * reaching those surfaces through the glass and metal balls is not sampled,
+ * which shows with the few large lights. */
+static int bench_lights(bench_options_t *opts) {
+    (void)opts;
+    static const int counts[] = {10, 100, 1000, 10000};
+    size_t pixels = (size_t)LIGHTS_WIDTH * LIGHTS_HEIGHT;
+    unsigned char *masked = malloc(pixels);
+    if (!masked) return -1;
+    printf("== lights: night showcase %dx%d, %d spp, noise over %d seeds ==\n", LIGHTS_WIDTH,
+           LIGHTS_HEIGHT, LIGHTS_SPP, LIGHTS_RUNS);
+    printf("%8s %10s %12s %10s %12s %10s %11s\n", "lights", "tree ms", "tree noise",
+           "ms/frame", "hits noise", "ms/frame", "efficiency");
+    int status = 0;
+    for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]) && status == 0; k++) {
+        scene_t *scene = scene_create_lights(SCENE_DEFAULT_SEED, counts[k]);
+        if (!scene) {
+            status = -1;
+            break;
+        }
+        double start = now_seconds();
+        light_tree_t *tree = light_tree_create(scene->world->objects, scene->world->count);
+        double build = now_seconds() - start;
+        light_tree_destroy(tree);
+
+        scene->aperture = 0.0;
+        camera_t camera = scene_camera(scene, (double)LIGHTS_WIDTH / LIGHTS_HEIGHT);
+        for (size_t i = 0; i < pixels; i++) {
+            masked[i] = (unsigned char)pixel_not_diffuse(scene, &camera,
+                                                         (int)(i % LIGHTS_WIDTH),
+                                                         (int)(i / LIGHTS_WIDTH));
+        }
+        double tree_time, hits_time;
+        double tree_noise =
+            frame_noise(scene, &camera, masked, LIGHTS_RUNS, LIGHTS_SPP, &tree_time);
+        light_tree_t *lights = scene->lights;
+        scene->lights = NULL;
+        double hits_noise =
+            frame_noise(scene, &camera, masked, LIGHTS_RUNS, LIGHTS_SPP, &hits_time);
+        scene->lights = lights;
+        scene_destroy(scene);
+        if (tree_noise < 0.0 || hits_noise < 0.0) {
+            status = -1;
+            break;
+        }
+        printf("%8d %10.2f %12.4f %10.1f %12.4f %10.1f %11.2f\n", counts[k], build * 1e3,
+               tree_noise, tree_time * 1e3, hits_noise, hits_time * 1e3,
+               hits_noise * hits_time / (tree_noise * tree_time));
+    }
+    printf("\n");
+    free(masked);
+    return status;
+}
+
+#define QUERY_RAYS 1000000
+#define QUERY_REPEATS 3
+
+/* Best of QUERY_REPEATS timings of closest-hit (normals: with them),
+ * occlusion or, for the renderer's loop (mode 3), scene_hit over ray_t
+ * structures, in million queries per second */
+static double time_queries(const scene_t *scene, const vibe_rays_t *rays, vibe_hits_t *hits,
+                           unsigned char *occluded, const ray_t *aos, int mode) {
+    double best = INFINITY;
+    for (int k = 0; k < QUERY_REPEATS; k++) {
+        double start = now_seconds();
+        long found;
+        if (mode == 0 || mode == 1) {
+            vibe_hits_t plain = {hits->t, hits->primitive, NULL, NULL, NULL};
+            query_closest(scene, NULL, rays, QUERY_RAYS, mode == 1 ? hits : &plain);
+        } else if (mode == 2) {
+            query_occluded(scene, NULL, rays, QUERY_RAYS, occluded);
+        } else {
+            trace_rays(scene, aos, QUERY_RAYS, &found);
+        }
+        best = fmin(best, now_seconds() - start);
+    }
+    return QUERY_RAYS / best * 1e-6;
+}
+
+/* Bulk ray queries over the showcase and sphere fields: closest hits with
+ * and without normals and occlusion of unbounded rays and of short segments
+ * toward points above the field (shadow-ray-like), against the renderer's
+ * own per-ray scene_hit loop over the same rays */
+static int bench_queries(bench_options_t *opts) {
+    (void)opts;
+    static const int sides[] = {0, 316, 1000}; /* 0: the showcase scene */
+    double *soa = malloc((size_t)QUERY_RAYS * 8 * sizeof(double));
+    double *normals = malloc((size_t)QUERY_RAYS * 3 * sizeof(double));
+    double *t = malloc(QUERY_RAYS * sizeof(double));
+    int *primitive = malloc(QUERY_RAYS * sizeof(int));
+    unsigned char *occluded = malloc(QUERY_RAYS);
+    ray_t *aos = malloc(QUERY_RAYS * sizeof(ray_t));
+    if (!soa || !normals || !t || !primitive || !occluded || !aos) {
+        free(soa);
+        free(normals);
+        free(t);
+        free(primitive);
+        free(occluded);
+        free(aos);
+        return -1;
+    }
+    double *o[3] = {soa, soa + QUERY_RAYS, soa + 2 * QUERY_RAYS};
+    double *d[3] = {soa + 3 * QUERY_RAYS, soa + 4 * QUERY_RAYS, soa + 5 * QUERY_RAYS};
+    double *t_min = soa + 6 * QUERY_RAYS, *t_max = soa + 7 * QUERY_RAYS;
+    vibe_rays_t rays = {o[0], o[1], o[2], d[0], d[1], d[2], t_min, NULL, 0.0};
+    vibe_hits_t hits = {t, primitive, normals, normals + QUERY_RAYS, normals + 2 * QUERY_RAYS};
+
+    printf("== queries: %d rays per batch, million queries per second ==\n", QUERY_RAYS);
+    printf("%-10s %9s %9s %9s %9s %9s %9s %9s\n", "scene", "objects", "closest", "+normals",
+           "occluded", "segments", "blocked", "scene_hit");
+    int status = 0;
+    for (size_t k = 0; k < sizeof(sides) / sizeof(sides[0]) && status == 0; k++) {
+        int n = sides[k];
+        scene_t *scene = n ? make_field(n) : scene_create_random(SCENE_DEFAULT_SEED);
+        if (!scene) {
+            status = -1;
+            break;
+        }
+        /* Rays as in the grid section: half from above, half bounces */
+        double half = n ? n / 2.0 : 11.0;
+        random_seed(3);
+        for (int i = 0; i < QUERY_RAYS; i++) {
+            vec3_t origin = vec3(random_double_range(-half, half), 0.0,
+                                 random_double_range(-half, half));
+            vec3_t dir = random_unit_vector();
+            if (i % 2 == 0) {
+                origin.e[1] = 0.2 * half + 2.0;
+                dir.e[1] = -fabs(dir.e[1]) - 0.5;
+            } else {
+                origin.e[1] = random_double_range(0.01, 0.6);
+                dir.e[1] = fabs(dir.e[1]);
+            }
+            for (int a = 0; a < 3; a++) {
+                o[a][i] = origin.e[a];
+                d[a][i] = dir.e[a];
+            }
+            t_min[i] = 0.001;
+            aos[i] = ray_timed(origin, dir, 0.0);
+        }
+        double closest = time_queries(scene, &rays, &hits, occluded, aos, 0);
+        double with_normals = time_queries(scene, &rays, &hits, occluded, aos, 1);
+        double unbounded = time_queries(scene, &rays, &hits, occluded, aos, 2);
+        double loop = time_queries(scene, &rays, &hits, occluded, aos, 3);
+
+        /* Segments from just over the field to points 3 units up, a few
+         * units away, as a shadow ray would run toward a light */
+        for (int i = 0; i < QUERY_RAYS; i++) {
+            o[1][i] = random_double_range(0.01, 0.6);
+            d[0][i] = random_double_range(-4.0, 4.0);
+            d[1][i] = 3.0 - o[1][i];
+            d[2][i] = random_double_range(-4.0, 4.0);
+            t_max[i] = 1.0;
+        }
+        rays.t_max = t_max;
+        double segments = time_queries(scene, &rays, &hits, occluded, aos, 2);
+        long blocked = 0;
+        for (int i = 0; i < QUERY_RAYS; i++) blocked += occluded[i];
+        rays.t_max = NULL;
+
+        char name[32];
+        snprintf(name, sizeof(name), n ? "field %d" : "showcase", n);
+        printf("%-10s %9d %9.2f %9.2f %9.2f %9.2f %8.1f%% %9.2f\n", name, scene->world->count,
+               closest, with_normals, unbounded, segments, 100.0 * blocked / QUERY_RAYS, loop);
+        scene_destroy(scene);
+    }
+    printf("\n");
+    free(soa);
+    free(normals);
+    free(t);
+    free(primitive);
+    free(occluded);
+    free(aos);
+    return status;
+}
+
+#define ARENA_BUILDS 3
+
+/* The field scene as built before arenas: the same spheres and materials,
+ * each malloc'ed on its own and added one by one on one thread */
+static scene_t *heap_field(unsigned int seed, int side) {
+    scene_t *scene = scene_create();
+    const material_t *ground =
+        scene ? scene_add_material(scene, lambertian_create(vec3(0.5, 0.5, 0.5))) : NULL;
+    if (!ground) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    hittable_list_add(scene->world,
+                      sphere_to_hittable(sphere_create(vec3(0, -1000, 0), 1000, ground)));
+    for (int a = 0; a < side; a++) {
+        random_seed(sample_seed(seed, (uint64_t)a, 0));
+        for (int b = 0; b < side; b++) {
+            vec3_t center = vec3(a - side / 2 + 0.9 * random_double(), 0.2,
+                                 b - side / 2 + 0.9 * random_double());
+            vec3_t albedo = vec3(random_double() * random_double(),
+                                 random_double() * random_double(),
+                                 random_double() * random_double());
+            const material_t *mat = scene_add_material(scene, lambertian_create(albedo));
+            hittable_list_add(scene->world, sphere_to_hittable(sphere_create(center, 0.2, mat)));
+        }
+    }
+    const material_t *big[] = {
+        scene_add_material(scene, lambertian_create(vec3(0.4, 0.2, 0.1))),
+        scene_add_material(scene, dielectric_create(1.5)),
+        scene_add_material(scene, metal_create(vec3(0.7, 0.6, 0.5), 0.0))};
+    for (int k = -1; k <= 1; k++) {
+        hittable_list_add(scene->world,
+                          sphere_to_hittable(sphere_create(vec3(4.0 * k, 1, 0), 1.0, big[k + 1])));
+    }
+    if (scene_finalize(scene) != 0) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    return scene;
+}
+
+/* Scene builds with a malloc per sphere and material against the arena
+ * builder of the field scene, on one thread and on all: build time with the
+ * BVH, the BVH's share of it (timed as a rebuild), and teardown, each the
+ * best of ARENA_BUILDS */
+static int bench_arena(bench_options_t *opts) {
+    (void)opts;
+    static const int sides[] = {316, 1000};
+    int threads = omp_get_max_threads();
+    printf("== arena: field scenes, one material per sphere ==\n");
+    printf("%-10s %9s %-12s %10s %10s %10s %12s\n", "scene", "objects", "builder", "build ms",
+           "bvh ms", "objects ms", "teardown ms");
+    int status = 0;
+    for (size_t k = 0; k < sizeof(sides) / sizeof(sides[0]) && status == 0; k++) {
+        int side = sides[k];
+        for (int builder = 0; builder < (threads > 1 ? 3 : 2) && status == 0; builder++) {
+            double build = INFINITY, bvh = INFINITY, teardown = INFINITY;
+            int objects = 0;
+            omp_set_num_threads(builder == 1 ? 1 : threads);
+            for (int b = 0; b < ARENA_BUILDS; b++) {
+                double start = now_seconds();
+                scene_t *scene = builder == 0 ? heap_field(SCENE_DEFAULT_SEED, side)
+                                              : scene_create_field(SCENE_DEFAULT_SEED, side);
+                build = fmin(build, now_seconds() - start);
+                if (!scene) {
+                    status = -1;
+                    break;
+                }
+                objects = scene->world->count;
+                start = now_seconds();
+                if (scene_set_accelerator(scene, SCENE_ACCEL_BVH) != 0) status = -1;
+                bvh = fmin(bvh, now_seconds() - start);
+                start = now_seconds();
+                scene_destroy(scene);
+                teardown = fmin(teardown, now_seconds() - start);
+            }
+            char name[32], label[32];
+            snprintf(name, sizeof(name), "field %d", side);
+            snprintf(label, sizeof(label), builder == 0 ? "heap" : "arena x%d",
+                     builder == 1 ? 1 : threads);
+            printf("%-10s %9d %-12s %10.2f %10.2f %10.2f %12.2f\n", name, objects, label,
+                   build * 1e3, bvh * 1e3, (build - bvh) * 1e3, teardown * 1e3);
+        }
+    }
+    omp_set_num_threads(threads);
+    printf("\n");
+    return status;
+}
+
+typedef struct {
+    const char *name;
+    int (*run)(bench_options_t *opts);
+} bench_section_t;
+
+static const bench_section_t sections[] = {
+    {"sort", bench_sort},
+    {"affinity", bench_affinity},
+    {"kernels", bench_kernels},
+    {"daemon", bench_daemon},
+    {"guiding", bench_guiding},
+    {"caustics", bench_caustics},
+    {"edit", bench_edit},
+    {"compiled", bench_compiled},
+    {"temporal", bench_temporal},
+    {"environment", bench_environment},
+    {"convergence", bench_convergence},
+    {"grid", bench_grid},
+    {"lights", bench_lights},
+    {"queries", bench_queries},
+    {"arena", bench_arena},
+};
+
+#define SECTION_COUNT (int)(sizeof(sections) / sizeof(sections[0]))
+
+/* Print command line help */
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--obj PATH] [--data DIR] [section...]\nSections:", prog);
+    for (int i = 0; i < SECTION_COUNT; i++) fprintf(stderr, " %s", sections[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv) {
+    bench_options_t opts = {.data = BENCH_DATA_DIR};
+    const char *selected[16];
+    int selected_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--obj") == 0 && i + 1 < argc) {
+            opts.obj = argv[++i];
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            opts.data = argv[++i];
+        } else if (argv[i][0] != '-' && selected_count < 16) {
+            selected[selected_count++] = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    for (int k = 0; k < selected_count; k++) {
+        int known = 0;
+        for (int i = 0; i < SECTION_COUNT; i++) known |= strcmp(selected[k], sections[i].name) == 0;
+        if (!known) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    /* Counters must exist before OpenMP starts its threads to follow them */
+    opts.have_counters = perf_counters_open(&opts.counters) == 0;
+
+    int status = 0;
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        int run = selected_count == 0;
+        for (int k = 0; k < selected_count; k++) run |= strcmp(selected[k], sections[i].name) == 0;
+        if (run && sections[i].run(&opts) != 0) status = 1;
+    }
+
+    perf_counters_close(&opts.counters);
+    return status;
+}
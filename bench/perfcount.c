@@ -0,0 +1,62 @@
+#define _GNU_SOURCE
+#include "perfcount.h"
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Open one hardware counter, disabled, inherited by new threads */
+static int open_counter(uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* Open the counters */
+int perf_counters_open(perf_counters_t *pc) {
+    pc->misses_fd = open_counter(PERF_COUNT_HW_CACHE_MISSES);
+    pc->references_fd = open_counter(PERF_COUNT_HW_CACHE_REFERENCES);
+    if (pc->misses_fd < 0 || pc->references_fd < 0) {
+        perf_counters_close(pc);
+        return -1;
+    }
+    return 0;
+}
+
+/* Reset and start counting */
+void perf_counters_start(perf_counters_t *pc) {
+    if (pc->misses_fd < 0) return;
+    ioctl(pc->misses_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(pc->references_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(pc->misses_fd, PERF_EVENT_IOC_ENABLE, 0);
+    ioctl(pc->references_fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+/* Stop counting and read the counts */
+void perf_counters_stop(perf_counters_t *pc, uint64_t *misses, uint64_t *references) {
+    *misses = 0;
+    *references = 0;
+    if (pc->misses_fd < 0) return;
+    ioctl(pc->misses_fd, PERF_EVENT_IOC_DISABLE, 0);
+    ioctl(pc->references_fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(pc->misses_fd, misses, sizeof(*misses)) != sizeof(*misses)) *misses = 0;
+    if (read(pc->references_fd, references, sizeof(*references)) != sizeof(*references)) {
+        *references = 0;
+    }
+}
+
+/* Close the counters */
+void perf_counters_close(perf_counters_t *pc) {
+    if (pc->misses_fd >= 0) close(pc->misses_fd);
+    if (pc->references_fd >= 0) close(pc->references_fd);
+    pc->misses_fd = -1;
+    pc->references_fd = -1;
+}
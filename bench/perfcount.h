@@ -0,0 +1,27 @@
+#ifndef PERFCOUNT_H
+#define PERFCOUNT_H
+
+#include <stdint.h>
+
+/* Hardware cache counters of this process and the threads it starts after the
+ * counters are opened (Linux perf events, user space only). Unavailable on
+ * kernels or virtual machines without a PMU; callers then fall back to a
+ * software estimate. */
+typedef struct {
+    int misses_fd;
+    int references_fd;
+} perf_counters_t;
+
+/* Open the counters; returns 0 if hardware counting is available */
+int perf_counters_open(perf_counters_t *pc);
+
+/* Reset and start counting */
+void perf_counters_start(perf_counters_t *pc);
+
+/* Stop counting and read cache misses and references */
+void perf_counters_stop(perf_counters_t *pc, uint64_t *misses, uint64_t *references);
+
+/* Close the counters */
+void perf_counters_close(perf_counters_t *pc);
+
+#endif /* PERFCOUNT_H */
@@ -0,0 +1,66 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include "vec3.h"
+#include <math.h>
+
+/* Axis-aligned bounding box */
+typedef struct {
+    vec3_t min;
+    vec3_t max;
+} aabb_t;
+
+/* Box containing nothing; the identity of aabb_union */
+static inline aabb_t aabb_empty(void) {
+    return (aabb_t){{{INFINITY, INFINITY, INFINITY}}, {{-INFINITY, -INFINITY, -INFINITY}}};
+}
+
+/* Smallest box containing both a and b */
+static inline aabb_t aabb_union(const aabb_t a, const aabb_t b) {
+    aabb_t out;
+    for (int i = 0; i < 3; i++) {
+        out.min.e[i] = a.min.e[i] < b.min.e[i] ? a.min.e[i] : b.min.e[i];
+        out.max.e[i] = a.max.e[i] > b.max.e[i] ? a.max.e[i] : b.max.e[i];
+    }
+    return out;
+}
+
+/* Grow a box to contain point p */
+static inline aabb_t aabb_extend(const aabb_t a, const vec3_t p) {
+    return aabb_union(a, (aabb_t){p, p});
+}
+
+/* Center of a box */
+static inline vec3_t aabb_centroid(const aabb_t a) {
+    return (vec3_t){{0.5 * (a.min.e[0] + a.max.e[0]), 0.5 * (a.min.e[1] + a.max.e[1]),
+                     0.5 * (a.min.e[2] + a.max.e[2])}};
+}
+
+/* Surface area (0 for empty boxes) */
+static inline double aabb_area(const aabb_t a) {
+    double dx = a.max.e[0] - a.min.e[0];
+    double dy = a.max.e[1] - a.min.e[1];
+    double dz = a.max.e[2] - a.min.e[2];
+    if (dx < 0.0 || dy < 0.0 || dz < 0.0) return 0.0;
+    return 2.0 * (dx * dy + dy * dz + dz * dx);
+}
+
+/* Slab test against a ray given its origin and per-axis inverse direction */
+static inline int aabb_hit(const aabb_t *box, const vec3_t origin, const vec3_t inv_dir,
+                           double t_min, double t_max) {
+    for (int a = 0; a < 3; a++) {
+        double t0 = (box->min.e[a] - origin.e[a]) * inv_dir.e[a];
+        double t1 = (box->max.e[a] - origin.e[a]) * inv_dir.e[a];
+        if (inv_dir.e[a] < 0.0) {
+            double tmp = t0;
+            t0 = t1;
+            t1 = tmp;
+        }
+        t_min = t0 > t_min ? t0 : t_min;
+        t_max = t1 < t_max ? t1 : t_max;
+        if (t_max < t_min) return 0;
+    }
+    return 1;
+}
+
+#endif /* AABB_H */
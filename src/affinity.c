@@ -0,0 +1,262 @@
+#define _GNU_SOURCE
+#include "affinity.h"
+#include <dirent.h>
+#include <omp.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define MPOL_DEFAULT 0
+#define MPOL_INTERLEAVE 3
+#define MAX_NODE_ID 1024
+
+/* Dense node of the calling thread, set when it is pinned */
+static __thread int thread_node = 0;
+
+/* Affinity mask the process started with, restored by AFFINITY_NONE */
+static cpu_set_t process_mask;
+static int have_process_mask = 0;
+
+/* Read one integer from a per-CPU sysfs file, or fallback */
+static int read_cpu_int(int cpu, const char *file, int fallback) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, file);
+    FILE *f = fopen(path, "r");
+    if (!f) return fallback;
+    int value;
+    if (fscanf(f, "%d", &value) != 1) value = fallback;
+    fclose(f);
+    return value;
+}
+
+/* OS NUMA node of a CPU: the nodeN entry in its sysfs directory (0 if none) */
+static int read_cpu_node(int cpu) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+    int node = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        int id;
+        char extra;
+        if (sscanf(entry->d_name, "node%d%c", &id, &extra) == 1) {
+            node = id;
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+/* Read the topology of the allowed CPUs */
+cpu_topology_t *topology_detect(void) {
+    cpu_set_t mask;
+    if (sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+        CPU_ZERO(&mask);
+        CPU_SET(0, &mask);
+    } else if (!have_process_mask) {
+        process_mask = mask;
+        have_process_mask = 1;
+    }
+
+    int count = CPU_COUNT(&mask);
+    cpu_topology_t *topo = calloc(1, sizeof(cpu_topology_t));
+    int *core_keys = malloc(2 * count * sizeof(int));
+    if (!topo || !core_keys) {
+        free(topo);
+        free(core_keys);
+        return NULL;
+    }
+    topo->cpus = malloc(count * sizeof(cpu_info_t));
+    topo->node_ids = malloc(count * sizeof(int));
+    if (!topo->cpus || !topo->node_ids) {
+        free(core_keys);
+        topology_destroy(topo);
+        return NULL;
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE && topo->cpu_count < count; cpu++) {
+        if (!CPU_ISSET(cpu, &mask)) continue;
+        cpu_info_t *info = &topo->cpus[topo->cpu_count++];
+        info->cpu = cpu;
+
+        /* Cores are identified by (package, core id); CPUs without topology
+         * files count as cores of their own */
+        int package = read_cpu_int(cpu, "physical_package_id", -1);
+        int core_id = read_cpu_int(cpu, "core_id", -1 - cpu);
+        info->core = -1;
+        info->smt = 0;
+        for (int c = 0; c < topo->core_count; c++) {
+            if (core_keys[2 * c] == package && core_keys[2 * c + 1] == core_id) info->core = c;
+        }
+        if (info->core < 0) {
+            info->core = topo->core_count++;
+            core_keys[2 * info->core] = package;
+            core_keys[2 * info->core + 1] = core_id;
+        }
+        for (int i = 0; i < topo->cpu_count - 1; i++) info->smt += topo->cpus[i].core == info->core;
+
+        int node_id = read_cpu_node(cpu);
+        info->node = -1;
+        for (int n = 0; n < topo->node_count; n++) {
+            if (topo->node_ids[n] == node_id) info->node = n;
+        }
+        if (info->node < 0) {
+            info->node = topo->node_count++;
+            topo->node_ids[info->node] = node_id;
+        }
+    }
+    free(core_keys);
+    return topo;
+}
+
+/* Free a topology */
+void topology_destroy(cpu_topology_t *topo) {
+    if (!topo) return;
+    free(topo->cpus);
+    free(topo->node_ids);
+    free(topo);
+}
+
+static const char *policy_names[] = {"none", "compact", "scatter", "cores"};
+
+/* Parse a policy name */
+int affinity_parse(const char *name, affinity_policy_t *policy) {
+    for (int i = 0; i < (int)(sizeof(policy_names) / sizeof(policy_names[0])); i++) {
+        if (strcmp(name, policy_names[i]) == 0) {
+            *policy = (affinity_policy_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Name of a policy */
+const char *affinity_name(affinity_policy_t policy) {
+    return policy_names[policy];
+}
+
+/* A CPU with its placement order under a policy */
+typedef struct {
+    int key[3];
+    int cpu;
+} placement_t;
+
+/* Order placements by key, then by CPU number */
+static int compare_placements(const void *a, const void *b) {
+    const placement_t *pa = a, *pb = b;
+    for (int i = 0; i < 3; i++) {
+        if (pa->key[i] != pb->key[i]) return pa->key[i] < pb->key[i] ? -1 : 1;
+    }
+    return (pa->cpu > pb->cpu) - (pa->cpu < pb->cpu);
+}
+
+/* CPU of each thread under policy */
+int affinity_plan(const cpu_topology_t *topo, affinity_policy_t policy, int *cpus, int max) {
+    placement_t *order = malloc(topo->cpu_count * sizeof(placement_t));
+    int *core_rank = malloc(topo->core_count * sizeof(int));
+    int *node_cores = calloc(topo->node_count, sizeof(int));
+    int count = 0;
+    if (!order || !core_rank || !node_cores) goto done;
+
+    /* Rank of each core within its node, so scatter alternates nodes */
+    for (int i = 0; i < topo->cpu_count; i++) {
+        const cpu_info_t *info = &topo->cpus[i];
+        if (info->smt == 0) core_rank[info->core] = node_cores[info->node]++;
+    }
+
+    for (int i = 0; i < topo->cpu_count; i++) {
+        const cpu_info_t *info = &topo->cpus[i];
+        if (policy == AFFINITY_CORES && info->smt > 0) continue;
+
+        placement_t *p = &order[count++];
+        p->cpu = info->cpu;
+        if (policy == AFFINITY_COMPACT || policy == AFFINITY_NONE) {
+            p->key[0] = info->node;
+            p->key[1] = core_rank[info->core];
+            p->key[2] = info->smt;
+        } else {
+            p->key[0] = info->smt;
+            p->key[1] = core_rank[info->core];
+            p->key[2] = info->node;
+        }
+    }
+    qsort(order, count, sizeof(placement_t), compare_placements);
+    if (count > max) count = max;
+    for (int i = 0; i < count; i++) cpus[i] = order[i].cpu;
+
+done:
+    free(order);
+    free(core_rank);
+    free(node_cores);
+    return count;
+}
+
+/* Dense node of an OS CPU number */
+static int node_of_cpu(const cpu_topology_t *topo, int cpu) {
+    for (int i = 0; i < topo->cpu_count; i++) {
+        if (topo->cpus[i].cpu == cpu) return topo->cpus[i].node;
+    }
+    return 0;
+}
+
+/* Pin the OpenMP team */
+int affinity_apply(const cpu_topology_t *topo, affinity_policy_t policy, int threads) {
+    int *cpus = malloc(topo->cpu_count * sizeof(int));
+    if (!cpus) return -1;
+
+    int planned = affinity_plan(topo, policy, cpus, topo->cpu_count);
+    int team = policy == AFFINITY_NONE ? topo->cpu_count : planned;
+    if (threads > 0 && (policy == AFFINITY_NONE || threads < team)) team = threads;
+    if (team < 1) {
+        free(cpus);
+        return -1;
+    }
+
+    int failed = 0;
+    omp_set_dynamic(0);
+    omp_set_num_threads(team);
+    #pragma omp parallel reduction(|:failed)
+    {
+        int tid = omp_get_thread_num();
+        if (policy == AFFINITY_NONE) {
+            if (have_process_mask) {
+                failed |= sched_setaffinity(0, sizeof(cpu_set_t), &process_mask) != 0;
+            }
+            thread_node = 0;
+        } else {
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            CPU_SET(cpus[tid], &mask);
+            failed |= sched_setaffinity(0, sizeof(mask), &mask) != 0;
+            thread_node = node_of_cpu(topo, cpus[tid]);
+        }
+    }
+    free(cpus);
+    return failed ? -1 : team;
+}
+
+/* Dense node of the calling thread */
+int affinity_thread_node(void) {
+    return thread_node;
+}
+
+/* Switch the calling thread between interleaved and local allocation */
+int affinity_interleave(const cpu_topology_t *topo, int enable) {
+    if (topo->node_count < 2) return 0;
+    if (!enable) return syscall(SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0UL) == 0 ? 0 : -1;
+
+    unsigned long mask[MAX_NODE_ID / (8 * sizeof(unsigned long))] = {0};
+    size_t bits = 8 * sizeof(unsigned long);
+    for (int n = 0; n < topo->node_count; n++) {
+        int id = topo->node_ids[n];
+        if (id < 0 || id >= MAX_NODE_ID) return -1;
+        mask[id / bits] |= 1UL << (id % bits);
+    }
+    long status = syscall(SYS_set_mempolicy, MPOL_INTERLEAVE, mask, (unsigned long)MAX_NODE_ID);
+    return status == 0 ? 0 : -1;
+}
@@ -0,0 +1,64 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+/* CPU topology and thread placement. The render threads are OpenMP threads;
+ * pinning runs one parallel region in which every thread binds itself to its
+ * CPU, and the runtime keeps reusing those threads for later regions. */
+
+typedef enum {
+    AFFINITY_NONE,    /* leave placement to the OS */
+    AFFINITY_COMPACT, /* fill a node's cores and their SMT siblings first */
+    AFFINITY_SCATTER, /* spread over nodes, then cores, then SMT siblings */
+    AFFINITY_CORES    /* one thread per physical core, spread like scatter */
+} affinity_policy_t;
+
+/* One logical CPU the process may run on */
+typedef struct {
+    int cpu;  /* OS CPU number */
+    int core; /* dense physical core index */
+    int smt;  /* rank among the core's hardware threads */
+    int node; /* dense NUMA node index */
+} cpu_info_t;
+
+typedef struct {
+    cpu_info_t *cpus;
+    int cpu_count;
+    int core_count;
+    int node_count;
+    int *node_ids; /* OS NUMA node number of each dense node index */
+} cpu_topology_t;
+
+/* Read the topology of the CPUs in the process's affinity mask from /sys.
+ * Missing entries fall back to one node and one core per CPU. Returns NULL on
+ * allocation failure. */
+cpu_topology_t *topology_detect(void);
+
+/* Free a topology */
+void topology_destroy(cpu_topology_t *topo);
+
+/* Parse a policy name (none, compact, scatter or cores); -1 if unknown */
+int affinity_parse(const char *name, affinity_policy_t *policy);
+
+/* Name of a policy */
+const char *affinity_name(affinity_policy_t policy);
+
+/* Fill cpus with the CPU of each thread under policy, in thread order, and
+ * return the number of threads the policy places (at most max) */
+int affinity_plan(const cpu_topology_t *topo, affinity_policy_t policy, int *cpus, int max);
+
+/* Run subsequent OpenMP regions on threads placed by policy. threads <= 0
+ * uses every placement of the policy; otherwise the first threads of the
+ * plan. AFFINITY_NONE restores the process mask. Returns the team size, or -1
+ * if pinning failed. */
+int affinity_apply(const cpu_topology_t *topo, affinity_policy_t policy, int threads);
+
+/* Dense NUMA node of the calling thread as pinned by affinity_apply (0 when
+ * unpinned) */
+int affinity_thread_node(void);
+
+/* Interleave pages first touched by the calling thread from now on across
+ * every node (enable), or return to local allocation. Returns 0 on success or
+ * on single-node machines, -1 if the kernel refused. */
+int affinity_interleave(const cpu_topology_t *topo, int enable);
+
+#endif /* AFFINITY_H */
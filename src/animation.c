@@ -0,0 +1,91 @@
+#include "animation.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Create a path from count keyframes */
+path_t *path_create(const double *times, const vec3_t *points, int count) {
+    if (count < 1) return NULL;
+    for (int i = 1; i < count; i++) {
+        if (!(times[i] > times[i - 1])) return NULL;
+    }
+
+    path_t *path = malloc(sizeof(path_t));
+    if (!path) return NULL;
+    path->count = count;
+    path->period = 0.0;
+    path->times = malloc(count * sizeof(double));
+    path->points = malloc(count * sizeof(vec3_t));
+    if (!path->times || !path->points) {
+        path_destroy(path);
+        return NULL;
+    }
+    for (int i = 0; i < count; i++) {
+        path->times[i] = times[i];
+        path->points[i] = points[i];
+    }
+    return path;
+}
+
+/* Create a path that repeats forever */
+path_t *path_create_loop(const double *times, const vec3_t *points, int count) {
+    if (count < 2 || memcmp(&points[0], &points[count - 1], sizeof(vec3_t)) != 0) return NULL;
+    path_t *path = path_create(times, points, count);
+    if (path) path->period = times[count - 1] - times[0];
+    return path;
+}
+
+/* Time t moved into the first period of a looping path */
+double path_wrap(const path_t *path, double t) {
+    if (path->period <= 0.0) return t;
+    double start = path->times[0];
+    double wrapped = start + fmod(t - start, path->period);
+    return wrapped < start ? wrapped + path->period : wrapped;
+}
+
+/* Position on the path at time t */
+vec3_t path_eval(const path_t *path, double t) {
+    int n = path->count;
+    t = path_wrap(path, t);
+    if (t <= path->times[0]) return path->points[0];
+    if (t >= path->times[n - 1]) return path->points[n - 1];
+
+    /* Find the segment [lo, lo + 1] containing t */
+    int lo = 0, hi = n - 1;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (path->times[mid] <= t) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    double s = (t - path->times[lo]) / (path->times[hi] - path->times[lo]);
+    return vec3_add(vec3_mul(path->points[lo], 1.0 - s), vec3_mul(path->points[hi], s));
+}
+
+/* Whether a keyframe lies strictly inside (t0, t1). A looping path's keys
+ * are checked in the period t0 falls in and the next one. */
+int path_has_key_inside(const path_t *path, double t0, double t1) {
+    if (path->period > 0.0) {
+        if (t1 - t0 >= path->period) return 1;
+        double start = path_wrap(path, t0);
+        t1 = start + (t1 - t0);
+        t0 = start;
+    }
+    for (int i = 0; i < path->count; i++) {
+        double key = path->times[i];
+        if (key > t0 && key < t1) return 1;
+        key += path->period;
+        if (path->period > 0.0 && key > t0 && key < t1) return 1;
+    }
+    return 0;
+}
+
+/* Free the path */
+void path_destroy(path_t *path) {
+    if (!path) return;
+    free(path->times);
+    free(path->points);
+    free(path);
+}
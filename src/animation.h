@@ -0,0 +1,47 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "vec3.h"
+
+/* Keyframed motion. Times are in frames: frame f of a sequence is exposed over
+ * [f, f + shutter], so with the shutter closed every ray of the frame samples
+ * time f. */
+
+/* Shutter interval of the frame being rendered */
+typedef struct {
+    double open;
+    double close;
+} shutter_t;
+
+/* Piecewise linear path through keyframes sorted by time; positions before
+ * the first or after the last key are held, unless the path loops */
+typedef struct {
+    int count;
+    double *times;
+    vec3_t *points;
+    double period; /* > 0: the keys repeat with this period */
+} path_t;
+
+/* Create a path from count keyframes (copied). Returns NULL if count < 1,
+ * the times are not increasing, or allocation fails. */
+path_t *path_create(const double *times, const vec3_t *points, int count);
+
+/* Create a path that repeats forever, with the keys spanning one period
+ * (times[count - 1] - times[0]). Returns NULL if count < 2, the last point
+ * is not the first, or as path_create does. */
+path_t *path_create_loop(const double *times, const vec3_t *points, int count);
+
+/* Time t moved into the first period of a looping path; t otherwise */
+double path_wrap(const path_t *path, double t);
+
+/* Position on the path at time t */
+vec3_t path_eval(const path_t *path, double t);
+
+/* Whether a keyframe lies strictly inside (t0, t1), i.e. the motion over the
+ * interval is not a single straight segment */
+int path_has_key_inside(const path_t *path, double t0, double t1);
+
+/* Free the path */
+void path_destroy(path_t *path);
+
+#endif /* ANIMATION_H */
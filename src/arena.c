@@ -0,0 +1,89 @@
+#include "arena.h"
+#include <stdlib.h>
+
+struct arena_block {
+    arena_block_t *next;
+    size_t size; /* bytes after the header */
+    size_t used;
+};
+
+/* Bytes of header in front of a block's memory, keeping it block aligned */
+#define HEADER_SIZE \
+    ((sizeof(arena_block_t) + ARENA_BLOCK_ALIGN - 1) / ARENA_BLOCK_ALIGN * ARENA_BLOCK_ALIGN)
+
+/* Start a block of at least size bytes in front of the others */
+static int add_block(arena_t *arena, size_t size) {
+    if (size < arena->next_size) size = arena->next_size;
+    size = (size + ARENA_BLOCK_ALIGN - 1) / ARENA_BLOCK_ALIGN * ARENA_BLOCK_ALIGN;
+    arena_block_t *block = aligned_alloc(ARENA_BLOCK_ALIGN, HEADER_SIZE + size);
+    if (!block) return -1;
+    block->next = arena->blocks;
+    block->size = size;
+    block->used = 0;
+    arena->blocks = block;
+    arena->reserved += size;
+    if (arena->next_size < ARENA_MAX_GROWTH) arena->next_size *= 2;
+    return 0;
+}
+
+/* Create an arena with a first block of at least reserve bytes */
+arena_t *arena_create(size_t reserve) {
+    arena_t *arena = calloc(1, sizeof(arena_t));
+    if (!arena) return NULL;
+    arena->next_size = ARENA_MIN_BLOCK;
+    if (add_block(arena, reserve) != 0) {
+        free(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+/* Make room for bytes more in the current block */
+int arena_reserve(arena_t *arena, size_t bytes) {
+    arena_block_t *block = arena->blocks;
+    if (block && block->size - block->used >= bytes) return 0;
+    return add_block(arena, bytes);
+}
+
+/* Bump-allocate size bytes aligned to align */
+void *arena_alloc(arena_t *arena, size_t size, size_t align) {
+    arena_block_t *block = arena->blocks;
+    size_t start = block ? (block->used + align - 1) & ~(align - 1) : 0;
+    if (!block || start + size > block->size) {
+        /* The rest of the current block is left unused */
+        if (add_block(arena, size) != 0) return NULL;
+        block = arena->blocks;
+        start = 0;
+    }
+    arena->used += start + size - block->used;
+    block->used = start + size;
+    return (char *)block + HEADER_SIZE + start;
+}
+
+/* Move src's blocks behind dst's current block */
+void arena_merge(arena_t *dst, arena_t *src) {
+    if (!src) return;
+    arena_block_t *last = src->blocks;
+    while (last && last->next) last = last->next;
+    if (last) {
+        /* dst keeps allocating from its own newest block */
+        arena_block_t **link = dst->blocks ? &dst->blocks->next : &dst->blocks;
+        last->next = *link;
+        *link = src->blocks;
+    }
+    dst->reserved += src->reserved;
+    dst->used += src->used;
+    free(src);
+}
+
+/* Free every block and the arena */
+void arena_destroy(arena_t *arena) {
+    if (!arena) return;
+    arena_block_t *block = arena->blocks;
+    while (block) {
+        arena_block_t *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
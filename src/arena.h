@@ -0,0 +1,47 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Arena: memory handed out by bumping a pointer through large blocks and
+ * given back all at once. Scene builders make their spheres and materials in
+ * the scene's arena, so a million-object world costs a few block allocations
+ * instead of two mallocs per object, its objects lie next to each other in
+ * the order they were made, and teardown frees a handful of blocks instead of
+ * walking every object. An arena is not thread safe: parallel builders give
+ * each thread an arena of its own and merge them into the scene's when done. */
+
+#define ARENA_BLOCK_ALIGN 64       /* blocks start on a cache line */
+#define ARENA_MIN_BLOCK (64 << 10) /* smallest block, and the first without a hint */
+#define ARENA_MAX_GROWTH (64 << 20) /* blocks double up to this size */
+
+typedef struct arena_block arena_block_t;
+
+typedef struct arena {
+    arena_block_t *blocks; /* the newest first; only it is allocated from */
+    size_t next_size;      /* size of the next block to allocate */
+    size_t reserved;       /* bytes in all blocks */
+    size_t used;           /* bytes handed out, padding included */
+} arena_t;
+
+/* Create an arena whose first block holds at least reserve bytes (a size
+ * hint; 0 for the default). Returns NULL on allocation failure. */
+arena_t *arena_create(size_t reserve);
+
+/* Make sure the next bytes bytes of allocations fit in the current block,
+ * starting a new one if not. Returns 0, or -1 on allocation failure. */
+int arena_reserve(arena_t *arena, size_t bytes);
+
+/* Allocate size bytes aligned to align (a power of two no larger than
+ * ARENA_BLOCK_ALIGN). The memory lives until the arena is destroyed.
+ * Returns NULL on allocation failure. */
+void *arena_alloc(arena_t *arena, size_t size, size_t align);
+
+/* Move every block of src into dst and free src, leaving all of src's
+ * allocations valid; for gathering the arenas of a parallel build */
+void arena_merge(arena_t *dst, arena_t *src);
+
+/* Free the arena and everything allocated from it */
+void arena_destroy(arena_t *arena);
+
+#endif /* ARENA_H */
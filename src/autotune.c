@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+#include "autotune.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LINE_MAX_LENGTH 512
+
+/* Chunk sizes tried, smallest first; RENDER_CHUNK_DEFAULT is among them */
+static const int chunk_sizes[] = {4, 16, 64, 100, 256, 1024};
+
+/* Monotonic time in seconds */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Key of this host */
+void autotune_host(char *buf, size_t size) {
+    char model[256] = "unknown CPU";
+    char line[LINE_MAX_LENGTH];
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    while (f && fgets(line, sizeof(line), f)) {
+        char *colon = strchr(line, ':');
+        if (strncmp(line, "model name", 10) != 0 || !colon) continue;
+        const char *start = colon + 1;
+        while (*start == ' ' || *start == '\t') start++;
+        size_t length = strcspn(start, "\r\n");
+        if (length > 0 && length < sizeof(model)) {
+            memcpy(model, start, length);
+            model[length] = '\0';
+        }
+        break;
+    }
+    if (f) fclose(f);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    snprintf(buf, size, "%s, %ld CPUs", model, cpus > 0 ? cpus : 1L);
+}
+
+/* Decimal digits of the scene's top-level object count */
+int autotune_size_class(const scene_t *scene) {
+    int size_class = 1;
+    for (int count = scene->world->count; count >= 10; count /= 10) size_class++;
+    return size_class;
+}
+
+/* Camera samples per second of the fastest of repeats renders of samples
+ * [0, spp) of rect with threads and chunk; -1 if out of memory */
+static double trial(const scene_t *scene, const camera_t *camera,
+                    const render_settings_t *settings, render_rect_t rect, int threads,
+                    int chunk, int spp, int repeats, accum_t *accum) {
+    render_settings_t rs = *settings;
+    rs.threads = threads;
+    rs.chunk_size = chunk;
+    double best = 0.0;
+    for (int r = 0; r < repeats; r++) {
+        accum_clear(accum);
+        double start = now_seconds();
+        if (render_region(scene, camera, &rs, rect, 0, spp, accum) != 0) return -1.0;
+        double elapsed = now_seconds() - start;
+        double pixels = (double)(rect.x1 - rect.x0) * (rect.y1 - rect.y0);
+        double rate = pixels * spp / (elapsed > 1e-9 ? elapsed : 1e-9);
+        if (rate > best) best = rate;
+    }
+    return best;
+}
+
+/* Tune threads and chunk size: first the chunk at the most threads, then the
+ * thread count at the best chunk. Trials render as many samples per pixel as
+ * fit in AUTOTUNE_TRIAL_SECONDS. */
+int autotune_run(const scene_t *scene, const camera_t *camera,
+                 const render_settings_t *settings, render_rect_t rect,
+                 autotune_config_t *best) {
+    int width = rect.x1 - rect.x0;
+    int height = rect.y1 - rect.y0;
+    int pixels = width * height;
+    int max_threads = settings->threads > 0 ? settings->threads : omp_get_max_threads();
+    accum_t *accum = accum_create(width, height);
+    if (!accum) return -1;
+
+    /* A one-sample probe sizes the trials */
+    double rate = trial(scene, camera, settings, rect, max_threads, RENDER_CHUNK_DEFAULT, 1, 1,
+                        accum);
+    int renders = 1;
+    double budget = rate * AUTOTUNE_TRIAL_SECONDS; /* samples per trial */
+    int spp = (int)(budget / pixels);
+    if (spp < 1) {
+        /* Slow frames are calibrated on a band of rows through the middle */
+        int rows = (int)(budget / width);
+        if (rows < 1) rows = 1;
+        rect.y0 += (height - rows) / 2;
+        rect.y1 = rect.y0 + rows;
+        pixels = width * rows;
+        spp = 1;
+    }
+    if (spp > settings->samples_per_pixel) spp = settings->samples_per_pixel;
+
+    *best = (autotune_config_t){.threads = max_threads, .chunk = RENDER_CHUNK_DEFAULT};
+    for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]) && rate >= 0.0; i++) {
+        int chunk = chunk_sizes[i];
+        if (chunk > pixels && chunk != RENDER_CHUNK_DEFAULT) continue;
+        rate = trial(scene, camera, settings, rect, max_threads, chunk, spp, AUTOTUNE_REPEATS,
+                     accum);
+        renders += AUTOTUNE_REPEATS;
+        if (rate > best->rate) *best = (autotune_config_t){max_threads, chunk, rate};
+    }
+
+    /* Halving the team helps when threads fight over cores or memory */
+    int chunk = best->chunk;
+    for (int threads = max_threads / 2; threads >= 1 && rate >= 0.0; threads /= 2) {
+        rate = trial(scene, camera, settings, rect, threads, chunk, spp, AUTOTUNE_REPEATS,
+                     accum);
+        renders += AUTOTUNE_REPEATS;
+        if (rate > best->rate) *best = (autotune_config_t){threads, chunk, rate};
+    }
+    accum_destroy(accum);
+    return rate < 0.0 ? -1 : renders;
+}
+
+/* Parse one cache line; returns 1 if it is well formed. host points into line. */
+static int parse_line(char *line, int *size_class, autotune_config_t *config, char **host) {
+    int offset = 0;
+    if (sscanf(line, "%d %d %d %lf %n", size_class, &config->threads, &config->chunk,
+               &config->rate, &offset) != 4 || offset == 0) {
+        return 0;
+    }
+    *host = line + offset;
+    (*host)[strcspn(*host, "\r\n")] = '\0';
+    return config->threads > 0 && config->chunk > 0;
+}
+
+/* Read the cached configuration for host and size class */
+int autotune_load(const char *path, const char *host, int size_class,
+                  autotune_config_t *config) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char line[LINE_MAX_LENGTH];
+    int found = -1;
+    while (fgets(line, sizeof(line), f)) {
+        int line_class;
+        autotune_config_t entry;
+        char *line_host;
+        if (parse_line(line, &line_class, &entry, &line_host) && line_class == size_class &&
+            strcmp(line_host, host) == 0) {
+            *config = entry;
+            found = 0;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+/* Create the directory holding path if it is missing (one level) */
+static void make_parent(const char *path) {
+    const char *slash = strrchr(path, '/');
+    if (!slash || slash == path) return;
+    char dir[LINE_MAX_LENGTH];
+    if ((size_t)(slash - path) >= sizeof(dir)) return;
+    memcpy(dir, path, slash - path);
+    dir[slash - path] = '\0';
+    mkdir(dir, 0755);
+}
+
+/* Store config for host and size class, rewriting the file through a
+ * temporary so readers never see half of it */
+int autotune_save(const char *path, const char *host, int size_class,
+                  const autotune_config_t *config) {
+    if (strchr(host, '\n')) return -1;
+    make_parent(path);
+    size_t length = strlen(path) + 8;
+    char *temp = malloc(length);
+    if (!temp) return -1;
+    snprintf(temp, length, "%s.tmp", path);
+    FILE *out = fopen(temp, "w");
+    if (!out) {
+        free(temp);
+        return -1;
+    }
+
+    FILE *in = fopen(path, "r");
+    char line[LINE_MAX_LENGTH];
+    while (in && fgets(line, sizeof(line), in)) {
+        char copy[LINE_MAX_LENGTH];
+        memcpy(copy, line, sizeof(line));
+        int line_class;
+        autotune_config_t entry;
+        char *line_host;
+        if (!parse_line(copy, &line_class, &entry, &line_host)) continue;
+        if (line_class == size_class && strcmp(line_host, host) == 0) continue;
+        fputs(line, out);
+        if (!strchr(line, '\n')) fputc('\n', out);
+    }
+    if (in) fclose(in);
+    fprintf(out, "%d %d %d %.0f %s\n", size_class, config->threads, config->chunk,
+            config->rate, host);
+
+    int status = fclose(out) == 0 && rename(temp, path) == 0 ? 0 : -1;
+    if (status != 0) remove(temp);
+    free(temp);
+    return status;
+}
@@ -0,0 +1,58 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include "camera.h"
+#include "render.h"
+#include "scene.h"
+#include <stddef.h>
+
+/* Autotuning of the render's scheduling knobs. Short calibration renders of
+ * the real frame try a small grid of thread counts and scheduling chunk sizes
+ * and keep whichever traces the most samples per second. Only knobs that
+ * leave the image unchanged are tuned: every sample draws from its own random
+ * stream, so threads and chunks decide how fast the frame is rendered, never
+ * what it holds. Results are cached per host (CPU model and logical CPU
+ * count) and scene size class, one line per entry:
+ *
+ *     <size class> <threads> <chunk> <samples/s> <host>
+ */
+
+#define AUTOTUNE_TRIAL_SECONDS 0.25 /* aimed length of one calibration render */
+#define AUTOTUNE_REPEATS 2          /* renders per setting; the fastest counts */
+
+/* A tuned configuration */
+typedef struct {
+    int threads;  /* render threads */
+    int chunk;    /* pixels per dynamically scheduled chunk */
+    double rate;  /* camera samples per second measured with them */
+} autotune_config_t;
+
+/* Key of this host: its CPU model and logical CPU count, written to buf
+ * (truncated to size) */
+void autotune_host(char *buf, size_t size);
+
+/* Size class of a scene: the number of decimal digits in its count of
+ * top-level objects, so scenes within a factor of ten share a tuning */
+int autotune_size_class(const scene_t *scene);
+
+/* Tune the threads and chunk size for rendering rect of scene through camera
+ * with settings (whose threads and chunk_size are ignored); the best
+ * configuration goes to *best. Frames too slow for one sample per pixel per
+ * trial are timed on a band of rows through the middle. Up to
+ * settings->threads threads are tried if it is set, else up to the OpenMP
+ * default. Returns the number of calibration renders, or -1 if out of memory. */
+int autotune_run(const scene_t *scene, const camera_t *camera,
+                 const render_settings_t *settings, render_rect_t rect,
+                 autotune_config_t *best);
+
+/* Read the configuration cached at path for host and size class into
+ * *config. Returns 0 if found, -1 if the file or the entry is missing. */
+int autotune_load(const char *path, const char *host, int size_class,
+                  autotune_config_t *config);
+
+/* Store config at path for host and size class, replacing any earlier entry
+ * for the pair and keeping the others. Returns 0 on success, -1 on error. */
+int autotune_save(const char *path, const char *host, int size_class,
+                  const autotune_config_t *config);
+
+#endif /* AUTOTUNE_H */
@@ -0,0 +1,395 @@
+#include "bvh.h"
+#include "dispatch.h"
+#include <stdlib.h>
+
+#define BVH_BINS 16
+#define BVH_MAX_LEAF 4
+#define BVH_MAX_DEPTH 48 /* deeper subtrees are split by count, bounding the stack */
+/* Traversal pushes one node per level. Count splits past BVH_MAX_DEPTH halve
+ * an int count, so leaves lie at most 31 levels deeper. */
+#define BVH_STACK_SIZE (BVH_MAX_DEPTH + 32)
+_Static_assert(BVH_STACK_SIZE >= BVH_MAX_DEPTH + 31, "BVH traversal stack can overflow");
+
+typedef struct {
+    aabb_t box;
+    vec3_t centroid;
+    int index;
+} build_item_t;
+
+/* Make node a leaf over items [start, start + count) */
+static void make_leaf(bvh_node_t *node, aabb_t box, int start, int count) {
+    node->box = box;
+    node->start = start;
+    node->count = count;
+    node->axis = 0;
+}
+
+/* Partition items so those whose centroid falls in a bin <= split come first;
+ * returns the index of the first item of the right half */
+static int partition(build_item_t *items, int start, int count, int axis,
+                     double cmin, double scale, int split) {
+    int i = start;
+    int j = start + count - 1;
+    while (i <= j) {
+        int bin = (int)((items[i].centroid.e[axis] - cmin) * scale);
+        if (bin >= BVH_BINS) bin = BVH_BINS - 1;
+        if (bin <= split) {
+            i++;
+        } else {
+            build_item_t tmp = items[i];
+            items[i] = items[j];
+            items[j] = tmp;
+            j--;
+        }
+    }
+    return i;
+}
+
+typedef struct {
+    bvh_node_t *nodes;
+    int node_count;
+} builder_t;
+
+/* Recursively build the subtree over items [start, start + count);
+ * returns the index of its root node */
+static int build(builder_t *bvh, build_item_t *items, int start, int count, int depth) {
+    int index = bvh->node_count++;
+
+    aabb_t box = aabb_empty();
+    aabb_t centroids = aabb_empty();
+    for (int i = start; i < start + count; i++) {
+        box = aabb_union(box, items[i].box);
+        centroids = aabb_extend(centroids, items[i].centroid);
+    }
+
+    if (count <= BVH_MAX_LEAF) {
+        make_leaf(&bvh->nodes[index], box, start, count);
+        return index;
+    }
+
+    /* Split along the axis where centroids spread the most */
+    int axis = 0;
+    vec3_t extent = vec3_sub(centroids.max, centroids.min);
+    if (extent.e[1] > extent.e[axis]) axis = 1;
+    if (extent.e[2] > extent.e[axis]) axis = 2;
+
+    int mid = start + count / 2;
+    if (extent.e[axis] > 0.0 && depth < BVH_MAX_DEPTH) {
+        /* Binned SAH: pick the bin boundary minimizing area-weighted counts */
+        aabb_t bin_box[BVH_BINS];
+        int bin_count[BVH_BINS] = {0};
+        for (int b = 0; b < BVH_BINS; b++) bin_box[b] = aabb_empty();
+
+        double cmin = centroids.min.e[axis];
+        double scale = BVH_BINS / extent.e[axis];
+        for (int i = start; i < start + count; i++) {
+            int b = (int)((items[i].centroid.e[axis] - cmin) * scale);
+            if (b >= BVH_BINS) b = BVH_BINS - 1;
+            bin_count[b]++;
+            bin_box[b] = aabb_union(bin_box[b], items[i].box);
+        }
+
+        double right_area[BVH_BINS];
+        int right_count[BVH_BINS];
+        aabb_t acc = aabb_empty();
+        int n = 0;
+        for (int b = BVH_BINS - 1; b > 0; b--) {
+            acc = aabb_union(acc, bin_box[b]);
+            n += bin_count[b];
+            right_area[b] = aabb_area(acc);
+            right_count[b] = n;
+        }
+
+        int best = -1;
+        double best_cost = INFINITY;
+        acc = aabb_empty();
+        n = 0;
+        for (int b = 0; b < BVH_BINS - 1; b++) {
+            acc = aabb_union(acc, bin_box[b]);
+            n += bin_count[b];
+            if (n == 0 || right_count[b + 1] == 0) continue;
+            double cost = aabb_area(acc) * n + right_area[b + 1] * right_count[b + 1];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = b;
+            }
+        }
+
+        /* Small nodes stay leaves when no split beats testing everything */
+        double leaf_cost = aabb_area(box) * count;
+        if (count <= 2 * BVH_MAX_LEAF && best_cost >= leaf_cost) {
+            make_leaf(&bvh->nodes[index], box, start, count);
+            return index;
+        }
+        if (best >= 0) {
+            mid = partition(items, start, count, axis, cmin, scale, best);
+        }
+    }
+
+    build(bvh, items, start, mid - start, depth + 1);
+    int right = build(bvh, items, mid, start + count - mid, depth + 1);
+
+    bvh_node_t *node = &bvh->nodes[index];
+    node->box = box;
+    node->start = right;
+    node->count = 0;
+    node->axis = axis;
+    return index;
+}
+
+/* Build nodes over count boxes */
+int bvh_build(const aabb_t *boxes, int count, bvh_node_t *nodes, int *order) {
+    if (count <= 0) return 0;
+
+    build_item_t *items = malloc(count * sizeof(build_item_t));
+    if (!items) return -1;
+    for (int i = 0; i < count; i++) {
+        items[i].box = boxes[i];
+        items[i].centroid = aabb_centroid(boxes[i]);
+        items[i].index = i;
+    }
+
+    builder_t builder = {nodes, 0};
+    build(&builder, items, 0, count, 0);
+    for (int i = 0; i < count; i++) {
+        order[i] = items[i].index;
+    }
+
+    free(items);
+    return builder.node_count;
+}
+
+/* Build a BVH over count objects */
+bvh_t *bvh_create(const hittable_t *objects, int count) {
+    bvh_t *bvh = calloc(1, sizeof(bvh_t));
+    if (!bvh) return NULL;
+
+    int n = count > 0 ? count : 1;
+    aabb_t *boxes = malloc(n * sizeof(aabb_t));
+    int *source = malloc(n * sizeof(int));
+    int *order = malloc(n * sizeof(int));
+    bvh->nodes = malloc(2 * n * sizeof(bvh_node_t));
+    bvh->objects = malloc(n * sizeof(hittable_t));
+    bvh->ids = malloc(n * sizeof(int));
+    bvh->unbounded = malloc(n * sizeof(hittable_t));
+    bvh->unbounded_ids = malloc(n * sizeof(int));
+    if (!boxes || !source || !order || !bvh->nodes || !bvh->objects || !bvh->ids ||
+        !bvh->unbounded || !bvh->unbounded_ids) {
+        free(boxes);
+        free(source);
+        free(order);
+        bvh_destroy(bvh);
+        return NULL;
+    }
+
+    int bounded = 0;
+    for (int i = 0; i < count; i++) {
+        aabb_t box;
+        if (objects[i].bounding_box && objects[i].bounding_box(objects[i].data, &box)) {
+            boxes[bounded] = box;
+            source[bounded++] = i;
+        } else {
+            bvh->unbounded_ids[bvh->unbounded_count] = i;
+            bvh->unbounded[bvh->unbounded_count++] = objects[i];
+        }
+    }
+
+    bvh->node_count = bvh_build(boxes, bounded, bvh->nodes, order);
+    if (bvh->node_count >= 0) {
+        for (int i = 0; i < bounded; i++) {
+            bvh->objects[i] = objects[source[order[i]]];
+            bvh->ids[i] = source[order[i]];
+        }
+        bvh->object_count = bounded;
+    }
+
+    free(boxes);
+    free(source);
+    free(order);
+    if (bvh->node_count < 0) {
+        bvh_destroy(bvh);
+        return NULL;
+    }
+    return bvh;
+}
+
+/* Recompute the node bounds bottom-up */
+int bvh_refit(bvh_t *bvh, double time0, double time1) {
+    int motion = time1 > time0;
+    if (motion && !bvh->end_boxes && bvh->node_count > 0) {
+        bvh->end_boxes = malloc(bvh->node_count * sizeof(aabb_t));
+        if (!bvh->end_boxes) return -1;
+    } else if (!motion) {
+        free(bvh->end_boxes);
+        bvh->end_boxes = NULL;
+    }
+    bvh->time0 = time0;
+    bvh->time1 = motion ? time1 : time0;
+
+    /* Children follow their parents, so a reverse sweep sees them first */
+    for (int i = bvh->node_count - 1; i >= 0; i--) {
+        bvh_node_t *node = &bvh->nodes[i];
+        aabb_t open = aabb_empty();
+        aabb_t close = aabb_empty();
+
+        if (node->count > 0) {
+            for (int k = node->start; k < node->start + node->count; k++) {
+                const hittable_t *obj = &bvh->objects[k];
+                aabb_t a, b;
+                if (!motion || !obj->motion_bounds || !obj->motion_bounds(obj->data, &a, &b)) {
+                    obj->bounding_box(obj->data, &a);
+                    b = a;
+                }
+                open = aabb_union(open, a);
+                close = aabb_union(close, b);
+            }
+        } else {
+            open = aabb_union(bvh->nodes[i + 1].box, bvh->nodes[node->start].box);
+            if (motion) {
+                close = aabb_union(bvh->end_boxes[i + 1], bvh->end_boxes[node->start]);
+            }
+        }
+
+        node->box = open;
+        if (motion) bvh->end_boxes[i] = close;
+    }
+    return 0;
+}
+
+/* Node bounds at interpolation weight s between time0 and time1 */
+static inline aabb_t node_box_at(const bvh_t *bvh, int index, double s) {
+    aabb_t a = bvh->nodes[index].box;
+    const aabb_t *b = &bvh->end_boxes[index];
+    for (int k = 0; k < 3; k++) {
+        a.min.e[k] += s * (b->min.e[k] - a.min.e[k]);
+        a.max.e[k] += s * (b->max.e[k] - a.max.e[k]);
+    }
+    return a;
+}
+
+/* Walk the BVH for the closest hit, or with any set stop at the first */
+static inline int traverse(const bvh_t *bvh, const ray_t r, double t_min, double t_max,
+                           hit_record_t *rec, int any) {
+    hit_record_t temp_rec = {0};
+    int hit_anything = 0;
+    double closest_so_far = t_max;
+
+    for (int i = 0; i < bvh->unbounded_count; i++) {
+        const hittable_t *obj = &bvh->unbounded[i];
+        if (obj->hit(obj->data, r, t_min, closest_so_far, &temp_rec)) {
+            hit_anything = 1;
+            closest_so_far = temp_rec.t;
+            *rec = temp_rec;
+            rec->object = bvh->unbounded_ids[i];
+            if (any) return 1;
+        }
+    }
+    if (bvh->node_count == 0) return hit_anything;
+
+    vec3_t inv_dir = vec3(1.0 / r.direction.e[0], 1.0 / r.direction.e[1],
+                          1.0 / r.direction.e[2]);
+    int stack[BVH_STACK_SIZE];
+    int sp = 0;
+    int index = 0;
+
+    double s = 0.0;
+    if (bvh->end_boxes) {
+        s = (r.time - bvh->time0) / (bvh->time1 - bvh->time0);
+        s = s < 0.0 ? 0.0 : (s > 1.0 ? 1.0 : s);
+    }
+
+    while (1) {
+        const bvh_node_t *node = &bvh->nodes[index];
+        aabb_t moved;
+        const aabb_t *box = &node->box;
+        if (bvh->end_boxes) {
+            moved = node_box_at(bvh, index, s);
+            box = &moved;
+        }
+        if (aabb_hit(box, r.origin, inv_dir, t_min, closest_so_far)) {
+            if (node->count > 0) {
+                for (int i = node->start; i < node->start + node->count; i++) {
+                    const hittable_t *obj = &bvh->objects[i];
+                    if (obj->hit(obj->data, r, t_min, closest_so_far, &temp_rec)) {
+                        hit_anything = 1;
+                        closest_so_far = temp_rec.t;
+                        *rec = temp_rec;
+                        rec->object = bvh->ids[i];
+                        if (any) return 1;
+                    }
+                }
+            } else {
+                /* Visit the child nearer along the split axis first */
+                int first = index + 1;
+                int second = node->start;
+                if (r.direction.e[node->axis] < 0.0) {
+                    first = node->start;
+                    second = index + 1;
+                }
+                stack[sp++] = second;
+                index = first;
+                continue;
+            }
+        }
+        if (sp == 0) break;
+        index = stack[--sp];
+    }
+    return hit_anything;
+}
+
+/* Find the closest intersection */
+VIBE_KERNEL
+int bvh_hit(const bvh_t *bvh, const ray_t r, double t_min, double t_max,
+            hit_record_t *rec) {
+    return traverse(bvh, r, t_min, t_max, rec, 0);
+}
+
+/* Whether anything lies along r within (t_min, t_max) */
+VIBE_KERNEL
+int bvh_occluded(const bvh_t *bvh, const ray_t r, double t_min, double t_max) {
+    hit_record_t rec;
+    return traverse(bvh, r, t_min, t_max, &rec, 1);
+}
+
+/* Bounds of everything in the BVH */
+int bvh_bounding_box(const bvh_t *bvh, aabb_t *box) {
+    if (bvh->unbounded_count > 0 || bvh->node_count == 0) return 0;
+    *box = bvh->nodes[0].box;
+    if (bvh->end_boxes) *box = aabb_union(*box, bvh->end_boxes[0]);
+    return 1;
+}
+
+static int bvh_hittable_hit(const void *obj, const ray_t r, double t_min,
+                            double t_max, hit_record_t *rec) {
+    return bvh_hit((const bvh_t *)obj, r, t_min, t_max, rec);
+}
+
+static int bvh_hittable_bounding_box(const void *obj, aabb_t *box) {
+    return bvh_bounding_box((const bvh_t *)obj, box);
+}
+
+static void bvh_hittable_destroy(void *obj) {
+    bvh_destroy((bvh_t *)obj);
+}
+
+/* Wrap a BVH as a hittable */
+hittable_t bvh_to_hittable(bvh_t *bvh) {
+    return (hittable_t){
+        .data = bvh,
+        .hit = bvh_hittable_hit,
+        .bounding_box = bvh_hittable_bounding_box,
+        .destroy = bvh_hittable_destroy,
+    };
+}
+
+/* Free the BVH */
+void bvh_destroy(bvh_t *bvh) {
+    if (!bvh) return;
+    free(bvh->nodes);
+    free(bvh->objects);
+    free(bvh->ids);
+    free(bvh->unbounded);
+    free(bvh->unbounded_ids);
+    free(bvh->end_boxes);
+    free(bvh);
+}
@@ -0,0 +1,66 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "aabb.h"
+#include "hittable.h"
+
+/* Bounding volume hierarchy over hittable objects, built with a binned
+ * surface area heuristic and stored as a flat array of nodes. The BVH keeps
+ * copies of the hittable_t handles but does not own the objects. */
+
+typedef struct {
+    aabb_t box;
+    int start; /* leaf: first object; interior: index of the right child
+                * (the left child directly follows its parent) */
+    int count; /* objects in a leaf, 0 for interior nodes */
+    int axis;  /* split axis of interior nodes */
+} bvh_node_t;
+
+typedef struct {
+    bvh_node_t *nodes;
+    int node_count;
+    hittable_t *objects;   /* bounded objects in leaf order */
+    int *ids;              /* index of each bounded object in the build input */
+    int object_count;
+    hittable_t *unbounded; /* objects without bounds, tested by every ray */
+    int *unbounded_ids;
+    int unbounded_count;
+    /* Motion blur: node boxes hold the bounds at time0 and end_boxes those at
+     * time1; rays test the box interpolated to their time. NULL when static. */
+    aabb_t *end_boxes;
+    double time0, time1;
+} bvh_t;
+
+/* Build nodes over count boxes; nodes must hold 2 * count entries. order[i]
+ * receives the index of the box stored at leaf slot i. Returns the number of
+ * nodes, or -1 on allocation failure. Shared with primitives that keep their
+ * own BVH (meshes). */
+int bvh_build(const aabb_t *boxes, int count, bvh_node_t *nodes, int *order);
+
+/* Build a BVH over count objects. Returns NULL on allocation failure. */
+bvh_t *bvh_create(const hittable_t *objects, int count);
+
+/* Recompute the node bounds bottom-up after objects moved, keeping the tree
+ * topology. With time1 > time0, objects providing motion_bounds get separate
+ * boxes at both ends of the interval. Returns 0, or -1 on allocation failure. */
+int bvh_refit(bvh_t *bvh, double time0, double time1);
+
+/* Find the closest intersection; rec->object is the hit object's index in
+ * the objects the BVH was built over */
+int bvh_hit(const bvh_t *bvh, const ray_t r, double t_min, double t_max,
+            hit_record_t *rec);
+
+/* Whether r hits anything within (t_min, t_max): stops at the first hit
+ * found, however far along the ray */
+int bvh_occluded(const bvh_t *bvh, const ray_t r, double t_min, double t_max);
+
+/* Bounds of everything in the BVH; returns 0 if empty or unbounded */
+int bvh_bounding_box(const bvh_t *bvh, aabb_t *box);
+
+/* Wrap a BVH as a hittable; destroy frees the BVH but not its objects */
+hittable_t bvh_to_hittable(bvh_t *bvh);
+
+/* Free the BVH (the objects are left alone) */
+void bvh_destroy(bvh_t *bvh);
+
+#endif /* BVH_H */
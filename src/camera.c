@@ -1,4 +1,5 @@
 #include "camera.h"
+#include "dispatch.h"
 #include "vec3.h"
 #include <math.h>
 
@@ -48,16 +49,43 @@ camera_t camera_create(vec3_t lookfrom, vec3_t lookat, vec3_t vup, double vfov,
     };
 }
 
+/* Open the shutter over [time0, time1] */
+void camera_set_shutter(camera_t *cam, double time0, double time1) {
+    cam->time0 = time0;
+    cam->time1 = time1 > time0 ? time1 : time0;
+}
+
 /* Generate a ray through the camera at (u, v) with optional random offset */
+VIBE_KERNEL
 ray_t camera_get_ray(const camera_t *cam, double u, double v) {
     vec3_t rd = vec3_mul(random_in_unit_disk(), cam->lens_radius);
     vec3_t offset = vec3_add(vec3_mul(cam->u, rd.e[0]),
                               vec3_mul(cam->v, rd.e[1]));
+    /* Static shutters draw no random number, keeping still frames unchanged */
+    double time = cam->time1 > cam->time0
+                      ? random_double_range(cam->time0, cam->time1)
+                      : cam->time0;
 
-    return ray(
+    return ray_timed(
         vec3_add(cam->origin, offset),
         vec3_sub(vec3_add(cam->lower_left_corner,
                          vec3_add(vec3_mul(cam->horizontal, u),
                                  vec3_mul(cam->vertical, v))),
-                vec3_add(cam->origin, offset)));
+                vec3_add(cam->origin, offset)),
+        time);
+}
+
+/* Image coordinates of a point seen through the lens centre */
+int camera_project(const camera_t *cam, vec3_t point, double *u, double *v) {
+    vec3_t d = vec3_sub(point, cam->origin);
+    double depth = -vec3_dot(d, cam->w);
+    if (depth <= 0.0) return 0;
+
+    /* Scale d onto the plane of the viewport, then measure along its edges */
+    vec3_t corner = vec3_sub(cam->lower_left_corner, cam->origin);
+    double focus = -vec3_dot(corner, cam->w);
+    vec3_t p = vec3_sub(vec3_mul(d, focus / depth), corner);
+    *u = vec3_dot(p, cam->horizontal) / vec3_length_squared(cam->horizontal);
+    *v = vec3_dot(p, cam->vertical) / vec3_length_squared(cam->vertical);
+    return 1;
 }
@@ -12,6 +12,7 @@ typedef struct {
     vec3_t vertical;
     vec3_t u, v, w;
     double lens_radius;
+    double time0, time1; /* shutter interval; rays get a random time inside it */
 } camera_t;
 
 /* Create a camera with look-at and field of view
@@ -23,7 +24,15 @@ typedef struct {
 camera_t camera_create(vec3_t lookfrom, vec3_t lookat, vec3_t vup, double vfov,
                        double aspect_ratio, double aperture, double focus_dist);
 
+/* Open the shutter over [time0, time1] (time0 == time1 means no motion blur) */
+void camera_set_shutter(camera_t *cam, double time0, double time1);
+
 /* Generate a ray through the camera at (u, v) with optional random offset */
 ray_t camera_get_ray(const camera_t *cam, double u, double v);
 
+/* Image coordinates (u, v) at which a ray through the lens centre meets point,
+ * the inverse of camera_get_ray without defocus. Returns 0 if the point is not
+ * in front of the camera. */
+int camera_project(const camera_t *cam, vec3_t point, double *u, double *v);
+
 #endif /* CAMERA_H */
@@ -0,0 +1,29 @@
+#ifndef COMPILED_H
+#define COMPILED_H
+
+#include "camera.h"
+#include "render.h"
+
+/* Renderers specialized to one fixed scene. vibe_scenec writes a scene's
+ * BVH, spheres and materials out as C constants, then includes
+ * compiled_kernel.h, which turns them into the functions below: traversal
+ * and shading see only the scene's own primitive and material kinds, with
+ * each material's parameters folded into its own case of a switch, and no
+ * function pointers. A compiled scene renders exactly the image
+ * render_region renders for the scene it was compiled from. */
+
+/* Name and seed of the scene compiled in */
+extern const char compiled_scene_name[];
+extern const unsigned int compiled_scene_seed;
+
+/* Camera of the compiled scene's default view for the given aspect ratio */
+camera_t compiled_camera(double aspect_ratio);
+
+/* Render samples [s0, s1) of every pixel of rect into out, as render_region
+ * does for the compiled scene. Settings' batching, guide, caustics,
+ * footprint and replicas are not supported and are ignored. Returns 0 when
+ * done, -1 if cancelled. */
+int compiled_render(const camera_t *camera, const render_settings_t *settings,
+                    render_rect_t rect, int s0, int s1, accum_t *out);
+
+#endif /* COMPILED_H */
@@ -0,0 +1,251 @@
+#ifndef COMPILED_KERNEL_H
+#define COMPILED_KERNEL_H
+
+/* The hand-written half of every renderer vibe_scenec generates. A generated
+ * file defines KERNEL_NODES, KERNEL_SPHERES and KERNEL_STACK, includes this
+ * header, then defines the constants and kernel_scatter declared below. The
+ * arithmetic mirrors sphere.c, material.c and render.c step for step, so the
+ * images match the generic renderer's exactly. */
+
+#include "aabb.h"
+#include "compiled.h"
+#include "vec3.h"
+#include <math.h>
+#include <omp.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define USE_OPENMP 1
+
+/* A node of the scene's BVH, laid out as bvh_node_t */
+typedef struct {
+    aabb_t box;
+    int start; /* leaf: first sphere; interior: index of the right child */
+    int count; /* spheres in a leaf, 0 for interior nodes */
+    int axis;
+} kernel_node_t;
+
+/* The scene's default view and shutter */
+typedef struct {
+    double lookfrom[3], lookat[3], vup[3];
+    double vfov, aperture, focus_dist;
+    double shutter_open, shutter_close;
+} kernel_view_t;
+
+/* A hit, with the material as an index into kernel_scatter's cases */
+typedef struct {
+    vec3_t point;
+    vec3_t normal;
+    double t;
+    int front_face;
+    int material;
+} kernel_hit_t;
+
+/* Defined by the generated file */
+static const kernel_node_t kernel_nodes[KERNEL_NODES];
+static const double kernel_spheres[KERNEL_SPHERES][4]; /* center, radius; leaf order */
+static const unsigned short kernel_sphere_material[KERNEL_SPHERES];
+static const kernel_view_t kernel_view;
+static int kernel_scatter(int material, const ray_t r_in, const kernel_hit_t *rec,
+                          vec3_t *attenuation, ray_t *scattered);
+
+/* Lambertian scattering (lambertian_scatter) */
+static inline int kernel_lambertian(vec3_t albedo, const ray_t r_in, const kernel_hit_t *rec,
+                                    vec3_t *attenuation, ray_t *scattered) {
+    *attenuation = albedo;
+    vec3_t scatter_direction = vec3_add(rec->normal, random_unit_vector());
+    if (vec3_length_squared(scatter_direction) < 1e-8) {
+        scatter_direction = rec->normal;
+    }
+    *scattered = ray_timed(rec->point, scatter_direction, r_in.time);
+    return 1;
+}
+
+/* Metal scattering (metal_scatter) */
+static inline int kernel_metal(vec3_t albedo, double fuzz, const ray_t r_in,
+                               const kernel_hit_t *rec, vec3_t *attenuation,
+                               ray_t *scattered) {
+    vec3_t reflected =
+        vec3_sub(r_in.direction,
+                 vec3_mul(rec->normal, 2.0 * vec3_dot(r_in.direction, rec->normal)));
+    reflected = vec3_normalize(reflected);
+
+    vec3_t fuzz_vec = vec3_mul(random_in_unit_sphere(), fuzz);
+    *scattered = ray_timed(rec->point, vec3_add(reflected, fuzz_vec), r_in.time);
+    *attenuation = albedo;
+    return vec3_dot(scattered->direction, rec->normal) > 0;
+}
+
+/* Schlick's approximation for reflectance */
+static inline double kernel_reflectance(double cosine, double ref_idx) {
+    double r0 = (1.0 - ref_idx) / (1.0 + ref_idx);
+    r0 = r0 * r0;
+    return r0 + (1.0 - r0) * pow(1.0 - cosine, 5.0);
+}
+
+/* Dielectric scattering (dielectric_scatter) */
+static inline int kernel_dielectric(double ir, const ray_t r_in, const kernel_hit_t *rec,
+                                    vec3_t *attenuation, ray_t *scattered) {
+    *attenuation = vec3(1.0, 1.0, 1.0);
+    double etai_over_etat = rec->front_face ? (1.0 / ir) : ir;
+
+    vec3_t unit_direction = vec3_normalize(r_in.direction);
+    double cos_theta = fmin(-vec3_dot(unit_direction, rec->normal), 1.0);
+    double sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+
+    int cannot_refract = etai_over_etat * sin_theta > 1.0;
+    vec3_t direction;
+    if (cannot_refract || kernel_reflectance(cos_theta, etai_over_etat) > random_double()) {
+        direction = vec3_sub(unit_direction,
+                             vec3_mul(rec->normal, 2.0 * vec3_dot(unit_direction, rec->normal)));
+    } else {
+        vec3_t r_out_perp = vec3_mul(vec3_add(unit_direction, vec3_mul(rec->normal, cos_theta)),
+                                     etai_over_etat);
+        double r_out_parallel_len_sq = 1.0 - vec3_length_squared(r_out_perp);
+        vec3_t r_out_parallel = vec3_mul(rec->normal, -sqrt(fabs(r_out_parallel_len_sq)));
+        direction = vec3_add(r_out_perp, r_out_parallel);
+    }
+    *scattered = ray_timed(rec->point, direction, r_in.time);
+    return 1;
+}
+
+/* Ray-sphere intersection with sphere i (hit_sphere) */
+static inline int kernel_sphere_hit(int i, const ray_t r, double t_min, double t_max,
+                                    kernel_hit_t *rec) {
+    vec3_t center = vec3(kernel_spheres[i][0], kernel_spheres[i][1], kernel_spheres[i][2]);
+    double radius = kernel_spheres[i][3];
+    vec3_t oc = vec3_sub(r.origin, center);
+    double a = vec3_length_squared(r.direction);
+    double half_b = vec3_dot(oc, r.direction);
+    double c = vec3_length_squared(oc) - radius * radius;
+    double discriminant = half_b * half_b - a * c;
+    if (discriminant < 0) return 0;
+
+    double sqrt_discriminant = sqrt(discriminant);
+    double t = (-half_b - sqrt_discriminant) / a;
+    if (t < t_min || t_max < t) {
+        t = (-half_b + sqrt_discriminant) / a;
+        if (t < t_min || t_max < t) return 0;
+    }
+
+    rec->t = t;
+    rec->point = ray_at(r, t);
+    vec3_t outward_normal = vec3_div(vec3_sub(rec->point, center), radius);
+    rec->front_face = vec3_dot(r.direction, outward_normal) < 0;
+    rec->normal = rec->front_face ? outward_normal : vec3_mul(outward_normal, -1.0);
+    rec->material = kernel_sphere_material[i];
+    return 1;
+}
+
+/* Closest hit in the scene (bvh_hit) */
+static inline int kernel_hit(const ray_t r, double t_min, double t_max, kernel_hit_t *rec) {
+    vec3_t inv_dir = vec3(1.0 / r.direction.e[0], 1.0 / r.direction.e[1],
+                          1.0 / r.direction.e[2]);
+    int stack[KERNEL_STACK];
+    int sp = 0, index = 0, hit_anything = 0;
+    double closest_so_far = t_max;
+
+    while (1) {
+        const kernel_node_t *node = &kernel_nodes[index];
+        if (aabb_hit(&node->box, r.origin, inv_dir, t_min, closest_so_far)) {
+            if (node->count > 0) {
+                for (int i = node->start; i < node->start + node->count; i++) {
+                    if (kernel_sphere_hit(i, r, t_min, closest_so_far, rec)) {
+                        hit_anything = 1;
+                        closest_so_far = rec->t;
+                    }
+                }
+            } else {
+                int first = index + 1;
+                int second = node->start;
+                if (r.direction.e[node->axis] < 0.0) {
+                    first = node->start;
+                    second = index + 1;
+                }
+                stack[sp++] = second;
+                index = first;
+                continue;
+            }
+        }
+        if (sp == 0) break;
+        index = stack[--sp];
+    }
+    return hit_anything;
+}
+
+/* Radiance along a ray (ray_color) */
+static vec3_t kernel_color(const ray_t r, int depth) {
+    kernel_hit_t rec;
+    if (depth <= 0) {
+        return vec3(0.0, 0.0, 0.0);
+    }
+    if (kernel_hit(r, 0.001, INFINITY, &rec)) {
+        ray_t scattered;
+        vec3_t attenuation;
+        if (kernel_scatter(rec.material, r, &rec, &attenuation, &scattered)) {
+            vec3_t color = kernel_color(scattered, depth - 1);
+            return vec3(attenuation.e[0] * color.e[0], attenuation.e[1] * color.e[1],
+                        attenuation.e[2] * color.e[2]);
+        }
+        return vec3(0.0, 0.0, 0.0);
+    }
+    return sky_color(r);
+}
+
+/* One radiance component in fixed point (to_fixed) */
+static inline uint64_t kernel_fixed(double x) {
+    if (!(x > 0.0)) return 0;
+    if (x > ACCUM_MAX_SAMPLE) x = ACCUM_MAX_SAMPLE;
+    return (uint64_t)(x * (double)(1 << ACCUM_FRACTION_BITS) + 0.5);
+}
+
+/* Camera of the default view */
+camera_t compiled_camera(double aspect_ratio) {
+    const kernel_view_t *v = &kernel_view;
+    camera_t camera = camera_create(vec3(v->lookfrom[0], v->lookfrom[1], v->lookfrom[2]),
+                                    vec3(v->lookat[0], v->lookat[1], v->lookat[2]),
+                                    vec3(v->vup[0], v->vup[1], v->vup[2]), v->vfov,
+                                    aspect_ratio, v->aperture, v->focus_dist);
+    camera_set_shutter(&camera, v->shutter_open, v->shutter_close);
+    return camera;
+}
+
+/* Render samples [s0, s1) of rect (render_region, render_pixel) */
+int compiled_render(const camera_t *camera, const render_settings_t *settings,
+                    render_rect_t rect, int s0, int s1, accum_t *out) {
+    int rect_width = rect.x1 - rect.x0;
+    int rect_height = rect.y1 - rect.y0;
+    if (rect_width <= 0 || rect_height <= 0 || s1 <= s0) return 0;
+    int width = settings->width;
+    int height = settings->height;
+    int threads = settings->threads > 0 ? settings->threads : omp_get_max_threads();
+    atomic_int *cancel = settings->cancel;
+
+    #if USE_OPENMP
+    #pragma omp parallel for num_threads(threads) schedule(dynamic, 100)
+    #endif
+    for (int idx = 0; idx < rect_width * rect_height; idx++) {
+        if (cancel && atomic_load_explicit(cancel, memory_order_relaxed)) continue;
+
+        int x = rect.x0 + idx % rect_width;
+        int y = rect.y0 + idx / rect_width;
+        int j = height - 1 - y;
+        uint64_t pixel = (uint64_t)y * width + x;
+        accum_pixel_t *acc = &out->pixels[(size_t)(y - rect.y0) * out->width + (x - rect.x0)];
+        for (int s = s0; s < s1; s++) {
+            random_seed(sample_seed(settings->seed, pixel, s));
+            double u = (x + random_double()) / (width - 1);
+            double v = (j + random_double()) / (height - 1);
+            vec3_t color = kernel_color(camera_get_ray(camera, u, v), settings->max_depth);
+            acc->sum[0] += kernel_fixed(color.e[0]);
+            acc->sum[1] += kernel_fixed(color.e[1]);
+            acc->sum[2] += kernel_fixed(color.e[2]);
+        }
+        acc->samples += (uint32_t)(s1 - s0);
+    }
+
+    return cancel && atomic_load(cancel) ? -1 : 0;
+}
+
+#endif /* COMPILED_KERNEL_H */
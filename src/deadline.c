@@ -0,0 +1,217 @@
+#define _POSIX_C_SOURCE 200809L
+#include "deadline.h"
+#include "affinity.h"
+#include <omp.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define USE_OPENMP 1
+#define PILOT_STRIDE 16      /* the pilot traces one pixel in this many */
+#define PASS_SPLIT 4         /* a pass takes this fraction of the remaining time */
+#define FINAL_PASS 0.08      /* below this many seconds left, one last pass */
+#define FINAL_SAFETY 0.95    /* the last pass plans for this share of the time left */
+#define MIN_RATE_TIME 1e-3   /* shorter passes do not update the rate */
+#define VARIANCE_FLOOR 1e-4  /* keeps seemingly noiseless pixels in the running */
+#define DISPLAY_EPSILON 1e-2 /* dark pixels: limits the gamma slope */
+
+/* Shared by the passes of one render */
+typedef struct {
+    const scene_t *scene;
+    const camera_t *camera;
+    const render_settings_t *settings;
+    render_rect_t rect;
+    accum_t *out;
+    double *square; /* per pixel: sum of squared sample luminance */
+    double end;     /* monotonic time at which every pass stops */
+} deadline_state_t;
+
+/* Monotonic time in seconds */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Luminance of a fixed-point radiance sum */
+static double luminance(const uint64_t sum[3]) {
+    return (0.2126 * sum[0] + 0.7152 * sum[1] + 0.0722 * sum[2]) /
+           (double)(1 << ACCUM_FRACTION_BITS);
+}
+
+/* Trace samples [samples, target) of every pixel, one at a time so each
+ * sample's luminance feeds the variance estimate. Stops at the deadline or on
+ * cancellation between samples. Returns the number of samples traced. */
+static uint64_t run_pass(const deadline_state_t *st, const uint32_t *target) {
+    const render_settings_t *settings = st->settings;
+    int rect_width = st->rect.x1 - st->rect.x0;
+    int pixel_count = rect_width * (st->rect.y1 - st->rect.y0);
+    atomic_int *cancel = settings->cancel;
+    atomic_int stop = 0;
+    uint64_t traced = 0;
+
+    #if USE_OPENMP
+    #pragma omp parallel for reduction(+:traced) schedule(dynamic, 64) \
+        num_threads(settings->threads > 0 ? settings->threads : omp_get_max_threads())
+    #endif
+    for (int i = 0; i < pixel_count; i++) {
+        const scene_t *scene = st->scene;
+        if (settings->replicas && settings->replicas[affinity_thread_node()]) {
+            scene = settings->replicas[affinity_thread_node()];
+        }
+        int x = st->rect.x0 + i % rect_width;
+        int y = st->rect.y0 + i / rect_width;
+        accum_pixel_t *acc = &st->out->pixels[i];
+
+        for (int s = (int)acc->samples; s < (int)target[i]; s++) {
+            if (atomic_load_explicit(&stop, memory_order_relaxed)) break;
+            if (now_seconds() >= st->end ||
+                (cancel && atomic_load_explicit(cancel, memory_order_relaxed))) {
+                atomic_store_explicit(&stop, 1, memory_order_relaxed);
+                break;
+            }
+            accum_pixel_t one = {0};
+            render_pixel(scene, st->camera, settings, x, y, s, s + 1, &one);
+            for (int c = 0; c < 3; c++) acc->sum[c] += one.sum[c];
+            acc->samples++;
+            double l = luminance(one.sum);
+            st->square[i] += l * l;
+            traced++;
+        }
+    }
+    return traced;
+}
+
+/* Uncertainty of a pixel's displayed value: variance of its mean luminance,
+ * scaled by the slope of the gamma 2 curve at that luminance */
+static double pixel_error(const accum_pixel_t *acc, double square) {
+    double n = acc->samples;
+    double mean = luminance(acc->sum) / n;
+    double variance = n > 1.0 ? (square - n * mean * mean) / (n - 1.0) : 0.0;
+    if (variance < 0.0) variance = 0.0;
+    return (variance + VARIANCE_FLOOR) / (n * (mean + DISPLAY_EPSILON));
+}
+
+/* Plan a pass of about budget samples into target. Pixels below
+ * DEADLINE_MIN_SPP are first topped up evenly; after that samples go to
+ * pixels in proportion to their error, at most doubling any pixel per pass.
+ * Returns the number of samples planned. */
+static uint64_t plan_pass(const accum_t *out, const double *square, uint32_t cap,
+                          double budget, uint32_t *target) {
+    int pixel_count = out->width * out->height;
+    uint32_t min_spp = cap < DEADLINE_MIN_SPP ? cap : DEADLINE_MIN_SPP;
+    uint32_t lowest = cap;
+    for (int i = 0; i < pixel_count; i++) {
+        if (out->pixels[i].samples < lowest) lowest = out->pixels[i].samples;
+    }
+
+    uint64_t planned = 0;
+    if (lowest < min_spp) {
+        /* Raise the least sampled pixels first, one level at a time; a
+         * level the budget cannot complete gets samples spread evenly */
+        for (int i = 0; i < pixel_count; i++) target[i] = out->pixels[i].samples;
+        for (uint32_t level = lowest; level < min_spp && budget >= 1.0; level++) {
+            int count = 0;
+            for (int i = 0; i < pixel_count; i++) count += target[i] == level;
+            double share = budget >= count ? 1.0 : budget / count;
+            double carry = 0.0;
+            for (int i = 0; i < pixel_count; i++) {
+                if (target[i] != level) continue;
+                carry += share;
+                if (carry >= 1.0) {
+                    target[i]++;
+                    carry -= 1.0;
+                    planned++;
+                }
+            }
+            budget -= count * share;
+        }
+        return planned;
+    }
+
+    double total = 0.0;
+    for (int i = 0; i < pixel_count; i++) {
+        const accum_pixel_t *acc = &out->pixels[i];
+        total += acc->samples < cap ? pixel_error(acc, square[i]) : 0.0;
+    }
+    /* Carry the fractional shares along so rounding keeps the total */
+    double carry = 0.0;
+    for (int i = 0; i < pixel_count; i++) {
+        const accum_pixel_t *acc = &out->pixels[i];
+        uint32_t n = acc->samples;
+        target[i] = n;
+        if (n >= cap || total <= 0.0) continue;
+
+        carry += budget * pixel_error(acc, square[i]) / total;
+        uint32_t extra = (uint32_t)carry;
+        carry -= extra;
+        if (extra > n) extra = n;
+        if (extra > cap - n) extra = cap - n;
+        target[i] = n + extra;
+        planned += extra;
+    }
+    return planned;
+}
+
+/* Render rect to the deadline */
+int deadline_render(const scene_t *scene, const camera_t *camera,
+                    const render_settings_t *settings, render_rect_t rect,
+                    double seconds, accum_t *out, deadline_stats_t *stats) {
+    double start = now_seconds();
+    int pixel_count = out->width * out->height;
+    uint32_t cap = settings->samples_per_pixel > 0 ? (uint32_t)settings->samples_per_pixel : 1;
+    deadline_state_t st = {
+        .scene = scene,
+        .camera = camera,
+        .settings = settings,
+        .rect = rect,
+        .out = out,
+        .square = calloc(pixel_count, sizeof(double)),
+        .end = start + seconds,
+    };
+    uint32_t *target = malloc(pixel_count * sizeof(uint32_t));
+    if (!st.square || !target) {
+        free(st.square);
+        free(target);
+        return -1;
+    }
+
+    *stats = (deadline_stats_t){0};
+    /* Pilot: one sample on a sparse grid of pixels, to measure the rate */
+    uint64_t planned = 0;
+    for (int i = 0; i < pixel_count; i++) {
+        target[i] = i % PILOT_STRIDE == 0;
+        planned += target[i];
+    }
+    for (;;) {
+        double pass_start = now_seconds();
+        uint64_t traced = run_pass(&st, target);
+        double pass_time = now_seconds() - pass_start;
+        stats->passes++;
+        stats->samples += traced;
+        if (traced < planned) break; /* deadline or cancellation */
+        if (pass_time >= MIN_RATE_TIME || stats->rate == 0.0) {
+            stats->rate = traced / (pass_time > 0.0 ? pass_time : 1e-9);
+        }
+
+        double remaining = st.end - now_seconds();
+        if (remaining <= 0.0) break;
+        double budget = remaining > FINAL_PASS ? stats->rate * remaining / PASS_SPLIT
+                                               : stats->rate * remaining * FINAL_SAFETY;
+        if (budget < 1.0) break;
+        planned = plan_pass(out, st.square, cap, budget, target);
+        if (planned == 0) break; /* every pixel is at the cap */
+    }
+    stats->elapsed = now_seconds() - start;
+
+    stats->min_spp = UINT32_MAX;
+    for (int i = 0; i < pixel_count; i++) {
+        uint32_t n = out->pixels[i].samples;
+        if (n < stats->min_spp) stats->min_spp = n;
+        if (n > stats->max_spp) stats->max_spp = n;
+    }
+    stats->mean_spp = (double)stats->samples / pixel_count;
+
+    free(st.square);
+    free(target);
+    return 0;
+}
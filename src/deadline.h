@@ -0,0 +1,36 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include "render.h"
+#include "scene.h"
+#include <stdint.h>
+
+/* Render to a wall-clock deadline. A sparse pilot pass measures the sample
+ * rate, passes spread evenly over the frame bring every pixel to
+ * DEADLINE_MIN_SPP, and adaptive passes then spend the remaining time on the
+ * pixels whose displayed value is least certain. Every pass is sized from the live rate so the last
+ * one ends at the deadline. Pixel (x, y) always holds samples [0, n) of its
+ * random streams, so it matches render_pixel over the same range exactly. */
+
+#define DEADLINE_MIN_SPP 4
+
+/* What a deadline render achieved */
+typedef struct {
+    int passes;
+    uint64_t samples;     /* camera samples traced */
+    uint32_t min_spp;
+    uint32_t max_spp;
+    double mean_spp;
+    double rate;          /* last measured camera samples per second (0 if no
+                           * pass completed) */
+    double elapsed;       /* seconds spent rendering */
+} deadline_stats_t;
+
+/* Render rect into out (zeroed, rect-sized) for at most seconds of wall-clock
+ * time. settings->samples_per_pixel caps every pixel; the render ends early
+ * once all pixels reach it. Returns 0 on success, -1 on allocation failure. */
+int deadline_render(const scene_t *scene, const camera_t *camera,
+                    const render_settings_t *settings, render_rect_t rect,
+                    double seconds, accum_t *out, deadline_stats_t *stats);
+
+#endif /* DEADLINE_H */
@@ -0,0 +1,49 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+/* Runtime ISA dispatch for the hot kernels. Functions marked VIBE_KERNEL are
+ * compiled for several ISA levels and the dynamic loader binds each to the
+ * widest version the CPU supports at startup (GCC target_clones, resolved
+ * from CPUID through ifunc), so one binary runs at full width on every node
+ * generation. No version enables FMA and C11 mode keeps expressions
+ * uncontracted, so all versions compute bit-identical results: nodes of
+ * different generations still render the same pixels.
+ *
+ * KERNEL_CLONES selects the versions (make OPTIONS=-DKERNEL_CLONES=N):
+ *   0  the x86-64 baseline (SSE2) only
+ *   1  AVX2 and the baseline (default)
+ *   2  AVX-512, AVX2 and the baseline
+ * AVX-512 is opt-in: the kernels are scalar double math over 3-vectors,
+ * which gains nothing from 512-bit registers, and that version measured
+ * about 10% slower than AVX2 (see `vibe_bench kernels`). */
+
+#ifndef KERNEL_CLONES
+#define KERNEL_CLONES 1
+#endif
+
+#if KERNEL_CLONES && defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+    defined(__linux__)
+#if KERNEL_CLONES >= 2
+#define VIBE_KERNEL __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define VIBE_KERNEL __attribute__((target_clones("avx2", "default")))
+#endif
+#define VIBE_KERNEL_CLONED 1
+#else
+#define VIBE_KERNEL
+#define VIBE_KERNEL_CLONED 0
+#endif
+
+/* Version of the kernels this machine runs */
+static inline const char *dispatch_level(void) {
+#if VIBE_KERNEL_CLONED
+    __builtin_cpu_init();
+    if (KERNEL_CLONES >= 2 && __builtin_cpu_supports("avx512f")) return "avx512f";
+    if (__builtin_cpu_supports("avx2")) return "avx2";
+    return "sse2";
+#else
+    return "generic";
+#endif
+}
+
+#endif /* DISPATCH_H */
@@ -0,0 +1,446 @@
+#define _POSIX_C_SOURCE 200809L
+#include "distrib.h"
+#include "net.h"
+#include "scene.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_WORKERS 256
+#define POLL_INTERVAL_MS 100
+#define CONNECT_RETRY_SECONDS 10.0
+#define MIN_SPECULATION_SECONDS 0.5
+#define SCENE_NAME_SIZE 32
+
+enum {
+    MSG_JOB = 1,
+    MSG_RESULT = 2,
+    MSG_SHUTDOWN = 3,
+};
+
+/* Everything a worker needs to render one job */
+typedef struct {
+    uint32_t width, height;
+    uint32_t max_depth;
+    uint32_t seed;
+    uint32_t scene_seed;
+    uint32_t x0, y0, x1, y1;
+    uint32_t s0, s1;
+    char scene[SCENE_NAME_SIZE];
+} msg_job_t;
+
+typedef enum { JOB_PENDING, JOB_RUNNING, JOB_DONE } job_state_t;
+
+typedef struct {
+    msg_job_t spec;
+    job_state_t state;
+    int copies;     /* workers currently rendering this job */
+    double started; /* time the oldest running copy was handed out */
+} job_t;
+
+/* A worker connection. Its socket is non-blocking and results are gathered
+ * across reads, so a worker that stalls halfway through one cannot hold up
+ * the coordinator; its job is reassigned like any slow one. */
+typedef struct {
+    int fd;
+    int job;             /* index of the job being rendered, -1 when idle */
+    net_header_t header; /* of the result being received */
+    size_t received;     /* bytes of it received, header included */
+    accum_t *tile;       /* its pixels, once the header is in */
+} worker_t;
+
+/* Close a worker connection and return its job to the queue if nobody else
+ * is rendering it */
+static void drop_worker(worker_t *w, job_t *jobs) {
+    if (w->job >= 0) {
+        job_t *job = &jobs[w->job];
+        job->copies--;
+        if (job->state == JOB_RUNNING && job->copies == 0) {
+            job->state = JOB_PENDING;
+            fprintf(stderr, "Worker lost, requeueing tile (%u,%u) samples %u-%u\n",
+                    job->spec.x0, job->spec.y0, job->spec.s0, job->spec.s1);
+        }
+    }
+    close(w->fd);
+    accum_destroy(w->tile);
+    *w = (worker_t){.fd = -1, .job = -1};
+}
+
+/* Pick the job to hand to an idle worker: pending jobs first, then a running
+ * job that has taken much longer than usual (its result is deterministic, so
+ * whichever copy finishes first wins). Returns -1 if there is nothing to do. */
+static int next_job(job_t *jobs, int job_count, double threshold, double now) {
+    for (int i = 0; i < job_count; i++) {
+        if (jobs[i].state == JOB_PENDING) return i;
+    }
+
+    int slowest = -1;
+    for (int i = 0; i < job_count; i++) {
+        if (jobs[i].state != JOB_RUNNING || jobs[i].copies != 1) continue;
+        if (now - jobs[i].started < threshold) continue;
+        if (slowest < 0 || jobs[i].started < jobs[slowest].started) slowest = i;
+    }
+    return slowest;
+}
+
+/* Read what a worker has sent of its result, at most len bytes into buf;
+ * returns the byte count, 0 if nothing is waiting, -1 on error or end of
+ * stream */
+static ssize_t read_some(int fd, void *buf, size_t len) {
+    while (1) {
+        ssize_t n = recv(fd, buf, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        return n > 0 ? n : -1;
+    }
+}
+
+/* Receive what has arrived of a worker's result and merge it once whole if
+ * the job is still open. Returns 1 if a job was completed, 0 for a duplicate
+ * or a result still on its way, -1 on protocol error. */
+static int receive_result(worker_t *w, job_t *jobs, int job_count, accum_t *out) {
+    net_header_t *h = &w->header;
+    while (w->received < sizeof(*h)) {
+        ssize_t n = read_some(w->fd, (char *)h + w->received, sizeof(*h) - w->received);
+        if (n <= 0) return (int)n;
+        w->received += (size_t)n;
+        if (w->received < sizeof(*h)) continue;
+
+        if (h->magic != NET_MAGIC || h->type != MSG_RESULT) return -1;
+        if ((int)h->id != w->job || w->job < 0 || w->job >= job_count) return -1;
+        const msg_job_t *spec = &jobs[w->job].spec;
+        int tw = (int)(spec->x1 - spec->x0);
+        int th = (int)(spec->y1 - spec->y0);
+        if (h->payload != (uint32_t)(tw * th) * sizeof(accum_pixel_t)) return -1;
+        w->tile = accum_create(tw, th);
+        if (!w->tile) return -1;
+    }
+    while (w->received < sizeof(*h) + h->payload) {
+        size_t done = w->received - sizeof(*h);
+        ssize_t n = read_some(w->fd, (char *)w->tile->pixels + done, h->payload - done);
+        if (n <= 0) return (int)n;
+        w->received += (size_t)n;
+    }
+
+    job_t *job = &jobs[w->job];
+    int completed = 0;
+    if (job->state != JOB_DONE) {
+        accum_merge(out, w->tile, (int)job->spec.x0, (int)job->spec.y0);
+        job->state = JOB_DONE;
+        completed = 1;
+    }
+    accum_destroy(w->tile);
+    w->tile = NULL;
+    w->received = 0;
+
+    job->copies--;
+    w->job = -1;
+    return completed;
+}
+
+/* Number of connected workers */
+static int live_workers(const worker_t *workers) {
+    int live = 0;
+    for (int i = 0; i < MAX_WORKERS; i++) live += workers[i].fd >= 0;
+    return live;
+}
+
+/* Reap local workers that have exited (their pids become 0) and count the
+ * ones still running */
+static int running_children(pid_t *children, int child_count) {
+    int running = 0;
+    for (int i = 0; i < child_count; i++) {
+        if (children[i] <= 0) continue;
+        pid_t reaped = waitpid(children[i], NULL, WNOHANG);
+        if (reaped == children[i] || reaped < 0) {
+            children[i] = 0;
+        } else {
+            running++;
+        }
+    }
+    return running;
+}
+
+/* Render a frame with workers */
+int distrib_coordinate(const distrib_options_t *opts, const char *scene_name,
+                       unsigned int scene_seed, const render_settings_t *settings,
+                       accum_t *out) {
+    if (strlen(scene_name) >= SCENE_NAME_SIZE) return -1;
+
+    int tile = opts->tile_size > 0 ? opts->tile_size : 64;
+    int splits = opts->sample_splits > 0 ? opts->sample_splits : 1;
+    if (splits > settings->samples_per_pixel) splits = settings->samples_per_pixel;
+
+    int tiles_x = (settings->width + tile - 1) / tile;
+    int tiles_y = (settings->height + tile - 1) / tile;
+    int job_count = tiles_x * tiles_y * splits;
+
+    job_t *jobs = calloc(job_count, sizeof(job_t));
+    worker_t *workers = malloc(MAX_WORKERS * sizeof(worker_t));
+    pid_t *children = calloc(opts->local_workers > 0 ? opts->local_workers : 1,
+                             sizeof(pid_t));
+    struct pollfd *fds = malloc((MAX_WORKERS + 1) * sizeof(struct pollfd));
+    if (!jobs || !workers || !children || !fds) {
+        free(jobs);
+        free(workers);
+        free(children);
+        free(fds);
+        return -1;
+    }
+
+    /* Build the job list: each tile split into sample ranges */
+    int n = 0;
+    for (int ty = 0; ty < tiles_y; ty++) {
+        for (int tx = 0; tx < tiles_x; tx++) {
+            for (int k = 0; k < splits; k++) {
+                msg_job_t *spec = &jobs[n++].spec;
+                spec->width = (uint32_t)settings->width;
+                spec->height = (uint32_t)settings->height;
+                spec->max_depth = (uint32_t)settings->max_depth;
+                spec->seed = settings->seed;
+                spec->scene_seed = scene_seed;
+                strcpy(spec->scene, scene_name);
+                spec->x0 = (uint32_t)(tx * tile);
+                spec->y0 = (uint32_t)(ty * tile);
+                spec->x1 = (uint32_t)((tx + 1) * tile < settings->width
+                                          ? (tx + 1) * tile : settings->width);
+                spec->y1 = (uint32_t)((ty + 1) * tile < settings->height
+                                          ? (ty + 1) * tile : settings->height);
+                spec->s0 = (uint32_t)((long)settings->samples_per_pixel * k / splits);
+                spec->s1 = (uint32_t)((long)settings->samples_per_pixel * (k + 1) / splits);
+            }
+        }
+    }
+
+    int listen_fd = net_listen(opts->address);
+    if (listen_fd < 0) {
+        fprintf(stderr, "Error: could not listen on %s\n", opts->address);
+        free(jobs);
+        free(workers);
+        free(children);
+        free(fds);
+        return -1;
+    }
+
+    /* Fork local workers; they connect back like remote ones */
+    int child_count = 0;
+    for (int i = 0; i < opts->local_workers; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listen_fd);
+            _exit(distrib_work(opts->address, 0) == 0 ? 0 : 1);
+        }
+        if (pid > 0) children[child_count++] = pid;
+    }
+
+    for (int i = 0; i < MAX_WORKERS; i++) workers[i] = (worker_t){.fd = -1, .job = -1};
+
+    int done = 0;
+    int joined = 0;
+    int completed_jobs = 0;
+    double total_job_time = 0.0;
+    double worker_wait = opts->worker_wait > 0.0 ? opts->worker_wait : DISTRIB_WORKER_WAIT;
+    double unattended_since = net_now(); /* last time a worker was around */
+    fprintf(stderr, "Coordinating %d jobs on %s...\n", job_count, opts->address);
+
+    while (done < job_count) {
+        /* Give up once no worker is connected or still starting locally and
+         * none has connected for a while */
+        double now = net_now();
+        int present = live_workers(workers) + running_children(children, child_count);
+        if (present > 0) {
+            unattended_since = now;
+        } else if (now - unattended_since > worker_wait) {
+            fprintf(stderr, "\nError: no workers left after %.1f s, %d of %d jobs done\n",
+                    worker_wait, done, job_count);
+            break;
+        }
+
+        /* Hand work to idle workers */
+        double threshold = opts->job_timeout;
+        if (threshold <= 0.0) {
+            threshold = completed_jobs
+                            ? 3.0 * total_job_time / completed_jobs : INFINITY;
+            if (threshold < MIN_SPECULATION_SECONDS) {
+                threshold = MIN_SPECULATION_SECONDS;
+            }
+        }
+        for (int i = 0; i < MAX_WORKERS && joined >= opts->min_workers; i++) {
+            worker_t *w = &workers[i];
+            if (w->fd < 0 || w->job >= 0) continue;
+
+            int j = next_job(jobs, job_count, threshold, now);
+            if (j < 0) break;
+            if (jobs[j].state == JOB_RUNNING) {
+                fprintf(stderr, "Tile (%u,%u) samples %u-%u is slow, reassigning\n",
+                        jobs[j].spec.x0, jobs[j].spec.y0, jobs[j].spec.s0,
+                        jobs[j].spec.s1);
+            }
+            /* An idle worker's socket has room for a job message unless the
+             * worker stopped reading */
+            if (net_send_msg(w->fd, MSG_JOB, (uint32_t)j, &jobs[j].spec,
+                         sizeof(msg_job_t)) != 0) {
+                drop_worker(w, jobs);
+                continue;
+            }
+            if (jobs[j].state == JOB_PENDING) {
+                jobs[j].state = JOB_RUNNING;
+                jobs[j].started = now;
+            }
+            jobs[j].copies++;
+            w->job = j;
+        }
+
+        /* Wait for connections and results */
+        int nfds = 0;
+        fds[nfds++] = (struct pollfd){.fd = listen_fd, .events = POLLIN};
+        for (int i = 0; i < MAX_WORKERS; i++) {
+            if (workers[i].fd >= 0) {
+                fds[nfds++] = (struct pollfd){.fd = workers[i].fd, .events = POLLIN};
+            }
+        }
+        if (poll(fds, nfds, POLL_INTERVAL_MS) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            int slot = -1;
+            for (int i = 0; fd >= 0 && i < MAX_WORKERS; i++) {
+                if (workers[i].fd < 0) {
+                    slot = i;
+                    break;
+                }
+            }
+            if (slot >= 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0) {
+                workers[slot] = (worker_t){.fd = fd, .job = -1};
+                joined++;
+            } else if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        for (int f = 1; f < nfds; f++) {
+            if (!fds[f].revents) continue;
+
+            worker_t *w = NULL;
+            for (int i = 0; i < MAX_WORKERS; i++) {
+                if (workers[i].fd == fds[f].fd) {
+                    w = &workers[i];
+                    break;
+                }
+            }
+            if (!w) continue;
+
+            double started = w->job >= 0 ? jobs[w->job].started : 0.0;
+            int status = receive_result(w, jobs, job_count, out);
+            if (status < 0) {
+                drop_worker(w, jobs);
+            } else if (status > 0) {
+                done++;
+                completed_jobs++;
+                total_job_time += net_now() - started;
+                fprintf(stderr, "\rJobs done: %d/%d", done, job_count);
+            }
+        }
+    }
+    fprintf(stderr, "\n");
+
+    for (int i = 0; i < MAX_WORKERS; i++) {
+        if (workers[i].fd >= 0) {
+            net_send_msg(workers[i].fd, MSG_SHUTDOWN, 0, NULL, 0);
+            close(workers[i].fd);
+            accum_destroy(workers[i].tile);
+        }
+    }
+    close(listen_fd);
+    if (strncmp(opts->address, "unix:", 5) == 0) {
+        unlink(opts->address + 5);
+    }
+    for (int i = 0; i < child_count; i++) {
+        if (children[i] > 0) waitpid(children[i], NULL, 0);
+    }
+
+    free(jobs);
+    free(workers);
+    free(children);
+    free(fds);
+    return done == job_count ? 0 : -1;
+}
+
+/* Run a worker until the coordinator shuts it down */
+int distrib_work(const char *address, int max_jobs) {
+    int fd = net_connect(address, CONNECT_RETRY_SECONDS);
+    if (fd < 0) {
+        fprintf(stderr, "Error: worker could not connect to %s\n", address);
+        return -1;
+    }
+
+    scene_t *scene = NULL;
+    char scene_name[SCENE_NAME_SIZE] = "";
+    unsigned int scene_seed = 0;
+    int jobs_done = 0;
+    int status = -1;
+
+    while (1) {
+        net_header_t h;
+        msg_job_t spec;
+        if (net_recv_header(fd, &h) != 0) break;
+        if (h.type == MSG_SHUTDOWN) {
+            status = 0;
+            break;
+        }
+        if (h.type != MSG_JOB || h.payload != sizeof(spec) ||
+            net_recv_all(fd, &spec, sizeof(spec)) != 0) {
+            break;
+        }
+        if (max_jobs > 0 && jobs_done >= max_jobs) {
+            status = 0;
+            break;
+        }
+
+        /* The scene is only rebuilt when the coordinator asks for another one */
+        spec.scene[SCENE_NAME_SIZE - 1] = '\0';
+        if (!scene || scene_seed != spec.scene_seed || strcmp(scene_name, spec.scene) != 0) {
+            scene_destroy(scene);
+            scene = scene_create_named(spec.scene, spec.scene_seed);
+            scene_seed = spec.scene_seed;
+            strcpy(scene_name, spec.scene);
+            if (!scene) break;
+        }
+
+        render_settings_t settings = {
+            .width = (int)spec.width,
+            .height = (int)spec.height,
+            .samples_per_pixel = (int)(spec.s1 - spec.s0),
+            .max_depth = (int)spec.max_depth,
+            .seed = spec.seed,
+        };
+        render_rect_t rect = {(int)spec.x0, (int)spec.y0, (int)spec.x1, (int)spec.y1};
+        camera_t camera = scene_camera(scene, (double)settings.width / settings.height);
+
+        accum_t *tile = accum_create(rect.x1 - rect.x0, rect.y1 - rect.y0);
+        if (!tile) break;
+        render_region(scene, &camera, &settings, rect, (int)spec.s0, (int)spec.s1,
+                      tile);
+        uint32_t size =
+            (uint32_t)((size_t)tile->width * tile->height * sizeof(accum_pixel_t));
+        int sent = net_send_msg(fd, MSG_RESULT, h.id, tile->pixels, size);
+        accum_destroy(tile);
+        if (sent != 0) break;
+        jobs_done++;
+    }
+
+    scene_destroy(scene);
+    close(fd);
+    return status;
+}
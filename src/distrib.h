@@ -0,0 +1,45 @@
+#ifndef DISTRIB_H
+#define DISTRIB_H
+
+#include "render.h"
+
+/* Multi-process rendering. A coordinator splits a frame into jobs (a tile and
+ * a range of its samples) and hands them to worker processes over a stream
+ * socket. Workers build the scene from its name and seed and return the tile's
+ * fixed-point accumulation buffer, which the coordinator merges exactly.
+ *
+ * Addresses are "unix:/path/to/socket" or "tcp:host:port". Messages use the
+ * host byte order and struct layout, so all processes must share an
+ * architecture. */
+
+typedef struct {
+    const char *address;
+    int local_workers;  /* workers forked on this machine; remote ones may join */
+    int tile_size;      /* tile edge in pixels */
+    int sample_splits;  /* sample ranges each tile is divided into */
+    int min_workers;    /* jobs are held back until this many workers joined */
+    double job_timeout; /* seconds before a running job is also handed to an idle
+                         * worker; 0 = three times the mean job time */
+    double worker_wait; /* seconds to wait for a worker to connect while none is
+                         * connected and no local one is running before giving
+                         * up; 0 = DISTRIB_WORKER_WAIT */
+} distrib_options_t;
+
+#define DISTRIB_WORKER_WAIT 30.0 /* default worker_wait, in seconds */
+
+/* Render a frame with workers and merge the result into out (which must be
+ * settings->width x settings->height). Duplicate results of reassigned jobs are
+ * discarded. Returns 0 on success, -1 on a setup error or when every worker
+ * is gone and none connects within opts->worker_wait. */
+int distrib_coordinate(const distrib_options_t *opts, const char *scene_name,
+                       unsigned int scene_seed, const render_settings_t *settings,
+                       accum_t *out);
+
+/* Run a worker until the coordinator shuts it down. Connection attempts are
+ * retried for a few seconds so workers may start before the coordinator.
+ * max_jobs > 0 makes the worker drop its connection instead of answering job
+ * number max_jobs + 1 (used to exercise reassignment).
+ * Returns 0 on a clean shutdown, -1 on error. */
+int distrib_work(const char *address, int max_jobs);
+
+#endif /* DISTRIB_H */
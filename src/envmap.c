@@ -0,0 +1,210 @@
+#include "envmap.h"
+#include "image.h"
+#include "utils.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Build an alias table over n weights (Vose's method); 0 on success */
+static int alias_build(const double *weights, int n, float *prob, int *alias) {
+    int *small = malloc(n * sizeof(int));
+    int *large = malloc(n * sizeof(int));
+    double *scaled = malloc(n * sizeof(double));
+    if (!small || !large || !scaled) {
+        free(small);
+        free(large);
+        free(scaled);
+        return -1;
+    }
+    double total = 0.0;
+    for (int i = 0; i < n; i++) total += weights[i];
+    int small_count = 0, large_count = 0;
+    for (int i = 0; i < n; i++) {
+        scaled[i] = total > 0.0 ? weights[i] * n / total : 1.0;
+        if (scaled[i] < 1.0) {
+            small[small_count++] = i;
+        } else {
+            large[large_count++] = i;
+        }
+    }
+    /* Each small entry is topped up from a large one, which may become small */
+    while (small_count > 0 && large_count > 0) {
+        int s = small[--small_count];
+        int l = large[--large_count];
+        prob[s] = (float)scaled[s];
+        alias[s] = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            small[small_count++] = l;
+        } else {
+            large[large_count++] = l;
+        }
+    }
+    /* What remains is full up to rounding */
+    while (large_count > 0) {
+        int l = large[--large_count];
+        prob[l] = 1.0f;
+        alias[l] = l;
+    }
+    while (small_count > 0) {
+        int s = small[--small_count];
+        prob[s] = 1.0f;
+        alias[s] = s;
+    }
+    free(small);
+    free(large);
+    free(scaled);
+    return 0;
+}
+
+/* Entry of an alias table over n picked by uniform u in [0, 1) */
+static int alias_pick(const float *prob, const int *alias, int n, double u) {
+    double x = u * n;
+    int i = (int)x;
+    if (i >= n) i = n - 1;
+    return x - i < prob[i] ? i : alias[i];
+}
+
+/* Create a map from linear RGB */
+envmap_t *envmap_create(int width, int height, const float *rgb) {
+    if (width < 1 || height < 1 || !rgb) return NULL;
+    size_t texels = (size_t)width * height;
+    for (size_t i = 0; i < texels * 3; i++) {
+        if (!(rgb[i] >= 0.0f) || !isfinite(rgb[i])) return NULL;
+    }
+
+    envmap_t *env = calloc(1, sizeof(envmap_t));
+    double *weights = malloc(texels * sizeof(double));
+    double *row_weights = malloc(height * sizeof(double));
+    if (!env || !weights || !row_weights) {
+        free(env);
+        free(weights);
+        free(row_weights);
+        return NULL;
+    }
+    env->width = width;
+    env->height = height;
+    env->rgb = malloc(texels * 3 * sizeof(float));
+    env->density = malloc(texels * sizeof(float));
+    env->row_prob = malloc(height * sizeof(float));
+    env->row_alias = malloc(height * sizeof(int));
+    env->prob = malloc(texels * sizeof(float));
+    env->alias = malloc(texels * sizeof(int));
+    int ok = env->rgb && env->density && env->row_prob && env->row_alias && env->prob &&
+             env->alias;
+
+    if (ok) {
+        memcpy(env->rgb, rgb, texels * 3 * sizeof(float));
+
+        /* Texels weigh by luminance times the solid angle they cover; a
+         * black map is sampled uniformly over the sphere */
+        double total = 0.0;
+        for (int y = 0; y < height; y++) {
+            double sin_theta = sin(PI * (y + 0.5) / height);
+            for (int x = 0; x < width; x++) {
+                const float *c = &rgb[3 * ((size_t)y * width + x)];
+                double lum = 0.2126 * c[0] + 0.7152 * c[1] + 0.0722 * c[2];
+                weights[(size_t)y * width + x] = lum * sin_theta;
+                total += lum * sin_theta;
+            }
+        }
+        for (int y = 0; y < height && total <= 0.0; y++) {
+            for (int x = 0; x < width; x++) {
+                weights[(size_t)y * width + x] = sin(PI * (y + 0.5) / height);
+            }
+        }
+        total = 0.0;
+        for (int y = 0; y < height; y++) {
+            row_weights[y] = 0.0;
+            for (int x = 0; x < width; x++) row_weights[y] += weights[(size_t)y * width + x];
+            total += row_weights[y];
+        }
+        for (size_t i = 0; i < texels; i++) {
+            env->density[i] = (float)(weights[i] / total * texels);
+        }
+        ok = alias_build(row_weights, height, env->row_prob, env->row_alias) == 0;
+        for (int y = 0; y < height && ok; y++) {
+            size_t row = (size_t)y * width;
+            ok = alias_build(&weights[row], width, &env->prob[row], &env->alias[row]) == 0;
+        }
+    }
+    free(weights);
+    free(row_weights);
+    if (!ok) {
+        envmap_destroy(env);
+        return NULL;
+    }
+    return env;
+}
+
+/* Load a PFM image */
+envmap_t *envmap_load_pfm(const char *path) {
+    int width, height;
+    float *rgb = image_read_pfm(path, &width, &height);
+    if (!rgb) return NULL;
+    envmap_t *env = envmap_create(width, height, rgb);
+    free(rgb);
+    return env;
+}
+
+/* Write a map as PFM */
+int envmap_write_pfm(const envmap_t *env, const char *path) {
+    return image_write_pfm(path, env->rgb, env->width, env->height);
+}
+
+/* Free a map */
+void envmap_destroy(envmap_t *env) {
+    if (!env) return;
+    free(env->rgb);
+    free(env->density);
+    free(env->row_prob);
+    free(env->row_alias);
+    free(env->prob);
+    free(env->alias);
+    free(env);
+}
+
+/* Texel seen along a direction, with the sine of its polar angle */
+static size_t texel_of(const envmap_t *env, vec3_t direction, double *sin_theta) {
+    double length = vec3_length(direction);
+    double cos_theta = length > 0.0 ? direction.e[1] / length : 1.0;
+    cos_theta = fmax(-1.0, fmin(1.0, cos_theta));
+    double theta = acos(cos_theta);
+    double phi = atan2(direction.e[2], direction.e[0]);
+    int x = (int)((phi + PI) / (2.0 * PI) * env->width);
+    int y = (int)(theta / PI * env->height);
+    if (x < 0) x = 0;
+    if (x >= env->width) x = env->width - 1;
+    if (y >= env->height) y = env->height - 1;
+    *sin_theta = sqrt(fmax(0.0, 1.0 - cos_theta * cos_theta));
+    return (size_t)y * env->width + x;
+}
+
+/* Radiance from a direction */
+vec3_t envmap_lookup(const envmap_t *env, vec3_t direction) {
+    double sin_theta;
+    const float *c = &env->rgb[3 * texel_of(env, direction, &sin_theta)];
+    return vec3(c[0], c[1], c[2]);
+}
+
+/* Direction drawn in proportion to radiance */
+vec3_t envmap_sample(const envmap_t *env, double u1, double u2, double u3, double u4,
+                     double *pdf) {
+    int y = alias_pick(env->row_prob, env->row_alias, env->height, u1);
+    size_t row = (size_t)y * env->width;
+    int x = alias_pick(&env->prob[row], &env->alias[row], env->width, u2);
+
+    /* Uniform over the texel in (phi, theta) */
+    double phi = 2.0 * PI * (x + u3) / env->width - PI;
+    double theta = PI * (y + u4) / env->height;
+    double sin_theta = sin(theta);
+    *pdf = sin_theta > 0.0 ? env->density[row + x] / (2.0 * PI * PI * sin_theta) : 0.0;
+    return vec3(sin_theta * cos(phi), cos(theta), sin_theta * sin(phi));
+}
+
+/* Density with which a direction is sampled */
+double envmap_pdf(const envmap_t *env, vec3_t direction) {
+    double sin_theta;
+    size_t texel = texel_of(env, direction, &sin_theta);
+    return sin_theta > 0.0 ? env->density[texel] / (2.0 * PI * PI * sin_theta) : 0.0;
+}
@@ -0,0 +1,53 @@
+#ifndef ENVMAP_H
+#define ENVMAP_H
+
+#include "vec3.h"
+
+/* HDR environment maps: light arriving from infinitely far away, stored as a
+ * latitude-longitude image (row 0 looks straight up, the +y axis; column 0
+ * faces -x and columns run toward -z). Lookups take the nearest texel. For
+ * importance sampling each row holds an alias table over its texels
+ * (the conditional distribution) and one more alias table picks the row
+ * (the marginal), both in proportion to luminance times sin(theta), the
+ * solid angle a texel covers. Sampling a direction and evaluating its
+ * density are O(1) whatever the resolution, so a small sun in a large map
+ * is found by one table lookup. */
+
+typedef struct {
+    int width;
+    int height;
+    float *rgb;        /* linear RGB triples, top row first */
+    float *density;    /* sampling density per texel, over the unit square */
+    float *row_prob;   /* marginal alias table over rows */
+    int *row_alias;
+    float *prob;       /* conditional alias tables, one row of texels each */
+    int *alias;
+} envmap_t;
+
+/* Create a map from width x height linear RGB triples, top row first
+ * (copied). Returns NULL on invalid sizes, negative or non-finite texels, or
+ * allocation failure. */
+envmap_t *envmap_create(int width, int height, const float *rgb);
+
+/* Load a map from a PFM image (colour "PF" or grey "Pf", either byte order);
+ * NULL if it cannot be read */
+envmap_t *envmap_load_pfm(const char *path);
+
+/* Write a map as a little-endian colour PFM; 0 on success */
+int envmap_write_pfm(const envmap_t *env, const char *path);
+
+/* Free a map */
+void envmap_destroy(envmap_t *env);
+
+/* Radiance arriving from direction (any length) */
+vec3_t envmap_lookup(const envmap_t *env, vec3_t direction);
+
+/* Unit direction drawn in proportion to the map's radiance from four
+ * uniform numbers in [0, 1); its density over solid angle goes to *pdf */
+vec3_t envmap_sample(const envmap_t *env, double u1, double u2, double u3, double u4,
+                     double *pdf);
+
+/* Density over solid angle with which envmap_sample draws direction */
+double envmap_pdf(const envmap_t *env, vec3_t direction);
+
+#endif /* ENVMAP_H */
@@ -0,0 +1,47 @@
+#include "footprint.h"
+#include <stdlib.h>
+
+/* Create empty footprints */
+footprint_t *footprint_create(int width, int height) {
+    if (width <= 0 || height <= 0) return NULL;
+
+    footprint_t *footprint = malloc(sizeof(footprint_t));
+    if (!footprint) return NULL;
+    footprint->width = width;
+    footprint->height = height;
+    footprint->lights = 0;
+    footprint->pixels = malloc((size_t)width * height * sizeof(footprint_pixel_t));
+    if (!footprint->pixels) {
+        free(footprint);
+        return NULL;
+    }
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        footprint_pixel_reset(&footprint->pixels[i]);
+    }
+    return footprint;
+}
+
+/* Free footprints */
+void footprint_destroy(footprint_t *footprint) {
+    if (!footprint) return;
+    free(footprint->pixels);
+    free(footprint);
+}
+
+/* Mark the pixels that may have hit the objects */
+int footprint_mark(const footprint_t *footprint, const int *objects, int count,
+                   unsigned char *mask) {
+    int marked = 0;
+    for (size_t i = 0; i < (size_t)footprint->width * footprint->height; i++) {
+        const footprint_pixel_t *pixel = &footprint->pixels[i];
+        int touched = 0;
+        for (int k = 0; k < count && !touched; k++) {
+            touched = footprint_touches(pixel, objects[k]);
+        }
+        if (touched && !mask[i]) {
+            mask[i] = 1;
+            marked++;
+        }
+    }
+    return marked;
+}
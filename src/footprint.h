@@ -0,0 +1,75 @@
+#ifndef FOOTPRINT_H
+#define FOOTPRINT_H
+
+#include <stdint.h>
+
+/* Path footprints for incremental re-rendering. While a frame renders, each
+ * pixel records the scene's top-level objects (indices into scene->world)
+ * that any of its paths hit, in a small Bloom filter, and the object its
+ * first sample sees. After an edit, the pixels whose filters may hold the
+ * edited object are the ones whose samples could change through the paths
+ * they took; false positives only re-render more. An edit that changes the
+ * scene's lights changes how every pixel that used the light tree sampled
+ * it, so those pixels also record FOOTPRINT_LIGHTS. */
+
+#define FOOTPRINT_WORDS 4    /* filter size: 256 bits per pixel */
+#define FOOTPRINT_SKY (-1)   /* first hit of a pixel whose first sample escaped */
+#define FOOTPRINT_UNSET (-2) /* first hit not recorded yet */
+#define FOOTPRINT_LIGHTS (-3) /* recorded as an object by paths that sampled or
+                               * weighted against the light tree, whose
+                               * probabilities depend on every light */
+
+typedef struct {
+    uint64_t bits[FOOTPRINT_WORDS]; /* objects hit by any path */
+    int32_t first_hit;              /* object the first sample's camera ray hit */
+    uint32_t reserved;
+} footprint_pixel_t;
+
+/* Footprints of a frame; row 0 is the top of the image */
+typedef struct {
+    int width;
+    int height;
+    footprint_pixel_t *pixels;
+    uint64_t lights; /* signature of the light tree recorded against, 0 for none */
+} footprint_t;
+
+/* Create empty footprints for a width x height frame; NULL on failure */
+footprint_t *footprint_create(int width, int height);
+
+/* Free footprints */
+void footprint_destroy(footprint_t *footprint);
+
+/* Forget what a pixel's paths hit */
+static inline void footprint_pixel_reset(footprint_pixel_t *pixel) {
+    for (int w = 0; w < FOOTPRINT_WORDS; w++) pixel->bits[w] = 0;
+    pixel->first_hit = FOOTPRINT_UNSET;
+}
+
+/* The two filter bits of object */
+static inline void footprint_bits(int object, int *a, int *b) {
+    uint64_t h = ((uint64_t)(uint32_t)object + 1) * 0x9e3779b97f4a7c15ull;
+    *a = (int)(h >> 56);
+    *b = (int)(h >> 48) & 0xff;
+}
+
+/* Record that a path of the pixel hit object */
+static inline void footprint_add(footprint_pixel_t *pixel, int object) {
+    int a, b;
+    footprint_bits(object, &a, &b);
+    pixel->bits[a >> 6] |= 1ull << (a & 63);
+    pixel->bits[b >> 6] |= 1ull << (b & 63);
+}
+
+/* Whether a path of the pixel may have hit object (no false negatives) */
+static inline int footprint_touches(const footprint_pixel_t *pixel, int object) {
+    int a, b;
+    footprint_bits(object, &a, &b);
+    return (pixel->bits[a >> 6] >> (a & 63) & 1) && (pixel->bits[b >> 6] >> (b & 63) & 1);
+}
+
+/* Set mask[y * width + x] for the pixels that may have hit any of the count
+ * objects; returns how many it newly set */
+int footprint_mark(const footprint_t *footprint, const int *objects, int count,
+                   unsigned char *mask);
+
+#endif /* FOOTPRINT_H */
@@ -0,0 +1,115 @@
+#define _POSIX_C_SOURCE 200809L
+#include "framebuffer.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Wrap a mapping in a framebuffer_t */
+static framebuffer_t *framebuffer_wrap(void *map, size_t size) {
+    framebuffer_t *fb = malloc(sizeof(framebuffer_t));
+    if (!fb) {
+        munmap(map, size);
+        return NULL;
+    }
+    fb->header = map;
+    fb->size = size;
+    size_t image_size = (size_t)fb->header->stride * fb->header->height;
+    fb->images[0] = (uint8_t *)map + fb->header->header_size;
+    fb->images[1] = fb->images[0] + image_size;
+    return fb;
+}
+
+/* Create (or truncate) the file at path and map it */
+framebuffer_t *framebuffer_create(const char *path, int width, int height) {
+    if (width <= 0 || height <= 0) return NULL;
+
+    size_t stride = (size_t)width * 4;
+    size_t size = FRAMEBUFFER_HEADER_SIZE + 2 * stride * height;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return NULL;
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    framebuffer_header_t *h = map;
+    h->width = (uint32_t)width;
+    h->height = (uint32_t)height;
+    h->stride = (uint32_t)stride;
+    h->header_size = FRAMEBUFFER_HEADER_SIZE;
+    atomic_init(&h->generation, 0);
+    /* Viewers only trust the file once the magic is in place */
+    atomic_thread_fence(memory_order_release);
+    h->magic = FRAMEBUFFER_MAGIC;
+
+    return framebuffer_wrap(map, size);
+}
+
+/* Map an existing framebuffer file read-only */
+framebuffer_t *framebuffer_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < FRAMEBUFFER_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    const framebuffer_header_t *h = map;
+    size_t needed = (size_t)h->header_size + 2 * (size_t)h->stride * h->height;
+    if (h->magic != FRAMEBUFFER_MAGIC || needed > size) {
+        munmap(map, size);
+        return NULL;
+    }
+    return framebuffer_wrap(map, size);
+}
+
+/* Image the writer may fill next */
+uint8_t *framebuffer_back(framebuffer_t *fb) {
+    uint64_t gen = atomic_load_explicit(&fb->header->generation, memory_order_relaxed);
+    /* A viewer may still be copying this image as generation gen - 1; keep
+     * the pixels written next behind the publish of gen, so its re-check
+     * sees the new generation whenever it saw any of them */
+    atomic_thread_fence(memory_order_seq_cst);
+    return fb->images[(gen + 1) & 1];
+}
+
+/* Publish the back image with its metadata */
+void framebuffer_publish(framebuffer_t *fb, uint32_t samples, uint32_t block_size) {
+    framebuffer_header_t *h = fb->header;
+    uint64_t gen = atomic_load_explicit(&h->generation, memory_order_relaxed);
+    h->samples[(gen + 1) & 1] = samples;
+    h->block_size[(gen + 1) & 1] = block_size;
+    atomic_store_explicit(&h->generation, gen + 1, memory_order_release);
+}
+
+/* Generation of the latest frame, for a viewer about to copy it */
+uint64_t framebuffer_read_begin(const framebuffer_t *fb) {
+    return atomic_load_explicit(&fb->header->generation, memory_order_acquire);
+}
+
+/* Whether nothing has been published since framebuffer_read_begin gave g */
+int framebuffer_read_valid(const framebuffer_t *fb, uint64_t g) {
+    /* Order the copy before the re-check */
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&fb->header->generation, memory_order_relaxed) == g;
+}
+
+/* Unmap and free */
+void framebuffer_close(framebuffer_t *fb) {
+    if (!fb) return;
+    munmap(fb->header, fb->size);
+    free(fb);
+}
@@ -0,0 +1,63 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Memory-mapped framebuffer file shared with external viewers.
+ *
+ * Layout: a framebuffer_header_t followed by two images of height rows of
+ * stride bytes, each pixel 4 bytes (R, G, B, unused) gamma corrected. The
+ * writer fills the back image (index (generation + 1) & 1) and then bumps
+ * generation, so image (generation & 1) always holds the latest complete
+ * frame. Viewers need no lock: read g = generation, copy image g & 1, and
+ * discard the copy unless generation still equals g afterwards. Once g + 1
+ * is published, image g & 1 is the back image again and the writer may
+ * already be overwriting it (framebuffer_read_begin and
+ * framebuffer_read_valid implement this). */
+
+#define FRAMEBUFFER_MAGIC 0x3142465342495656ull /* "VVIBSFB1" */
+#define FRAMEBUFFER_HEADER_SIZE 64
+
+typedef struct {
+    uint64_t magic;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;        /* bytes per row */
+    uint32_t header_size;   /* offset of image 0 */
+    uint32_t samples[2];    /* samples per pixel shown by each image */
+    uint32_t block_size[2]; /* 1, or the pixel block size of a coarse pass */
+    atomic_uint_least64_t generation; /* frames published so far */
+} framebuffer_header_t;
+
+typedef struct {
+    framebuffer_header_t *header;
+    uint8_t *images[2];
+    size_t size;
+} framebuffer_t;
+
+/* Create (or truncate) the file at path and map it. Returns NULL on failure. */
+framebuffer_t *framebuffer_create(const char *path, int width, int height);
+
+/* Map an existing framebuffer file read-only, as a viewer would */
+framebuffer_t *framebuffer_open(const char *path);
+
+/* Image the writer may fill next */
+uint8_t *framebuffer_back(framebuffer_t *fb);
+
+/* Publish the back image with its metadata */
+void framebuffer_publish(framebuffer_t *fb, uint32_t samples, uint32_t block_size);
+
+/* Viewers: the generation g of the latest frame, to be copied from image
+ * g & 1 along with its samples and block size */
+uint64_t framebuffer_read_begin(const framebuffer_t *fb);
+
+/* Viewers: whether what was copied since framebuffer_read_begin returned g
+ * is a whole frame, i.e. nothing has been published since */
+int framebuffer_read_valid(const framebuffer_t *fb, uint64_t g);
+
+/* Unmap and free (the file is left in place) */
+void framebuffer_close(framebuffer_t *fb);
+
+#endif /* FRAMEBUFFER_H */
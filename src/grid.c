@@ -0,0 +1,324 @@
+#include "grid.h"
+#include "dispatch.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define USE_OPENMP 1
+#define GRID_MAX_CELLS (1 << 24)
+#define GRID_MAILBOX 8 /* objects a ray remembers having tested (a power of two) */
+
+/* Cells [lo, hi] a box overlaps along each axis */
+static void cell_range(const grid_t *grid, const aabb_t *box, int lo[3], int hi[3]) {
+    for (int a = 0; a < 3; a++) {
+        double origin = grid->bounds.min.e[a];
+        double scale = grid->inv_cell_size.e[a];
+        int l = (int)floor((box->min.e[a] - origin) * scale);
+        int h = (int)floor((box->max.e[a] - origin) * scale);
+        lo[a] = l < 0 ? 0 : (l >= grid->res[a] ? grid->res[a] - 1 : l);
+        hi[a] = h < 0 ? 0 : (h >= grid->res[a] ? grid->res[a] - 1 : h);
+    }
+}
+
+/* Widest side of a box */
+static double box_width(const aabb_t *box) {
+    double width = 0.0;
+    for (int a = 0; a < 3; a++) width = fmax(width, box->max.e[a] - box->min.e[a]);
+    return width;
+}
+
+/* Choose the cells for the gridded objects: about GRID_DENSITY per object,
+ * as close to cubes as the bounds allow */
+static void choose_resolution(grid_t *grid) {
+    vec3_t size = vec3_sub(grid->bounds.max, grid->bounds.min);
+    double widest = fmax(size.e[0], fmax(size.e[1], size.e[2]));
+    if (widest <= 0.0) widest = 1.0;
+    for (int a = 0; a < 3; a++) {
+        /* Flat or point-like bounds still get cells of a sensible size */
+        if (size.e[a] < widest * 1e-3) {
+            double pad = 0.5 * (widest * 1e-3 - size.e[a]);
+            grid->bounds.min.e[a] -= pad;
+            grid->bounds.max.e[a] += pad;
+            size.e[a] = widest * 1e-3;
+        }
+    }
+    double volume = size.e[0] * size.e[1] * size.e[2];
+    double per_unit = cbrt(GRID_DENSITY * grid->object_count / volume);
+    double cells = 1.0;
+    for (int a = 0; a < 3; a++) {
+        int res = (int)(size.e[a] * per_unit + 0.5);
+        grid->res[a] = res < 1 ? 1 : (res > GRID_MAX_RES ? GRID_MAX_RES : res);
+        cells *= grid->res[a];
+    }
+    if (cells > GRID_MAX_CELLS) {
+        double shrink = cbrt(GRID_MAX_CELLS / cells);
+        for (int a = 0; a < 3; a++) {
+            int res = (int)(grid->res[a] * shrink);
+            grid->res[a] = res < 1 ? 1 : res;
+        }
+    }
+    for (int a = 0; a < 3; a++) {
+        grid->cell_size.e[a] = size.e[a] / grid->res[a];
+        grid->inv_cell_size.e[a] = grid->res[a] / size.e[a];
+    }
+}
+
+/* Bin the gridded objects, whose boxes are given, into cells: count the
+ * objects of each cell, turn the counts into offsets, then place every
+ * object, all in parallel. Returns 0, or -1 on allocation failure. */
+static int bin_objects(grid_t *grid, const aabb_t *boxes) {
+    int cells = grid->res[0] * grid->res[1] * grid->res[2];
+    int nx = grid->res[0], ny = grid->res[1];
+    int *counts = calloc(cells + 1, sizeof(int));
+    if (!counts) return -1;
+
+    #if USE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 256)
+    #endif
+    for (int k = 0; k < grid->object_count; k++) {
+        int lo[3], hi[3];
+        cell_range(grid, &boxes[k], lo, hi);
+        for (int z = lo[2]; z <= hi[2]; z++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                for (int x = lo[0]; x <= hi[0]; x++) {
+                    #if USE_OPENMP
+                    #pragma omp atomic
+                    #endif
+                    counts[(z * ny + y) * nx + x]++;
+                }
+            }
+        }
+    }
+
+    /* Exclusive prefix sum: counts becomes each cell's first slot */
+    int total = 0;
+    for (int c = 0; c <= cells; c++) {
+        int n = counts[c];
+        counts[c] = total;
+        total += n;
+    }
+    grid->cell_start = malloc((cells + 1) * sizeof(int));
+    grid->refs = malloc((total > 0 ? total : 1) * sizeof(int));
+    if (!grid->cell_start || !grid->refs) {
+        free(counts);
+        return -1;
+    }
+    for (int c = 0; c <= cells; c++) grid->cell_start[c] = counts[c];
+
+    #if USE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 256)
+    #endif
+    for (int k = 0; k < grid->object_count; k++) {
+        int lo[3], hi[3];
+        cell_range(grid, &boxes[k], lo, hi);
+        for (int z = lo[2]; z <= hi[2]; z++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                for (int x = lo[0]; x <= hi[0]; x++) {
+                    int slot;
+                    #if USE_OPENMP
+                    #pragma omp atomic capture
+                    #endif
+                    slot = counts[(z * ny + y) * nx + x]++;
+                    grid->refs[slot] = k;
+                }
+            }
+        }
+    }
+    free(counts);
+
+    /* Threads placed objects in any order; sort each cell so builds repeat */
+    #if USE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 1024)
+    #endif
+    for (int c = 0; c < cells; c++) {
+        int *refs = grid->refs;
+        for (int i = grid->cell_start[c] + 1; i < grid->cell_start[c + 1]; i++) {
+            int k = refs[i];
+            int j = i;
+            for (; j > grid->cell_start[c] && refs[j - 1] > k; j--) refs[j] = refs[j - 1];
+            refs[j] = k;
+        }
+    }
+    return 0;
+}
+
+/* Build a grid over count objects */
+grid_t *grid_create(const hittable_t *objects, int count) {
+    grid_t *grid = calloc(1, sizeof(grid_t));
+    if (!grid) return NULL;
+
+    int n = count > 0 ? count : 1;
+    aabb_t *boxes = malloc(n * sizeof(aabb_t));
+    char *bounded = malloc(n);
+    grid->objects = malloc(n * sizeof(hittable_t));
+    grid->ids = malloc(n * sizeof(int));
+    grid->large = malloc(n * sizeof(hittable_t));
+    grid->large_ids = malloc(n * sizeof(int));
+    if (!boxes || !bounded || !grid->objects || !grid->ids || !grid->large ||
+        !grid->large_ids) {
+        free(boxes);
+        free(bounded);
+        grid_destroy(grid);
+        return NULL;
+    }
+
+    /* Typical object width: the geometric mean, which one huge ground
+     * sphere hardly moves */
+    double log_width = 0.0;
+    int boxed = 0;
+    #if USE_OPENMP
+    #pragma omp parallel for schedule(static) reduction(+ : log_width, boxed)
+    #endif
+    for (int i = 0; i < count; i++) {
+        const hittable_t *obj = &objects[i];
+        bounded[i] = obj->bounding_box && obj->bounding_box(obj->data, &boxes[i]);
+        if (bounded[i]) {
+            log_width += log(fmax(box_width(&boxes[i]), 1e-12));
+            boxed++;
+        }
+    }
+    double limit = boxed > 0 ? GRID_LARGE_FACTOR * exp(log_width / boxed) : 0.0;
+
+    grid->bounds = aabb_empty();
+    grid->extent = aabb_empty();
+    for (int i = 0; i < count; i++) {
+        if (bounded[i]) grid->extent = aabb_union(grid->extent, boxes[i]);
+        if (!bounded[i] || box_width(&boxes[i]) > limit) {
+            grid->unbounded |= !bounded[i];
+            grid->large_ids[grid->large_count] = i;
+            grid->large[grid->large_count++] = objects[i];
+            continue;
+        }
+        /* Gridded boxes are packed to the front as they are found */
+        int k = grid->object_count++;
+        grid->objects[k] = objects[i];
+        grid->ids[k] = i;
+        grid->bounds = aabb_union(grid->bounds, boxes[i]);
+        boxes[k] = boxes[i];
+    }
+    free(bounded);
+
+    int status = 0;
+    if (grid->object_count > 0) {
+        choose_resolution(grid);
+        status = bin_objects(grid, boxes);
+    }
+    free(boxes);
+    if (status != 0) {
+        grid_destroy(grid);
+        return NULL;
+    }
+    return grid;
+}
+
+/* Find the closest intersection */
+VIBE_KERNEL
+int grid_hit(const grid_t *grid, const ray_t r, double t_min, double t_max,
+             hit_record_t *rec) {
+    hit_record_t temp_rec = {0};
+    int hit_anything = 0;
+    double closest_so_far = t_max;
+
+    for (int i = 0; i < grid->large_count; i++) {
+        const hittable_t *obj = &grid->large[i];
+        if (obj->hit(obj->data, r, t_min, closest_so_far, &temp_rec)) {
+            hit_anything = 1;
+            closest_so_far = temp_rec.t;
+            *rec = temp_rec;
+            rec->object = grid->large_ids[i];
+        }
+    }
+    if (grid->object_count == 0) return hit_anything;
+
+    /* Stretch of the ray inside the grid */
+    double t0 = t_min, t1 = closest_so_far;
+    for (int a = 0; a < 3; a++) {
+        double inv = 1.0 / r.direction.e[a];
+        double near = (grid->bounds.min.e[a] - r.origin.e[a]) * inv;
+        double far = (grid->bounds.max.e[a] - r.origin.e[a]) * inv;
+        if (near > far) {
+            double tmp = near;
+            near = far;
+            far = tmp;
+        }
+        t0 = near > t0 ? near : t0;
+        t1 = far < t1 ? far : t1;
+        if (t1 < t0) return hit_anything;
+    }
+
+    /* 3D-DDA setup: the entry cell, where the ray next crosses a cell
+     * boundary along each axis, and how far apart those crossings are */
+    int cell[3], step[3], stop[3];
+    double next[3], delta[3];
+    for (int a = 0; a < 3; a++) {
+        double p = r.origin.e[a] + t0 * r.direction.e[a];
+        double d = r.direction.e[a];
+        int c = (int)floor((p - grid->bounds.min.e[a]) * grid->inv_cell_size.e[a]);
+        c = c < 0 ? 0 : (c >= grid->res[a] ? grid->res[a] - 1 : c);
+        cell[a] = c;
+        if (d > 0.0) {
+            double boundary = grid->bounds.min.e[a] + (c + 1) * grid->cell_size.e[a];
+            step[a] = 1;
+            stop[a] = grid->res[a];
+            next[a] = t0 + (boundary - p) / d;
+            delta[a] = grid->cell_size.e[a] / d;
+        } else if (d < 0.0) {
+            double boundary = grid->bounds.min.e[a] + c * grid->cell_size.e[a];
+            step[a] = -1;
+            stop[a] = -1;
+            next[a] = t0 + (boundary - p) / d;
+            delta[a] = -grid->cell_size.e[a] / d;
+        } else {
+            step[a] = 0;
+            stop[a] = -1;
+            next[a] = INFINITY;
+            delta[a] = INFINITY;
+        }
+    }
+
+    int mailbox[GRID_MAILBOX];
+    for (int i = 0; i < GRID_MAILBOX; i++) mailbox[i] = -1;
+    int nx = grid->res[0], ny = grid->res[1];
+    while (1) {
+        int c = (cell[2] * ny + cell[1]) * nx + cell[0];
+        for (int j = grid->cell_start[c]; j < grid->cell_start[c + 1]; j++) {
+            int k = grid->refs[j];
+            int slot = k & (GRID_MAILBOX - 1);
+            if (mailbox[slot] == k) continue;
+            mailbox[slot] = k;
+            const hittable_t *obj = &grid->objects[k];
+            if (obj->hit(obj->data, r, t_min, closest_so_far, &temp_rec)) {
+                hit_anything = 1;
+                closest_so_far = temp_rec.t;
+                *rec = temp_rec;
+                rec->object = grid->ids[k];
+            }
+        }
+
+        /* Cells further on start beyond a hit inside this one */
+        int a = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+        if (closest_so_far <= next[a] || next[a] > t1) break;
+        cell[a] += step[a];
+        if (cell[a] == stop[a]) break;
+        next[a] += delta[a];
+    }
+    return hit_anything;
+}
+
+/* Bounds of everything in the grid */
+int grid_bounding_box(const grid_t *grid, aabb_t *box) {
+    if (grid->unbounded || grid->object_count + grid->large_count == 0) return 0;
+    *box = grid->extent;
+    return 1;
+}
+
+/* Free the grid */
+void grid_destroy(grid_t *grid) {
+    if (!grid) return;
+    free(grid->cell_start);
+    free(grid->refs);
+    free(grid->objects);
+    free(grid->ids);
+    free(grid->large);
+    free(grid->large_ids);
+    free(grid);
+}
@@ -0,0 +1,56 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include "aabb.h"
+#include "hittable.h"
+
+/* Uniform grid over hittable objects, an alternative to the BVH for fields of
+ * many similar-sized primitives such as the showcase's scattered spheres.
+ * Objects much larger than is typical (the ground sphere) and unbounded ones
+ * are kept out of the grid and tested by every ray, so they do not stretch
+ * the cells. The rest are binned into cells sized for a few objects each by
+ * a parallel counting sort, and rays walk the cells they cross front to back
+ * (3D-DDA), stopping at the first cell that ends beyond the closest hit. An
+ * object spanning several cells is tested once per ray thanks to a small
+ * hashed mailbox on the stack. Like the BVH, the grid keeps copies of the
+ * hittable_t handles but does not own the objects; it has no refit, so it is
+ * rebuilt after objects move. */
+
+#define GRID_DENSITY 2.0      /* cells per gridded object */
+#define GRID_LARGE_FACTOR 8.0 /* objects wider than this many times the typical
+                               * object are kept out of the grid */
+#define GRID_MAX_RES 512      /* most cells along an axis */
+
+typedef struct {
+    aabb_t bounds;         /* of the gridded objects */
+    aabb_t extent;         /* of every bounded object, gridded or large */
+    int unbounded;         /* whether some object has no bounds */
+    int res[3];            /* cells along each axis */
+    vec3_t cell_size;
+    vec3_t inv_cell_size;
+    int *cell_start;       /* refs of cell c are cell_start[c] .. cell_start[c + 1] - 1 */
+    int *refs;             /* indices into objects, cell by cell, ascending in each */
+    hittable_t *objects;   /* gridded objects */
+    int *ids;              /* index of each gridded object in the build input */
+    int object_count;
+    hittable_t *large;     /* objects tested by every ray: unbounded or large */
+    int *large_ids;
+    int large_count;
+} grid_t;
+
+/* Build a grid over count objects with the OpenMP threads. Returns NULL on
+ * allocation failure. */
+grid_t *grid_create(const hittable_t *objects, int count);
+
+/* Find the closest intersection; rec->object is the hit object's index in
+ * the objects the grid was built over. The same hit as bvh_hit over them. */
+int grid_hit(const grid_t *grid, const ray_t r, double t_min, double t_max,
+             hit_record_t *rec);
+
+/* Bounds of everything in the grid; returns 0 if empty or unbounded */
+int grid_bounding_box(const grid_t *grid, aabb_t *box);
+
+/* Free the grid (the objects are left alone) */
+void grid_destroy(grid_t *grid);
+
+#endif /* GRID_H */
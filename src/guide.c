@@ -0,0 +1,222 @@
+#include "guide.h"
+#include "utils.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ENERGY_FRACTION_BITS 16
+#define ENERGY_MAX_RECORD 1e6  /* per-record clamp, keeps sums far from overflow */
+#define SPLIT_SAMPLES 4000     /* leaves split while they would see more records per pass */
+#define MAX_DEPTH 48
+#define MAX_CELLS 4096
+
+/* Initialize a cell with an untrained distribution and empty training bins */
+static void cell_init(guide_cell_t *cell) {
+    for (int b = 0; b < GUIDE_BINS; b++) {
+        cell->cdf[b] = (float)(b + 1) / GUIDE_BINS;
+        atomic_init(&cell->energy[b], 0);
+    }
+    cell->trained = 0;
+    atomic_init(&cell->samples, 0);
+}
+
+/* Create an untrained guide */
+guide_t *guide_create(aabb_t bounds) {
+    guide_t *guide = calloc(1, sizeof(guide_t));
+    if (!guide) return NULL;
+
+    guide->bounds = bounds;
+    guide->node_capacity = 64;
+    guide->cell_capacity = 32;
+    guide->nodes = malloc(guide->node_capacity * sizeof(guide_node_t));
+    guide->cells = malloc(guide->cell_capacity * sizeof(guide_cell_t));
+    if (!guide->nodes || !guide->cells) {
+        guide_destroy(guide);
+        return NULL;
+    }
+    /* One tree per facing, each starting as a single leaf */
+    for (int f = 0; f < GUIDE_FACINGS; f++) {
+        guide->nodes[f] = (guide_node_t){0, f};
+        cell_init(&guide->cells[f]);
+    }
+    guide->node_count = GUIDE_FACINGS;
+    guide->cell_count = GUIDE_FACINGS;
+    return guide;
+}
+
+/* Free a guide */
+void guide_destroy(guide_t *guide) {
+    if (!guide) return;
+    free(guide->nodes);
+    free(guide->cells);
+    free(guide);
+}
+
+/* Leaf containing p in the tree of normal's facing */
+guide_cell_t *guide_lookup(const guide_t *guide, vec3_t p, vec3_t normal) {
+    int axis = 0;
+    for (int a = 1; a < 3; a++) {
+        if (fabs(normal.e[a]) > fabs(normal.e[axis])) axis = a;
+    }
+    aabb_t box = guide->bounds;
+    int index = 2 * axis + (normal.e[axis] < 0.0);
+    for (int depth = 0; guide->nodes[index].child; depth++) {
+        int axis = depth % 3;
+        double mid = 0.5 * (box.min.e[axis] + box.max.e[axis]);
+        if (p.e[axis] < mid) {
+            box.max.e[axis] = mid;
+            index = guide->nodes[index].child;
+        } else {
+            box.min.e[axis] = mid;
+            index = guide->nodes[index].child + 1;
+        }
+    }
+    return &guide->cells[guide->nodes[index].cell];
+}
+
+/* Bin of a unit direction: cos(theta) = d.y in rows, phi around y in columns */
+static int direction_bin(vec3_t d) {
+    int row = (int)((d.e[1] + 1.0) * 0.5 * GUIDE_THETA_BINS);
+    double phi = atan2(d.e[2], d.e[0]);
+    int col = (int)((phi + PI) / (2.0 * PI) * GUIDE_PHI_BINS);
+    row = row < 0 ? 0 : (row >= GUIDE_THETA_BINS ? GUIDE_THETA_BINS - 1 : row);
+    col = col < 0 ? 0 : (col >= GUIDE_PHI_BINS ? GUIDE_PHI_BINS - 1 : col);
+    return row * GUIDE_PHI_BINS + col;
+}
+
+/* Probability of bin b */
+static double bin_probability(const guide_cell_t *cell, int b) {
+    return cell->cdf[b] - (b > 0 ? cell->cdf[b - 1] : 0.0f);
+}
+
+/* Draw a direction from the cell */
+vec3_t guide_sample(const guide_cell_t *cell) {
+    /* First bin whose cumulative probability exceeds u */
+    float u = (float)random_double();
+    int lo = 0, hi = GUIDE_BINS - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cell->cdf[mid] > u) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    int row = lo / GUIDE_PHI_BINS;
+    int col = lo % GUIDE_PHI_BINS;
+    double cos_theta = -1.0 + 2.0 * (row + random_double()) / GUIDE_THETA_BINS;
+    double phi = -PI + 2.0 * PI * (col + random_double()) / GUIDE_PHI_BINS;
+    double sin_theta = sqrt(fmax(0.0, 1.0 - cos_theta * cos_theta));
+    return vec3(sin_theta * cos(phi), cos_theta, sin_theta * sin(phi));
+}
+
+/* Density of the cell's distribution: bin probability over bin solid angle */
+double guide_pdf(const guide_cell_t *cell, vec3_t d) {
+    return bin_probability(cell, direction_bin(d)) * GUIDE_BINS / (4.0 * PI);
+}
+
+/* Record arriving radiance */
+void guide_record(guide_cell_t *cell, vec3_t d, double radiance) {
+    atomic_fetch_add_explicit(&cell->samples, 1, memory_order_relaxed);
+    if (!(radiance > 0.0)) return;
+    if (radiance > ENERGY_MAX_RECORD) radiance = ENERGY_MAX_RECORD;
+    uint64_t fixed = (uint64_t)(radiance * (double)(1 << ENERGY_FRACTION_BITS) + 0.5);
+    atomic_fetch_add_explicit(&cell->energy[direction_bin(d)], fixed, memory_order_relaxed);
+}
+
+/* Rebuild a cell's distribution from its training bins and restart its count */
+static void cell_learn(guide_cell_t *cell) {
+    uint64_t total = 0;
+    for (int b = 0; b < GUIDE_BINS; b++) total += atomic_load(&cell->energy[b]);
+    if (total > 0) {
+        uint64_t sum = 0;
+        for (int b = 0; b < GUIDE_BINS; b++) {
+            sum += atomic_load(&cell->energy[b]);
+            cell->cdf[b] = (float)((double)sum / total);
+        }
+        cell->cdf[GUIDE_BINS - 1] = 1.0f;
+        cell->trained = 1;
+    }
+    atomic_store(&cell->samples, 0);
+}
+
+/* Turn leaf node index into an interior node with two leaves that inherit
+ * its distribution; returns 0 on success */
+static int split_leaf(guide_t *guide, int index) {
+    if (guide->cell_count + 1 > MAX_CELLS) return -1;
+    if (guide->node_count + 2 > guide->node_capacity) {
+        int capacity = guide->node_capacity * 2;
+        guide_node_t *nodes = realloc(guide->nodes, capacity * sizeof(guide_node_t));
+        if (!nodes) return -1;
+        guide->nodes = nodes;
+        guide->node_capacity = capacity;
+    }
+    if (guide->cell_count + 1 > guide->cell_capacity) {
+        int capacity = guide->cell_capacity * 2;
+        guide_cell_t *cells = realloc(guide->cells, capacity * sizeof(guide_cell_t));
+        if (!cells) return -1;
+        guide->cells = cells;
+        guide->cell_capacity = capacity;
+    }
+
+    int parent = guide->nodes[index].cell;
+    int sibling = guide->cell_count++;
+    guide_cell_t *copy = &guide->cells[sibling];
+    cell_init(copy);
+    memcpy(copy->cdf, guide->cells[parent].cdf, sizeof(copy->cdf));
+    for (int b = 0; b < GUIDE_BINS; b++) {
+        uint64_t half = atomic_load(&guide->cells[parent].energy[b]) / 2;
+        atomic_store(&guide->cells[parent].energy[b], half);
+        atomic_store(&copy->energy[b], half);
+    }
+    copy->trained = guide->cells[parent].trained;
+
+    int child = guide->node_count;
+    guide->nodes[child] = (guide_node_t){0, parent};
+    guide->nodes[child + 1] = (guide_node_t){0, sibling};
+    guide->node_count += 2;
+    guide->nodes[index] = (guide_node_t){child, 0};
+    return 0;
+}
+
+/* Split the leaf at node index while its share of samples (halved per level)
+ * exceeds SPLIT_SAMPLES */
+static int refine(guide_t *guide, int index, int depth, double samples) {
+    if (samples <= SPLIT_SAMPLES || depth >= MAX_DEPTH) return 0;
+    if (split_leaf(guide, index) != 0) return -1;
+    int child = guide->nodes[index].child;
+    if (refine(guide, child, depth + 1, samples * 0.5) != 0) return -1;
+    return refine(guide, child + 1, depth + 1, samples * 0.5);
+}
+
+/* Learn from the last pass and refine the tree */
+int guide_update(guide_t *guide) {
+    /* Sample counts per leaf node before learning clears them */
+    int node_count = guide->node_count;
+    double *samples = malloc(node_count * sizeof(double));
+    int *depth = malloc(node_count * sizeof(int));
+    if (!samples || !depth) {
+        free(samples);
+        free(depth);
+        for (int c = 0; c < guide->cell_count; c++) cell_learn(&guide->cells[c]);
+        return -1;
+    }
+    for (int f = 0; f < GUIDE_FACINGS; f++) depth[f] = 0;
+    for (int n = 0; n < node_count; n++) {
+        const guide_node_t *node = &guide->nodes[n];
+        if (node->child) {
+            depth[node->child] = depth[node->child + 1] = depth[n] + 1;
+        } else {
+            samples[n] = atomic_load(&guide->cells[node->cell].samples);
+        }
+    }
+    for (int c = 0; c < guide->cell_count; c++) cell_learn(&guide->cells[c]);
+
+    int status = 0;
+    for (int n = 0; n < node_count && status == 0; n++) {
+        if (!guide->nodes[n].child) status = refine(guide, n, depth[n], samples[n]);
+    }
+    free(samples);
+    free(depth);
+    return status;
+}
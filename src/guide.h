@@ -0,0 +1,83 @@
+#ifndef GUIDE_H
+#define GUIDE_H
+
+#include "aabb.h"
+#include "vec3.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* Path guiding: an online-learned cache of where light arrives from. Surface
+ * points are grouped by the axis their normal faces most (+x, -x, +y, ...),
+ * so a leaf's light mostly lies above its surfaces. Each group splits space
+ * by a binary tree (halving along x, y, z in turn) whose leaves
+ * each hold a piecewise-constant distribution over the sphere of directions
+ * (GUIDE_THETA_BINS x GUIDE_PHI_BINS equal-area cells in cos(theta) and
+ * phi), as in the SD-tree of Mueller et al. with a fixed-depth directional
+ * quadtree.
+ *
+ * Training runs over progressive passes. During a pass render threads sample
+ * from the leaves' current distributions, which stay read-only, and add what
+ * arrives along each guided bounce to the leaves' training bins with atomic
+ * fixed-point adds, so recording is lock-free and the sums do not depend on
+ * thread scheduling. guide_update then rebuilds every distribution from its
+ * bins and splits leaves that saw many samples. Records divided by their
+ * sampling density estimate the arriving light whichever distribution drew
+ * them, so the bins keep the records of all passes; a split shares a leaf's
+ * bins evenly between its children. */
+
+#define GUIDE_THETA_BINS 16
+#define GUIDE_PHI_BINS 32
+#define GUIDE_BINS (GUIDE_THETA_BINS * GUIDE_PHI_BINS)
+#define GUIDE_FRACTION 0.5 /* share of diffuse bounces sampled from a trained guide */
+#define GUIDE_FACINGS 6    /* trees: one per signed axis of the surface normal */
+
+/* A leaf of the spatial tree */
+typedef struct {
+    float cdf[GUIDE_BINS];            /* sampling: cumulative bin probabilities */
+    int trained;                      /* cdf holds a learned distribution */
+    _Atomic uint64_t energy[GUIDE_BINS]; /* training: fixed-point radiance / pdf */
+    _Atomic uint32_t samples;         /* training: records this pass */
+} guide_cell_t;
+
+typedef struct {
+    int child; /* interior: index of the first of two children; 0 for leaves
+                * (nodes [0, GUIDE_FACINGS) are the roots) */
+    int cell;  /* leaf: index into the cells */
+} guide_node_t;
+
+typedef struct {
+    aabb_t bounds;
+    guide_node_t *nodes;
+    int node_count;
+    int node_capacity;
+    guide_cell_t *cells;
+    int cell_count;
+    int cell_capacity;
+} guide_t;
+
+/* Create an untrained guide over bounds; NULL on allocation failure */
+guide_t *guide_create(aabb_t bounds);
+
+/* Free a guide */
+void guide_destroy(guide_t *guide);
+
+/* Leaf containing point p of a surface facing normal (points outside the
+ * bounds go to the nearest leaf) */
+guide_cell_t *guide_lookup(const guide_t *guide, vec3_t p, vec3_t normal);
+
+/* Unit direction drawn from a trained cell's distribution */
+vec3_t guide_sample(const guide_cell_t *cell);
+
+/* Density of guide_sample at unit direction d, per steradian */
+double guide_pdf(const guide_cell_t *cell, vec3_t d);
+
+/* Record that radiance (already divided by the sampling density) arrived
+ * along unit direction d. Safe to call from any number of threads. */
+void guide_record(guide_cell_t *cell, vec3_t d, double radiance);
+
+/* Between passes: rebuild each leaf's distribution from what it recorded
+ * and split busy leaves. Not thread-safe. Returns 0 on success, -1 if the
+ * tree could not grow (the guide stays usable). */
+int guide_update(guide_t *guide);
+
+#endif /* GUIDE_H */
@@ -33,6 +33,16 @@ void hittable_list_add(hittable_list_t *list, hittable_t object) {
     list->objects[list->count++] = object;
 }
 
+/* Make room for capacity objects */
+int hittable_list_reserve(hittable_list_t *list, int capacity) {
+    if (capacity <= list->capacity) return 0;
+    hittable_t *objects = realloc(list->objects, capacity * sizeof(hittable_t));
+    if (!objects) return -1;
+    list->objects = objects;
+    list->capacity = capacity;
+    return 0;
+}
+
 /* Find closest intersection with any object */
 int hittable_list_hit(const hittable_list_t *list, const ray_t r, double t_min,
                       double t_max, hit_record_t *rec) {
@@ -48,12 +58,51 @@ int hittable_list_hit(const hittable_list_t *list, const ray_t r, double t_min,
             hit_anything = 1;
             closest_so_far = temp_rec.t;
             *rec = temp_rec;
+            rec->object = i;
         }
     }
 
     return hit_anything;
 }
 
+/* Bounds of all objects */
+int hittable_list_bounding_box(const hittable_list_t *list, aabb_t *box) {
+    if (!list || list->count == 0) return 0;
+
+    aabb_t total = aabb_empty();
+    for (int i = 0; i < list->count; i++) {
+        const hittable_t *obj = &list->objects[i];
+        aabb_t b;
+        if (!obj->bounding_box || !obj->bounding_box(obj->data, &b)) return 0;
+        total = aabb_union(total, b);
+    }
+    *box = total;
+    return 1;
+}
+
+static int list_hit(const void *obj, const ray_t r, double t_min, double t_max,
+                    hit_record_t *rec) {
+    return hittable_list_hit((const hittable_list_t *)obj, r, t_min, t_max, rec);
+}
+
+static int list_bounding_box(const void *obj, aabb_t *box) {
+    return hittable_list_bounding_box((const hittable_list_t *)obj, box);
+}
+
+static void list_destroy(void *obj) {
+    hittable_list_destroy((hittable_list_t *)obj);
+}
+
+/* Wrap a list as a single hittable that owns it */
+hittable_t hittable_list_to_hittable(hittable_list_t *list) {
+    return (hittable_t){
+        .data = list,
+        .hit = list_hit,
+        .bounding_box = list_bounding_box,
+        .destroy = list_destroy,
+    };
+}
+
 /* Free all objects and the list */
 void hittable_list_destroy(hittable_list_t *list) {
     if (!list) return;
@@ -1,6 +1,7 @@
 #ifndef HITTABLE_H
 #define HITTABLE_H
 
+#include "aabb.h"
 #include "vec3.h"
 #include "ray.h"
 
@@ -13,6 +14,8 @@ typedef struct hit_record {
     vec3_t normal;
     double t;
     int front_face;
+    int object; /* index of the hit object in the list or BVH searched last,
+                 * so scene_hit reports the scene's top-level object */
     const material_t *material;
 } hit_record_t;
 
@@ -29,6 +32,12 @@ typedef struct {
     void *data;
     int (*hit)(const void *obj, const ray_t r, double t_min, double t_max,
                hit_record_t *rec);
+    /* Bounds of the object; returns 0 if it is unbounded (optional) */
+    int (*bounding_box)(const void *obj, aabb_t *box);
+    /* Bounds at shutter open and close for objects moving linearly over the
+     * shutter interval; returns 0 when bounding_box must be used for both
+     * (optional) */
+    int (*motion_bounds)(const void *obj, aabb_t *open, aabb_t *close);
     void (*destroy)(void *obj);
 } hittable_t;
 
@@ -45,10 +54,20 @@ hittable_list_t *hittable_list_create(void);
 /* Add an object to the list */
 void hittable_list_add(hittable_list_t *list, hittable_t object);
 
+/* Make room for capacity objects in all, so adding up to that many never
+ * reallocates. Returns 0, or -1 on allocation failure. */
+int hittable_list_reserve(hittable_list_t *list, int capacity);
+
 /* Find closest intersection with any object */
 int hittable_list_hit(const hittable_list_t *list, const ray_t r, double t_min,
                       double t_max, hit_record_t *rec);
 
+/* Bounds of all objects; returns 0 if the list is empty or any object is unbounded */
+int hittable_list_bounding_box(const hittable_list_t *list, aabb_t *box);
+
+/* Wrap a list as a single hittable that owns it (destroy frees the list) */
+hittable_t hittable_list_to_hittable(hittable_list_t *list);
+
 /* Free all objects and the list */
 void hittable_list_destroy(hittable_list_t *list);
 
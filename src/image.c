@@ -0,0 +1,283 @@
+#include "image.h"
+#include "utils.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Write color value to PPM file (0-255) with gamma correction */
+static void write_color(FILE *out, const vec3_t color) {
+    /* Gamma correction (gamma = 2.0) */
+    double r = sqrt(color.e[0]);
+    double g = sqrt(color.e[1]);
+    double b = sqrt(color.e[2]);
+
+    int ir = (int)(255.999 * clamp(r, 0.0, 1.0));
+    int ig = (int)(255.999 * clamp(g, 0.0, 1.0));
+    int ib = (int)(255.999 * clamp(b, 0.0, 1.0));
+    fprintf(out, "%d %d %d\n", ir, ig, ib);
+}
+
+/* Write an accumulation buffer as a plain PPM */
+int image_write_ppm(const char *path, const accum_t *accum) {
+    return image_write_ppm_comment(path, accum, NULL);
+}
+
+/* Write the PPM header with each line of comment as a "# " line */
+static void write_header(FILE *out, int width, int height, const char *comment) {
+    fprintf(out, "P3\n");
+    for (const char *line = comment; line && *line;) {
+        size_t len = strcspn(line, "\n");
+        fprintf(out, "# %.*s\n", (int)len, line);
+        line += len + (line[len] == '\n');
+    }
+    fprintf(out, "%d %d\n255\n", width, height);
+}
+
+/* Write an accumulation buffer as a plain PPM with header comments */
+int image_write_ppm_comment(const char *path, const accum_t *accum, const char *comment) {
+    FILE *out = fopen(path, "w");
+    if (!out) return -1;
+
+    write_header(out, accum->width, accum->height, comment);
+    for (int idx = 0; idx < accum->width * accum->height; idx++) {
+        write_color(out, accum_pixel_mean(&accum->pixels[idx]));
+    }
+
+    int failed = ferror(out);
+    if (fclose(out) != 0) failed = 1;
+    return failed ? -1 : 0;
+}
+
+/* Write linear RGB triples as a plain PPM */
+int image_write_ppm_rgb(const char *path, const double *rgb, int width, int height,
+                        const char *comment) {
+    FILE *out = fopen(path, "w");
+    if (!out) return -1;
+
+    write_header(out, width, height, comment);
+    for (int idx = 0; idx < width * height; idx++) {
+        write_color(out, vec3(rgb[3 * idx], rgb[3 * idx + 1], rgb[3 * idx + 2]));
+    }
+
+    int failed = ferror(out);
+    if (fclose(out) != 0) failed = 1;
+    return failed ? -1 : 0;
+}
+
+/* Whether this machine stores floats little-endian */
+static int host_little_endian(void) {
+    uint16_t one = 1;
+    unsigned char first;
+    memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+/* Write linear RGB triples as PFM */
+int image_write_pfm(const char *path, const float *rgb, int width, int height) {
+    FILE *out = fopen(path, "wb");
+    if (!out) return -1;
+    int ok = fprintf(out, "PF\n%d %d\n%s\n", width, height,
+                     host_little_endian() ? "-1.0" : "1.0") > 0;
+    /* Rows run bottom to top */
+    for (int y = height - 1; y >= 0 && ok; y--) {
+        ok = fwrite(&rgb[(size_t)y * width * 3], sizeof(float) * 3, width, out) ==
+             (size_t)width;
+    }
+    ok &= fclose(out) == 0;
+    return ok ? 0 : -1;
+}
+
+/* Read a PFM image as linear RGB triples */
+float *image_read_pfm(const char *path, int *width, int *height) {
+    FILE *in = fopen(path, "rb");
+    if (!in) return NULL;
+
+    char magic[3] = {0};
+    int w = 0, h = 0;
+    double scale = 0.0;
+    int ok = fscanf(in, "%2s %d %d %lf", magic, &w, &h, &scale) == 4 &&
+             (strcmp(magic, "PF") == 0 || strcmp(magic, "Pf") == 0) && w > 0 && h > 0 &&
+             scale != 0.0 && fgetc(in) != EOF;
+    int channels = magic[1] == 'F' ? 3 : 1;
+    size_t texels = ok ? (size_t)w * h : 0;
+    float *data = ok ? malloc(texels * channels * sizeof(float)) : NULL;
+    float *rgb = ok ? malloc(texels * 3 * sizeof(float)) : NULL;
+    ok = ok && data && rgb && fread(data, sizeof(float) * channels, texels, in) == texels;
+    fclose(in);
+    if (!ok) {
+        free(data);
+        free(rgb);
+        return NULL;
+    }
+
+    /* A negative scale marks little-endian data; rows run bottom to top */
+    int swap = (scale < 0.0) != host_little_endian();
+    for (size_t i = 0; swap && i < texels * channels; i++) {
+        unsigned char b[4];
+        memcpy(b, &data[i], 4);
+        unsigned char r[4] = {b[3], b[2], b[1], b[0]};
+        memcpy(&data[i], r, 4);
+    }
+    for (int y = 0; y < h; y++) {
+        const float *src = &data[(size_t)(h - 1 - y) * w * channels];
+        float *dst = &rgb[(size_t)y * w * 3];
+        for (int x = 0; x < w; x++) {
+            for (int c = 0; c < 3; c++) {
+                dst[3 * x + c] = src[channels * x + (channels == 3 ? c : 0)];
+            }
+        }
+    }
+    free(data);
+    *width = w;
+    *height = h;
+    return rgb;
+}
+
+/* Crop comment of a window of the frame */
+void image_crop_comment(char *buf, size_t size, render_rect_t crop, int width, int height) {
+    if (crop.x0 == 0 && crop.y0 == 0 && crop.x1 == width && crop.y1 == height) {
+        buf[0] = '\0';
+        return;
+    }
+    snprintf(buf, size, "crop %d %d %d %d of %d %d", crop.x0, crop.y0, crop.x1, crop.y1,
+             width, height);
+}
+
+/* A plain PPM read back: 8-bit values and where they sit in the frame */
+typedef struct {
+    int width, height;
+    render_rect_t crop;
+    int frame_width, frame_height;
+    int *rgb;
+} ppm_t;
+
+/* Skip whitespace and comments, picking up a crop comment */
+static void skip_space(FILE *in, ppm_t *img) {
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        if (c == '#') {
+            char line[256];
+            if (!fgets(line, sizeof(line), in)) return;
+            render_rect_t r;
+            int w, h;
+            if (sscanf(line, " crop %d %d %d %d of %d %d", &r.x0, &r.y0, &r.x1, &r.y1, &w,
+                       &h) == 6) {
+                img->crop = r;
+                img->frame_width = w;
+                img->frame_height = h;
+            }
+        } else if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            ungetc(c, in);
+            return;
+        }
+    }
+}
+
+/* Read a P3 file; returns 0 on success */
+static int read_ppm(const char *path, ppm_t *img) {
+    *img = (ppm_t){0};
+    FILE *in = fopen(path, "r");
+    if (!in) return -1;
+
+    int maxval = 0;
+    char magic[3] = {0};
+    int ok = fread(magic, 1, 2, in) == 2 && strcmp(magic, "P3") == 0;
+    skip_space(in, img);
+    ok = ok && fscanf(in, "%d", &img->width) == 1;
+    skip_space(in, img);
+    ok = ok && fscanf(in, "%d", &img->height) == 1;
+    skip_space(in, img);
+    ok = ok && fscanf(in, "%d", &maxval) == 1 && maxval == 255 && img->width > 0 &&
+         img->height > 0;
+    if (ok && img->frame_width == 0) {
+        img->crop = (render_rect_t){0, 0, img->width, img->height};
+        img->frame_width = img->width;
+        img->frame_height = img->height;
+    }
+    ok = ok && img->crop.x1 - img->crop.x0 == img->width &&
+         img->crop.y1 - img->crop.y0 == img->height;
+
+    size_t values = ok ? (size_t)img->width * img->height * 3 : 0;
+    img->rgb = ok ? malloc(values * sizeof(int)) : NULL;
+    ok = ok && img->rgb;
+    for (size_t i = 0; ok && i < values; i++) {
+        ok = fscanf(in, "%d", &img->rgb[i]) == 1;
+    }
+    fclose(in);
+    if (!ok) {
+        free(img->rgb);
+        img->rgb = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Assemble crops into the full frame */
+int image_stitch(const char *output, const char *const *crops, int count) {
+    int width = 0, height = 0;
+    int *frame = NULL;
+    unsigned char *covered = NULL;
+    int status = count > 0 ? 0 : -1;
+
+    for (int k = 0; k < count && status == 0; k++) {
+        ppm_t img;
+        if (read_ppm(crops[k], &img) != 0) {
+            fprintf(stderr, "Error: could not read %s\n", crops[k]);
+            status = -1;
+            break;
+        }
+        if (!frame) {
+            width = img.frame_width;
+            height = img.frame_height;
+            frame = malloc((size_t)width * height * 3 * sizeof(int));
+            covered = calloc((size_t)width * height, 1);
+            if (!frame || !covered) status = -1;
+        }
+        if (status == 0 && (img.frame_width != width || img.frame_height != height ||
+                             img.crop.x0 < 0 || img.crop.y0 < 0 || img.crop.x1 > width ||
+                             img.crop.y1 > height)) {
+            fprintf(stderr, "Error: %s is not a crop of a %dx%d frame\n", crops[k], width,
+                    height);
+            status = -1;
+        }
+        for (int y = 0; y < img.height && status == 0; y++) {
+            for (int x = 0; x < img.width; x++) {
+                size_t d = (size_t)(img.crop.y0 + y) * width + img.crop.x0 + x;
+                const int *src = &img.rgb[3 * ((size_t)y * img.width + x)];
+                if (covered[d] && memcmp(&frame[3 * d], src, 3 * sizeof(int)) != 0) {
+                    fprintf(stderr, "Error: %s disagrees with an overlapping crop at (%d,%d)\n",
+                            crops[k], img.crop.x0 + x, img.crop.y0 + y);
+                    status = -1;
+                    break;
+                }
+                memcpy(&frame[3 * d], src, 3 * sizeof(int));
+                covered[d] = 1;
+            }
+        }
+        free(img.rgb);
+    }
+
+    for (size_t i = 0; status == 0 && i < (size_t)width * height; i++) {
+        if (!covered[i]) {
+            fprintf(stderr, "Error: pixel (%d,%d) is in no crop\n", (int)(i % width),
+                    (int)(i / width));
+            status = -1;
+        }
+    }
+
+    FILE *out = status == 0 ? fopen(output, "w") : NULL;
+    if (status == 0 && !out) status = -1;
+    if (out) {
+        write_header(out, width, height, NULL);
+        for (size_t i = 0; i < (size_t)width * height; i++) {
+            fprintf(out, "%d %d %d\n", frame[3 * i], frame[3 * i + 1], frame[3 * i + 2]);
+        }
+        if (ferror(out)) status = -1;
+        if (fclose(out) != 0) status = -1;
+    }
+    free(frame);
+    free(covered);
+    return status;
+}
@@ -0,0 +1,43 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "render.h"
+#include <stddef.h>
+
+/* Write an accumulation buffer as a plain PPM (P3) with gamma 2 correction.
+ * Returns 0 on success, -1 if the file could not be written. */
+int image_write_ppm(const char *path, const accum_t *accum);
+
+/* Same, with comment written into the header as "# " lines (one per line of
+ * comment), e.g. how the image was rendered */
+int image_write_ppm_comment(const char *path, const accum_t *accum, const char *comment);
+
+/* Write width x height linear RGB triples (row 0 at the top) the same way;
+ * comment may be NULL */
+int image_write_ppm_rgb(const char *path, const double *rgb, int width, int height,
+                        const char *comment);
+
+/* Write width x height linear RGB triples (row 0 at the top) as a
+ * little-endian colour PFM, keeping full float precision. Returns 0 on
+ * success, -1 if the file could not be written. */
+int image_write_pfm(const char *path, const float *rgb, int width, int height);
+
+/* Read a PFM image (colour "PF" or grey "Pf", either byte order) as linear
+ * RGB triples, row 0 at the top, storing its size in *width and *height.
+ * Returns a malloc'd buffer the caller frees, or NULL if the file cannot be
+ * read. */
+float *image_read_pfm(const char *path, int *width, int *height);
+
+/* Header comment recording that an image holds the window crop of a
+ * width x height frame; empty when crop is the whole frame */
+void image_crop_comment(char *buf, size_t size, render_rect_t crop, int width, int height);
+
+/* Assemble crops written by this module (placed by their crop comments; an
+ * image without one is a whole frame) into a full-frame PPM at output.
+ * Overlapping crops must agree. Because every pixel of a crop carries the
+ * samples of the full render, the result is byte-identical to writing the
+ * full frame directly. Returns 0 on success, -1 if the crops do not cover
+ * one frame exactly or a file could not be read or written. */
+int image_stitch(const char *output, const char *const *crops, int count);
+
+#endif /* IMAGE_H */
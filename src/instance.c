@@ -0,0 +1,166 @@
+#include "instance.h"
+#include "dispatch.h"
+#include "utils.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Identity transform */
+transform_t transform_identity(void) {
+    return (transform_t){{{1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}}};
+}
+
+/* Translation by offset */
+transform_t transform_translate(const vec3_t offset) {
+    transform_t t = transform_identity();
+    for (int i = 0; i < 3; i++) t.m[i][3] = offset.e[i];
+    return t;
+}
+
+/* Uniform scale */
+transform_t transform_scale(double factor) {
+    transform_t t = transform_identity();
+    for (int i = 0; i < 3; i++) t.m[i][i] = factor;
+    return t;
+}
+
+/* Rotation about +Y */
+transform_t transform_rotate_y(double degrees) {
+    double theta = degrees * PI / 180.0;
+    double c = cos(theta);
+    double s = sin(theta);
+    return (transform_t){{{c, 0.0, s, 0.0}, {0.0, 1.0, 0.0, 0.0}, {-s, 0.0, c, 0.0}}};
+}
+
+/* a applied after b */
+transform_t transform_compose(const transform_t *a, const transform_t *b) {
+    transform_t out;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            double sum = j == 3 ? a->m[i][3] : 0.0;
+            for (int k = 0; k < 3; k++) sum += a->m[i][k] * b->m[k][j];
+            out.m[i][j] = sum;
+        }
+    }
+    return out;
+}
+
+/* Inverse via the adjugate of the linear part */
+transform_t transform_inverse(const transform_t *t) {
+    double m[3][4];
+    transform_t inv;
+    memcpy(m, t->m, sizeof(m));
+
+    inv.m[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    inv.m[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+    inv.m[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+    inv.m[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    inv.m[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+    inv.m[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+    inv.m[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    inv.m[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+    inv.m[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+    double det = m[0][0] * inv.m[0][0] + m[0][1] * inv.m[1][0] + m[0][2] * inv.m[2][0];
+    double inv_det = 1.0 / det;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) inv.m[i][j] *= inv_det;
+    }
+    for (int i = 0; i < 3; i++) {
+        inv.m[i][3] = -(inv.m[i][0] * m[0][3] + inv.m[i][1] * m[1][3] +
+                        inv.m[i][2] * m[2][3]);
+    }
+    return inv;
+}
+
+/* Transform a point */
+vec3_t transform_point(const transform_t *t, const vec3_t p) {
+    return vec3(t->m[0][0] * p.e[0] + t->m[0][1] * p.e[1] + t->m[0][2] * p.e[2] + t->m[0][3],
+                t->m[1][0] * p.e[0] + t->m[1][1] * p.e[1] + t->m[1][2] * p.e[2] + t->m[1][3],
+                t->m[2][0] * p.e[0] + t->m[2][1] * p.e[1] + t->m[2][2] * p.e[2] + t->m[2][3]);
+}
+
+/* Transform a direction */
+vec3_t transform_vector(const transform_t *t, const vec3_t v) {
+    return vec3(t->m[0][0] * v.e[0] + t->m[0][1] * v.e[1] + t->m[0][2] * v.e[2],
+                t->m[1][0] * v.e[0] + t->m[1][1] * v.e[1] + t->m[1][2] * v.e[2],
+                t->m[2][0] * v.e[0] + t->m[2][1] * v.e[1] + t->m[2][2] * v.e[2]);
+}
+
+/* Intersect in object space. The direction is not renormalized, so t is the
+ * same in both spaces and only the point and normal need converting back. */
+VIBE_KERNEL
+static int instance_hit(const void *obj, const ray_t r, double t_min, double t_max,
+                        hit_record_t *rec) {
+    const instance_t *inst = (const instance_t *)obj;
+    ray_t local = ray_timed(transform_point(&inst->to_object, r.origin),
+                            transform_vector(&inst->to_object, r.direction), r.time);
+
+    if (!inst->object.hit(inst->object.data, local, t_min, t_max, rec)) {
+        return 0;
+    }
+
+    /* Normals transform by the inverse transpose; front_face is unchanged
+     * because (M^-T n) . (M d) = n . d */
+    const transform_t *to_object = &inst->to_object;
+    vec3_t n = rec->normal;
+    vec3_t world_normal = vec3(
+        to_object->m[0][0] * n.e[0] + to_object->m[1][0] * n.e[1] + to_object->m[2][0] * n.e[2],
+        to_object->m[0][1] * n.e[0] + to_object->m[1][1] * n.e[1] + to_object->m[2][1] * n.e[2],
+        to_object->m[0][2] * n.e[0] + to_object->m[1][2] * n.e[1] + to_object->m[2][2] * n.e[2]);
+    rec->point = transform_point(&inst->to_world, rec->point);
+    rec->normal = vec3_normalize(world_normal);
+    return 1;
+}
+
+static int instance_bounding_box(const void *obj, aabb_t *box) {
+    const instance_t *inst = (const instance_t *)obj;
+    if (!inst->bounded) return 0;
+    *box = inst->box;
+    return 1;
+}
+
+static void instance_destroy(void *obj) {
+    free(obj);
+}
+
+/* Create an instance of object */
+instance_t *instance_create(hittable_t object, const transform_t *to_world) {
+    transform_t to_object = transform_inverse(to_world);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            if (!isfinite(to_object.m[i][j])) return NULL;
+        }
+    }
+
+    instance_t *inst = malloc(sizeof(instance_t));
+    if (!inst) return NULL;
+
+    inst->object = object;
+    inst->to_world = *to_world;
+    inst->to_object = to_object;
+
+    /* World bounds: the transformed corners of the object's box */
+    aabb_t local;
+    inst->bounded = object.bounding_box && object.bounding_box(object.data, &local);
+    if (inst->bounded) {
+        inst->box = aabb_empty();
+        for (int c = 0; c < 8; c++) {
+            vec3_t corner = vec3(c & 1 ? local.max.e[0] : local.min.e[0],
+                                 c & 2 ? local.max.e[1] : local.min.e[1],
+                                 c & 4 ? local.max.e[2] : local.min.e[2]);
+            inst->box = aabb_extend(inst->box, transform_point(to_world, corner));
+        }
+    }
+    return inst;
+}
+
+/* Create a hittable instance */
+hittable_t instance_to_hittable(instance_t *instance) {
+    return (hittable_t){
+        .data = instance,
+        .hit = instance_hit,
+        .bounding_box = instance_bounding_box,
+        .destroy = instance_destroy,
+    };
+}
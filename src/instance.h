@@ -0,0 +1,47 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "aabb.h"
+#include "hittable.h"
+#include "vec3.h"
+
+/* Affine transform: the 3x3 linear part in columns 0-2, translation in 3 */
+typedef struct {
+    double m[3][4];
+} transform_t;
+
+/* Identity, translation, uniform scale and rotation about +Y (degrees) */
+transform_t transform_identity(void);
+transform_t transform_translate(const vec3_t offset);
+transform_t transform_scale(double factor);
+transform_t transform_rotate_y(double degrees);
+
+/* a applied after b */
+transform_t transform_compose(const transform_t *a, const transform_t *b);
+
+/* Inverse of an invertible transform */
+transform_t transform_inverse(const transform_t *t);
+
+/* Transform a point / a direction (no translation) */
+vec3_t transform_point(const transform_t *t, const vec3_t p);
+vec3_t transform_vector(const transform_t *t, const vec3_t v);
+
+/* A shared object (typically a BVH over a sub-scene) placed in the world
+ * through a transform. Rays are moved into object space at traversal time,
+ * and instances may themselves be instanced. */
+typedef struct {
+    hittable_t object;      /* shared, not owned */
+    transform_t to_world;
+    transform_t to_object;
+    aabb_t box;             /* world-space bounds */
+    int bounded;
+} instance_t;
+
+/* Create an instance of object; returns NULL on allocation failure or if the
+ * transform is singular */
+instance_t *instance_create(hittable_t object, const transform_t *to_world);
+
+/* Create a hittable instance; destroy frees the instance, not the object */
+hittable_t instance_to_hittable(instance_t *instance);
+
+#endif /* INSTANCE_H */
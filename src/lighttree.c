@@ -0,0 +1,296 @@
+#include "lighttree.h"
+#include "material.h"
+#include "sphere.h"
+#include "utils.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INSIDE_MIN_DISTANCE 0.1 /* of the bounding sphere's radius */
+
+/* Luminance of a color */
+static double luminance(vec3_t c) {
+    return 0.2126 * c.e[0] + 0.7152 * c.e[1] + 0.0722 * c.e[2];
+}
+
+/* Smallest cone holding cones (a_axis, a_theta) and (b_axis, b_theta) */
+static void cone_union(vec3_t *a_axis, double *a_theta, vec3_t b_axis, double b_theta) {
+    if (b_theta > *a_theta) {
+        vec3_t axis = *a_axis;
+        double theta = *a_theta;
+        *a_axis = b_axis;
+        *a_theta = b_theta;
+        b_axis = axis;
+        b_theta = theta;
+    }
+    double theta_d = acos(clamp(vec3_dot(*a_axis, b_axis), -1.0, 1.0));
+    if (fmin(theta_d + b_theta, PI) <= *a_theta) return;
+
+    double theta = 0.5 * (*a_theta + theta_d + b_theta);
+    if (theta >= PI) {
+        *a_theta = PI;
+        return;
+    }
+    /* Turn a's axis toward b's by the growth of a's half angle */
+    double turn = theta - *a_theta;
+    vec3_t side = vec3_sub(b_axis, vec3_mul(*a_axis, vec3_dot(*a_axis, b_axis)));
+    double length = vec3_length(side);
+    if (length > 1e-12) {
+        *a_axis = vec3_add(vec3_mul(*a_axis, cos(turn)), vec3_mul(side, sin(turn) / length));
+    }
+    *a_theta = theta;
+}
+
+/* Importance of node for a receiver at point with the given normal: power
+ * over squared distance to the node's center, times the largest cosines at
+ * the emitter and the receiver over its bounding sphere */
+static double importance(const light_node_t *node, vec3_t point, vec3_t normal) {
+    vec3_t center = aabb_centroid(node->box);
+    double r2 = 0.25 * vec3_length_squared(vec3_sub(node->box.max, node->box.min));
+    vec3_t to = vec3_sub(center, point);
+    double d2 = vec3_length_squared(to);
+    if (d2 <= r2) {
+        /* Inside the bounding sphere nothing bounds the cosines; the distance
+         * to the center still ranks the node, floored so that a point near
+         * the center does not claim all of the probability */
+        return node->power / fmax(d2, INSIDE_MIN_DISTANCE * INSIDE_MIN_DISTANCE * r2);
+    }
+
+    double d = sqrt(d2);
+    vec3_t dir = vec3_div(to, d);
+    double sin_u = sqrt(r2 / d2);
+    double cos_u = sqrt(1.0 - r2 / d2);
+
+    /* Receiver: the angle to the normal less the bounding sphere's half angle */
+    double cos_i = vec3_dot(normal, dir);
+    double cos_receiver = 1.0;
+    if (cos_i < cos_u) {
+        double sin_i = sqrt(fmax(0.0, 1.0 - cos_i * cos_i));
+        cos_receiver = cos_i * cos_u + sin_i * sin_u;
+        if (cos_receiver <= 0.0) return 0.0;
+    }
+
+    /* Emitter: the angle from the cone less its spread and the sphere's */
+    double cos_emitter = 1.0;
+    if (node->theta_o < PI) {
+        double theta = acos(clamp(-vec3_dot(node->axis, dir), -1.0, 1.0));
+        double theta_e = theta - node->theta_o - asin(sin_u);
+        if (theta_e >= 0.5 * PI) return 0.0;
+        if (theta_e > 0.0) cos_emitter = cos(theta_e);
+    }
+    return node->power * cos_receiver * cos_emitter / d2;
+}
+
+/* A light waiting to be placed, keyed by its center along the split axis */
+typedef struct {
+    double key;
+    int light;
+} build_item_t;
+
+static int compare_items(const void *a, const void *b) {
+    const build_item_t *x = a;
+    const build_item_t *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->light > y->light) - (x->light < y->light);
+}
+
+/* Build the subtree over count items below parent, splitting at the median
+ * along the widest axis of their centers; returns its root */
+static int build(light_tree_t *tree, build_item_t *items, int count, int parent) {
+    int index = tree->node_count++;
+    tree->nodes[index].parent = parent;
+    if (count == 1) {
+        const light_t *light = &tree->lights[items[0].light];
+        vec3_t extent = vec3(light->radius, light->radius, light->radius);
+        light_node_t *node = &tree->nodes[index];
+        node->box = (aabb_t){vec3_sub(light->center, extent), vec3_add(light->center, extent)};
+        node->axis = vec3(0.0, 1.0, 0.0);
+        node->theta_o = PI;
+        node->power = 4.0 * PI * light->radius * light->radius * luminance(*light->emission);
+        node->child = items[0].light;
+        node->leaf = 1;
+        tree->leaf_of[items[0].light] = index;
+        return index;
+    }
+
+    aabb_t centers = aabb_empty();
+    for (int i = 0; i < count; i++) {
+        centers = aabb_extend(centers, tree->lights[items[i].light].center);
+    }
+    vec3_t size = vec3_sub(centers.max, centers.min);
+    int axis = size.e[0] > size.e[1] ? (size.e[0] > size.e[2] ? 0 : 2)
+                                     : (size.e[1] > size.e[2] ? 1 : 2);
+    for (int i = 0; i < count; i++) {
+        items[i].key = tree->lights[items[i].light].center.e[axis];
+    }
+    qsort(items, count, sizeof(build_item_t), compare_items);
+
+    int half = count / 2;
+    int left = build(tree, items, half, index);
+    int right = build(tree, items + half, count - half, index);
+    const light_node_t *a = &tree->nodes[left];
+    const light_node_t *b = &tree->nodes[right];
+    light_node_t *node = &tree->nodes[index];
+    node->box = aabb_union(a->box, b->box);
+    node->axis = a->axis;
+    node->theta_o = a->theta_o;
+    cone_union(&node->axis, &node->theta_o, b->axis, b->theta_o);
+    node->power = a->power + b->power;
+    node->child = right;
+    node->leaf = 0;
+    return index;
+}
+
+/* Fold size bytes at data into an FNV-1a hash */
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+/* Build a tree over the emissive static spheres */
+light_tree_t *light_tree_create(const hittable_t *objects, int count) {
+    light_tree_t *tree = calloc(1, sizeof(light_tree_t));
+    if (!tree) return NULL;
+
+    tree->object_count = count;
+    tree->signature = 0xcbf29ce484222325ull;
+    tree->light_of_object = malloc((count > 0 ? count : 1) * sizeof(int));
+    tree->lights = malloc((count > 0 ? count : 1) * sizeof(light_t));
+    if (!tree->light_of_object || !tree->lights) {
+        light_tree_destroy(tree);
+        return NULL;
+    }
+    for (int i = 0; i < count; i++) {
+        const sphere_t *sphere = sphere_from_hittable(&objects[i]);
+        tree->light_of_object[i] = -1;
+        if (!sphere || !sphere->material || !sphere->material->emission) continue;
+        tree->light_of_object[i] = tree->light_count;
+        tree->lights[tree->light_count++] = (light_t){
+            .center = sphere->center,
+            .radius = fabs(sphere->radius),
+            .emission = sphere->material->emission,
+            .object = i,
+        };
+        const light_t *light = &tree->lights[tree->light_count - 1];
+        tree->signature = hash_bytes(tree->signature, &light->center, sizeof(vec3_t));
+        tree->signature = hash_bytes(tree->signature, &light->radius, sizeof(double));
+        tree->signature = hash_bytes(tree->signature, light->emission, sizeof(vec3_t));
+        tree->signature = hash_bytes(tree->signature, &light->object, sizeof(int));
+    }
+    if (tree->light_count == 0) return tree;
+
+    int n = tree->light_count;
+    build_item_t *items = malloc(n * sizeof(build_item_t));
+    tree->nodes = malloc((2 * n - 1) * sizeof(light_node_t));
+    tree->leaf_of = malloc(n * sizeof(int));
+    if (!items || !tree->nodes || !tree->leaf_of) {
+        free(items);
+        light_tree_destroy(tree);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) items[i].light = i;
+    build(tree, items, n, -1);
+    free(items);
+    return tree;
+}
+
+/* Pick a light in proportion to the importance of the subtrees */
+int light_tree_sample(const light_tree_t *tree, vec3_t point, vec3_t normal, double u,
+                      double *pmf) {
+    *pmf = 0.0;
+    if (tree->light_count == 0 || importance(&tree->nodes[0], point, normal) <= 0.0) {
+        return -1;
+    }
+    double p = 1.0;
+    int index = 0;
+    while (!tree->nodes[index].leaf) {
+        int right = tree->nodes[index].child;
+        double a = importance(&tree->nodes[index + 1], point, normal);
+        double b = importance(&tree->nodes[right], point, normal);
+        if (a + b <= 0.0) return -1;
+        double left_p = a / (a + b);
+        /* Reuse u for the next choice, rescaled to [0, 1) */
+        if (u < left_p) {
+            u /= left_p;
+            p *= left_p;
+            index++;
+        } else {
+            u = (u - left_p) / (1.0 - left_p);
+            p *= 1.0 - left_p;
+            index = right;
+        }
+        u = fmin(u, 0x1.fffffffffffffp-1);
+    }
+    *pmf = p;
+    return tree->nodes[index].child;
+}
+
+/* Probability of picking light, from its leaf up to the root */
+double light_tree_pmf(const light_tree_t *tree, vec3_t point, vec3_t normal, int light) {
+    if (light < 0 || light >= tree->light_count ||
+        importance(&tree->nodes[0], point, normal) <= 0.0) {
+        return 0.0;
+    }
+    double p = 1.0;
+    int index = tree->leaf_of[light];
+    for (int parent = tree->nodes[index].parent; parent >= 0;
+         index = parent, parent = tree->nodes[parent].parent) {
+        int right = tree->nodes[parent].child;
+        double a = importance(&tree->nodes[parent + 1], point, normal);
+        double b = importance(&tree->nodes[right], point, normal);
+        if (a + b <= 0.0) return 0.0;
+        p *= (index == right ? b : a) / (a + b);
+    }
+    return p;
+}
+
+/* Solid angle fraction 1 - cos(theta_max) of the cone a sphere subtends, or
+ * 0 from inside it */
+static double cone_extent(const light_t *light, vec3_t point, double *d2) {
+    *d2 = vec3_length_squared(vec3_sub(light->center, point));
+    double r2 = light->radius * light->radius;
+    if (*d2 <= r2) return 0.0;
+    double sin2 = r2 / *d2;
+    return sin2 / (1.0 + sqrt(1.0 - sin2)); /* exact for small spheres far away */
+}
+
+/* Direction toward the light, uniform over the cone its sphere subtends */
+vec3_t light_sample_direction(const light_t *light, vec3_t point, double u1, double u2,
+                              double *pdf) {
+    double d2;
+    double extent = cone_extent(light, point, &d2);
+    if (extent <= 0.0) {
+        *pdf = 0.0;
+        return vec3(0.0, 0.0, 0.0);
+    }
+    vec3_t w = vec3_div(vec3_sub(light->center, point), sqrt(d2));
+    vec3_t a = fabs(w.e[0]) > 0.9 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3_t s = vec3_normalize(vec3_cross(w, a));
+    vec3_t t = vec3_cross(w, s);
+
+    double one_minus_cos = u1 * extent;
+    double cos_theta = 1.0 - one_minus_cos;
+    double sin_theta = sqrt(fmax(0.0, one_minus_cos * (2.0 - one_minus_cos)));
+    double phi = 2.0 * PI * u2;
+    *pdf = 1.0 / (2.0 * PI * extent);
+    return vec3_add(vec3_mul(w, cos_theta), vec3_add(vec3_mul(s, sin_theta * cos(phi)),
+                                                     vec3_mul(t, sin_theta * sin(phi))));
+}
+
+/* Density of light_sample_direction's directions that reach the light */
+double light_direction_pdf(const light_t *light, vec3_t point) {
+    double d2;
+    double extent = cone_extent(light, point, &d2);
+    return extent > 0.0 ? 1.0 / (2.0 * PI * extent) : 0.0;
+}
+
+/* Free the tree */
+void light_tree_destroy(light_tree_t *tree) {
+    if (!tree) return;
+    free(tree->nodes);
+    free(tree->lights);
+    free(tree->leaf_of);
+    free(tree->light_of_object);
+    free(tree);
+}
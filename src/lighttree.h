@@ -0,0 +1,87 @@
+#ifndef LIGHTTREE_H
+#define LIGHTTREE_H
+
+#include "aabb.h"
+#include "hittable.h"
+#include "vec3.h"
+#include <stdint.h>
+
+/* Light tree: a BVH over a scene's emissive spheres for next-event
+ * estimation with many lights (a light BVH after Conty Estevez and Kulla).
+ * Every node bounds the positions of its lights, their total power and the
+ * cone of directions they emit into. Seen from a shading point, a node's
+ * importance is its power over the squared distance, scaled by bounds on the
+ * cosines at the emitter and at the receiving surface over all of the node's
+ * box. Sampling walks down from the root choosing a child in proportion to
+ * its importance, so a light is picked in O(log N) with a probability that
+ * follows its estimated contribution, and the walk from a light up to the
+ * root gives that probability back for multiple importance sampling. The
+ * bounds are conservative: every light that can reach the shading point
+ * keeps a non-zero probability, so estimates stay unbiased. Sphere lights
+ * emit in all directions, so their cones are whole spheres and orientation
+ * culls through the receiver's horizon. */
+
+/* One sphere light */
+typedef struct {
+    vec3_t center;
+    double radius;
+    const vec3_t *emission; /* its material's radiance */
+    int object;             /* index of the sphere in the build input */
+} light_t;
+
+typedef struct {
+    aabb_t box;         /* of the lights' spheres */
+    vec3_t axis;        /* emission cone: within theta_o of axis */
+    double theta_o;     /* PI for lights shining all around */
+    double power;       /* luminance times area, summed */
+    int child;          /* interior: index of the right child (the left child
+                         * directly follows its parent); leaf: the light */
+    int parent;         /* -1 at the root */
+    int leaf;
+} light_node_t;
+
+typedef struct {
+    light_node_t *nodes;
+    int node_count;
+    light_t *lights;
+    int light_count;
+    int *leaf_of;         /* node of each light */
+    int *light_of_object; /* light of each object in the build input, or -1 */
+    int object_count;
+    uint64_t signature;   /* hash of every light's sphere and radiance: trees
+                           * with equal signatures sample alike */
+} light_tree_t;
+
+/* Build a tree over the static spheres among count objects whose material
+ * emits light (other emitters are only found by rays that hit them).
+ * Returns NULL on allocation failure; the tree may hold no lights. */
+light_tree_t *light_tree_create(const hittable_t *objects, int count);
+
+/* Pick a light for the shading point with surface normal normal from a
+ * uniform number u in [0, 1); its probability goes to *pmf. Returns -1 if
+ * no light can reach the point. */
+int light_tree_sample(const light_tree_t *tree, vec3_t point, vec3_t normal, double u,
+                      double *pmf);
+
+/* Probability with which light_tree_sample picks light at the point */
+double light_tree_pmf(const light_tree_t *tree, vec3_t point, vec3_t normal, int light);
+
+/* Light of object (an index into the build input), or -1 */
+static inline int light_tree_light_of(const light_tree_t *tree, int object) {
+    return object >= 0 && object < tree->object_count ? tree->light_of_object[object] : -1;
+}
+
+/* Unit direction from point toward the light drawn uniformly over the cone
+ * its sphere subtends, from two uniform numbers in [0, 1); its density over
+ * solid angle goes to *pdf (0 if the point is inside the sphere) */
+vec3_t light_sample_direction(const light_t *light, vec3_t point, double u1, double u2,
+                              double *pdf);
+
+/* Density over solid angle with which light_sample_direction draws a
+ * direction that reaches the light */
+double light_direction_pdf(const light_t *light, vec3_t point);
+
+/* Free the tree */
+void light_tree_destroy(light_tree_t *tree);
+
+#endif /* LIGHTTREE_H */
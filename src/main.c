@@ -1,235 +1,774 @@
-#include "vec3.h"
-#include "ray.h"
-#include "hittable.h"
-#include "sphere.h"
-#include "camera.h"
-#include "material.h"
-#include "utils.h"
+#define _POSIX_C_SOURCE 200809L
+#include "vibe.h"
+#include "vibe_private.h"
+#include "autotune.h"
+#include "deadline.h"
+#include "distrib.h"
+#include "image.h"
+#include "multiview.h"
+#include "preview.h"
+#include "server.h"
+#include "temporal.h"
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <omp.h>
-
-/* Image dimensions */
-#define IMAGE_WIDTH 1200
-#define IMAGE_HEIGHT 800
-#define SAMPLES_PER_PIXEL 500
-#define MAX_DEPTH 50
-#define USE_OPENMP 1
-
-/* Calculate color based on ray-scene intersection with recursion */
-static vec3_t ray_color(const ray_t r, const hittable_list_t *world, int depth) {
-    hit_record_t rec = {0};
-
-    if (depth <= 0) {
-        return vec3(0.0, 0.0, 0.0);
-    }
-
-    if (hittable_list_hit(world, r, 0.001, INFINITY, &rec)) {
-        ray_t scattered = {0};
-        vec3_t attenuation = {0};
-
-        if (rec.material && rec.material->scatter) {
-            if (rec.material->scatter(rec.material->data, r, &rec, &attenuation,
-                                      &scattered)) {
-                vec3_t color = ray_color(scattered, world, depth - 1);
-                return vec3(attenuation.e[0] * color.e[0],
-                           attenuation.e[1] * color.e[1],
-                           attenuation.e[2] * color.e[2]);
-            }
+#include <string.h>
+#include <time.h>
+
+/* Command-line front end of libvibe */
+
+#define OUTPUT_PATH "output/final.ppm"
+#define WRITE_SECONDS_PER_PIXEL 4e-7 /* time kept back to write a deadline image */
+#define REUSE_HISTORY 4 /* with --reuse, history counts for at most this many frames of --spp */
+#define VIEWS_MAX 4096  /* most cameras a views file may list */
+#define TUNE_CACHE_NAME "vibe_tracing.tune" /* in $XDG_CACHE_HOME or ~/.cache */
+
+/* Monotonic time in seconds */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Output path of a sequence frame: the frame number goes before the extension */
+static void frame_path(char *buf, size_t size, const char *output, int frame) {
+    const char *slash = strrchr(output, '/');
+    const char *dot = strrchr(output, '.');
+    if (!dot || (slash && dot < slash)) dot = output + strlen(output);
+    snprintf(buf, size, "%.*s_%04d%s", (int)(dot - output), output, frame, dot);
+}
+
+/* Write the crop window rendered into rgb, recording its place in the frame
+ * so crops can be stitched back together */
+static int write_crop(const char *path, const double *rgb, const vibe_settings_t *settings) {
+    render_rect_t rect;
+    if (vibe_crop_rect(settings, &rect) != 0) return -1;
+    char comment[64];
+    image_crop_comment(comment, sizeof(comment), rect, settings->width, settings->height);
+    return image_write_ppm_rgb(path, rgb, rect.x1 - rect.x0, rect.y1 - rect.y0, comment);
+}
+
+/* View of frame f of a flythrough that turns by orbit degrees per frame about
+ * the up direction through the look-at point */
+static vibe_view_t orbit_view(const vibe_view_t *view, double orbit, int f) {
+    vibe_view_t turned = *view;
+    double angle = orbit * f * 3.14159265358979323846 / 180.0;
+    double c = cos(angle), s = sin(angle);
+    double up_len = sqrt(view->vup[0] * view->vup[0] + view->vup[1] * view->vup[1] +
+                         view->vup[2] * view->vup[2]);
+    double k[3], d[3];
+    for (int i = 0; i < 3; i++) {
+        k[i] = view->vup[i] / up_len;
+        d[i] = view->lookfrom[i] - view->lookat[i];
+    }
+    /* Rodrigues' rotation of the look-at offset about k */
+    double kd = k[0] * d[0] + k[1] * d[1] + k[2] * d[2];
+    double cross[3] = {k[1] * d[2] - k[2] * d[1], k[2] * d[0] - k[0] * d[2],
+                       k[0] * d[1] - k[1] * d[0]};
+    for (int i = 0; i < 3; i++) {
+        turned.lookfrom[i] = view->lookat[i] + d[i] * c + cross[i] * s + k[i] * kd * (1.0 - c);
+    }
+    return turned;
+}
+
+/* Render frames [0, frames) of an animated scene, refitting between frames.
+ * The camera turns by orbit degrees per frame; reuse > 0 reprojects each
+ * frame into the next, tracing reuse samples where history holds */
+static int render_sequence(vibe_scene_t *scene, const vibe_settings_t *settings,
+                           int frames, double shutter, double orbit, int reuse,
+                           const char *output, double *rgb) {
+    vibe_view_t view;
+    vibe_scene_view(scene, &view);
+    temporal_t *temporal = NULL;
+    temporal_options_t options = {.fresh_spp = reuse,
+                                  .max_history = REUSE_HISTORY * settings->samples_per_pixel};
+    if (reuse > 0 && !(temporal = temporal_create(settings->width, settings->height))) return -1;
+
+    int status = 0;
+    for (int f = 0; f < frames && status == 0; f++) {
+        double start = now_seconds();
+        if (vibe_scene_set_shutter(scene, f, f + shutter) != 0) {
+            status = -1;
+            break;
+        }
+        double setup = now_seconds() - start;
+
+        vibe_view_t frame_view = orbit_view(&view, orbit, f);
+        temporal_stats_t stats;
+        if (temporal) {
+            camera_t camera = vibe_camera(scene, &frame_view, settings);
+            render_settings_t rs = vibe_render_settings(scene, settings);
+            status = temporal_render(temporal, vibe_scene_world(scene), &camera, &rs, &options,
+                                     rgb, &stats);
+        } else {
+            status = vibe_render(scene, &frame_view, settings, rgb);
+        }
+        if (status != 0) break;
+        double render = now_seconds() - start - setup;
+
+        char path[4096];
+        frame_path(path, sizeof(path), output, f);
+        if ((status = write_crop(path, rgb, settings)) != 0) break;
+        if (temporal) {
+            int pixels = settings->width * settings->height;
+            fprintf(stderr, "Frame %d: setup %.3f ms, render %.3f s, reused %.0f%%, "
+                            "%.1f spp traced -> %s\n", f, setup * 1e3, render,
+                    100.0 * stats.reused / pixels, (double)stats.samples / pixels, path);
+        } else {
+            fprintf(stderr, "Frame %d: setup %.3f ms, render %.3f s -> %s\n", f,
+                    setup * 1e3, render, path);
         }
-        return vec3(0.0, 0.0, 0.0);
     }
+    temporal_destroy(temporal);
+    return status;
+}
 
-    vec3_t unit_direction = vec3_normalize(r.direction);
-    double t = 0.5 * (unit_direction.e[1] + 1.0);
-    vec3_t white = vec3(1.0, 1.0, 1.0);
-    vec3_t blue = vec3(0.5, 0.7, 1.0);
-    return vec3_add(vec3_mul(white, 1.0 - t), vec3_mul(blue, t));
+/* Cameras of a views file, one per line: lookfrom and lookat (6 numbers),
+ * optionally followed by vup, vfov, aperture and focus distance (12), then
+ * optionally width and height (14). Omitted values come from the scene's
+ * view and the settings; '#' starts a comment. Returns the number of views,
+ * or -1 if the file cannot be read or a line is malformed. */
+static int load_views(const char *path, const vibe_scene_t *scene,
+                      const vibe_settings_t *settings, multiview_view_t **views) {
+    FILE *in = fopen(path, "r");
+    if (!in) return -1;
+    multiview_view_t *list = malloc(VIEWS_MAX * sizeof(multiview_view_t));
+    vibe_view_t base;
+    vibe_scene_view(scene, &base);
+
+    int count = 0, ok = list != NULL;
+    char line[1024];
+    while (ok && fgets(line, sizeof(line), in)) {
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        double n[15];
+        int found = 0;
+        char *p = line, *end;
+        for (double x = strtod(p, &end); end != p && found < 15; x = strtod(p, &end)) {
+            n[found++] = x;
+            p = end;
+        }
+        if (found == 0) continue;
+        if ((found != 6 && found != 12 && found != 14) || count == VIEWS_MAX) {
+            ok = 0;
+            break;
+        }
+        vibe_view_t view = base;
+        vibe_settings_t frame = *settings;
+        memcpy(view.lookfrom, &n[0], sizeof(view.lookfrom));
+        memcpy(view.lookat, &n[3], sizeof(view.lookat));
+        if (found >= 12) {
+            memcpy(view.vup, &n[6], sizeof(view.vup));
+            view.vfov = n[9];
+            view.aperture = n[10];
+            view.focus_dist = n[11];
+        }
+        if (found == 14) {
+            frame.width = (int)n[12];
+            frame.height = (int)n[13];
+        }
+        if (frame.width < 2 || frame.height < 2) {
+            ok = 0;
+            break;
+        }
+        list[count].width = frame.width;
+        list[count].height = frame.height;
+        list[count].camera = vibe_camera(scene, &view, &frame);
+        count++;
+    }
+    fclose(in);
+    if (!ok || count == 0) {
+        free(list);
+        return -1;
+    }
+    *views = list;
+    return count;
 }
 
-/* Write color value to PPM file (0-255) with gamma correction */
-static void write_color(FILE *out, const vec3_t color, int samples) {
-    double r = color.e[0] / samples;
-    double g = color.e[1] / samples;
-    double b = color.e[2] / samples;
+/* Where finished views of a batch go */
+typedef struct {
+    const char *output;
+    double start;
+} views_output_t;
+
+/* Write a finished view to the output path numbered with its index */
+static int write_view(int view, const accum_t *image, void *user) {
+    const views_output_t *out = user;
+    char path[4096];
+    frame_path(path, sizeof(path), out->output, view);
+    if (image_write_ppm(path, image) != 0) return -1;
+    fprintf(stderr, "View %d: %dx%d at %.3f s -> %s\n", view, image->width, image->height,
+            now_seconds() - out->start, path);
+    return 0;
+}
 
-    /* Gamma correction (gamma = 2.0) */
-    r = sqrt(r);
-    g = sqrt(g);
-    b = sqrt(b);
+/* Render count views in one batch over the scene, writing each as it is
+ * finished */
+static int render_views(const vibe_scene_t *scene, const vibe_settings_t *settings,
+                        const multiview_view_t *views, int count, const char *output) {
+    fprintf(stderr, "Rendering %d views...\n", count);
+    render_settings_t rs = vibe_render_settings(scene, settings);
+    views_output_t out = {.output = output, .start = now_seconds()};
+    return multiview_render(vibe_scene_world(scene), views, count, &rs,
+                            MULTIVIEW_DEFAULT_TILE, write_view, &out);
+}
 
-    int ir = (int)(255.999 * clamp(r, 0.0, 1.0));
-    int ig = (int)(255.999 * clamp(g, 0.0, 1.0));
-    int ib = (int)(255.999 * clamp(b, 0.0, 1.0));
-    fprintf(out, "%d %d %d\n", ir, ig, ib);
+/* Render until budget seconds have passed, adapting the samples per pixel,
+ * and write the image with what was achieved recorded in its header */
+static int render_to_deadline(const vibe_scene_t *scene, const vibe_settings_t *settings,
+                              double budget, const char *output) {
+    render_rect_t rect;
+    if (vibe_crop_rect(settings, &rect) != 0) return -1;
+    vibe_view_t view;
+    vibe_scene_view(scene, &view);
+    camera_t camera = vibe_camera(scene, &view, settings);
+    render_settings_t rs = vibe_render_settings(scene, settings);
+
+    int width = rect.x1 - rect.x0;
+    int height = rect.y1 - rect.y0;
+    accum_t *accum = accum_create(width, height);
+    if (!accum) return -1;
+    double render_budget = budget - WRITE_SECONDS_PER_PIXEL * width * height;
+    deadline_stats_t stats;
+    int status = deadline_render(vibe_scene_world(scene), &camera, &rs, rect,
+                                 render_budget > 0.0 ? render_budget : 0.0, accum, &stats);
+    if (status == 0) {
+        char crop[64], comment[256];
+        image_crop_comment(crop, sizeof(crop), rect, settings->width, settings->height);
+        snprintf(comment, sizeof(comment),
+                 "%s%sdeadline %.3f s\nspp mean %.2f min %u max %u\npasses %d, %.0f samples/s",
+                 crop, crop[0] ? "\n" : "", budget, stats.mean_spp, stats.min_spp,
+                 stats.max_spp, stats.passes, stats.rate);
+        fprintf(stderr, "Rendered %.2f spp (min %u, max %u) in %d passes, %.3f s\n",
+                stats.mean_spp, stats.min_spp, stats.max_spp, stats.passes, stats.elapsed);
+        status = image_write_ppm_comment(output, accum, comment);
+    }
+    accum_destroy(accum);
+    return status;
 }
 
-int main(void) {
-    /* Create output directory if needed */
-    (void)system("mkdir -p output");
+/* Assemble the comma-separated crop images of list into output */
+static int stitch_crops(const char *list, const char *output) {
+    char *paths = strdup(list);
+    const char **crops = calloc(strlen(list) / 2 + 1, sizeof(char *));
+    int count = 0;
+    if (!paths || !crops) {
+        free(paths);
+        return -1;
+    }
+    for (char *p = strtok(paths, ","); p; p = strtok(NULL, ",")) crops[count++] = p;
+    int status = image_stitch(output, crops, count);
+    if (status == 0) fprintf(stderr, "Stitched %d crops into %s\n", count, output);
+    free(crops);
+    free(paths);
+    return status;
+}
 
-    /* Create world (scene) */
-    hittable_list_t *world = hittable_list_create();
-    if (!world) {
-        fprintf(stderr, "Error: could not create hittable list\n");
-        return 1;
-    }
-
-    /* Create materials */
-    material_t mat_ground = lambertian_create(vec3(0.5, 0.5, 0.5));
-
-    /* Create spheres with materials */
-    sphere_t *ground = sphere_create(vec3(0.0, -1000.0, 0.0), 1000.0, &mat_ground);
-    if (ground) {
-        hittable_list_add(world, sphere_to_hittable(ground));
-    }
-
-    /* Persistent material storage for random spheres (max 22x22 = 484) */
-    material_t *random_mats = malloc(484 * sizeof(material_t));
-    if (!random_mats) {
-        fprintf(stderr, "Error: could not allocate random materials\n");
-        hittable_list_destroy(world);
-        return 1;
-    }
-    int num_random_mats = 0;
-
-    /* Generate random scene with many spheres */
-    for (int a = -11; a < 11; a++) {
-        for (int b = -11; b < 11; b++) {
-            double choose_mat = random_double();
-            vec3_t center = vec3(a + 0.9 * random_double(), 0.2,
-                                b + 0.9 * random_double());
-
-            if (vec3_length(vec3_sub(center, vec3(4.0, 0.2, 0.0))) > 0.9) {
-                sphere_t *sphere = NULL;
-                material_t mat = {0};
-
-                if (choose_mat < 0.8) {
-                    /* Diffuse sphere */
-                    vec3_t albedo = vec3(random_double() * random_double(),
-                                        random_double() * random_double(),
-                                        random_double() * random_double());
-                    mat = lambertian_create(albedo);
-                } else if (choose_mat < 0.95) {
-                    /* Metal sphere */
-                    vec3_t albedo = vec3(0.5 * (1.0 + random_double()),
-                                        0.5 * (1.0 + random_double()),
-                                        0.5 * (1.0 + random_double()));
-                    double fuzz = 0.5 * random_double();
-                    mat = metal_create(albedo, fuzz);
-                } else {
-                    /* Glass sphere */
-                    mat = dielectric_create(1.5);
-                }
-
-                /* Store material in persistent array so pointer remains valid */
-                random_mats[num_random_mats] = mat;
-                sphere = sphere_create(center, 0.2, &random_mats[num_random_mats]);
-                num_random_mats++;
-
-                if (sphere) {
-                    hittable_list_add(world, sphere_to_hittable(sphere));
-                }
+/* Print a daemon job's progress */
+static void show_progress(double fraction, void *user) {
+    (void)user;
+    fprintf(stderr, "\rProgress: %3.0f%%", 100.0 * fraction);
+}
+
+/* Send the render described on the command line to a daemon and wait */
+static int submit_job(const char *address, const vibe_scene_desc_t *desc,
+                      const vibe_settings_t *settings, int priority, const char *output) {
+    server_job_t job = {.scene_seed = desc->seed, .priority = priority, .default_view = 1,
+                        .settings = *settings};
+    if (strlen(desc->name) >= sizeof(job.scene) ||
+        (desc->obj_path && strlen(desc->obj_path) >= sizeof(job.obj_path)) ||
+        strlen(output) >= sizeof(job.output)) {
+        fprintf(stderr, "Error: scene name or path too long\n");
+        return -1;
+    }
+    strcpy(job.scene, desc->name);
+    if (desc->obj_path) strcpy(job.obj_path, desc->obj_path);
+    strcpy(job.output, output);
+
+    server_result_t result = {0};
+    int status = server_submit(address, &job, show_progress, NULL, &result);
+    fprintf(stderr, "\n");
+    if (status != 0) {
+        fprintf(stderr, "Error: %s\n", result.message[0] ? result.message
+                                                         : "could not reach the daemon");
+        return -1;
+    }
+    fprintf(stderr, "Rendered %s in %.3f s (queued %.3f s, scene %s)\n", output,
+            result.render, result.queued, result.scene_cached ? "cached" : "built");
+    return 0;
+}
+
+/* Default tuning cache path into buf; -1 if no cache directory is known */
+static int default_tune_cache(char *buf, size_t size) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if (xdg && xdg[0]) {
+        snprintf(buf, size, "%s/%s", xdg, TUNE_CACHE_NAME);
+    } else if (home && home[0]) {
+        snprintf(buf, size, "%s/.cache/%s", home, TUNE_CACHE_NAME);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/* Tune threads and chunk size for the scene and frame and cache the result
+ * (tune), or else apply the cached tuning of this host and scene size class.
+ * Cached thread counts give way to --threads (threads_given). */
+static int apply_tuning(const vibe_scene_t *scene, vibe_settings_t *settings, int tune,
+                        const char *cache, int threads_given) {
+    char path[1024];
+    if (!cache && default_tune_cache(path, sizeof(path)) == 0) cache = path;
+    if (cache && strcmp(cache, "none") == 0) cache = NULL;
+    char host[320];
+    autotune_host(host, sizeof(host));
+    int size_class = autotune_size_class(vibe_scene_world(scene));
+    autotune_config_t config;
+
+    if (!tune) {
+        if (!cache || autotune_load(cache, host, size_class, &config) != 0) return 0;
+        if (!threads_given) settings->threads = config.threads;
+        settings->chunk_size = config.chunk;
+        fprintf(stderr, "Tuning: %d threads, chunks of %d pixels (cached in %s)\n",
+                settings->threads, config.chunk, cache);
+        return 0;
+    }
+
+    render_rect_t rect;
+    if (vibe_crop_rect(settings, &rect) != 0) return -1;
+    vibe_view_t view;
+    vibe_scene_view(scene, &view);
+    camera_t camera = vibe_camera(scene, &view, settings);
+    render_settings_t rs = vibe_render_settings(scene, settings);
+    fprintf(stderr, "Tuning for %s, size class %d...\n", host, size_class);
+    double start = now_seconds();
+    int renders = autotune_run(vibe_scene_world(scene), &camera, &rs, rect, &config);
+    if (renders < 0) return -1;
+    settings->threads = config.threads;
+    settings->chunk_size = config.chunk;
+    fprintf(stderr, "Tuned: %d threads, chunks of %d pixels, %.0f samples/s (%d renders, "
+                    "%.2f s)\n", config.threads, config.chunk, config.rate, renders,
+            now_seconds() - start);
+    if (cache && autotune_save(cache, host, size_class, &config) != 0) {
+        fprintf(stderr, "Warning: could not write the tuning cache %s\n", cache);
+    }
+    return 0;
+}
+
+/* Print command line help */
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --width N          image width (default %d)\n"
+            "  --height N         image height (default %d)\n"
+            "  --spp N            samples per pixel (default %d)\n"
+            "  --depth N          maximum bounce depth (default %d)\n"
+            "  --seed N           sampling seed\n"
+            "  --crop X0,Y0,X1,Y1 render only pixels [X0,X1) x [Y0,Y1) of the frame\n"
+            "  --stitch A,B,...   assemble crop images into the full frame at --output\n"
+            "  --deadline SEC     finish within SEC seconds (scene build included), sampling\n"
+            "                     adaptively with --spp as the per-pixel maximum\n"
+            "  --batch N          trace paths in batches of about N, bounce by bounce\n"
+            "  --sort 0|1         sort batched secondary rays for coherence (default 1)\n"
+            "  --guide 0|1        path guiding learned over progressive passes (default 0)\n"
+            "  --caustics N       caustics from progressive photon maps of N photons\n"
+            "  --threads N        render threads (default: one per CPU, or per the policy)\n"
+            "  --autotune 0|1     time short renders to pick threads and chunk size, and\n"
+            "                     cache them for this CPU and scene size (default 0)\n"
+            "  --tune-cache PATH  tuning cache, loaded by every local render (default\n"
+            "                     ~/.cache/%s; none to skip it)\n"
+            "  --affinity POLICY  pin threads: none (default), compact, scatter or cores\n"
+            "  --numa MODE        scene memory: local (default), interleave or replicate\n"
+            "  --scene NAME       random (default), bouncing, forest, room, glass, lights\n"
+            "                     or field\n"
+            "  --obj PATH         add a Wavefront OBJ mesh to the scene\n"
+            "  --accel NAME       acceleration structure: bvh (default) or grid\n"
+            "  --env PATH         light the scene with a PFM latitude-longitude HDR map\n"
+            "  --output PATH      output image (default %s)\n"
+            "  --frames N         render an N-frame sequence to PATH_0000.ppm, ...\n"
+            "  --shutter S        motion blur: expose each frame for S frames (0..1)\n"
+            "  --orbit DEG        sequences: turn the camera DEG degrees per frame\n"
+            "  --reuse N          sequences: reproject the previous frame, tracing N samples\n"
+            "                     where its history holds and --spp elsewhere\n"
+            "  --views PATH       render every camera listed in PATH (lookfrom lookat\n"
+            "                     [vup vfov aperture focus [width height]] per line) in one\n"
+            "                     batch, to PATH_0000.ppm, ... of --output\n"
+            "  --coordinator ADDR render with worker processes listening on ADDR\n"
+            "                     (unix:/path or tcp:host:port)\n"
+            "  --workers N        workers to fork locally as coordinator (default 0)\n"
+            "  --tile N           tile size of distributed jobs (default 64)\n"
+            "  --splits N         sample ranges per tile (default 1)\n"
+            "  --timeout SEC      reassign jobs running longer than SEC\n"
+            "  --worker ADDR      serve jobs for the coordinator at ADDR\n"
+            "  --serve ADDR       run a render daemon on ADDR (unix:/path)\n"
+            "  --root DIR         directory the daemon's job paths are relative to\n"
+            "                     (default .)\n"
+            "  --cache N          scenes the daemon keeps built (default %d)\n"
+            "  --submit ADDR      render through the daemon at ADDR; paths are relative to\n"
+            "                     its --root\n"
+            "  --priority N       daemon job priority, higher first (default 0)\n"
+            "  --stop ADDR        ask the daemon at ADDR to finish its queue and exit\n"
+            "  --preview PATH     progressive preview published to framebuffer file PATH\n"
+            "  --control PATH     camera control file watched by the preview\n",
+            prog, VIBE_DEFAULT_WIDTH, VIBE_DEFAULT_HEIGHT, VIBE_DEFAULT_SPP, VIBE_DEFAULT_DEPTH,
+            TUNE_CACHE_NAME, OUTPUT_PATH, SERVER_DEFAULT_CACHE);
+}
+
+int main(int argc, char **argv) {
+    double start = now_seconds();
+    vibe_settings_t settings;
+    vibe_settings_default(&settings);
+    vibe_scene_desc_t desc = {.name = "random"};
+    distrib_options_t dist = {.tile_size = 64, .sample_splits = 1};
+    preview_options_t preview = {0};
+    const char *output = OUTPUT_PATH;
+    const char *worker_address = NULL;
+    const char *affinity = NULL;
+    server_options_t serve = {0};
+    const char *submit_address = NULL;
+    const char *stop_address = NULL;
+    int priority = 0;
+    int frames = 0;
+    double shutter = 0.0;
+    double orbit = 0.0;
+    int reuse = 0;
+    const char *views_path = NULL;
+    double deadline = 0.0;
+    const char *stitch = NULL;
+    int autotune = 0;
+    const char *tune_cache = NULL;
+    int threads_given = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--help") == 0) {
+            usage(argv[0]);
+            return 0;
+        }
+        if (!val) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+
+        if (strcmp(arg, "--width") == 0) {
+            settings.width = atoi(val);
+        } else if (strcmp(arg, "--height") == 0) {
+            settings.height = atoi(val);
+        } else if (strcmp(arg, "--spp") == 0) {
+            settings.samples_per_pixel = atoi(val);
+        } else if (strcmp(arg, "--depth") == 0) {
+            settings.max_depth = atoi(val);
+        } else if (strcmp(arg, "--seed") == 0) {
+            settings.seed = (unsigned int)strtoul(val, NULL, 0);
+        } else if (strcmp(arg, "--crop") == 0) {
+            vibe_rect_t *c = &settings.crop;
+            if (sscanf(val, "%d,%d,%d,%d", &c->x0, &c->y0, &c->x1, &c->y1) != 4) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--stitch") == 0) {
+            stitch = val;
+        } else if (strcmp(arg, "--deadline") == 0) {
+            deadline = atof(val);
+        } else if (strcmp(arg, "--batch") == 0) {
+            settings.batch_size = atoi(val);
+        } else if (strcmp(arg, "--sort") == 0) {
+            settings.sort_rays = atoi(val);
+        } else if (strcmp(arg, "--guide") == 0) {
+            settings.guiding = atoi(val);
+        } else if (strcmp(arg, "--caustics") == 0) {
+            settings.caustic_photons = atoi(val);
+        } else if (strcmp(arg, "--threads") == 0) {
+            settings.threads = atoi(val);
+            threads_given = 1;
+        } else if (strcmp(arg, "--autotune") == 0) {
+            autotune = atoi(val);
+        } else if (strcmp(arg, "--tune-cache") == 0) {
+            tune_cache = val;
+        } else if (strcmp(arg, "--affinity") == 0) {
+            affinity = val;
+        } else if (strcmp(arg, "--numa") == 0) {
+            if (strcmp(val, "local") == 0) {
+                desc.memory = VIBE_MEMORY_LOCAL;
+            } else if (strcmp(val, "interleave") == 0) {
+                desc.memory = VIBE_MEMORY_INTERLEAVE;
+            } else if (strcmp(val, "replicate") == 0) {
+                desc.memory = VIBE_MEMORY_REPLICATE;
+            } else {
+                usage(argv[0]);
+                return 1;
             }
+        } else if (strcmp(arg, "--scene") == 0) {
+            desc.name = val;
+        } else if (strcmp(arg, "--accel") == 0) {
+            if (strcmp(val, "bvh") == 0) {
+                desc.accel = VIBE_ACCEL_BVH;
+            } else if (strcmp(val, "grid") == 0) {
+                desc.accel = VIBE_ACCEL_GRID;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--obj") == 0) {
+            desc.obj_path = val;
+        } else if (strcmp(arg, "--env") == 0) {
+            desc.env_path = val;
+        } else if (strcmp(arg, "--output") == 0) {
+            output = val;
+        } else if (strcmp(arg, "--frames") == 0) {
+            frames = atoi(val);
+        } else if (strcmp(arg, "--shutter") == 0) {
+            shutter = atof(val);
+        } else if (strcmp(arg, "--orbit") == 0) {
+            orbit = atof(val);
+        } else if (strcmp(arg, "--reuse") == 0) {
+            reuse = atoi(val);
+        } else if (strcmp(arg, "--views") == 0) {
+            views_path = val;
+        } else if (strcmp(arg, "--coordinator") == 0) {
+            dist.address = val;
+        } else if (strcmp(arg, "--workers") == 0) {
+            dist.local_workers = atoi(val);
+        } else if (strcmp(arg, "--tile") == 0) {
+            dist.tile_size = atoi(val);
+        } else if (strcmp(arg, "--splits") == 0) {
+            dist.sample_splits = atoi(val);
+        } else if (strcmp(arg, "--timeout") == 0) {
+            dist.job_timeout = atof(val);
+        } else if (strcmp(arg, "--worker") == 0) {
+            worker_address = val;
+        } else if (strcmp(arg, "--serve") == 0) {
+            serve.address = val;
+        } else if (strcmp(arg, "--root") == 0) {
+            serve.root = val;
+        } else if (strcmp(arg, "--cache") == 0) {
+            serve.cache_size = atoi(val);
+        } else if (strcmp(arg, "--submit") == 0) {
+            submit_address = val;
+        } else if (strcmp(arg, "--priority") == 0) {
+            priority = atoi(val);
+        } else if (strcmp(arg, "--stop") == 0) {
+            stop_address = val;
+        } else if (strcmp(arg, "--preview") == 0) {
+            preview.framebuffer_path = val;
+        } else if (strcmp(arg, "--control") == 0) {
+            preview.control_path = val;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (worker_address) {
+        return distrib_work(worker_address, 0) == 0 ? 0 : 1;
+    }
+    if (serve.address) {
+        return server_run(&serve) == 0 ? 0 : 1;
+    }
+    if (stop_address) {
+        return server_shutdown(stop_address) == 0 ? 0 : 1;
+    }
+    if (views_path && (submit_address || dist.address || preview.framebuffer_path ||
+                       frames > 0 || deadline > 0.0 || settings.batch_size > 0 ||
+                       settings.guiding || settings.caustic_photons > 0)) {
+        fprintf(stderr, "Error: --views renders locally, without --frames, --deadline, "
+                        "--batch, --guide or --caustics\n");
+        return 1;
+    }
+
+    if (desc.accel != VIBE_ACCEL_BVH && (submit_address || dist.address)) {
+        /* Daemons and workers pick their own structures */
+        fprintf(stderr, "Error: --accel applies to local renders only\n");
+        return 1;
+    }
+    if (autotune && (submit_address || dist.address)) {
+        /* Daemons and workers run on machines of their own */
+        fprintf(stderr, "Error: --autotune applies to local renders only\n");
+        return 1;
+    }
+
+    if (submit_address) {
+        if (desc.env_path) {
+            /* Daemon jobs name their scene; maps stay on this machine */
+            fprintf(stderr, "Error: --env cannot be combined with --submit\n");
+            return 1;
         }
+        return submit_job(submit_address, &desc, &settings, priority, output) == 0 ? 0 : 1;
     }
 
-    /* Three main spheres */
-    material_t mat_center = lambertian_create(vec3(0.4, 0.2, 0.1));
-    sphere_t *center = sphere_create(vec3(-4.0, 1.0, 0.0), 1.0, &mat_center);
-    if (center) {
-        hittable_list_add(world, sphere_to_hittable(center));
+    if ((desc.obj_path || desc.env_path) && dist.address) {
+        /* Workers rebuild scenes from name and seed only */
+        fprintf(stderr, "Error: --obj and --env cannot be combined with --coordinator\n");
+        return 1;
     }
 
-    material_t mat_middle = dielectric_create(1.5);
-    sphere_t *middle = sphere_create(vec3(0.0, 1.0, 0.0), 1.0, &mat_middle);
-    if (middle) {
-        hittable_list_add(world, sphere_to_hittable(middle));
+    if ((frames > 0 || shutter > 0.0) && (dist.address || preview.framebuffer_path)) {
+        fprintf(stderr, "Error: sequences and motion blur render locally only\n");
+        return 1;
     }
 
-    material_t mat_right = metal_create(vec3(0.7, 0.6, 0.5), 0.0);
-    sphere_t *right = sphere_create(vec3(4.0, 1.0, 0.0), 1.0, &mat_right);
-    if (right) {
-        hittable_list_add(world, sphere_to_hittable(right));
+    if ((orbit != 0.0 || reuse > 0) && frames == 0) {
+        fprintf(stderr, "Error: --orbit and --reuse apply to sequences (--frames)\n");
+        return 1;
     }
 
-    /* Camera setup */
-    camera_t camera = camera_create(
-        vec3(13.0, 2.0, 3.0),          /* lookfrom */
-        vec3(0.0, 0.0, 0.0),           /* lookat */
-        vec3(0.0, 1.0, 0.0),           /* vup */
-        20.0,                           /* vfov (degrees) */
-        (double)IMAGE_WIDTH / IMAGE_HEIGHT, /* aspect ratio */
-        0.1,                            /* aperture (depth of field) */
-        10.0                            /* focus distance */
-    );
+    if (reuse > 0 && (shutter > 0.0 || settings.guiding || settings.caustic_photons > 0)) {
+        fprintf(stderr, "Error: --reuse cannot be combined with --shutter, --guide or "
+                        "--caustics\n");
+        return 1;
+    }
 
-    /* Open output file */
-    FILE *out = fopen("output/final.ppm", "w");
-    if (!out) {
-        fprintf(stderr, "Error: could not open output/final.ppm\n");
-        hittable_list_destroy(world);
+    if (deadline > 0.0 && (frames > 0 || dist.address || preview.framebuffer_path)) {
+        fprintf(stderr, "Error: --deadline renders single local images only\n");
         return 1;
     }
 
-    /* Write PPM header */
-    fprintf(out, "P3\n%d %d\n255\n", IMAGE_WIDTH, IMAGE_HEIGHT);
-    fflush(out);
+    if ((settings.guiding || settings.caustic_photons > 0) &&
+        (deadline > 0.0 || dist.address || preview.framebuffer_path)) {
+        fprintf(stderr, "Error: --guide and --caustics render without --deadline, locally or "
+                        "through the daemon\n");
+        return 1;
+    }
+
+    if (settings.width < 2 || settings.height < 2 || settings.samples_per_pixel < 1) {
+        fprintf(stderr, "Error: invalid image size or sample count\n");
+        return 1;
+    }
 
-    /* Pre-allocate buffer for all pixels to avoid file synchronization issues */
-    vec3_t *pixel_buffer = malloc(IMAGE_WIDTH * IMAGE_HEIGHT * sizeof(vec3_t));
-    if (!pixel_buffer) {
-        fprintf(stderr, "Error: could not allocate pixel buffer\n");
-        fclose(out);
-        hittable_list_destroy(world);
+    render_rect_t crop;
+    if (vibe_crop_rect(&settings, &crop) != 0) {
+        fprintf(stderr, "Error: crop window outside the frame\n");
+        return 1;
+    }
+    if ((crop.x1 - crop.x0 != settings.width || crop.y1 - crop.y0 != settings.height) &&
+        (dist.address || preview.framebuffer_path)) {
+        fprintf(stderr, "Error: --crop renders locally or through the daemon only\n");
+        return 1;
+    }
+    if ((crop.x1 - crop.x0 != settings.width || crop.y1 - crop.y0 != settings.height) &&
+        reuse > 0) {
+        fprintf(stderr, "Error: --reuse renders full frames only\n");
+        return 1;
+    }
+    if ((crop.x1 - crop.x0 != settings.width || crop.y1 - crop.y0 != settings.height) &&
+        views_path) {
+        fprintf(stderr, "Error: --views renders full frames only\n");
         return 1;
     }
 
-    /* Render each pixel with multisampling (parallelized) */
-    fprintf(stderr, "Rendering...\n");
-    #if USE_OPENMP
-    #pragma omp parallel for schedule(dynamic, 100)
-    #endif
-    for (int pixel_idx = 0; pixel_idx < IMAGE_WIDTH * IMAGE_HEIGHT; pixel_idx++) {
-        int j = IMAGE_HEIGHT - 1 - (pixel_idx / IMAGE_WIDTH);
-        int i = pixel_idx % IMAGE_WIDTH;
-        
-        vec3_t pixel_color = vec3(0.0, 0.0, 0.0);
+    /* Create output directory if needed */
+    (void)system("mkdir -p output");
+
+    if (stitch) {
+        return stitch_crops(stitch, output) == 0 ? 0 : 1;
+    }
+
+    if (dist.address) {
+        /* The coordinator never renders itself, so forking workers is safe */
+        render_settings_t rs = vibe_render_settings(NULL, &settings);
+        accum_t *accum = accum_create(settings.width, settings.height);
+        int status = accum ? distrib_coordinate(&dist, desc.name, SCENE_DEFAULT_SEED, &rs, accum)
+                           : -1;
+        if (status == 0) {
+            fprintf(stderr, "Rendering complete. Writing file...\n");
+            status = image_write_ppm(output, accum);
+        }
+        accum_destroy(accum);
+        if (status != 0) {
+            fprintf(stderr, "Error: distributed render failed\n");
+            return 1;
+        }
+        fprintf(stderr, "\nDone.\n");
+        return 0;
+    }
 
-        /* Multiple samples per pixel for antialiasing */
-        for (int s = 0; s < SAMPLES_PER_PIXEL; s++) {
-            double u = (i + random_double()) / (IMAGE_WIDTH - 1);
-            double v = (j + random_double()) / (IMAGE_HEIGHT - 1);
-            ray_t r = camera_get_ray(&camera, u, v);
-            pixel_color = vec3_add(pixel_color, ray_color(r, world, MAX_DEPTH));
+    /* Place the render threads before anything is allocated, so the scene
+     * and buffers are first touched by the threads that use them */
+    if (affinity) {
+        int team = vibe_place_threads(affinity, settings.threads);
+        if (team < 0) {
+            fprintf(stderr, "Error: %s\n", vibe_last_error());
+            return 1;
         }
+        fprintf(stderr, "Threads: %d (%s)\n", team, affinity);
+    }
 
-        /* Store in buffer */
-        pixel_buffer[pixel_idx] = pixel_color;
+    /* Create world (scene) */
+    vibe_scene_t *scene = vibe_scene_load(&desc);
+    if (!scene || (frames == 0 && shutter > 0.0 &&
+                   vibe_scene_set_shutter(scene, 0.0, shutter) != 0)) {
+        fprintf(stderr, "Error: %s\n", vibe_last_error());
+        vibe_scene_destroy(scene);
+        return 1;
     }
-    fprintf(stderr, "Rendering complete. Writing file...\n");
-    fflush(stderr);
 
-    /* Write pixel buffer to file */
-    for (int idx = 0; idx < IMAGE_WIDTH * IMAGE_HEIGHT; idx++) {
-        write_color(out, pixel_buffer[idx], SAMPLES_PER_PIXEL);
+    if (apply_tuning(scene, &settings, autotune, tune_cache, threads_given) != 0) {
+        fprintf(stderr, "Error: tuning failed\n");
+        vibe_scene_destroy(scene);
+        return 1;
     }
-    fflush(out);
 
-    fprintf(stderr, "\nDone.\n");
-    fclose(out);
-    free(pixel_buffer);
-    hittable_list_destroy(world);
+    multiview_view_t *views = NULL;
+    int view_count = views_path ? load_views(views_path, scene, &settings, &views) : 0;
+    if (view_count < 0) {
+        fprintf(stderr, "Error: could not read views from '%s'\n", views_path);
+        vibe_scene_destroy(scene);
+        return 1;
+    }
 
-    /* Clean up materials */
-    if (mat_ground.destroy) mat_ground.destroy(mat_ground.data);
-    if (mat_center.destroy) mat_center.destroy(mat_center.data);
-    if (mat_middle.destroy) mat_middle.destroy(mat_middle.data);
-    if (mat_right.destroy) mat_right.destroy(mat_right.data);
-    for (int i = 0; i < num_random_mats; i++) {
-        if (random_mats[i].destroy) random_mats[i].destroy(random_mats[i].data);
+    int status = 0;
+    int stopped = 0; /* a preview was stopped short of its last pass */
+    if (preview.framebuffer_path) {
+        render_settings_t rs = vibe_render_settings(scene, &settings);
+        accum_t *accum = accum_create(settings.width, settings.height);
+        status = accum ? preview_run(vibe_scene_world(scene), &rs, &preview, accum) : -1;
+        if (status == 0) {
+            fprintf(stderr, "Rendering complete. Writing file...\n");
+            status = image_write_ppm(output, accum);
+        } else if (status == PREVIEW_STOPPED) {
+            /* A partial, possibly coarse, frame is not a result */
+            fprintf(stderr, "Preview stopped before its last pass, %s not written\n", output);
+            stopped = 1;
+            status = 0;
+        }
+        accum_destroy(accum);
+    } else if (views_path) {
+        status = render_views(scene, &settings, views, view_count, output);
+    } else if (deadline > 0.0) {
+        double budget = deadline - (now_seconds() - start);
+        fprintf(stderr, "Rendering for %.3f s...\n", budget);
+        status = render_to_deadline(scene, &settings, budget, output);
+    } else {
+        double *rgb = malloc((size_t)settings.width * settings.height * 3 * sizeof(double));
+        if (!rgb) {
+            status = -1;
+        } else if (frames > 0) {
+            status = render_sequence(scene, &settings, frames, shutter, orbit, reuse, output,
+                                     rgb);
+        } else {
+            /* Render each pixel with multisampling (parallelized) */
+            fprintf(stderr, "Rendering...\n");
+            vibe_view_t view;
+            vibe_scene_view(scene, &view);
+            status = vibe_render(scene, &view, &settings, rgb);
+            if (status == 0) {
+                fprintf(stderr, "Rendering complete. Writing file...\n");
+                status = write_crop(output, rgb, &settings);
+            }
+        }
+        free(rgb);
     }
-    free(random_mats);
+    free(views);
+    vibe_scene_destroy(scene);
 
+    if (status != 0) {
+        fprintf(stderr, "Error: %s\n", vibe_last_error()[0] ? vibe_last_error() : "render failed");
+        return 1;
+    }
+    if (stopped) return 1;
+    fprintf(stderr, "\nDone.\n");
     return 0;
 }
@@ -1,18 +1,26 @@
 #include "material.h"
+#include "arena.h"
+#include "dispatch.h"
 #include "hittable.h"
 #include "vec3.h"
 #include <math.h>
+#include <stddef.h>
 #include <stdlib.h>
 
+/* Room for a material's parameters in arena, or on the heap without one */
+static void *material_alloc(arena_t *arena, size_t size) {
+    return arena ? arena_alloc(arena, size, _Alignof(max_align_t)) : malloc(size);
+}
+
 /* Lambertian (diffuse) material */
 typedef struct {
     vec3_t albedo;
 } lambertian_t;
 
+VIBE_KERNEL
 static int lambertian_scatter(const void *mat, const ray_t r_in,
                               const hit_record_t *rec, vec3_t *attenuation,
                               ray_t *scattered) {
-    (void)r_in;
     const lambertian_t *lamb = (const lambertian_t *)mat;
     *attenuation = lamb->albedo;
 
@@ -20,7 +28,7 @@ static int lambertian_scatter(const void *mat, const ray_t r_in,
     if (vec3_length_squared(scatter_direction) < 1e-8) {
         scatter_direction = rec->normal;
     }
-    *scattered = ray(rec->point, scatter_direction);
+    *scattered = ray_timed(rec->point, scatter_direction, r_in.time);
     return 1;
 }
 
@@ -28,24 +36,30 @@ static void lambertian_destroy(void *mat) {
     free(mat);
 }
 
-material_t lambertian_create(const vec3_t albedo) {
-    lambertian_t *lamb = malloc(sizeof(lambertian_t));
+material_t lambertian_create_in(arena_t *arena, const vec3_t albedo) {
+    lambertian_t *lamb = material_alloc(arena, sizeof(lambertian_t));
     if (!lamb) return (material_t){0};
 
     lamb->albedo = albedo;
     return (material_t){
         .data = lamb,
         .scatter = lambertian_scatter,
-        .destroy = lambertian_destroy,
+        .destroy = arena ? NULL : lambertian_destroy,
+        .diffuse = &lamb->albedo,
     };
 }
 
+material_t lambertian_create(const vec3_t albedo) {
+    return lambertian_create_in(NULL, albedo);
+}
+
 /* Metal (reflective) material */
 typedef struct {
     vec3_t albedo;
     double fuzz;
 } metal_t;
 
+VIBE_KERNEL
 static int metal_scatter(const void *mat, const ray_t r_in,
                          const hit_record_t *rec, vec3_t *attenuation,
                          ray_t *scattered) {
@@ -56,7 +70,7 @@ static int metal_scatter(const void *mat, const ray_t r_in,
     reflected = vec3_normalize(reflected);
 
     vec3_t fuzz_vec = vec3_mul(random_in_unit_sphere(), metal->fuzz);
-    *scattered = ray(rec->point, vec3_add(reflected, fuzz_vec));
+    *scattered = ray_timed(rec->point, vec3_add(reflected, fuzz_vec), r_in.time);
     *attenuation = metal->albedo;
     return vec3_dot(scattered->direction, rec->normal) > 0;
 }
@@ -65,8 +79,8 @@ static void metal_destroy(void *mat) {
     free(mat);
 }
 
-material_t metal_create(const vec3_t albedo, double fuzz) {
-    metal_t *metal = malloc(sizeof(metal_t));
+material_t metal_create_in(arena_t *arena, const vec3_t albedo, double fuzz) {
+    metal_t *metal = material_alloc(arena, sizeof(metal_t));
     if (!metal) return (material_t){0};
 
     metal->albedo = albedo;
@@ -74,10 +88,14 @@ material_t metal_create(const vec3_t albedo, double fuzz) {
     return (material_t){
         .data = metal,
         .scatter = metal_scatter,
-        .destroy = metal_destroy,
+        .destroy = arena ? NULL : metal_destroy,
     };
 }
 
+material_t metal_create(const vec3_t albedo, double fuzz) {
+    return metal_create_in(NULL, albedo, fuzz);
+}
+
 /* Dielectric (glass) material with Schlick approximation */
 typedef struct {
     double ir; /* index of refraction */
@@ -100,6 +118,7 @@ static vec3_t refract(const vec3_t uv, const vec3_t n, double etai_over_etat) {
     return vec3_add(r_out_perp, r_out_parallel);
 }
 
+VIBE_KERNEL
 static int dielectric_scatter(const void *mat, const ray_t r_in,
                               const hit_record_t *rec, vec3_t *attenuation,
                               ray_t *scattered) {
@@ -124,7 +143,7 @@ static int dielectric_scatter(const void *mat, const ray_t r_in,
         direction = refract(unit_direction, rec->normal, etai_over_etat);
     }
 
-    *scattered = ray(rec->point, direction);
+    *scattered = ray_timed(rec->point, direction, r_in.time);
     return 1;
 }
 
@@ -132,14 +151,75 @@ static void dielectric_destroy(void *mat) {
     free(mat);
 }
 
-material_t dielectric_create(double index_of_refraction) {
-    dielectric_t *diel = malloc(sizeof(dielectric_t));
+material_t dielectric_create_in(arena_t *arena, double index_of_refraction) {
+    dielectric_t *diel = material_alloc(arena, sizeof(dielectric_t));
     if (!diel) return (material_t){0};
 
     diel->ir = index_of_refraction;
     return (material_t){
         .data = diel,
         .scatter = dielectric_scatter,
-        .destroy = dielectric_destroy,
+        .destroy = arena ? NULL : dielectric_destroy,
     };
 }
+
+material_t dielectric_create(double index_of_refraction) {
+    return dielectric_create_in(NULL, index_of_refraction);
+}
+
+/* Diffuse light: absorbs whatever reaches it */
+typedef struct {
+    vec3_t emission;
+} diffuse_light_t;
+
+static int diffuse_light_scatter(const void *mat, const ray_t r_in,
+                                 const hit_record_t *rec, vec3_t *attenuation,
+                                 ray_t *scattered) {
+    (void)mat;
+    (void)r_in;
+    (void)rec;
+    (void)attenuation;
+    (void)scattered;
+    return 0;
+}
+
+static void diffuse_light_destroy(void *mat) {
+    free(mat);
+}
+
+material_t diffuse_light_create_in(arena_t *arena, const vec3_t emission) {
+    diffuse_light_t *light = material_alloc(arena, sizeof(diffuse_light_t));
+    if (!light) return (material_t){0};
+
+    light->emission = emission;
+    return (material_t){
+        .data = light,
+        .scatter = diffuse_light_scatter,
+        .destroy = arena ? NULL : diffuse_light_destroy,
+        .emission = &light->emission,
+    };
+}
+
+material_t diffuse_light_create(const vec3_t emission) {
+    return diffuse_light_create_in(NULL, emission);
+}
+
+/* Kind and parameters of a material */
+material_params_t material_params(const material_t *material) {
+    material_params_t params = {0};
+    if (material->scatter == lambertian_scatter) {
+        params.kind = MATERIAL_LAMBERTIAN;
+        params.albedo = ((const lambertian_t *)material->data)->albedo;
+    } else if (material->scatter == metal_scatter) {
+        params.kind = MATERIAL_METAL;
+        params.albedo = ((const metal_t *)material->data)->albedo;
+        params.fuzz = ((const metal_t *)material->data)->fuzz;
+    } else if (material->scatter == dielectric_scatter) {
+        params.kind = MATERIAL_DIELECTRIC;
+        params.refraction_index = ((const dielectric_t *)material->data)->ir;
+    } else if (material->scatter == diffuse_light_scatter) {
+        params.kind = MATERIAL_LIGHT;
+        params.emission = ((const diffuse_light_t *)material->data)->emission;
+    }
+    return params;
+}
@@ -4,9 +4,10 @@
 #include "ray.h"
 #include "vec3.h"
 
-/* Forward declaration */
+/* Forward declarations */
 struct hit_record;
 typedef struct hit_record hit_record_t;
+typedef struct arena arena_t;
 
 /* Material scatter function pointer */
 typedef int (*scatter_fn)(const void *mat, const ray_t r_in,
@@ -18,15 +19,54 @@ typedef struct material {
     void *data;
     scatter_fn scatter;
     void (*destroy)(void *mat);
+    const vec3_t *diffuse; /* Lambertian materials: their albedo, so path guiding
+                            * can sample their bounces itself; NULL otherwise */
+    const vec3_t *emission; /* Lights: the radiance they give off on both sides,
+                             * which renderers add where rays hit them; NULL
+                             * otherwise */
 } material_t;
 
+/* Built-in materials. Each constructor has an _in variant that makes the
+ * material's parameters in an arena instead of on the heap: such materials
+ * have no destroy and live as long as the arena. */
+
 /* Lambertian (diffuse) material creation */
 material_t lambertian_create(const vec3_t albedo);
+material_t lambertian_create_in(arena_t *arena, const vec3_t albedo);
 
 /* Metal (reflective) material creation */
 material_t metal_create(const vec3_t albedo, double fuzz);
+material_t metal_create_in(arena_t *arena, const vec3_t albedo, double fuzz);
 
 /* Dielectric (glass) material creation */
 material_t dielectric_create(double index_of_refraction);
+material_t dielectric_create_in(arena_t *arena, double index_of_refraction);
+
+/* Diffuse light: emits radiance evenly in every direction and reflects
+ * nothing */
+material_t diffuse_light_create(const vec3_t emission);
+material_t diffuse_light_create_in(arena_t *arena, const vec3_t emission);
+
+/* Kinds of the built-in materials */
+typedef enum {
+    MATERIAL_OTHER,
+    MATERIAL_LAMBERTIAN,
+    MATERIAL_METAL,
+    MATERIAL_DIELECTRIC,
+    MATERIAL_LIGHT,
+} material_kind_t;
+
+/* Parameters of a built-in material, for tools that specialize code to a
+ * scene's materials; fields the kind does not use are 0 */
+typedef struct {
+    material_kind_t kind;
+    vec3_t albedo;           /* Lambertian and metal */
+    double fuzz;             /* metal */
+    double refraction_index; /* dielectric */
+    vec3_t emission;         /* light */
+} material_params_t;
+
+/* Kind and parameters of a material (MATERIAL_OTHER if it is not built in) */
+material_params_t material_params(const material_t *material);
 
 #endif /* MATERIAL_H */
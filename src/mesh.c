@@ -0,0 +1,598 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mesh.h"
+#include "bvh.h"
+#include "dispatch.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MESH_STACK_SIZE 96
+#define OBJ_CHUNK_SIZE (1 << 20) /* bytes of OBJ text per parse task */
+#define OBJ_MAX_CHUNKS 1024
+
+/* Precompute the shear transform for a ray */
+tri_ray_t tri_ray_prepare(const ray_t r) {
+    const double *d = r.direction.e;
+    tri_ray_t tr;
+    tr.origin = r.origin;
+
+    tr.kz = 0;
+    if (fabs(d[1]) > fabs(d[tr.kz])) tr.kz = 1;
+    if (fabs(d[2]) > fabs(d[tr.kz])) tr.kz = 2;
+    tr.kx = (tr.kz + 1) % 3;
+    tr.ky = (tr.kx + 1) % 3;
+    /* Keep the winding of the projected triangle */
+    if (d[tr.kz] < 0.0) {
+        int tmp = tr.kx;
+        tr.kx = tr.ky;
+        tr.ky = tmp;
+    }
+
+    tr.sx = d[tr.kx] / d[tr.kz];
+    tr.sy = d[tr.ky] / d[tr.kz];
+    tr.sz = 1.0 / d[tr.kz];
+    return tr;
+}
+
+/* Watertight ray/triangle test */
+int triangle_intersect(const tri_ray_t *tr, const float *v0, const float *v1,
+                       const float *v2, double t_min, double t_max, double *t) {
+    const double *o = tr->origin.e;
+    int kx = tr->kx, ky = tr->ky, kz = tr->kz;
+
+    /* Vertices relative to the origin, sheared so the ray runs along +z */
+    double az = v0[kz] - o[kz];
+    double bz = v1[kz] - o[kz];
+    double cz = v2[kz] - o[kz];
+    double ax = (v0[kx] - o[kx]) - tr->sx * az;
+    double ay = (v0[ky] - o[ky]) - tr->sy * az;
+    double bx = (v1[kx] - o[kx]) - tr->sx * bz;
+    double by = (v1[ky] - o[ky]) - tr->sy * bz;
+    double cx = (v2[kx] - o[kx]) - tr->sx * cz;
+    double cy = (v2[ky] - o[ky]) - tr->sy * cz;
+
+    /* Edge functions; a shared edge yields exactly negated values in its two
+     * triangles, so no ray slips through the crack between them */
+    double u = cx * by - cy * bx;
+    double v = ax * cy - ay * cx;
+    double w = bx * ay - by * ax;
+    if ((u < 0.0 || v < 0.0 || w < 0.0) && (u > 0.0 || v > 0.0 || w > 0.0)) {
+        return 0;
+    }
+
+    double det = u + v + w;
+    if (det == 0.0) return 0;
+
+    double hit_t = (u * az + v * bz + w * cz) * tr->sz / det;
+    if (hit_t < t_min || t_max < hit_t) return 0;
+
+    *t = hit_t;
+    return 1;
+}
+
+/* Watertight test on up to four triangles at once */
+int triangle_intersect4(const tri_ray_t *tr, const float *const v[4][3], int count,
+                        double t_min, double t_max, double *t) {
+    const double *o = tr->origin.e;
+    int kx = tr->kx, ky = tr->ky, kz = tr->kz;
+    double px[3][4], py[3][4], pz[3][4];
+
+    /* Gather into structure-of-arrays lanes; unused lanes repeat lane 0 */
+    for (int lane = 0; lane < 4; lane++) {
+        int src = lane < count ? lane : 0;
+        for (int k = 0; k < 3; k++) {
+            const float *p = v[src][k];
+            px[k][lane] = p[kx] - o[kx];
+            py[k][lane] = p[ky] - o[ky];
+            pz[k][lane] = p[kz] - o[kz];
+        }
+    }
+
+    double hit_t[4];
+    double sx = tr->sx, sy = tr->sy, sz = tr->sz;
+#pragma omp simd
+    for (int i = 0; i < 4; i++) {
+        double ax = px[0][i] - sx * pz[0][i];
+        double ay = py[0][i] - sy * pz[0][i];
+        double bx = px[1][i] - sx * pz[1][i];
+        double by = py[1][i] - sy * pz[1][i];
+        double cx = px[2][i] - sx * pz[2][i];
+        double cy = py[2][i] - sy * pz[2][i];
+
+        double u = cx * by - cy * bx;
+        double w_v = ax * cy - ay * cx;
+        double w = bx * ay - by * ax;
+        int negative = (u < 0.0) | (w_v < 0.0) | (w < 0.0);
+        int positive = (u > 0.0) | (w_v > 0.0) | (w > 0.0);
+        double det = u + w_v + w;
+        int inside = !(negative & positive) & (det != 0.0);
+
+        double tt = (u * pz[0][i] + w_v * pz[1][i] + w * pz[2][i]) * sz /
+                    (det != 0.0 ? det : 1.0);
+        hit_t[i] = inside & (tt >= t_min) & (tt <= t_max) ? tt : INFINITY;
+    }
+
+    int best = -1;
+    double best_t = INFINITY;
+    for (int i = 0; i < count; i++) {
+        if (hit_t[i] < best_t) {
+            best_t = hit_t[i];
+            best = i;
+        }
+    }
+    if (best >= 0) *t = best_t;
+    return best;
+}
+
+/* Largest float not above d */
+static float round_down(double d) {
+    float f = (float)d;
+    return (double)f > d ? nextafterf(f, -INFINITY) : f;
+}
+
+/* Smallest float not below d */
+static float round_up(double d) {
+    float f = (float)d;
+    return (double)f < d ? nextafterf(f, INFINITY) : f;
+}
+
+/* Build the per-mesh BVH and reorder the index buffer into leaf order */
+static int mesh_build(mesh_t *mesh) {
+    int n = mesh->triangle_count;
+    if (n == 0) return 0;
+
+    aabb_t *boxes = malloc(n * sizeof(aabb_t));
+    int *order = malloc(n * sizeof(int));
+    bvh_node_t *nodes = malloc(2 * (size_t)n * sizeof(bvh_node_t));
+    uint32_t *indices = malloc(3 * (size_t)n * sizeof(uint32_t));
+    int status = -1;
+    if (!boxes || !order || !nodes || !indices) goto done;
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        aabb_t box = aabb_empty();
+        for (int k = 0; k < 3; k++) {
+            const float *p = &mesh->positions[3 * (size_t)mesh->indices[3 * (size_t)i + k]];
+            box = aabb_extend(box, vec3(p[0], p[1], p[2]));
+        }
+        boxes[i] = box;
+    }
+
+    int node_count = bvh_build(boxes, n, nodes, order);
+    if (node_count < 0) goto done;
+
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < 3; k++) {
+            indices[3 * (size_t)i + k] = mesh->indices[3 * (size_t)order[i] + k];
+        }
+    }
+
+    /* Shrink the nodes to floats, rounding the bounds outward */
+    mesh->nodes = malloc(node_count * sizeof(mesh_node_t));
+    if (!mesh->nodes) goto done;
+    for (int i = 0; i < node_count; i++) {
+        mesh_node_t *dst = &mesh->nodes[i];
+        for (int a = 0; a < 3; a++) {
+            dst->min[a] = round_down(nodes[i].box.min.e[a]);
+            dst->max[a] = round_up(nodes[i].box.max.e[a]);
+        }
+        dst->start = (uint32_t)nodes[i].start;
+        dst->count = (uint16_t)nodes[i].count;
+        dst->axis = (uint16_t)nodes[i].axis;
+    }
+    mesh->node_count = node_count;
+
+    free(mesh->indices);
+    mesh->indices = indices;
+    indices = NULL;
+    status = 0;
+
+done:
+    free(boxes);
+    free(order);
+    free(nodes);
+    free(indices);
+    return status;
+}
+
+/* Create a mesh over the given buffers */
+mesh_t *mesh_create(float *positions, int vertex_count, uint32_t *indices,
+                    int triangle_count, const material_t *material) {
+    mesh_t *mesh = calloc(1, sizeof(mesh_t));
+    if (!mesh) {
+        free(positions);
+        free(indices);
+        return NULL;
+    }
+    mesh->positions = positions;
+    mesh->indices = indices;
+    mesh->vertex_count = vertex_count;
+    mesh->triangle_count = triangle_count;
+    mesh->material = material;
+
+    for (size_t i = 0; i < 3 * (size_t)triangle_count; i++) {
+        if (indices[i] >= (uint32_t)vertex_count) {
+            mesh_destroy(mesh);
+            return NULL;
+        }
+    }
+    if (mesh_build(mesh) != 0) {
+        mesh_destroy(mesh);
+        return NULL;
+    }
+    return mesh;
+}
+
+/* Find the closest triangle hit by the ray */
+VIBE_KERNEL
+static int mesh_hit(const void *obj, const ray_t r, double t_min, double t_max,
+                    hit_record_t *rec) {
+    const mesh_t *mesh = (const mesh_t *)obj;
+    if (mesh->node_count == 0) return 0;
+
+    tri_ray_t tr = tri_ray_prepare(r);
+    vec3_t inv_dir = vec3(1.0 / r.direction.e[0], 1.0 / r.direction.e[1],
+                          1.0 / r.direction.e[2]);
+    int hit_triangle = -1;
+    double closest_so_far = t_max;
+    int stack[MESH_STACK_SIZE];
+    int sp = 0;
+    int index = 0;
+
+    while (1) {
+        const mesh_node_t *node = &mesh->nodes[index];
+        aabb_t box = {vec3(node->min[0], node->min[1], node->min[2]),
+                      vec3(node->max[0], node->max[1], node->max[2])};
+        if (aabb_hit(&box, r.origin, inv_dir, t_min, closest_so_far)) {
+            if (node->count > 0) {
+                int end = (int)node->start + node->count;
+                for (int i = (int)node->start; i < end; i += 4) {
+                    int n = end - i < 4 ? end - i : 4;
+                    const float *v[4][3];
+                    for (int lane = 0; lane < n; lane++) {
+                        const uint32_t *tri = &mesh->indices[3 * (size_t)(i + lane)];
+                        for (int k = 0; k < 3; k++) {
+                            v[lane][k] = &mesh->positions[3 * (size_t)tri[k]];
+                        }
+                    }
+                    double t;
+                    int lane = triangle_intersect4(&tr, (const float *const(*)[3])v, n,
+                                                   t_min, closest_so_far, &t);
+                    if (lane >= 0) {
+                        closest_so_far = t;
+                        hit_triangle = i + lane;
+                    }
+                }
+            } else {
+                /* Visit the child nearer along the split axis first */
+                int first = index + 1;
+                int second = (int)node->start;
+                if (r.direction.e[node->axis] < 0.0) {
+                    first = (int)node->start;
+                    second = index + 1;
+                }
+                stack[sp++] = second;
+                index = first;
+                continue;
+            }
+        }
+        if (sp == 0) break;
+        index = stack[--sp];
+    }
+    if (hit_triangle < 0) return 0;
+
+    const uint32_t *tri = &mesh->indices[3 * (size_t)hit_triangle];
+    const float *p0 = &mesh->positions[3 * (size_t)tri[0]];
+    const float *p1 = &mesh->positions[3 * (size_t)tri[1]];
+    const float *p2 = &mesh->positions[3 * (size_t)tri[2]];
+    vec3_t e1 = vec3(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]);
+    vec3_t e2 = vec3(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]);
+
+    rec->t = closest_so_far;
+    rec->point = ray_at(r, closest_so_far);
+    set_face_normal(rec, r, vec3_normalize(vec3_cross(e1, e2)));
+    rec->material = mesh->material;
+    return 1;
+}
+
+/* Bounds of the mesh (its BVH root) */
+static int mesh_bounding_box(const void *obj, aabb_t *box) {
+    const mesh_t *mesh = (const mesh_t *)obj;
+    if (mesh->node_count == 0) return 0;
+    const mesh_node_t *root = &mesh->nodes[0];
+    box->min = vec3(root->min[0], root->min[1], root->min[2]);
+    box->max = vec3(root->max[0], root->max[1], root->max[2]);
+    return 1;
+}
+
+static void mesh_hittable_destroy(void *obj) {
+    mesh_destroy((mesh_t *)obj);
+}
+
+/* Create a hittable mesh object */
+hittable_t mesh_to_hittable(mesh_t *mesh) {
+    return (hittable_t){
+        .data = mesh,
+        .hit = mesh_hit,
+        .bounding_box = mesh_bounding_box,
+        .destroy = mesh_hittable_destroy,
+    };
+}
+
+/* Free the mesh and its buffers */
+void mesh_destroy(mesh_t *mesh) {
+    if (!mesh) return;
+    free(mesh->positions);
+    free(mesh->indices);
+    free(mesh->nodes);
+    free(mesh);
+}
+
+/* OBJ loading. The file is mapped and split into chunks at line boundaries.
+ * A first parallel pass counts vertices and triangles per chunk, prefix sums
+ * give each chunk its output offsets, and a second parallel pass parses the
+ * chunks straight into the shared buffers. */
+
+typedef struct {
+    const char *begin;
+    const char *end;
+    int vertices;      /* vertices in the chunk */
+    int triangles;     /* triangles after fan triangulation */
+    int vertex_base;   /* vertices in earlier chunks */
+    int triangle_base; /* triangles in earlier chunks */
+    int error;
+} obj_chunk_t;
+
+static const double powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char *skip_space(const char *p, const char *end) {
+    while (p < end && is_space(*p)) p++;
+    return p;
+}
+
+static const char *next_line(const char *p, const char *end) {
+    while (p < end && *p != '\n') p++;
+    return p < end ? p + 1 : end;
+}
+
+/* Parse a decimal number; returns NULL if there is none at p */
+static const char *parse_double(const char *p, const char *end, double *out) {
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+        if (mantissa < UINT64_C(100000000000000000)) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        } else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+            if (mantissa < UINT64_C(100000000000000000)) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                exponent--;
+            }
+        }
+    }
+    if (digits == 0) return NULL;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int exp_negative = 0, exp_value = 0;
+        if (q < end && (*q == '-' || *q == '+')) exp_negative = *q++ == '-';
+        if (q < end && *q >= '0' && *q <= '9') {
+            for (; q < end && *q >= '0' && *q <= '9'; q++) {
+                if (exp_value < 10000) exp_value = exp_value * 10 + (*q - '0');
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+            p = q;
+        }
+    }
+
+    double value = (double)mantissa;
+    if (exponent >= -22 && exponent <= 22) {
+        value = exponent < 0 ? value / powers_of_ten[-exponent]
+                             : value * powers_of_ten[exponent];
+    } else {
+        value *= pow(10.0, exponent);
+    }
+    *out = negative ? -value : value;
+    return p;
+}
+
+/* Parse a face vertex reference ("i", "i/t", "i//n", "i/t/n"), returning the
+ * position index or 0 if malformed */
+static const char *parse_face_index(const char *p, const char *end, long *out) {
+    int negative = 0;
+    if (p < end && *p == '-') {
+        negative = 1;
+        p++;
+    }
+    long value = 0;
+    const char *start = p;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (value < 1L << 40) value = value * 10 + (*p - '0');
+    }
+    *out = p == start ? 0 : (negative ? -value : value);
+    while (p < end && !is_space(*p) && *p != '\n') p++;
+    return p;
+}
+
+/* Count vertex references on a face line starting after "f" */
+static int count_face_vertices(const char *p, const char *end) {
+    int n = 0;
+    while (1) {
+        p = skip_space(p, end);
+        if (p >= end || *p == '\n' || *p == '#') return n;
+        n++;
+        while (p < end && !is_space(*p) && *p != '\n') p++;
+    }
+}
+
+/* Line kind: 'v' for a vertex position, 'f' for a face, 0 otherwise; *body
+ * receives the text after the keyword */
+static char line_kind(const char *p, const char *end, const char **body) {
+    p = skip_space(p, end);
+    if (end - p >= 2 && (p[0] == 'v' || p[0] == 'f') && is_space(p[1])) {
+        *body = p + 1;
+        return p[0];
+    }
+    return 0;
+}
+
+/* First pass: count what a chunk will produce */
+static void obj_count(obj_chunk_t *chunk) {
+    for (const char *p = chunk->begin; p < chunk->end; p = next_line(p, chunk->end)) {
+        const char *body;
+        char kind = line_kind(p, chunk->end, &body);
+        if (kind == 'v') {
+            chunk->vertices++;
+        } else if (kind == 'f') {
+            int n = count_face_vertices(body, chunk->end);
+            if (n >= 3) chunk->triangles += n - 2;
+        }
+    }
+}
+
+/* Second pass: parse a chunk into its slice of the buffers */
+static void obj_parse(obj_chunk_t *chunk, float *positions, uint32_t *indices) {
+    float *pos = positions + 3 * (size_t)chunk->vertex_base;
+    uint32_t *idx = indices + 3 * (size_t)chunk->triangle_base;
+    long vertices_seen = chunk->vertex_base;
+
+    for (const char *p = chunk->begin; p < chunk->end; p = next_line(p, chunk->end)) {
+        const char *body;
+        char kind = line_kind(p, chunk->end, &body);
+        if (kind == 'v') {
+            const char *q = body;
+            for (int k = 0; k < 3; k++) {
+                double value = 0.0;
+                q = skip_space(q, chunk->end);
+                q = parse_double(q, chunk->end, &value);
+                if (!q) {
+                    chunk->error = 1;
+                    return;
+                }
+                pos[k] = (float)value;
+            }
+            pos += 3;
+            vertices_seen++;
+        } else if (kind == 'f') {
+            int n = count_face_vertices(body, chunk->end);
+            if (n < 3) continue;
+
+            const char *q = body;
+            uint32_t first = 0, prev = 0;
+            for (int i = 0; i < n; i++) {
+                long ref;
+                q = skip_space(q, chunk->end);
+                q = parse_face_index(q, chunk->end, &ref);
+                /* Positive indices are 1-based, negative ones count back */
+                long resolved = ref > 0 ? ref - 1 : vertices_seen + ref;
+                if (ref == 0 || resolved < 0 || resolved > UINT32_MAX) {
+                    chunk->error = 1;
+                    return;
+                }
+                uint32_t current = (uint32_t)resolved;
+                if (i == 0) {
+                    first = current;
+                } else if (i >= 2) {
+                    idx[0] = first;
+                    idx[1] = prev;
+                    idx[2] = current;
+                    idx += 3;
+                }
+                prev = current;
+            }
+        }
+    }
+}
+
+/* Load a Wavefront OBJ file */
+mesh_t *mesh_load_obj(const char *path, const material_t *material) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    const char *text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) return NULL;
+    const char *text_end = text + size;
+
+    int chunk_count = (int)(size / OBJ_CHUNK_SIZE) + 1;
+    if (chunk_count > OBJ_MAX_CHUNKS) chunk_count = OBJ_MAX_CHUNKS;
+    obj_chunk_t *chunks = calloc(chunk_count, sizeof(obj_chunk_t));
+    if (!chunks) {
+        munmap((void *)text, size);
+        return NULL;
+    }
+
+    /* Chunk boundaries move forward to the start of the next line */
+    chunks[0].begin = text;
+    for (int c = 1; c < chunk_count; c++) {
+        const char *p = text + size / chunk_count * c;
+        if (p < chunks[c - 1].begin) p = chunks[c - 1].begin;
+        chunks[c].begin = p == text ? p : next_line(p - 1, text_end);
+        chunks[c - 1].end = chunks[c].begin;
+    }
+    chunks[chunk_count - 1].end = text_end;
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunk_count; c++) {
+        obj_count(&chunks[c]);
+    }
+
+    long vertex_total = 0, triangle_total = 0;
+    for (int c = 0; c < chunk_count; c++) {
+        chunks[c].vertex_base = (int)vertex_total;
+        chunks[c].triangle_base = (int)triangle_total;
+        vertex_total += chunks[c].vertices;
+        triangle_total += chunks[c].triangles;
+    }
+
+    float *positions = NULL;
+    uint32_t *indices = NULL;
+    int error = triangle_total == 0 || vertex_total > INT32_MAX || triangle_total > INT32_MAX;
+    if (!error) {
+        positions = malloc(3 * (size_t)(vertex_total > 0 ? vertex_total : 1) * sizeof(float));
+        indices = malloc(3 * (size_t)triangle_total * sizeof(uint32_t));
+        error = !positions || !indices;
+    }
+
+    if (!error) {
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int c = 0; c < chunk_count; c++) {
+            obj_parse(&chunks[c], positions, indices);
+        }
+        for (int c = 0; c < chunk_count; c++) {
+            error |= chunks[c].error;
+        }
+    }
+
+    free(chunks);
+    munmap((void *)text, size);
+    if (error) {
+        free(positions);
+        free(indices);
+        return NULL;
+    }
+    return mesh_create(positions, (int)vertex_total, indices, (int)triangle_total, material);
+}
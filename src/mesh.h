@@ -0,0 +1,69 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <stdint.h>
+#include "hittable.h"
+
+/* Indexed triangle mesh. Vertex positions are stored once as packed floats and
+ * triangles reference them through a uint32 index buffer. Each mesh carries its
+ * own BVH with compact 32-byte nodes; building it reorders the index buffer into
+ * leaf order, so triangle IDs refer to that order. */
+
+typedef struct {
+    float min[3];
+    float max[3];
+    uint32_t start; /* leaf: first triangle; interior: index of the right child */
+    uint16_t count; /* triangles in a leaf, 0 for interior nodes */
+    uint16_t axis;  /* split axis of interior nodes */
+} mesh_node_t;
+
+typedef struct {
+    float *positions;  /* 3 floats per vertex */
+    uint32_t *indices; /* 3 vertex indices per triangle */
+    int vertex_count;
+    int triangle_count;
+    mesh_node_t *nodes;
+    int node_count;
+    const material_t *material;
+} mesh_t;
+
+/* Per-ray constants of the watertight intersection test */
+typedef struct {
+    vec3_t origin;
+    int kx, ky, kz; /* axes permuted so the direction is largest along kz */
+    double sx, sy, sz;
+} tri_ray_t;
+
+/* Precompute the shear transform for a ray */
+tri_ray_t tri_ray_prepare(const ray_t r);
+
+/* Watertight ray/triangle test (Woop et al.): rays through shared edges and
+ * vertices hit exactly one of the adjacent triangles' closed interiors.
+ * On a hit in (t_min, t_max) stores t and returns 1. */
+int triangle_intersect(const tri_ray_t *tr, const float *v0, const float *v1,
+                       const float *v2, double t_min, double t_max, double *t);
+
+/* The same test on up to four triangles at once, vectorized across lanes.
+ * v[lane][k] points at vertex k of each triangle. Returns the lane of the
+ * closest hit and stores its t, or -1 if none hit. */
+int triangle_intersect4(const tri_ray_t *tr, const float *const v[4][3], int count,
+                        double t_min, double t_max, double *t);
+
+/* Create a mesh that takes ownership of malloc'd position and index buffers
+ * and builds its BVH. Returns NULL on failure or out-of-range indices (the
+ * buffers are freed either way). */
+mesh_t *mesh_create(float *positions, int vertex_count, uint32_t *indices,
+                    int triangle_count, const material_t *material);
+
+/* Load a Wavefront OBJ file. Only vertex positions and faces are used;
+ * polygons are fan-triangulated and negative (relative) indices are resolved.
+ * Large files are parsed in parallel chunks. Returns NULL on error. */
+mesh_t *mesh_load_obj(const char *path, const material_t *material);
+
+/* Create a hittable mesh object; destroy frees the mesh */
+hittable_t mesh_to_hittable(mesh_t *mesh);
+
+/* Free the mesh and its buffers */
+void mesh_destroy(mesh_t *mesh);
+
+#endif /* MESH_H */
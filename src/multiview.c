@@ -0,0 +1,128 @@
+#include "multiview.h"
+#include "affinity.h"
+#include <omp.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define USE_OPENMP 1
+
+/* Progress of one view through the queue */
+typedef struct {
+    _Atomic(accum_t *) image; /* created by the first tile taken */
+    atomic_int remaining;     /* tiles not yet rendered */
+    int tiles_x;
+    int first_tile;           /* queue position of its first tile */
+} view_state_t;
+
+/* The image of a view, created by whichever thread needs it first; NULL on
+ * allocation failure */
+static accum_t *view_image(view_state_t *state, const multiview_view_t *view) {
+    accum_t *image = atomic_load(&state->image);
+    if (image) return image;
+    accum_t *fresh = accum_create(view->width, view->height);
+    if (!fresh) return NULL;
+    if (atomic_compare_exchange_strong(&state->image, &image, fresh)) return fresh;
+    accum_destroy(fresh);
+    return image;
+}
+
+/* View owning queue position t */
+static int view_of(const view_state_t *states, int count, int t) {
+    int lo = 0, hi = count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (states[mid].first_tile <= t) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/* Render every view from one queue of tiles */
+int multiview_render(const scene_t *scene, const multiview_view_t *views, int count,
+                     const render_settings_t *settings, int tile_size, multiview_done_fn done,
+                     void *user) {
+    if (count < 1 || tile_size < 1 || !done || settings->samples_per_pixel < 1 ||
+        settings->guide || settings->caustics || settings->footprint) {
+        return -1;
+    }
+    for (int v = 0; v < count; v++) {
+        if (views[v].width < 2 || views[v].height < 2) return -1;
+    }
+    view_state_t *states = calloc(count, sizeof(view_state_t));
+    if (!states) return -1;
+
+    int total = 0;
+    for (int v = 0; v < count; v++) {
+        int tiles_x = (views[v].width + tile_size - 1) / tile_size;
+        int tiles_y = (views[v].height + tile_size - 1) / tile_size;
+        atomic_init(&states[v].image, NULL);
+        atomic_init(&states[v].remaining, tiles_x * tiles_y);
+        states[v].tiles_x = tiles_x;
+        states[v].first_tile = total;
+        total += tiles_x * tiles_y;
+    }
+
+    atomic_int *cancel = settings->cancel;
+    atomic_int failed = 0;
+    int spp = settings->samples_per_pixel;
+    int threads = settings->threads > 0 ? settings->threads : omp_get_max_threads();
+
+    #if USE_OPENMP
+    #pragma omp parallel num_threads(threads)
+    #endif
+    {
+        const scene_t *local = scene;
+        if (settings->replicas && settings->replicas[affinity_thread_node()]) {
+            local = settings->replicas[affinity_thread_node()];
+        }
+
+        /* Tiles are taken in queue order, so views finish one after another */
+        #if USE_OPENMP
+        #pragma omp for schedule(dynamic, 1)
+        #endif
+        for (int t = 0; t < total; t++) {
+            if (atomic_load_explicit(&failed, memory_order_relaxed) ||
+                (cancel && atomic_load_explicit(cancel, memory_order_relaxed))) {
+                continue;
+            }
+            int v = view_of(states, count, t);
+            const multiview_view_t *view = &views[v];
+            view_state_t *state = &states[v];
+            accum_t *image = view_image(state, view);
+            if (!image) {
+                atomic_store(&failed, 1);
+                continue;
+            }
+
+            /* The view's own frame size places its camera samples */
+            render_settings_t frame = *settings;
+            frame.width = view->width;
+            frame.height = view->height;
+            int tile = t - state->first_tile;
+            int x0 = tile % state->tiles_x * tile_size;
+            int y0 = tile / state->tiles_x * tile_size;
+            int x1 = x0 + tile_size < view->width ? x0 + tile_size : view->width;
+            int y1 = y0 + tile_size < view->height ? y0 + tile_size : view->height;
+            for (int y = y0; y < y1; y++) {
+                for (int x = x0; x < x1; x++) {
+                    render_pixel(local, &view->camera, &frame, x, y, 0, spp,
+                                 &image->pixels[(size_t)y * view->width + x]);
+                }
+            }
+
+            /* The last tile of a view hands it over */
+            if (atomic_fetch_sub(&state->remaining, 1) == 1) {
+                if (done(v, image, user) != 0) atomic_store(&failed, 1);
+                accum_destroy(atomic_exchange(&state->image, NULL));
+            }
+        }
+    }
+
+    /* Views left unfinished by a failure or cancellation */
+    for (int v = 0; v < count; v++) accum_destroy(atomic_load(&states[v].image));
+    free(states);
+    return atomic_load(&failed) || (cancel && atomic_load(cancel)) ? -1 : 0;
+}
@@ -0,0 +1,42 @@
+#ifndef MULTIVIEW_H
+#define MULTIVIEW_H
+
+#include "camera.h"
+#include "render.h"
+#include "scene.h"
+
+/* Many views of one static scene rendered as a single job, e.g. the cameras
+ * of a product turntable. Every view is cut into tiles and all tiles go into
+ * one queue, view after view, that the render threads drain together: the
+ * thread that finishes the last tile of a view hands the finished image to a
+ * callback while the others carry on with the next views, so no thread idles
+ * between views. A view's image is allocated when its first tile is taken
+ * and freed once the callback returns, so only the views in flight are held
+ * in memory. Pixels get exactly the samples render_region gives the same
+ * camera and resolution. */
+
+#define MULTIVIEW_DEFAULT_TILE 32
+
+/* One view: a camera for the full frame of width x height pixels */
+typedef struct {
+    camera_t camera;
+    int width;
+    int height;
+} multiview_view_t;
+
+/* Called once per view as soon as its image is complete, from whichever
+ * render thread finished it, so calls for different views may run at the
+ * same time. The image is freed when it returns. Returns 0 to go on, -1 to
+ * stop the job. */
+typedef int (*multiview_done_fn)(int view, const accum_t *image, void *user);
+
+/* Render the count views with the samples, depth, seed, threads and replicas
+ * of settings (its size is ignored; guiding, caustics and footprints are not
+ * supported and batched tracing is not used), in tiles of tile_size pixels
+ * square. Returns 0 when every view was handed over, -1 on invalid
+ * arguments, allocation failure, cancellation or a failed callback. */
+int multiview_render(const scene_t *scene, const multiview_view_t *views, int count,
+                     const render_settings_t *settings, int tile_size, multiview_done_fn done,
+                     void *user);
+
+#endif /* MULTIVIEW_H */
@@ -0,0 +1,137 @@
+#define _POSIX_C_SOURCE 200809L
+#include "net.h"
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Monotonic time in seconds */
+double net_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Write exactly len bytes; returns 0 on success */
+int net_send_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Read exactly len bytes; returns 0 on success, -1 on error or end of stream */
+int net_recv_all(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Send a header followed by an optional payload */
+int net_send_msg(int fd, uint32_t type, uint32_t id, const void *payload, uint32_t size) {
+    net_header_t h = {NET_MAGIC, type, id, size};
+    if (net_send_all(fd, &h, sizeof(h)) != 0) return -1;
+    return size ? net_send_all(fd, payload, size) : 0;
+}
+
+/* Read a header and validate its magic */
+int net_recv_header(int fd, net_header_t *h) {
+    if (net_recv_all(fd, h, sizeof(*h)) != 0) return -1;
+    return h->magic == NET_MAGIC ? 0 : -1;
+}
+
+/* Resolve "unix:path" or "tcp:host:port" and create a matching socket.
+ * On success returns the fd and fills addr/len; returns -1 otherwise. */
+static int open_address(const char *address, int passive,
+                        struct sockaddr_storage *addr, socklen_t *len) {
+    memset(addr, 0, sizeof(*addr));
+
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un *un = (struct sockaddr_un *)addr;
+        const char *path = address + 5;
+        if (strlen(path) >= sizeof(un->sun_path)) return -1;
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, path);
+        *len = sizeof(*un);
+        return socket(AF_UNIX, SOCK_STREAM, 0);
+    }
+
+    if (strncmp(address, "tcp:", 4) == 0) {
+        char host[256];
+        const char *spec = address + 4;
+        const char *colon = strrchr(spec, ':');
+        if (!colon || (size_t)(colon - spec) >= sizeof(host)) return -1;
+        memcpy(host, spec, colon - spec);
+        host[colon - spec] = '\0';
+
+        struct addrinfo hints = {0}, *res = NULL;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = passive ? AI_PASSIVE : 0;
+        if (getaddrinfo(host[0] ? host : NULL, colon + 1, &hints, &res) != 0) {
+            return -1;
+        }
+        memcpy(addr, res->ai_addr, res->ai_addrlen);
+        *len = res->ai_addrlen;
+        int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        freeaddrinfo(res);
+        return fd;
+    }
+
+    return -1;
+}
+
+/* Bind and listen on an address; returns the listening fd or -1 */
+int net_listen(const char *address) {
+    struct sockaddr_storage addr;
+    socklen_t len;
+    int fd = open_address(address, 1, &addr, &len);
+    if (fd < 0) return -1;
+
+    if (addr.ss_family == AF_UNIX) {
+        unlink(((struct sockaddr_un *)&addr)->sun_path);
+    } else {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, len) != 0 || listen(fd, 64) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Connect to an address, retrying while the other end comes up */
+int net_connect(const char *address, double retry_seconds) {
+    double deadline = net_now() + retry_seconds;
+
+    while (1) {
+        struct sockaddr_storage addr;
+        socklen_t len;
+        int fd = open_address(address, 0, &addr, &len);
+        if (fd < 0) return -1;
+        if (connect(fd, (struct sockaddr *)&addr, len) == 0) return fd;
+        close(fd);
+
+        if (net_now() > deadline) return -1;
+        struct timespec wait = {0, 50 * 1000 * 1000};
+        nanosleep(&wait, NULL);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Stream sockets shared by the distributed renderer and the render daemon.
+ * Addresses are "unix:/path/to/socket" or "tcp:host:port". Messages are a
+ * fixed header followed by a payload, in the host byte order and struct
+ * layout, so both ends must share an architecture. */
+
+#define NET_MAGIC 0x56494245u /* "VIBE" */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t id;      /* job the message refers to */
+    uint32_t payload; /* bytes following the header */
+} net_header_t;
+
+/* Monotonic time in seconds */
+double net_now(void);
+
+/* Write exactly len bytes; returns 0 on success */
+int net_send_all(int fd, const void *buf, size_t len);
+
+/* Read exactly len bytes; returns 0 on success, -1 on error or end of stream */
+int net_recv_all(int fd, void *buf, size_t len);
+
+/* Send a header followed by an optional payload */
+int net_send_msg(int fd, uint32_t type, uint32_t id, const void *payload, uint32_t size);
+
+/* Read a header and validate its magic */
+int net_recv_header(int fd, net_header_t *h);
+
+/* Bind and listen on an address; returns the listening fd or -1 */
+int net_listen(const char *address);
+
+/* Connect to an address, retrying for up to retry_seconds while the other
+ * end comes up; returns the fd or -1 */
+int net_connect(const char *address, double retry_seconds);
+
+#endif /* NET_H */
@@ -0,0 +1,274 @@
+#include "photon.h"
+#include "material.h"
+#include "render.h"
+#include "utils.h"
+#include <math.h>
+#include <omp.h>
+#include <stdlib.h>
+
+#define USE_OPENMP 1
+#define RADIUS_FRACTION 0.1 /* first gather radius over the largest target radius */
+#define RADIUS_ALPHA (2.0 / 3.0)
+#define PHOTON_SALT 0x70686f74u /* keeps photon streams apart from pixel streams */
+
+/* A bounding sphere photons are aimed at */
+typedef struct {
+    vec3_t center;
+    double radius;
+} target_t;
+
+/* Hash of a grid cell */
+static uint32_t cell_hash(long ix, long iy, long iz, uint32_t mask) {
+    return ((uint32_t)ix * 73856093u ^ (uint32_t)iy * 19349663u ^ (uint32_t)iz * 83492791u) &
+           mask;
+}
+
+/* Grid cell coordinate of x */
+static long cell_coord(double x, double cell_size) {
+    return (long)floor(x / cell_size);
+}
+
+/* Number of target spheres the line through q along unit d passes through */
+static int targets_crossed(const target_t *targets, int count, vec3_t q, vec3_t d) {
+    int crossed = 0;
+    for (int j = 0; j < count; j++) {
+        vec3_t oc = vec3_sub(targets[j].center, q);
+        double along = vec3_dot(oc, d);
+        crossed += vec3_dot(oc, oc) - along * along <= targets[j].radius * targets[j].radius;
+    }
+    return crossed;
+}
+
+/* Trace photon i; returns 1 and fills out if it lands on a diffuse surface
+ * after a non-diffuse bounce */
+static int trace_photon(const scene_t *scene, const target_t *targets, const double *cdf,
+                        int target_count, double distance, double flux, int max_depth,
+                        photon_t *out) {
+    /* Target in proportion to its cross-section, then a direction toward the
+     * sky and a point on the target's disk facing it */
+    double u = random_double() * cdf[target_count - 1];
+    int lo = 0, hi = target_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cdf[mid] > u) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    const target_t *t = &targets[lo];
+    vec3_t sky = random_unit_vector();
+    vec3_t a = fabs(sky.e[0]) > 0.9 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3_t s = vec3_normalize(vec3_cross(sky, a));
+    vec3_t v = vec3_cross(sky, s);
+    double r = t->radius * sqrt(random_double());
+    double phi = 2.0 * PI * random_double();
+    vec3_t q = vec3_add(t->center,
+                        vec3_add(vec3_mul(s, r * cos(phi)), vec3_mul(v, r * sin(phi))));
+
+    /* Lines through several targets are emitted from each of them */
+    double weight = flux / targets_crossed(targets, target_count, q, sky);
+    vec3_t power = vec3_mul(scene_background(scene, ray(q, sky)), weight);
+    ray_t current = ray_timed(vec3_add(q, vec3_mul(sky, distance)), vec3_mul(sky, -1.0),
+                              scene->shutter.open);
+
+    int specular = 0;
+    for (int depth = 0; depth < max_depth; depth++) {
+        hit_record_t rec = {0};
+        if (!scene_hit(scene, current, 0.001, INFINITY, &rec)) return 0;
+        const material_t *mat = rec.material;
+        if (!mat || !mat->scatter) return 0;
+        if (mat->diffuse) {
+            if (!specular) return 0; /* direct light, not a caustic */
+            for (int c = 0; c < 3; c++) {
+                out->position[c] = (float)rec.point.e[c];
+                out->power[c] = (float)power.e[c];
+            }
+            return 1;
+        }
+
+        vec3_t attenuation = {0};
+        ray_t scattered = {0};
+        if (!mat->scatter(mat->data, current, &rec, &attenuation, &scattered)) return 0;
+        power = vec3(power.e[0] * attenuation.e[0], power.e[1] * attenuation.e[1],
+                     power.e[2] * attenuation.e[2]);
+        current = scattered;
+        specular = 1;
+    }
+    return 0;
+}
+
+/* Bounding sphere of a box */
+static target_t box_sphere(aabb_t box) {
+    vec3_t half = vec3_mul(vec3_sub(box.max, box.min), 0.5);
+    return (target_t){vec3_add(box.min, half), vec3_length(half)};
+}
+
+/* Trace and store the photons of one map */
+photon_map_t *photon_map_build(const scene_t *scene, int emitted, double radius,
+                               unsigned int seed, int max_depth) {
+    photon_map_t *map = calloc(1, sizeof(photon_map_t));
+    if (!map) return NULL;
+    map->radius = radius;
+    map->cell_size = 2.0 * radius;
+
+    int target_count = scene->specular_count;
+    target_t *targets = malloc((target_count + 1) * sizeof(target_t));
+    double *cdf = malloc((target_count + 1) * sizeof(double));
+    photon_t *traced = malloc(((size_t)emitted + 1) * sizeof(photon_t));
+    unsigned char *landed = calloc((size_t)emitted + 1, 1);
+    if (!targets || !cdf || !traced || !landed) {
+        free(targets);
+        free(cdf);
+        free(traced);
+        free(landed);
+        photon_map_destroy(map);
+        return NULL;
+    }
+
+    aabb_t bounds;
+    int bounded = scene->bvh ? bvh_bounding_box(scene->bvh, &bounds)
+                             : hittable_list_bounding_box(scene->world, &bounds);
+    double extent = bounded ? vec3_length(vec3_sub(bounds.max, bounds.min)) : 1e4;
+    double area = 0.0, largest = 0.0;
+    for (int i = 0; i < target_count; i++) {
+        targets[i] = box_sphere(scene->specular[i]);
+        area += PI * targets[i].radius * targets[i].radius;
+        cdf[i] = area;
+        if (targets[i].radius > largest) largest = targets[i].radius;
+    }
+
+    if (target_count > 0 && emitted > 0 && radius > 0.0) {
+        /* Flux of one photon: sky radiance over the whole sphere of
+         * directions through the targets' total cross-section */
+        double flux = 4.0 * PI * area / emitted;
+        double distance = extent + largest + 1.0;
+        #if USE_OPENMP
+        #pragma omp parallel for schedule(dynamic, 256)
+        #endif
+        for (int i = 0; i < emitted; i++) {
+            random_seed(sample_seed(seed ^ PHOTON_SALT, (uint64_t)i, 0));
+            landed[i] = (unsigned char)trace_photon(scene, targets, cdf, target_count, distance,
+                                                    flux, max_depth, &traced[i]);
+        }
+        for (int i = 0; i < emitted; i++) map->count += landed[i];
+    }
+
+    /* Counting sort by cell, in emission order so the map is deterministic */
+    uint32_t size = 1;
+    while (size < (uint32_t)map->count) size *= 2;
+    map->mask = size - 1;
+    map->cells = calloc((size_t)size + 1, sizeof(uint32_t));
+    map->photons = malloc(((size_t)map->count + 1) * sizeof(photon_t));
+    uint32_t *hashes = malloc(((size_t)emitted + 1) * sizeof(uint32_t));
+    int ok = map->cells && map->photons && hashes;
+    if (ok) {
+        for (int i = 0; i < emitted && map->count > 0; i++) {
+            if (!landed[i]) continue;
+            const float *p = traced[i].position;
+            hashes[i] = cell_hash(cell_coord(p[0], map->cell_size),
+                                  cell_coord(p[1], map->cell_size),
+                                  cell_coord(p[2], map->cell_size), map->mask);
+            map->cells[hashes[i] + 1]++;
+        }
+        for (uint32_t h = 0; h < size; h++) map->cells[h + 1] += map->cells[h];
+        map->bounds = (aabb_t){vec3(INFINITY, INFINITY, INFINITY),
+                               vec3(-INFINITY, -INFINITY, -INFINITY)};
+        for (int i = 0; i < emitted && map->count > 0; i++) {
+            if (!landed[i]) continue;
+            for (int a = 0; a < 3; a++) {
+                map->bounds.min.e[a] = fmin(map->bounds.min.e[a], traced[i].position[a] - radius);
+                map->bounds.max.e[a] = fmax(map->bounds.max.e[a], traced[i].position[a] + radius);
+            }
+        }
+        uint32_t *next = malloc((size_t)size * sizeof(uint32_t));
+        ok = next != NULL;
+        for (uint32_t h = 0; ok && h < size; h++) next[h] = map->cells[h];
+        for (int i = 0; ok && i < emitted && map->count > 0; i++) {
+            if (landed[i]) map->photons[next[hashes[i]]++] = traced[i];
+        }
+        free(next);
+    }
+
+    free(hashes);
+    free(targets);
+    free(cdf);
+    free(traced);
+    free(landed);
+    if (!ok) {
+        photon_map_destroy(map);
+        return NULL;
+    }
+    return map;
+}
+
+/* Free a photon map */
+void photon_map_destroy(photon_map_t *map) {
+    if (!map) return;
+    free(map->photons);
+    free(map->cells);
+    free(map);
+}
+
+/* Irradiance at p */
+vec3_t photon_map_irradiance(const photon_map_t *map, vec3_t p) {
+    vec3_t sum = vec3(0.0, 0.0, 0.0);
+    if (map->count == 0) return sum;
+    for (int a = 0; a < 3; a++) {
+        if (p.e[a] < map->bounds.min.e[a] || p.e[a] > map->bounds.max.e[a]) return sum;
+    }
+
+    /* The occupied cells overlapping the gather sphere; distinct cells may
+     * share a hash bucket, which must be visited once */
+    double r = map->radius;
+    long lo[3], hi[3];
+    for (int a = 0; a < 3; a++) {
+        lo[a] = cell_coord(p.e[a] - r, map->cell_size);
+        hi[a] = cell_coord(p.e[a] + r, map->cell_size);
+    }
+    uint32_t buckets[8];
+    int bucket_count = 0;
+    for (long ix = lo[0]; ix <= hi[0]; ix++) {
+        for (long iy = lo[1]; iy <= hi[1]; iy++) {
+            for (long iz = lo[2]; iz <= hi[2]; iz++) {
+                uint32_t h = cell_hash(ix, iy, iz, map->mask);
+                if (map->cells[h] == map->cells[h + 1]) continue;
+                int seen = 0;
+                for (int b = 0; b < bucket_count; b++) seen |= buckets[b] == h;
+                if (!seen) buckets[bucket_count++] = h;
+            }
+        }
+    }
+
+    double r2 = r * r;
+    for (int b = 0; b < bucket_count; b++) {
+        for (uint32_t i = map->cells[buckets[b]]; i < map->cells[buckets[b] + 1]; i++) {
+            const photon_t *ph = &map->photons[i];
+            double dx = ph->position[0] - p.e[0];
+            double dy = ph->position[1] - p.e[1];
+            double dz = ph->position[2] - p.e[2];
+            if (dx * dx + dy * dy + dz * dz > r2) continue;
+            sum.e[0] += ph->power[0];
+            sum.e[1] += ph->power[1];
+            sum.e[2] += ph->power[2];
+        }
+    }
+    return vec3_mul(sum, 1.0 / (PI * r2));
+}
+
+/* First gather radius */
+double photon_initial_radius(const scene_t *scene) {
+    double largest = 0.0;
+    for (int i = 0; i < scene->specular_count; i++) {
+        double radius = box_sphere(scene->specular[i]).radius;
+        if (radius > largest) largest = radius;
+    }
+    return RADIUS_FRACTION * largest;
+}
+
+/* Gather radius of pass k */
+double photon_pass_radius(double initial, int pass) {
+    double r2 = initial * initial;
+    for (int i = 1; i <= pass; i++) r2 *= (i + RADIUS_ALPHA) / (i + 1.0);
+    return sqrt(r2);
+}
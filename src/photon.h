@@ -0,0 +1,61 @@
+#ifndef PHOTON_H
+#define PHOTON_H
+
+#include "aabb.h"
+#include "scene.h"
+#include "vec3.h"
+#include <stdint.h>
+
+/* Caustic photon maps. Photons leave the sky aimed at the bounds of the
+ * scene's non-diffuse objects (scene_t.specular), follow chains of glass and
+ * metal bounces, and are stored where they first land on a diffuse surface.
+ * Paths that reach the sky from a diffuse surface through glass or metal
+ * are exactly the light these photons carry, so a renderer gathering the
+ * photons at diffuse hits must not count those paths again.
+ *
+ * Photons are traced in parallel, each from its own random stream, and are
+ * stored into a hashed grid of cells twice the gather radius wide, so a
+ * gather visits at most eight cells; points away from every photon are
+ * turned back by the map's bounds before hashing. A map's contents do not depend on the
+ * thread count. */
+
+/* A stored photon: where it landed and the flux it carries */
+typedef struct {
+    float position[3];
+    float power[3];
+} photon_t;
+
+typedef struct {
+    photon_t *photons;  /* grouped by hash cell */
+    uint32_t *cells;    /* cell h holds photons [cells[h], cells[h + 1]) */
+    uint32_t mask;      /* hash table size - 1 */
+    int count;
+    double radius;      /* gather radius */
+    double cell_size;
+    aabb_t bounds;      /* of the photons, grown by the radius */
+} photon_map_t;
+
+/* Trace emitted photons from the sky with the given random seed and keep
+ * those that reach a diffuse surface through at least one non-diffuse
+ * bounce within max_depth bounces, at the scene's shutter open time. The
+ * map is empty if the scene has no non-diffuse objects; NULL on allocation
+ * failure. */
+photon_map_t *photon_map_build(const scene_t *scene, int emitted, double radius,
+                               unsigned int seed, int max_depth);
+
+/* Free a photon map */
+void photon_map_destroy(photon_map_t *map);
+
+/* Irradiance at point p from the photons within the gather radius */
+vec3_t photon_map_irradiance(const photon_map_t *map, vec3_t p);
+
+/* Gather radius for the scene's first pass: a fraction of the largest
+ * non-diffuse object (0 if there are none) */
+double photon_initial_radius(const scene_t *scene);
+
+/* Gather radius of pass k (from 0) in progressive photon mapping: the
+ * squared radius shrinks by (k + alpha) / (k + 1) each pass, so the
+ * estimates of the passes average to the exact caustics */
+double photon_pass_radius(double initial, int pass);
+
+#endif /* PHOTON_H */
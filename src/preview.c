@@ -0,0 +1,237 @@
+#define _POSIX_C_SOURCE 200809L
+#include "preview.h"
+#include "framebuffer.h"
+#include "utils.h"
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define COARSEST_BLOCK 8
+#define MAX_PASS_SAMPLES 8 /* cap on progressive batch size, keeps passes short */
+#define WATCH_INTERVAL_NS (20 * 1000 * 1000)
+
+enum {
+    INTERRUPT_RESTART = 1,
+    INTERRUPT_STOP = 2,
+};
+
+/* Shared with the signal handler and the control file watcher */
+static atomic_int interrupt_flags;
+
+/* Camera placement editable through the control file */
+typedef struct {
+    vec3_t lookfrom;
+    vec3_t lookat;
+    vec3_t vup;
+    double vfov;
+    double aperture;
+    double focus_dist;
+} view_t;
+
+typedef struct {
+    const char *path;
+    atomic_int running;
+} watcher_t;
+
+static void on_signal(int sig) {
+    (void)sig;
+    atomic_fetch_or(&interrupt_flags, INTERRUPT_STOP);
+}
+
+/* Modification stamp of a file (zero if it does not exist) */
+static void file_stamp(const char *path, struct timespec *mtime, off_t *size) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        *mtime = st.st_mtim;
+        *size = st.st_size;
+    } else {
+        memset(mtime, 0, sizeof(*mtime));
+        *size = -1;
+    }
+}
+
+/* Poll the control file and raise a restart when it changes */
+static void *watch_control(void *arg) {
+    watcher_t *w = arg;
+    struct timespec last_mtime;
+    off_t last_size;
+    file_stamp(w->path, &last_mtime, &last_size);
+
+    while (atomic_load(&w->running)) {
+        struct timespec wait = {0, WATCH_INTERVAL_NS};
+        nanosleep(&wait, NULL);
+
+        struct timespec mtime;
+        off_t size;
+        file_stamp(w->path, &mtime, &size);
+        if (mtime.tv_sec != last_mtime.tv_sec || mtime.tv_nsec != last_mtime.tv_nsec ||
+            size != last_size) {
+            last_mtime = mtime;
+            last_size = size;
+            atomic_fetch_or(&interrupt_flags, INTERRUPT_RESTART);
+        }
+    }
+    return NULL;
+}
+
+/* Apply the control file to view; unreadable files leave it unchanged */
+static void load_control(const char *path, view_t *view) {
+    FILE *in = fopen(path, "r");
+    if (!in) return;
+
+    char line[256];
+    while (fgets(line, sizeof(line), in)) {
+        char key[32];
+        double a, b, c;
+        int n = sscanf(line, "%31s %lf %lf %lf", key, &a, &b, &c);
+        if (n < 2 || key[0] == '#') continue;
+
+        if (n == 4 && strcmp(key, "lookfrom") == 0) {
+            view->lookfrom = vec3(a, b, c);
+        } else if (n == 4 && strcmp(key, "lookat") == 0) {
+            view->lookat = vec3(a, b, c);
+        } else if (n == 4 && strcmp(key, "vup") == 0) {
+            view->vup = vec3(a, b, c);
+        } else if (strcmp(key, "vfov") == 0) {
+            view->vfov = a;
+        } else if (strcmp(key, "aperture") == 0) {
+            view->aperture = a;
+        } else if (strcmp(key, "focus_dist") == 0) {
+            view->focus_dist = a;
+        } else {
+            fprintf(stderr, "Warning: ignoring control line: %s", line);
+        }
+    }
+    fclose(in);
+}
+
+/* Render the first sample of the pixels new at this block size: every
+ * block-aligned pixel, except those already done by the coarser level */
+static int render_level(const scene_t *scene, const camera_t *camera,
+                        const render_settings_t *settings, int block, accum_t *out) {
+    int cols = (settings->width + block - 1) / block;
+    int rows = (settings->height + block - 1) / block;
+    int coarser = block * 2;
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int idx = 0; idx < cols * rows; idx++) {
+        if (atomic_load_explicit(&interrupt_flags, memory_order_relaxed)) continue;
+
+        int x = (idx % cols) * block;
+        int y = (idx / cols) * block;
+        if (block < COARSEST_BLOCK && x % coarser == 0 && y % coarser == 0) continue;
+
+        render_pixel(scene, camera, settings, x, y, 0, 1,
+                     &out->pixels[(size_t)y * out->width + x]);
+    }
+    return atomic_load(&interrupt_flags) ? -1 : 0;
+}
+
+/* Convert the accumulation to 8-bit gamma corrected pixels and publish it;
+ * coarse levels replicate each block's rendered pixel */
+static void publish(framebuffer_t *fb, const accum_t *accum, int block, int samples) {
+    uint8_t *image = framebuffer_back(fb);
+    int width = accum->width;
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < accum->height; y++) {
+        uint8_t *row = image + (size_t)y * fb->header->stride;
+        for (int x = 0; x < width; x++) {
+            int sx = x - x % block;
+            int sy = y - y % block;
+            vec3_t c = accum_pixel_mean(&accum->pixels[(size_t)sy * width + sx]);
+            for (int k = 0; k < 3; k++) {
+                row[4 * x + k] = (uint8_t)(255.999 * clamp(sqrt(c.e[k]), 0.0, 1.0));
+            }
+            row[4 * x + 3] = 255;
+        }
+    }
+    framebuffer_publish(fb, (uint32_t)samples, (uint32_t)block);
+}
+
+/* Run the preview */
+int preview_run(const scene_t *scene, const render_settings_t *settings,
+                const preview_options_t *opts, accum_t *out) {
+    framebuffer_t *fb =
+        framebuffer_create(opts->framebuffer_path, settings->width, settings->height);
+    if (!fb) {
+        fprintf(stderr, "Error: could not map %s\n", opts->framebuffer_path);
+        return -1;
+    }
+
+    render_settings_t pass = *settings;
+    pass.cancel = &interrupt_flags;
+    atomic_store(&interrupt_flags, 0);
+
+    struct sigaction sa = {0};
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    watcher_t watcher = {.path = opts->control_path};
+    pthread_t watch_thread;
+    int watching = 0;
+    if (opts->control_path) {
+        atomic_init(&watcher.running, 1);
+        watching = pthread_create(&watch_thread, NULL, watch_control, &watcher) == 0;
+    }
+
+    view_t view = {scene->lookfrom, scene->lookat, scene->vup,
+                   scene->vfov, scene->aperture, scene->focus_dist};
+    double aspect = (double)settings->width / settings->height;
+    render_rect_t full = {0, 0, settings->width, settings->height};
+    int complete = 0; /* out holds every sample of the current view */
+
+    while (1) {
+        if (opts->control_path) load_control(opts->control_path, &view);
+        atomic_fetch_and(&interrupt_flags, ~INTERRUPT_RESTART);
+        camera_t camera = camera_create(view.lookfrom, view.lookat, view.vup, view.vfov,
+                                        aspect, view.aperture, view.focus_dist);
+        accum_clear(out);
+
+        /* Coarse to fine, then progressive accumulation */
+        int cancelled = 0;
+        for (int block = COARSEST_BLOCK; block >= 1 && !cancelled; block /= 2) {
+            cancelled = render_level(scene, &camera, &pass, block, out) != 0;
+            if (!cancelled) publish(fb, out, block, 1);
+        }
+
+        int done = 1;
+        int batch = 1;
+        while (!cancelled && done < settings->samples_per_pixel) {
+            int n = batch < settings->samples_per_pixel - done
+                        ? batch : settings->samples_per_pixel - done;
+            cancelled = render_region(scene, &camera, &pass, full, done, done + n, out) != 0;
+            if (cancelled) break;
+            done += n;
+            publish(fb, out, 1, done);
+            fprintf(stderr, "\rPreview: %d/%d spp", done, settings->samples_per_pixel);
+            if (batch < MAX_PASS_SAMPLES) batch *= 2;
+        }
+        complete = !cancelled;
+
+        /* Without a control file there is nothing to wait for */
+        if (!watching && !cancelled) break;
+        while (!atomic_load(&interrupt_flags)) {
+            struct timespec wait = {0, WATCH_INTERVAL_NS};
+            nanosleep(&wait, NULL);
+        }
+        if (atomic_load(&interrupt_flags) & INTERRUPT_STOP) break;
+        fprintf(stderr, "\nControl file changed, restarting\n");
+    }
+    fprintf(stderr, "\n");
+
+    if (watching) {
+        atomic_store(&watcher.running, 0);
+        pthread_join(watch_thread, NULL);
+    }
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    framebuffer_close(fb);
+    return complete ? 0 : PREVIEW_STOPPED;
+}
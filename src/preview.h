@@ -0,0 +1,33 @@
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include "render.h"
+#include "scene.h"
+
+/* Interactive preview. Frames are refined coarse to fine: one sample per 8x8,
+ * 4x4 and 2x2 block, then one sample for every pixel, then progressive passes
+ * up to settings->samples_per_pixel. Every pass is published to a shared
+ * framebuffer file (see framebuffer.h).
+ *
+ * The control file holds "key value..." lines overriding the scene camera:
+ * lookfrom x y z, lookat x y z, vup x y z, vfov deg, aperture a, focus_dist d.
+ * Whenever it changes, the current pass is abandoned and the frame restarts. */
+
+typedef struct {
+    const char *framebuffer_path;
+    const char *control_path; /* optional; when set, the preview keeps waiting
+                               * for changes after the last pass */
+} preview_options_t;
+
+/* Returned by preview_run when SIGINT/SIGTERM stopped it before the frame
+ * had all its samples */
+#define PREVIEW_STOPPED 1
+
+/* Run the preview until the last pass (or SIGINT/SIGTERM when watching a
+ * control file). out receives the final accumulation and must match the
+ * settings' resolution. Returns 0 once out holds every sample,
+ * PREVIEW_STOPPED if a stop left it partial, or -1 on setup failure. */
+int preview_run(const scene_t *scene, const render_settings_t *settings,
+                const preview_options_t *opts, accum_t *out);
+
+#endif /* PREVIEW_H */
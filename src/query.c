@@ -0,0 +1,68 @@
+#include "query.h"
+#include "affinity.h"
+#include <math.h>
+
+#define USE_OPENMP 1
+
+/* Whether rays has every array the queries need */
+int query_rays_valid(const vibe_rays_t *rays) {
+    return rays && rays->ox && rays->oy && rays->oz && rays->dx && rays->dy && rays->dz;
+}
+
+/* The scene the calling thread should read */
+static const scene_t *local_scene(const scene_t *scene, const scene_t *const *replicas) {
+    if (!replicas) return scene;
+    const scene_t *replica = replicas[affinity_thread_node()];
+    return replica ? replica : scene;
+}
+
+/* Ray i of the batch with its t range */
+static inline ray_t batch_ray(const vibe_rays_t *rays, int i, double *t_min, double *t_max) {
+    *t_min = rays->t_min ? rays->t_min[i] : 0.0;
+    *t_max = rays->t_max ? rays->t_max[i] : INFINITY;
+    return ray_timed(vec3(rays->ox[i], rays->oy[i], rays->oz[i]),
+                     vec3(rays->dx[i], rays->dy[i], rays->dz[i]), rays->time);
+}
+
+/* Closest hits of count rays */
+void query_closest(const scene_t *scene, const scene_t *const *replicas,
+                   const vibe_rays_t *rays, int count, vibe_hits_t *hits) {
+    int normals = hits->nx && hits->ny && hits->nz;
+
+    #if USE_OPENMP
+    #pragma omp parallel for schedule(dynamic, QUERY_CHUNK)
+    #endif
+    for (int i = 0; i < count; i++) {
+        double t_min, t_max;
+        ray_t r = batch_ray(rays, i, &t_min, &t_max);
+        hit_record_t rec;
+        if (scene_hit(local_scene(scene, replicas), r, t_min, t_max, &rec)) {
+            hits->t[i] = rec.t;
+            hits->primitive[i] = rec.object;
+            if (normals) {
+                double sign = rec.front_face ? 1.0 : -1.0;
+                hits->nx[i] = sign * rec.normal.e[0];
+                hits->ny[i] = sign * rec.normal.e[1];
+                hits->nz[i] = sign * rec.normal.e[2];
+            }
+        } else {
+            hits->t[i] = INFINITY;
+            hits->primitive[i] = -1;
+            if (normals) hits->nx[i] = hits->ny[i] = hits->nz[i] = 0.0;
+        }
+    }
+}
+
+/* Occlusion of count rays */
+void query_occluded(const scene_t *scene, const scene_t *const *replicas,
+                    const vibe_rays_t *rays, int count, unsigned char *occluded) {
+    #if USE_OPENMP
+    #pragma omp parallel for schedule(dynamic, QUERY_CHUNK)
+    #endif
+    for (int i = 0; i < count; i++) {
+        double t_min, t_max;
+        ray_t r = batch_ray(rays, i, &t_min, &t_max);
+        occluded[i] = (unsigned char)scene_occluded(local_scene(scene, replicas), r, t_min,
+                                                    t_max);
+    }
+}
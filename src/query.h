@@ -0,0 +1,27 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "scene.h"
+#include "vibe.h"
+
+/* Bulk ray queries: the closest-hit and occlusion tests of the renderer run
+ * over structure-of-arrays batches for clients that want visibility and
+ * distances rather than images (collision probes, line of sight). Batches are
+ * split into chunks handed out dynamically to the OpenMP team; each ray reads
+ * its inputs and writes its results in place, so nothing is allocated. */
+
+#define QUERY_CHUNK 256 /* rays per dynamically scheduled chunk */
+
+/* Whether rays has every array the queries need */
+int query_rays_valid(const vibe_rays_t *rays);
+
+/* Closest hits of count rays against scene, or against the replica of each
+ * thread's NUMA node when replicas is set (see affinity.h) */
+void query_closest(const scene_t *scene, const scene_t *const *replicas,
+                   const vibe_rays_t *rays, int count, vibe_hits_t *hits);
+
+/* Occlusion of count rays against scene, or its per-node replicas */
+void query_occluded(const scene_t *scene, const scene_t *const *replicas,
+                    const vibe_rays_t *rays, int count, unsigned char *occluded);
+
+#endif /* QUERY_H */
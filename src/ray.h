@@ -7,12 +7,22 @@
 typedef struct {
     vec3_t origin;
     vec3_t direction;
+    double time; /* instant the ray samples, for moving objects */
 } ray_t;
 
-/* Construct a ray from origin and direction */
-ray_t ray(const vec3_t origin, const vec3_t direction);
+/* Construct a ray from origin and direction at time 0 */
+static inline ray_t ray(const vec3_t origin, const vec3_t direction) {
+    return (ray_t){origin, direction, 0.0};
+}
+
+/* Construct a ray at the given time */
+static inline ray_t ray_timed(const vec3_t origin, const vec3_t direction, double time) {
+    return (ray_t){origin, direction, time};
+}
 
 /* Get point at parameter t along the ray */
-vec3_t ray_at(const ray_t r, double t);
+static inline vec3_t ray_at(const ray_t r, double t) {
+    return vec3_add(r.origin, vec3_mul(r.direction, t));
+}
 
 #endif /* RAY_H */
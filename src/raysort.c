@@ -0,0 +1,88 @@
+#include "raysort.h"
+#include <string.h>
+
+#define ORIGIN_BITS 10 /* per axis */
+#define DIRECTION_BITS 3 /* per axis, within the octant */
+#define RADIX_BITS 8
+
+/* Spread the low 10 bits of v so they occupy every third bit */
+static uint64_t spread_bits(uint64_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x30000ff;
+    v = (v | (v << 8)) & 0x300f00f;
+    v = (v | (v << 4)) & 0x30c30c3;
+    v = (v | (v << 2)) & 0x9249249;
+    return v;
+}
+
+/* Interleave three 10-bit coordinates */
+static uint64_t morton3(uint64_t x, uint64_t y, uint64_t z) {
+    return spread_bits(x) | (spread_bits(y) << 1) | (spread_bits(z) << 2);
+}
+
+/* Quantize x in [lo, hi] to bits bits */
+static uint64_t quantize(double x, double lo, double hi, int bits) {
+    double cells = (double)(1 << bits);
+    double q = hi > lo ? (x - lo) / (hi - lo) * cells : 0.0;
+    if (!(q > 0.0)) return 0;
+    if (q >= cells) return (1u << bits) - 1;
+    return (uint64_t)q;
+}
+
+/* Sort key of a ray whose origin lies in bounds */
+uint64_t ray_sort_key(const ray_t *r, const aabb_t *bounds) {
+    const double *o = r->origin.e;
+    const double *d = r->direction.e;
+
+    uint64_t octant = (uint64_t)(d[0] < 0.0) | (uint64_t)(d[1] < 0.0) << 1 |
+                      (uint64_t)(d[2] < 0.0) << 2;
+    uint64_t cell = morton3(quantize(o[0], bounds->min.e[0], bounds->max.e[0], ORIGIN_BITS),
+                            quantize(o[1], bounds->min.e[1], bounds->max.e[1], ORIGIN_BITS),
+                            quantize(o[2], bounds->min.e[2], bounds->max.e[2], ORIGIN_BITS));
+
+    double len = fabs(d[0]) + fabs(d[1]) + fabs(d[2]);
+    double inv = len > 0.0 ? 1.0 / len : 0.0;
+    uint64_t dir = morton3(quantize(fabs(d[0]) * inv, 0.0, 1.0, DIRECTION_BITS),
+                           quantize(fabs(d[1]) * inv, 0.0, 1.0, DIRECTION_BITS),
+                           quantize(fabs(d[2]) * inv, 0.0, 1.0, DIRECTION_BITS));
+
+    return cell << (3 + 3 * DIRECTION_BITS) | octant << (3 * DIRECTION_BITS) | dir;
+}
+
+/* Stable LSD radix sort of (key, value) pairs */
+void ray_sort(uint64_t *keys, uint32_t *values, int count, uint64_t *tmp_keys,
+              uint32_t *tmp_values) {
+    uint64_t *src_k = keys, *dst_k = tmp_keys;
+    uint32_t *src_v = values, *dst_v = tmp_values;
+
+    for (int shift = 0; shift < RAYSORT_KEY_BITS; shift += RADIX_BITS) {
+        int offsets[1 << RADIX_BITS] = {0};
+        for (int i = 0; i < count; i++) {
+            offsets[(src_k[i] >> shift) & ((1 << RADIX_BITS) - 1)]++;
+        }
+        int total = 0;
+        for (int b = 0; b < 1 << RADIX_BITS; b++) {
+            int n = offsets[b];
+            offsets[b] = total;
+            total += n;
+        }
+        for (int i = 0; i < count; i++) {
+            int pos = offsets[(src_k[i] >> shift) & ((1 << RADIX_BITS) - 1)]++;
+            dst_k[pos] = src_k[i];
+            dst_v[pos] = src_v[i];
+        }
+
+        uint64_t *tk = src_k;
+        src_k = dst_k;
+        dst_k = tk;
+        uint32_t *tv = src_v;
+        src_v = dst_v;
+        dst_v = tv;
+    }
+
+    /* An odd number of passes leaves the result in the tmp arrays */
+    if (src_k != keys) {
+        memcpy(keys, src_k, count * sizeof(uint64_t));
+        memcpy(values, src_v, count * sizeof(uint32_t));
+    }
+}
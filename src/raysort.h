@@ -0,0 +1,25 @@
+#ifndef RAYSORT_H
+#define RAYSORT_H
+
+#include "aabb.h"
+#include "ray.h"
+#include <stdint.h>
+
+/* Coherence sort keys for batches of secondary rays. The key orders rays by
+ * the Morton code of their origin cell inside the batch bounds, then by
+ * direction octant, then by a coarse Morton code of the direction within the
+ * octant, so consecutive rays start close together and head the same way.
+ * Origin first keeps the geometry near the rays' starting points in cache;
+ * it measured fewer misses than octant first in `vibe_bench sort`. */
+
+#define RAYSORT_KEY_BITS 42
+
+/* Sort key of a ray whose origin lies in bounds */
+uint64_t ray_sort_key(const ray_t *r, const aabb_t *bounds);
+
+/* Stable LSD radix sort of count (key, value) pairs by key. The tmp arrays
+ * must hold count entries each. */
+void ray_sort(uint64_t *keys, uint32_t *values, int count, uint64_t *tmp_keys,
+              uint32_t *tmp_values);
+
+#endif /* RAYSORT_H */
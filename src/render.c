@@ -0,0 +1,742 @@
+#include "render.h"
+#include "affinity.h"
+#include "envmap.h"
+#include "hittable.h"
+#include "lighttree.h"
+#include "material.h"
+#include "photon.h"
+#include "raysort.h"
+#include "utils.h"
+#include <math.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define USE_OPENMP 1
+#define FIRST_TOUCH_MIN_PIXELS 65536 /* smaller buffers are zeroed serially */
+
+/* Create a zeroed accumulation buffer */
+accum_t *accum_create(int width, int height) {
+    if (width <= 0 || height <= 0) return NULL;
+
+    accum_t *accum = malloc(sizeof(accum_t));
+    if (!accum) return NULL;
+
+    accum->width = width;
+    accum->height = height;
+    size_t row_bytes = (size_t)width * sizeof(accum_pixel_t);
+    accum->pixels = malloc(row_bytes * height);
+    if (!accum->pixels) {
+        free(accum);
+        return NULL;
+    }
+
+    #if USE_OPENMP
+    #pragma omp parallel for schedule(static) if ((size_t)width * height >= FIRST_TOUCH_MIN_PIXELS)
+    #endif
+    for (int row = 0; row < height; row++) {
+        memset((char *)accum->pixels + row * row_bytes, 0, row_bytes);
+    }
+    return accum;
+}
+
+/* Reset every pixel to zero samples */
+void accum_clear(accum_t *accum) {
+    if (!accum) return;
+    memset(accum->pixels, 0,
+           (size_t)accum->width * accum->height * sizeof(accum_pixel_t));
+}
+
+/* Add src into dst at offset (x, y) */
+void accum_merge(accum_t *dst, const accum_t *src, int x, int y) {
+    if (!dst || !src) return;
+
+    for (int row = 0; row < src->height; row++) {
+        int dy = y + row;
+        if (dy < 0 || dy >= dst->height) continue;
+
+        for (int col = 0; col < src->width; col++) {
+            int dx = x + col;
+            if (dx < 0 || dx >= dst->width) continue;
+
+            const accum_pixel_t *s = &src->pixels[(size_t)row * src->width + col];
+            accum_pixel_t *d = &dst->pixels[(size_t)dy * dst->width + dx];
+            d->sum[0] += s->sum[0];
+            d->sum[1] += s->sum[1];
+            d->sum[2] += s->sum[2];
+            d->samples += s->samples;
+        }
+    }
+}
+
+/* Mean radiance of an accumulated pixel */
+vec3_t accum_pixel_mean(const accum_pixel_t *pixel) {
+    if (pixel->samples == 0) {
+        return vec3(0.0, 0.0, 0.0);
+    }
+    double scale = 1.0 / ((double)pixel->samples * (double)(1 << ACCUM_FRACTION_BITS));
+    return vec3(pixel->sum[0] * scale, pixel->sum[1] * scale, pixel->sum[2] * scale);
+}
+
+/* Free an accumulation buffer */
+void accum_destroy(accum_t *accum) {
+    if (!accum) return;
+    free(accum->pixels);
+    free(accum);
+}
+
+/* Convert one radiance component to fixed point (NaN and negatives count as 0) */
+static uint64_t to_fixed(double x) {
+    if (!(x > 0.0)) return 0;
+    if (x > ACCUM_MAX_SAMPLE) x = ACCUM_MAX_SAMPLE;
+    return (uint64_t)(x * (double)(1 << ACCUM_FRACTION_BITS) + 0.5);
+}
+
+/* Seed for sample s of pixel p: a splitmix64 finalizer over the three inputs */
+unsigned int sample_seed(unsigned int base, uint64_t pixel, int sample) {
+    uint64_t z = ((uint64_t)base << 32) ^ (pixel * 0x9e3779b97f4a7c15ull) ^
+                 ((uint64_t)sample * 0xd1b54a32d192ed03ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    return (unsigned int)(z >> 32);
+}
+
+/* Sky gradient seen by rays that escape the scene */
+vec3_t sky_color(const ray_t r) {
+    vec3_t unit_direction = vec3_normalize(r.direction);
+    double t = 0.5 * (unit_direction.e[1] + 1.0);
+    vec3_t white = vec3(1.0, 1.0, 1.0);
+    vec3_t blue = vec3(0.5, 0.7, 1.0);
+    return vec3_add(vec3_mul(white, 1.0 - t), vec3_mul(blue, t));
+}
+
+/* What a ray that escapes the scene sees */
+vec3_t scene_background(const scene_t *scene, const ray_t r) {
+    if (scene->environment) return envmap_lookup(scene->environment, r.direction);
+    return scene->unlit ? vec3(0.0, 0.0, 0.0) : sky_color(r);
+}
+
+/* Calculate color based on ray-scene intersection with recursion */
+vec3_t ray_color(const ray_t r, const scene_t *scene, int depth) {
+    hit_record_t rec = {0};
+
+    if (depth <= 0) {
+        return vec3(0.0, 0.0, 0.0);
+    }
+
+    if (scene_hit(scene, r, 0.001, INFINITY, &rec)) {
+        ray_t scattered = {0};
+        vec3_t attenuation = {0};
+
+        if (rec.material && rec.material->emission) {
+            return *rec.material->emission;
+        }
+        if (rec.material && rec.material->scatter) {
+            if (rec.material->scatter(rec.material->data, r, &rec, &attenuation,
+                                      &scattered)) {
+                vec3_t color = ray_color(scattered, scene, depth - 1);
+                return vec3(attenuation.e[0] * color.e[0],
+                           attenuation.e[1] * color.e[1],
+                           attenuation.e[2] * color.e[2]);
+            }
+        }
+        return vec3(0.0, 0.0, 0.0);
+    }
+
+    return scene_background(scene, r);
+}
+
+/* Luminance of a color */
+static double luminance(vec3_t c) {
+    return 0.2126 * c.e[0] + 0.7152 * c.e[1] + 0.0722 * c.e[2];
+}
+
+/* Where a path of ray_color_passes stands: light reaching the sky from a
+ * diffuse hit through non-diffuse bounces only is what caustic photons carry */
+#define PATH_CAMERA 0  /* no diffuse bounce yet */
+#define PATH_DIFFUSE 1 /* just left a diffuse surface */
+#define PATH_CAUSTIC 2 /* non-diffuse bounces only since the last diffuse one */
+
+/* Light arriving at a diffuse hit straight from the scene's environment map,
+ * sampled from the map and weighted against the bounce (drawn from the
+ * cosine lobe mixed with the guide's cell by fraction) with the power
+ * heuristic; still to be multiplied by the albedo */
+static vec3_t environment_light(const scene_t *scene, const hit_record_t *rec, double time,
+                                const guide_cell_t *cell, double fraction) {
+    const envmap_t *env = scene->environment;
+    double u1 = random_double();
+    double u2 = random_double();
+    double u3 = random_double();
+    double u4 = random_double();
+    double light_pdf;
+    vec3_t direction = envmap_sample(env, u1, u2, u3, u4, &light_pdf);
+    double cosine = vec3_dot(direction, rec->normal);
+    if (cosine <= 0.0 || light_pdf <= 0.0) return vec3(0.0, 0.0, 0.0);
+
+    hit_record_t blocker = {0};
+    if (scene_hit(scene, ray_timed(rec->point, direction, time), 0.001, INFINITY, &blocker)) {
+        return vec3(0.0, 0.0, 0.0);
+    }
+    double bounce_pdf = (1.0 - fraction) * cosine / PI;
+    if (fraction > 0.0) bounce_pdf += fraction * guide_pdf(cell, direction);
+    double weight = light_pdf * light_pdf / (light_pdf * light_pdf + bounce_pdf * bounce_pdf);
+    return vec3_mul(envmap_lookup(env, direction), weight * cosine / (PI * light_pdf));
+}
+
+/* Light arriving at a diffuse hit straight from one of the scene's emissive
+ * spheres, picked by the light tree and weighted against the bounce as in
+ * environment_light, recording the tree and the light into the footprint
+ * touched (if not NULL); still to be multiplied by the albedo */
+static vec3_t sphere_light(const scene_t *scene, const hit_record_t *rec, double time,
+                           const guide_cell_t *cell, double fraction,
+                           footprint_pixel_t *touched) {
+    const light_tree_t *lights = scene->lights;
+    double u = random_double();
+    double u1 = random_double();
+    double u2 = random_double();
+    double pick;
+    int index = light_tree_sample(lights, rec->point, rec->normal, u, &pick);
+    if (touched) footprint_add(touched, FOOTPRINT_LIGHTS);
+    if (index < 0) return vec3(0.0, 0.0, 0.0);
+
+    const light_t *light = &lights->lights[index];
+    if (touched) footprint_add(touched, light->object);
+    double direction_pdf;
+    vec3_t direction = light_sample_direction(light, rec->point, u1, u2, &direction_pdf);
+    double cosine = vec3_dot(direction, rec->normal);
+    if (cosine <= 0.0 || direction_pdf <= 0.0) return vec3(0.0, 0.0, 0.0);
+
+    /* The first thing along the direction must be the light itself */
+    hit_record_t target = {0};
+    if (!scene_hit(scene, ray_timed(rec->point, direction, time), 0.001, INFINITY, &target) ||
+        target.object != light->object) {
+        return vec3(0.0, 0.0, 0.0);
+    }
+    double light_pdf = pick * direction_pdf;
+    double bounce_pdf = (1.0 - fraction) * cosine / PI;
+    if (fraction > 0.0) bounce_pdf += fraction * guide_pdf(cell, direction);
+    double weight = light_pdf * light_pdf / (light_pdf * light_pdf + bounce_pdf * bounce_pdf);
+    return vec3_mul(*light->emission, weight * cosine / (PI * light_pdf));
+}
+
+/* Radiance along a ray as ray_color, with what settings and the scene add:
+ * bounces off diffuse surfaces sampled from a mix of the path guide and the
+ * cosine lobe (what arrives along each is recorded into the guide), caustics
+ * taken from the photon map at diffuse hits instead of from the paths, the
+ * objects hit recorded into the pixel's footprint touched (if not NULL), and
+ * the environment map and the light tree sampled at diffuse hits, combined
+ * by multiple importance sampling with bounces that reach them. pdf is the
+ * density over directions with which a diffuse bounce off a surface with
+ * the given normal drew r, 0 for camera and specular rays, which see the
+ * environment and lights unweighted. */
+static vec3_t ray_color_passes(const ray_t r, const scene_t *scene, int depth,
+                               const render_settings_t *settings, int path, double pdf,
+                               vec3_t normal, footprint_pixel_t *touched) {
+    hit_record_t rec = {0};
+
+    if (depth <= 0) {
+        return vec3(0.0, 0.0, 0.0);
+    }
+    int hit = scene_hit(scene, r, 0.001, INFINITY, &rec);
+    if (touched) {
+        if (touched->first_hit == FOOTPRINT_UNSET) {
+            touched->first_hit = hit ? rec.object : FOOTPRINT_SKY;
+        }
+        if (hit) footprint_add(touched, rec.object);
+    }
+    if (!hit) {
+        if (path == PATH_CAUSTIC && settings->caustics) return vec3(0.0, 0.0, 0.0);
+        vec3_t background = scene_background(scene, r);
+        if (scene->environment && pdf > 0.0) {
+            double light_pdf = envmap_pdf(scene->environment, r.direction);
+            background = vec3_mul(background, pdf * pdf / (pdf * pdf + light_pdf * light_pdf));
+        }
+        return background;
+    }
+    const material_t *mat = rec.material;
+    if (mat && mat->emission) {
+        int light = scene->lights && pdf > 0.0 ? light_tree_light_of(scene->lights, rec.object)
+                                               : -1;
+        if (light < 0) return *mat->emission;
+        if (touched) footprint_add(touched, FOOTPRINT_LIGHTS);
+        double light_pdf = light_tree_pmf(scene->lights, r.origin, normal, light) *
+                           light_direction_pdf(&scene->lights->lights[light], r.origin);
+        return vec3_mul(*mat->emission, pdf * pdf / (pdf * pdf + light_pdf * light_pdf));
+    }
+    if (!mat || !mat->scatter) {
+        return vec3(0.0, 0.0, 0.0);
+    }
+
+    if (!mat->diffuse) {
+        ray_t scattered = {0};
+        vec3_t attenuation = {0};
+        if (!mat->scatter(mat->data, r, &rec, &attenuation, &scattered)) {
+            return vec3(0.0, 0.0, 0.0);
+        }
+        vec3_t color = ray_color_passes(scattered, scene, depth - 1, settings,
+                                        path == PATH_CAMERA ? PATH_CAMERA : PATH_CAUSTIC, 0.0,
+                                        rec.normal, touched);
+        return vec3(attenuation.e[0] * color.e[0], attenuation.e[1] * color.e[1],
+                    attenuation.e[2] * color.e[2]);
+    }
+
+    /* Lambertian reflection of the caustic irradiance, plus one bounce */
+    const vec3_t *albedo = mat->diffuse;
+    vec3_t arriving = vec3(0.0, 0.0, 0.0);
+    if (settings->caustics) {
+        arriving = vec3_mul(photon_map_irradiance(settings->caustics, rec.point), 1.0 / PI);
+    }
+
+    guide_t *guide = settings->guide;
+    if (!guide) {
+        if (scene->environment && depth > 1) {
+            arriving = vec3_add(arriving, environment_light(scene, &rec, r.time, NULL, 0.0));
+        }
+        if (scene->lights && depth > 1) {
+            arriving = vec3_add(arriving, sphere_light(scene, &rec, r.time, NULL, 0.0, touched));
+        }
+        ray_t scattered = {0};
+        vec3_t attenuation = {0};
+        if (mat->scatter(mat->data, r, &rec, &attenuation, &scattered)) {
+            double bounce_pdf = 0.0;
+            if (scene->environment || scene->lights) {
+                vec3_t direction = vec3_normalize(scattered.direction);
+                bounce_pdf = fmax(vec3_dot(direction, rec.normal), 0.0) / PI;
+            }
+            arriving = vec3_add(arriving,
+                                ray_color_passes(scattered, scene, depth - 1, settings,
+                                                 PATH_DIFFUSE, bounce_pdf, rec.normal, touched));
+        }
+        return vec3(albedo->e[0] * arriving.e[0], albedo->e[1] * arriving.e[1],
+                    albedo->e[2] * arriving.e[2]);
+    }
+
+    guide_cell_t *cell = guide_lookup(guide, rec.point, rec.normal);
+    double fraction = cell->trained ? GUIDE_FRACTION : 0.0;
+    if (scene->environment && depth > 1) {
+        arriving = vec3_add(arriving, environment_light(scene, &rec, r.time, cell, fraction));
+    }
+    if (scene->lights && depth > 1) {
+        arriving = vec3_add(arriving,
+                            sphere_light(scene, &rec, r.time, cell, fraction, touched));
+    }
+    vec3_t direction;
+    if (random_double() < fraction) {
+        direction = guide_sample(cell);
+    } else {
+        direction = vec3_add(rec.normal, random_unit_vector());
+        double length = vec3_length(direction);
+        direction = length > 1e-4 ? vec3_div(direction, length) : rec.normal;
+    }
+    double cosine = vec3_dot(direction, rec.normal);
+    if (cosine > 0.0) {
+        double pdf = (1.0 - fraction) * cosine / PI;
+        if (fraction > 0.0) pdf += fraction * guide_pdf(cell, direction);
+
+        vec3_t incoming = ray_color_passes(ray_timed(rec.point, direction, r.time), scene,
+                                           depth - 1, settings, PATH_DIFFUSE, pdf, rec.normal,
+                                           touched);
+        guide_record(cell, direction, luminance(incoming) / pdf);
+        arriving = vec3_add(arriving, vec3_mul(incoming, cosine / (PI * pdf)));
+    }
+    /* (directions guided below the surface bring nothing) */
+    return vec3(albedo->e[0] * arriving.e[0], albedo->e[1] * arriving.e[1],
+                albedo->e[2] * arriving.e[2]);
+}
+
+/* Signature of the scene's light tree, for footprints; 0 without one */
+static uint64_t light_signature(const scene_t *scene) {
+    return scene->lights ? scene->lights->signature : 0;
+}
+
+/* Start the random stream of sample s of pixel (x, y) and return its camera ray */
+static ray_t camera_sample(const camera_t *camera, const render_settings_t *settings,
+                           int x, int y, int s) {
+    int width = settings->width;
+    int height = settings->height;
+    int j = height - 1 - y;
+    uint64_t pixel = (uint64_t)y * width + x;
+
+    random_seed(sample_seed(settings->seed, pixel, s));
+    double u = (x + random_double()) / (width - 1);
+    double v = (j + random_double()) / (height - 1);
+    return camera_get_ray(camera, u, v);
+}
+
+/* Add samples [s0, s1) of pixel (x, y) to acc */
+void render_pixel(const scene_t *scene, const camera_t *camera,
+                  const render_settings_t *settings, int x, int y, int s0, int s1,
+                  accum_pixel_t *acc) {
+    footprint_pixel_t *touched = NULL;
+    if (settings->footprint) {
+        touched = &settings->footprint->pixels[(size_t)y * settings->footprint->width + x];
+        if (s0 == 0) footprint_pixel_reset(touched);
+    }
+
+    /* Multiple samples per pixel for antialiasing */
+    for (int s = s0; s < s1; s++) {
+        ray_t r = camera_sample(camera, settings, x, y, s);
+        vec3_t color = settings->guide || settings->caustics || touched ||
+                               scene->environment || scene->lights
+                           ? ray_color_passes(r, scene, settings->max_depth, settings,
+                                              PATH_CAMERA, 0.0, vec3(0.0, 0.0, 0.0), touched)
+                           : ray_color(r, scene, settings->max_depth);
+        acc->sum[0] += to_fixed(color.e[0]);
+        acc->sum[1] += to_fixed(color.e[1]);
+        acc->sum[2] += to_fixed(color.e[2]);
+    }
+    acc->samples += (uint32_t)(s1 - s0);
+}
+
+/* Batched mode: a batch traces all samples of a run of pixels one bounce at a
+ * time. Each path carries its own suspended random stream, so the order in
+ * which paths are traced (and thus sorting) does not change the result. */
+typedef struct {
+    ray_t ray;
+    vec3_t throughput;
+    vec3_t color;
+    unsigned int rng;
+} path_state_t;
+
+typedef struct {
+    path_state_t *paths;
+    uint32_t *active;
+    uint32_t *tmp_active;
+    uint64_t *keys;
+    uint64_t *tmp_keys;
+} batch_buffers_t;
+
+/* Allocate buffers for capacity paths; returns 0 on success */
+static int batch_buffers_create(batch_buffers_t *buf, int capacity) {
+    buf->paths = malloc(capacity * sizeof(path_state_t));
+    buf->active = malloc(capacity * sizeof(uint32_t));
+    buf->tmp_active = malloc(capacity * sizeof(uint32_t));
+    buf->keys = malloc(capacity * sizeof(uint64_t));
+    buf->tmp_keys = malloc(capacity * sizeof(uint64_t));
+    return buf->paths && buf->active && buf->tmp_active && buf->keys && buf->tmp_keys
+               ? 0
+               : -1;
+}
+
+static void batch_buffers_destroy(batch_buffers_t *buf) {
+    free(buf->paths);
+    free(buf->active);
+    free(buf->tmp_active);
+    free(buf->keys);
+    free(buf->tmp_keys);
+}
+
+/* Reorder the active paths by ray coherence key */
+static void sort_active(batch_buffers_t *buf, int active) {
+    aabb_t bounds = aabb_empty();
+    for (int k = 0; k < active; k++) {
+        bounds = aabb_extend(bounds, buf->paths[buf->active[k]].ray.origin);
+    }
+    for (int k = 0; k < active; k++) {
+        buf->keys[k] = ray_sort_key(&buf->paths[buf->active[k]].ray, &bounds);
+    }
+    ray_sort(buf->keys, buf->active, active, buf->tmp_keys, buf->tmp_active);
+}
+
+/* Trace one bounce of a path; returns 1 if it continues */
+static int trace_bounce(const scene_t *scene, path_state_t *p) {
+    hit_record_t rec = {0};
+    int alive = 0;
+
+    random_restore(p->rng);
+    if (scene_hit(scene, p->ray, 0.001, INFINITY, &rec)) {
+        ray_t scattered = {0};
+        vec3_t attenuation = {0};
+        if (rec.material && rec.material->emission) {
+            const vec3_t *e = rec.material->emission;
+            p->color = vec3(p->throughput.e[0] * e->e[0], p->throughput.e[1] * e->e[1],
+                            p->throughput.e[2] * e->e[2]);
+        } else if (rec.material && rec.material->scatter &&
+            rec.material->scatter(rec.material->data, p->ray, &rec, &attenuation,
+                                  &scattered)) {
+            p->throughput = vec3(p->throughput.e[0] * attenuation.e[0],
+                                 p->throughput.e[1] * attenuation.e[1],
+                                 p->throughput.e[2] * attenuation.e[2]);
+            p->ray = scattered;
+            alive = 1;
+        }
+    } else {
+        vec3_t sky = scene_background(scene, p->ray);
+        p->color = vec3(p->throughput.e[0] * sky.e[0], p->throughput.e[1] * sky.e[1],
+                        p->throughput.e[2] * sky.e[2]);
+    }
+    p->rng = random_state();
+    return alive;
+}
+
+/* Trace samples [s0, s1) of rect pixels [first, first + count) as one batch */
+static void trace_batch(const scene_t *scene, const camera_t *camera,
+                        const render_settings_t *settings, render_rect_t rect,
+                        int first, int count, int s0, int s1, batch_buffers_t *buf,
+                        accum_t *out) {
+    int rect_width = rect.x1 - rect.x0;
+    int n = 0;
+    for (int i = first; i < first + count; i++) {
+        int x = rect.x0 + i % rect_width;
+        int y = rect.y0 + i / rect_width;
+        for (int s = s0; s < s1; s++) {
+            path_state_t *p = &buf->paths[n];
+            p->ray = camera_sample(camera, settings, x, y, s);
+            p->throughput = vec3(1.0, 1.0, 1.0);
+            p->color = vec3(0.0, 0.0, 0.0);
+            p->rng = random_state();
+            buf->active[n] = (uint32_t)n;
+            n++;
+        }
+    }
+
+    /* Primary rays are coherent in pixel order; sorting starts at the first
+     * bounce. Paths still alive after max_depth bounces contribute black. */
+    int active = n;
+    for (int depth = settings->max_depth; depth > 0 && active > 0; depth--) {
+        if (settings->sort_rays && depth < settings->max_depth && active > 1) {
+            sort_active(buf, active);
+        }
+        int alive = 0;
+        for (int k = 0; k < active; k++) {
+            uint32_t id = buf->active[k];
+            if (trace_bounce(scene, &buf->paths[id])) buf->active[alive++] = id;
+        }
+        active = alive;
+    }
+
+    int spp = s1 - s0;
+    for (int i = 0; i < count; i++) {
+        int x = (first + i) % rect_width;
+        int y = (first + i) / rect_width;
+        accum_pixel_t *acc = &out->pixels[(size_t)y * out->width + x];
+        for (int s = 0; s < spp; s++) {
+            const vec3_t *color = &buf->paths[i * spp + s].color;
+            acc->sum[0] += to_fixed(color->e[0]);
+            acc->sum[1] += to_fixed(color->e[1]);
+            acc->sum[2] += to_fixed(color->e[2]);
+        }
+        acc->samples += (uint32_t)spp;
+    }
+}
+
+/* Size of the render team */
+static int team_size(const render_settings_t *settings) {
+    return settings->threads > 0 ? settings->threads : omp_get_max_threads();
+}
+
+/* The calling thread's NUMA-local copy of the scene, if there is one */
+static const scene_t *local_scene(const scene_t *scene, const render_settings_t *settings) {
+    if (!settings->replicas) return scene;
+    const scene_t *replica = settings->replicas[affinity_thread_node()];
+    return replica ? replica : scene;
+}
+
+/* Render rect in batches of whole pixels so no two threads share a pixel */
+static int render_region_batched(const scene_t *scene, const camera_t *camera,
+                                 const render_settings_t *settings, render_rect_t rect,
+                                 int s0, int s1, accum_t *out) {
+    int rect_width = rect.x1 - rect.x0;
+    int pixel_count = rect_width * (rect.y1 - rect.y0);
+    int spp = s1 - s0;
+    int batch_pixels = settings->batch_size / spp > 0 ? settings->batch_size / spp : 1;
+    int batches = (pixel_count + batch_pixels - 1) / batch_pixels;
+    atomic_int *cancel = settings->cancel;
+
+    #if USE_OPENMP
+    #pragma omp parallel num_threads(team_size(settings))
+    #endif
+    {
+        const scene_t *local = local_scene(scene, settings);
+        batch_buffers_t buf;
+        int ok = batch_buffers_create(&buf, batch_pixels * spp) == 0;
+
+        #if USE_OPENMP
+        #pragma omp for schedule(dynamic, 1)
+        #endif
+        for (int b = 0; b < batches; b++) {
+            if (cancel && atomic_load_explicit(cancel, memory_order_relaxed)) continue;
+
+            int first = b * batch_pixels;
+            int count = pixel_count - first < batch_pixels ? pixel_count - first : batch_pixels;
+            if (ok) {
+                trace_batch(local, camera, settings, rect, first, count, s0, s1, &buf, out);
+                continue;
+            }
+            /* Without buffers fall back to tracing pixel by pixel */
+            for (int i = first; i < first + count; i++) {
+                int x = rect.x0 + i % rect_width;
+                int y = rect.y0 + i / rect_width;
+                render_pixel(local, camera, settings, x, y, s0, s1,
+                             &out->pixels[(size_t)(y - rect.y0) * out->width + (x - rect.x0)]);
+            }
+        }
+        batch_buffers_destroy(&buf);
+    }
+
+    return cancel && atomic_load(cancel) ? -1 : 0;
+}
+
+/* Render samples [s0, s1) of every pixel of rect into out */
+int render_region(const scene_t *scene, const camera_t *camera,
+                  const render_settings_t *settings, render_rect_t rect,
+                  int s0, int s1, accum_t *out) {
+    int rect_width = rect.x1 - rect.x0;
+    int rect_height = rect.y1 - rect.y0;
+    if (rect_width <= 0 || rect_height <= 0 || s1 <= s0) return 0;
+    if (settings->batch_size > 0 && !settings->guide && !settings->caustics &&
+        !settings->footprint && !scene->environment && !scene->lights) {
+        return render_region_batched(scene, camera, settings, rect, s0, s1, out);
+    }
+
+    atomic_int *cancel = settings->cancel;
+    int chunk = settings->chunk_size > 0 ? settings->chunk_size : RENDER_CHUNK_DEFAULT;
+    if (settings->footprint) settings->footprint->lights = light_signature(scene);
+
+    #if USE_OPENMP
+    #pragma omp parallel for num_threads(team_size(settings)) schedule(dynamic, chunk)
+    #endif
+    for (int idx = 0; idx < rect_width * rect_height; idx++) {
+        if (cancel && atomic_load_explicit(cancel, memory_order_relaxed)) continue;
+
+        int x = rect.x0 + idx % rect_width;
+        int y = rect.y0 + idx / rect_width;
+        render_pixel(local_scene(scene, settings), camera, settings, x, y, s0, s1,
+                     &out->pixels[(size_t)(y - rect.y0) * out->width + (x - rect.x0)]);
+    }
+
+    return cancel && atomic_load(cancel) ? -1 : 0;
+}
+
+/* Re-render the pixels an edit of the objects may have changed */
+int render_edit(const scene_t *scene, const camera_t *camera,
+                const render_settings_t *settings, const int *objects, int count,
+                accum_t *out) {
+    int width = settings->width;
+    int height = settings->height;
+    const footprint_t *footprint = settings->footprint;
+    if (!footprint || footprint->width != width || footprint->height != height ||
+        out->width != width || out->height != height) {
+        return -1;
+    }
+    for (int k = 0; k < count; k++) {
+        if (objects[k] < 0 || objects[k] >= scene->world->count) return -1;
+    }
+
+    size_t pixel_count = (size_t)width * height;
+    unsigned char *mask = calloc(pixel_count, 1);
+    aabb_t *boxes = malloc((count + 1) * sizeof(aabb_t));
+    int *bounded = malloc((count + 1) * sizeof(int));
+    int *marked = malloc(pixel_count * sizeof(int));
+    if (!mask || !boxes || !bounded || !marked) {
+        free(mask);
+        free(boxes);
+        free(bounded);
+        free(marked);
+        return -1;
+    }
+    footprint_mark(footprint, objects, count, mask);
+    int lights = FOOTPRINT_LIGHTS;
+    uint64_t signature = light_signature(scene);
+    if (footprint->lights != signature) footprint_mark(footprint, &lights, 1, mask);
+
+    /* Objects may now be seen where they were not: test every camera ray
+     * of the remaining pixels against their new bounds */
+    for (int k = 0; k < count; k++) {
+        const hittable_t *object = &scene->world->objects[objects[k]];
+        bounded[k] = object->bounding_box && object->bounding_box(object->data, &boxes[k]);
+    }
+    #if USE_OPENMP
+    #pragma omp parallel for num_threads(team_size(settings)) schedule(dynamic, 100)
+    #endif
+    for (int idx = 0; idx < (int)pixel_count; idx++) {
+        for (int s = 0; s < settings->samples_per_pixel && !mask[idx]; s++) {
+            ray_t r = camera_sample(camera, settings, idx % width, idx / width, s);
+            vec3_t inv_dir = vec3(1.0 / r.direction.e[0], 1.0 / r.direction.e[1],
+                                  1.0 / r.direction.e[2]);
+            for (int k = 0; k < count; k++) {
+                if (!bounded[k] || aabb_hit(&boxes[k], r.origin, inv_dir, 0.001, INFINITY)) {
+                    mask[idx] = 1;
+                }
+            }
+        }
+    }
+
+    int marked_count = 0;
+    for (size_t i = 0; i < pixel_count; i++) {
+        if (mask[i]) marked[marked_count++] = (int)i;
+    }
+    atomic_int *cancel = settings->cancel;
+
+    #if USE_OPENMP
+    #pragma omp parallel for num_threads(team_size(settings)) schedule(dynamic, 16)
+    #endif
+    for (int m = 0; m < marked_count; m++) {
+        if (cancel && atomic_load_explicit(cancel, memory_order_relaxed)) continue;
+
+        accum_pixel_t *acc = &out->pixels[marked[m]];
+        memset(acc, 0, sizeof(*acc));
+        render_pixel(local_scene(scene, settings), camera, settings, marked[m] % width,
+                     marked[m] / width, 0, settings->samples_per_pixel, acc);
+    }
+
+    free(mask);
+    free(boxes);
+    free(bounded);
+    free(marked);
+    if (cancel && atomic_load(cancel)) return -1;
+    settings->footprint->lights = signature;
+    return marked_count;
+}
+
+/* Render rect in progressive passes with a guide and caustic photon maps */
+int render_progressive(const scene_t *scene, const camera_t *camera,
+                       const render_settings_t *settings, render_rect_t rect, int guiding,
+                       int photons, accum_t *out) {
+    render_settings_t passes = *settings;
+    passes.guide = NULL;
+    passes.caustics = NULL;
+    if (guiding) {
+        aabb_t bounds;
+        int bounded = scene->bvh ? bvh_bounding_box(scene->bvh, &bounds)
+                                 : hittable_list_bounding_box(scene->world, &bounds);
+        if (!bounded) {
+            bounds = (aabb_t){vec3(-1e4, -1e4, -1e4), vec3(1e4, 1e4, 1e4)};
+        }
+        passes.guide = guide_create(bounds);
+        if (!passes.guide) return -1;
+    }
+    double radius = photon_initial_radius(scene);
+    if (radius <= 0.0) photons = 0; /* nothing makes caustics */
+
+    /* The guide learns after 1, 2, 4, ... samples per pixel; fresh photons
+     * come with every CAUSTIC_PASS_SPP samples */
+    int status = 0, learn_at = 1, pass = 0;
+    for (int s0 = 0; s0 < settings->samples_per_pixel && status == 0; pass++) {
+        int s1 = guiding ? learn_at : settings->samples_per_pixel;
+        if (photons > 0 && s1 > s0 + CAUSTIC_PASS_SPP) s1 = s0 + CAUSTIC_PASS_SPP;
+        if (s1 > settings->samples_per_pixel) s1 = settings->samples_per_pixel;
+
+        photon_map_t *map = NULL;
+        if (photons > 0) {
+            map = photon_map_build(scene, photons, photon_pass_radius(radius, pass),
+                                   sample_seed(settings->seed, 0, pass), settings->max_depth);
+            if (!map) {
+                status = -1;
+                break;
+            }
+        }
+        passes.caustics = map;
+        status = render_region(scene, camera, &passes, rect, s0, s1, out);
+        photon_map_destroy(map);
+
+        if (guiding && s1 == learn_at && s1 < settings->samples_per_pixel) {
+            guide_update(passes.guide);
+            learn_at = 2 * learn_at + 1;
+        }
+        s0 = s1;
+    }
+    guide_destroy(passes.guide);
+    return status;
+}
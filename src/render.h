@@ -0,0 +1,146 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "camera.h"
+#include "footprint.h"
+#include "guide.h"
+#include "photon.h"
+#include "ray.h"
+#include "scene.h"
+#include "vec3.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* Accumulated radiance is stored in fixed point. Integer sums are associative,
+ * so buffers rendered over any split of tiles or sample ranges merge into
+ * exactly the same result as a single render. */
+#define ACCUM_FRACTION_BITS 24
+#define ACCUM_MAX_SAMPLE 1e6 /* per-sample clamp, keeps sums far from overflow */
+
+/* Per-pixel accumulation: fixed-point radiance sum and sample count */
+typedef struct {
+    uint64_t sum[3];
+    uint32_t samples;
+    uint32_t reserved;
+} accum_pixel_t;
+
+/* Accumulation buffer; row 0 is the top of the image */
+typedef struct {
+    int width;
+    int height;
+    accum_pixel_t *pixels;
+} accum_t;
+
+/* Pixels per chunk handed to a render thread unless settings say otherwise */
+#define RENDER_CHUNK_DEFAULT 100
+
+/* Frame-wide render parameters */
+typedef struct {
+    int width;
+    int height;
+    int samples_per_pixel;
+    int max_depth;
+    int threads;       /* render threads, 0: the OpenMP default */
+    unsigned int seed; /* base of the per-pixel, per-sample random streams */
+    atomic_int *cancel; /* optional: rendering stops once *cancel is non-zero */
+    int batch_size;     /* > 0: trace about this many paths together, one bounce
+                         * at a time (same image up to rounding); 0: depth first */
+    int sort_rays;      /* batched mode: sort secondary rays for coherence */
+    int chunk_size;     /* depth-first mode: pixels per dynamically scheduled
+                         * chunk, 0: RENDER_CHUNK_DEFAULT (see autotune.h) */
+    const scene_t *const *replicas; /* optional: identical copies of the scene
+                                     * per NUMA node; each thread reads the copy
+                                     * of its node (see affinity.h) */
+    guide_t *guide;     /* optional: sample diffuse bounces from this path guide
+                         * and record into it (depth-first mode only) */
+    const photon_map_t *caustics; /* optional: take caustics from these photons
+                                   * (depth-first mode only) */
+    footprint_t *footprint; /* optional: record which objects the paths of each
+                             * pixel hit, for render_edit; frame sized
+                             * (depth-first mode only) */
+} render_settings_t;
+
+/* Pixel rectangle [x0, x1) x [y0, y1) in image coordinates */
+typedef struct {
+    int x0, y0;
+    int x1, y1;
+} render_rect_t;
+
+/* Create a zeroed accumulation buffer; returns NULL on allocation failure.
+ * Large buffers are zeroed by the OpenMP threads in row blocks, so their
+ * pages are first touched by the threads that render into them. */
+accum_t *accum_create(int width, int height);
+
+/* Reset every pixel to zero samples */
+void accum_clear(accum_t *accum);
+
+/* Add src into dst with src's top-left pixel at (x, y) of dst. Exact. */
+void accum_merge(accum_t *dst, const accum_t *src, int x, int y);
+
+/* Mean radiance of an accumulated pixel (black if it has no samples) */
+vec3_t accum_pixel_mean(const accum_pixel_t *pixel);
+
+/* Free an accumulation buffer */
+void accum_destroy(accum_t *accum);
+
+/* Radiance along a ray, following up to depth bounces */
+vec3_t ray_color(const ray_t r, const scene_t *scene, int depth);
+
+/* Radiance of the sky seen along r */
+vec3_t sky_color(const ray_t r);
+
+/* What a ray that escapes the scene sees: its environment map, or else the
+ * sky gradient */
+vec3_t scene_background(const scene_t *scene, const ray_t r);
+
+/* Seed of the random stream of sample s of pixel p, for base seed base */
+unsigned int sample_seed(unsigned int base, uint64_t pixel, int sample);
+
+/* Add samples [s0, s1) of pixel (x, y) to acc. Each sample draws from its own
+ * random stream derived from (seed, pixel, sample index), so the result does
+ * not depend on how the frame is split or which thread renders it. */
+void render_pixel(const scene_t *scene, const camera_t *camera,
+                  const render_settings_t *settings, int x, int y, int s0, int s1,
+                  accum_pixel_t *acc);
+
+/* Render samples [s0, s1) of every pixel of rect into out, whose top-left pixel
+ * corresponds to (rect.x0, rect.y0). Returns 0 when done, -1 if cancelled
+ * (pixels skipped after cancellation keep their previous contents). */
+int render_region(const scene_t *scene, const camera_t *camera,
+                  const render_settings_t *settings, render_rect_t rect,
+                  int s0, int s1, accum_t *out);
+
+/* Bring a frame rendered with render_region (out, all of settings'
+ * samples, footprints recorded into settings->footprint) up to date after
+ * the count top-level objects (indices into scene->world) were edited in
+ * place and any BVH refit (and the scene finalized again if the edit changed
+ * its lights). Re-renders from scratch the pixels whose paths may have hit an
+ * edited object, those whose camera rays reach its new bounds, and, when the
+ * lights changed, those that sampled the light tree, updating their
+ * footprints; every other pixel is kept. A material
+ * edit gives exactly the frame a full re-render would. A moved object can
+ * also cast new shadows and reflections onto pixels whose paths never hit
+ * it, which are kept as they were. Returns the number of pixels re-rendered,
+ * or -1 if cancelled, out of memory, or an index is out of range. */
+int render_edit(const scene_t *scene, const camera_t *camera,
+                const render_settings_t *settings, const int *objects, int count,
+                accum_t *out);
+
+/* Samples per pixel rendered with one caustic photon map */
+#define CAUSTIC_PASS_SPP 4
+
+/* Render samples [0, settings->samples_per_pixel) of rect in progressive
+ * passes. With guiding, a path guide learns from what arrives at diffuse
+ * hits after 1, 2, 4, ... samples per pixel and the later samples are drawn
+ * from it. With photons > 0, every CAUSTIC_PASS_SPP samples get a fresh map
+ * of that many emitted caustic photons, gathered with a radius that shrinks
+ * pass by pass (progressive photon mapping), in place of the noisy caustic
+ * paths. The guide is trained on rect alone, so unlike plain renders a
+ * guided crop differs from the same pixels of a full frame; the result is
+ * independent of the thread count. Returns 0 when done, -1 if cancelled or
+ * out of memory. */
+int render_progressive(const scene_t *scene, const camera_t *camera,
+                       const render_settings_t *settings, render_rect_t rect, int guiding,
+                       int photons, accum_t *out);
+
+#endif /* RENDER_H */
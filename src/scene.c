@@ -0,0 +1,669 @@
+#include "scene.h"
+#include "instance.h"
+#include "mesh.h"
+#include "render.h"
+#include "sphere.h"
+#include <math.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define USE_OPENMP 1
+
+#define INITIAL_MATERIAL_CAPACITY 16
+#define OBJECT_ARENA_BYTES 128 /* a sphere, a material of its own and padding */
+
+/* Create an empty scene with the showcase camera placement */
+scene_t *scene_create(void) {
+    scene_t *scene = calloc(1, sizeof(scene_t));
+    if (!scene) return NULL;
+
+    scene->world = hittable_list_create();
+    scene->shared = hittable_list_create();
+    scene->arena = arena_create(0);
+    if (!scene->world || !scene->shared || !scene->arena) {
+        hittable_list_destroy(scene->world);
+        hittable_list_destroy(scene->shared);
+        arena_destroy(scene->arena);
+        free(scene);
+        return NULL;
+    }
+
+    scene->lookfrom = vec3(13.0, 2.0, 3.0);
+    scene->lookat = vec3(0.0, 0.0, 0.0);
+    scene->vup = vec3(0.0, 1.0, 0.0);
+    scene->vfov = 20.0;
+    scene->aperture = 0.1;
+    scene->focus_dist = 10.0;
+    return scene;
+}
+
+/* Make room for objects more spheres with materials of their own */
+int scene_reserve(scene_t *scene, int objects) {
+    if (hittable_list_reserve(scene->world, scene->world->count + objects) != 0) return -1;
+    return arena_reserve(scene->arena, (size_t)objects * OBJECT_ARENA_BYTES);
+}
+
+/* Take ownership of a material */
+const material_t *scene_add_material(scene_t *scene, material_t material) {
+    if (!scene || !material.data) return NULL;
+
+    /* The material lives in the arena, so pointers survive later additions;
+     * only materials with parameters of their own to free are recorded */
+    material_t *stored = arena_alloc(scene->arena, sizeof(material_t), _Alignof(material_t));
+    if (!stored) {
+        if (material.destroy) material.destroy(material.data);
+        return NULL;
+    }
+    *stored = material;
+    if (!material.destroy) return stored;
+
+    if (scene->material_count >= scene->material_capacity) {
+        int capacity = scene->material_capacity ? scene->material_capacity * 2
+                                                : INITIAL_MATERIAL_CAPACITY;
+        material_t **materials =
+            realloc(scene->materials, capacity * sizeof(material_t *));
+        if (!materials) {
+            material.destroy(material.data);
+            return NULL;
+        }
+        scene->materials = materials;
+        scene->material_capacity = capacity;
+    }
+    scene->materials[scene->material_count++] = stored;
+    return stored;
+}
+
+/* Add an object made of mat to the world, noting its bounds if mat is
+ * specular (neither diffuse nor a light) */
+static void add_object(scene_t *scene, hittable_t object, const material_t *mat) {
+    hittable_list_add(scene->world, object);
+
+    aabb_t box;
+    if (mat->diffuse || mat->emission || !object.bounding_box ||
+        !object.bounding_box(object.data, &box)) {
+        return;
+    }
+    if (scene->specular_count == scene->specular_capacity) {
+        int capacity = scene->specular_capacity ? scene->specular_capacity * 2 : 16;
+        aabb_t *specular = realloc(scene->specular, capacity * sizeof(aabb_t));
+        if (!specular) return;
+        scene->specular = specular;
+        scene->specular_capacity = capacity;
+    }
+    scene->specular[scene->specular_count++] = box;
+}
+
+/* Add a sphere with the given material to the world */
+static void add_sphere(scene_t *scene, vec3_t center, double radius,
+                       material_t material) {
+    const material_t *mat = scene_add_material(scene, material);
+    if (!mat) return;
+
+    hittable_t sphere = sphere_hittable_in(scene->arena, center, radius, mat);
+    if (sphere.data) add_object(scene, sphere, mat);
+}
+
+/* Hops of the bouncing scene: a looping path from the ground to the top of a
+ * hop and back, BOUNCE_HALF_PERIOD frames each way */
+#define BOUNCE_HALF_PERIOD 4.0
+#define BOUNCE_KEYS 3
+
+/* Add a small sphere hopping in place with a random height and phase */
+static void add_bouncing_sphere(scene_t *scene, vec3_t center, double radius,
+                                material_t material) {
+    const material_t *mat = scene_add_material(scene, material);
+    if (!mat) return;
+
+    double height = random_double_range(0.3, 1.0);
+    double phase = random_double();
+    double times[BOUNCE_KEYS];
+    vec3_t points[BOUNCE_KEYS];
+    for (int k = 0; k < BOUNCE_KEYS; k++) {
+        times[k] = BOUNCE_HALF_PERIOD * (k - 1 + phase);
+        points[k] = k % 2 ? vec3_add(center, vec3(0.0, height, 0.0)) : center;
+    }
+    path_t *path = path_create_loop(times, points, BOUNCE_KEYS);
+    moving_sphere_t *sphere =
+        path ? moving_sphere_create(path, radius, mat, &scene->shutter) : NULL;
+    if (sphere) {
+        hittable_list_add(scene->world, moving_sphere_to_hittable(sphere));
+    }
+}
+
+/* Fill a scene with the showcase layout; animated makes the small diffuse
+ * spheres bounce */
+static scene_t *create_showcase(unsigned int seed, int animated) {
+    scene_t *scene = scene_create();
+    if (!scene || scene_reserve(scene, 22 * 22 + 4) != 0) {
+        scene_destroy(scene);
+        return NULL;
+    }
+
+    random_seed(seed);
+
+    add_sphere(scene, vec3(0.0, -1000.0, 0.0), 1000.0,
+               lambertian_create_in(scene->arena, vec3(0.5, 0.5, 0.5)));
+
+    /* Generate random scene with many spheres */
+    for (int a = -11; a < 11; a++) {
+        for (int b = -11; b < 11; b++) {
+            double choose_mat = random_double();
+            vec3_t center = vec3(a + 0.9 * random_double(), 0.2,
+                                b + 0.9 * random_double());
+
+            if (vec3_length(vec3_sub(center, vec3(4.0, 0.2, 0.0))) > 0.9) {
+                material_t mat = {0};
+
+                if (choose_mat < 0.8) {
+                    /* Diffuse sphere */
+                    vec3_t albedo = vec3(random_double() * random_double(),
+                                        random_double() * random_double(),
+                                        random_double() * random_double());
+                    mat = lambertian_create_in(scene->arena, albedo);
+                    if (animated) {
+                        add_bouncing_sphere(scene, center, 0.2, mat);
+                        continue;
+                    }
+                } else if (choose_mat < 0.95) {
+                    /* Metal sphere */
+                    vec3_t albedo = vec3(0.5 * (1.0 + random_double()),
+                                        0.5 * (1.0 + random_double()),
+                                        0.5 * (1.0 + random_double()));
+                    double fuzz = 0.5 * random_double();
+                    mat = metal_create_in(scene->arena, albedo, fuzz);
+                } else {
+                    /* Glass sphere */
+                    mat = dielectric_create_in(scene->arena, 1.5);
+                }
+
+                add_sphere(scene, center, 0.2, mat);
+            }
+        }
+    }
+
+    /* Three main spheres */
+    add_sphere(scene, vec3(-4.0, 1.0, 0.0), 1.0,
+               lambertian_create_in(scene->arena, vec3(0.4, 0.2, 0.1)));
+    add_sphere(scene, vec3(0.0, 1.0, 0.0), 1.0, dielectric_create_in(scene->arena, 1.5));
+    add_sphere(scene, vec3(4.0, 1.0, 0.0), 1.0,
+               metal_create_in(scene->arena, vec3(0.7, 0.6, 0.5), 0.0));
+
+    if (scene_finalize(scene) != 0) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    return scene;
+}
+
+/* Build the showcase scene */
+scene_t *scene_create_random(unsigned int seed) {
+    return create_showcase(seed, 0);
+}
+
+/* Build the showcase scene with bouncing spheres */
+scene_t *scene_create_bouncing(unsigned int seed) {
+    return create_showcase(seed, 1);
+}
+
+/* Wrap a list in a BVH owned by the scene; returns a hittable for the BVH */
+static int share_bvh(scene_t *scene, hittable_list_t *list, hittable_t *out) {
+    scene_own(scene, hittable_list_to_hittable(list));
+    bvh_t *bvh = bvh_create(list->objects, list->count);
+    if (!bvh) return -1;
+    *out = bvh_to_hittable(bvh);
+    scene_own(scene, *out);
+    return 0;
+}
+
+/* Trees in a grove, groves per side of the forest, spheres in a canopy */
+#define FOREST_GROVE_TREES 24
+#define FOREST_GROVES 48
+#define FOREST_CANOPY 40
+#define FOREST_GROVE_SPACING 4.0
+
+/* Build the instanced forest scene */
+scene_t *scene_create_forest(unsigned int seed) {
+    scene_t *scene = scene_create();
+    if (!scene) return NULL;
+
+    random_seed(seed);
+    scene->lookfrom = vec3(0.0, 14.0, 110.0);
+    scene->lookat = vec3(0.0, 0.0, 60.0);
+    scene->vfov = 50.0;
+    scene->aperture = 0.0;
+    scene->focus_dist = 50.0;
+
+    add_sphere(scene, vec3(0.0, -1000.0, 0.0), 1000.0,
+               lambertian_create_in(scene->arena, vec3(0.45, 0.4, 0.3)));
+
+    /* Level 0: one tree, a trunk of stacked spheres under a canopy blob */
+    const material_t *bark = scene_add_material(
+        scene, lambertian_create_in(scene->arena, vec3(0.3, 0.2, 0.1)));
+    const material_t *leaves = scene_add_material(
+        scene, lambertian_create_in(scene->arena, vec3(0.1, 0.4, 0.1)));
+    hittable_list_t *tree = hittable_list_create();
+    if (!bark || !leaves || !tree) {
+        hittable_list_destroy(tree);
+        scene_destroy(scene);
+        return NULL;
+    }
+    for (int i = 0; i < 6; i++) {
+        hittable_t s = sphere_hittable_in(scene->arena, vec3(0.0, 0.1 + 0.15 * i, 0.0), 0.09,
+                                          bark);
+        if (s.data) hittable_list_add(tree, s);
+    }
+    for (int i = 0; i < FOREST_CANOPY; i++) {
+        vec3_t offset = vec3_mul(random_in_unit_sphere(), 0.45);
+        hittable_t s = sphere_hittable_in(scene->arena, vec3_add(vec3(0.0, 1.2, 0.0), offset),
+                                          0.14, leaves);
+        if (s.data) hittable_list_add(tree, s);
+    }
+    hittable_t tree_bvh;
+    if (share_bvh(scene, tree, &tree_bvh) != 0) {
+        scene_destroy(scene);
+        return NULL;
+    }
+
+    /* Level 1: a grove instances the tree with random placement and size */
+    hittable_list_t *grove = hittable_list_create();
+    if (!grove) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    for (int i = 0; i < FOREST_GROVE_TREES; i++) {
+        transform_t scale = transform_scale(random_double_range(0.7, 1.3));
+        transform_t spin = transform_rotate_y(random_double_range(0.0, 360.0));
+        transform_t move = transform_translate(vec3(random_double_range(-1.8, 1.8), 0.0,
+                                                    random_double_range(-1.8, 1.8)));
+        transform_t a = transform_compose(&spin, &scale);
+        transform_t xf = transform_compose(&move, &a);
+        instance_t *inst = instance_create(tree_bvh, &xf);
+        if (inst) hittable_list_add(grove, instance_to_hittable(inst));
+    }
+    hittable_t grove_bvh;
+    if (share_bvh(scene, grove, &grove_bvh) != 0) {
+        scene_destroy(scene);
+        return NULL;
+    }
+
+    /* Level 2: the world instances groves on a grid */
+    double half = 0.5 * FOREST_GROVES * FOREST_GROVE_SPACING;
+    for (int gz = 0; gz < FOREST_GROVES; gz++) {
+        for (int gx = 0; gx < FOREST_GROVES; gx++) {
+            transform_t spin = transform_rotate_y(90.0 * (int)(4.0 * random_double()));
+            transform_t move = transform_translate(
+                vec3(gx * FOREST_GROVE_SPACING - half, 0.0, gz * FOREST_GROVE_SPACING - half));
+            transform_t xf = transform_compose(&move, &spin);
+            instance_t *inst = instance_create(grove_bvh, &xf);
+            if (inst) hittable_list_add(scene->world, instance_to_hittable(inst));
+        }
+    }
+
+    if (scene_finalize(scene) != 0) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    return scene;
+}
+
+/* Append quad corner + [0,1] u + [0,1] v as two triangles */
+static void add_quad(float *positions, uint32_t *indices, int *vertices, int *triangles,
+                     vec3_t corner, vec3_t u, vec3_t v) {
+    vec3_t p[4] = {corner, vec3_add(corner, u), vec3_add(vec3_add(corner, u), v),
+                   vec3_add(corner, v)};
+    uint32_t first = (uint32_t)*vertices;
+    for (int k = 0; k < 4; k++) {
+        for (int a = 0; a < 3; a++) positions[3 * (*vertices) + a] = (float)p[k].e[a];
+        (*vertices)++;
+    }
+    uint32_t tris[6] = {first, first + 1, first + 2, first, first + 2, first + 3};
+    memcpy(&indices[3 * (*triangles)], tris, sizeof(tris));
+    *triangles += 2;
+}
+
+/* Half extent and height of the room, and its skylight in the ceiling */
+#define ROOM_HALF 3.0
+#define ROOM_HEIGHT 3.0
+#define ROOM_QUADS 9
+
+/* Build the room scene */
+scene_t *scene_create_room(unsigned int seed) {
+    (void)seed;
+    scene_t *scene = scene_create();
+    if (!scene) return NULL;
+
+    scene->lookfrom = vec3(-0.5, 1.6, 2.8);
+    scene->lookat = vec3(0.3, 0.8, -1.0);
+    scene->vfov = 70.0;
+    scene->aperture = 0.0;
+    scene->focus_dist = 4.0;
+
+    const material_t *walls = scene_add_material(
+        scene, lambertian_create_in(scene->arena, vec3(0.8, 0.8, 0.8)));
+    float *positions = malloc(ROOM_QUADS * 4 * 3 * sizeof(float));
+    uint32_t *indices = malloc(ROOM_QUADS * 2 * 3 * sizeof(uint32_t));
+    if (!walls || !positions || !indices) {
+        free(positions);
+        free(indices);
+        scene_destroy(scene);
+        return NULL;
+    }
+
+    double h = ROOM_HALF, y = ROOM_HEIGHT;
+    int vertices = 0, triangles = 0;
+    /* Floor and walls */
+    add_quad(positions, indices, &vertices, &triangles, vec3(-h, 0, -h), vec3(2 * h, 0, 0),
+             vec3(0, 0, 2 * h));
+    add_quad(positions, indices, &vertices, &triangles, vec3(-h, 0, -h), vec3(2 * h, 0, 0),
+             vec3(0, y, 0));
+    add_quad(positions, indices, &vertices, &triangles, vec3(-h, 0, h), vec3(2 * h, 0, 0),
+             vec3(0, y, 0));
+    add_quad(positions, indices, &vertices, &triangles, vec3(-h, 0, -h), vec3(0, 0, 2 * h),
+             vec3(0, y, 0));
+    add_quad(positions, indices, &vertices, &triangles, vec3(h, 0, -h), vec3(0, 0, 2 * h),
+             vec3(0, y, 0));
+    /* Ceiling around the skylight x in [0.5, 2], z in [-2.5, -1] */
+    add_quad(positions, indices, &vertices, &triangles, vec3(-h, y, -h), vec3(0.5 + h, 0, 0),
+             vec3(0, 0, 2 * h));
+    add_quad(positions, indices, &vertices, &triangles, vec3(2, y, -h), vec3(h - 2, 0, 0),
+             vec3(0, 0, 2 * h));
+    add_quad(positions, indices, &vertices, &triangles, vec3(0.5, y, -h), vec3(1.5, 0, 0),
+             vec3(0, 0, h - 2.5));
+    add_quad(positions, indices, &vertices, &triangles, vec3(0.5, y, -1), vec3(1.5, 0, 0),
+             vec3(0, 0, 1 + h));
+    mesh_t *mesh = mesh_create(positions, vertices, indices, triangles, walls);
+    if (!mesh) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    hittable_list_add(scene->world, mesh_to_hittable(mesh));
+
+    /* Glass under the skylight, diffuse in the shade, a mirror between */
+    add_sphere(scene, vec3(1.25, 0.7, -1.75), 0.7, dielectric_create_in(scene->arena, 1.5));
+    add_sphere(scene, vec3(-1.3, 0.6, -1.0), 0.6,
+               lambertian_create_in(scene->arena, vec3(0.8, 0.3, 0.2)));
+    add_sphere(scene, vec3(0.1, 0.45, 0.3), 0.45,
+               metal_create_in(scene->arena, vec3(0.8, 0.8, 0.7), 0.05));
+
+    if (scene_finalize(scene) != 0) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    return scene;
+}
+
+/* Radius and radiance of the night scene's lights at the default count;
+ * other counts share the same total area */
+#define LIGHTS_RADIUS 0.08
+#define LIGHTS_RADIANCE 12.0
+
+/* Build the night scene */
+scene_t *scene_create_lights(unsigned int seed, int count) {
+    scene_t *scene = scene_create();
+    if (!scene || count < 1) {
+        scene_destroy(scene);
+        return NULL;
+    }
+
+    random_seed(seed);
+    scene->unlit = 1;
+    add_sphere(scene, vec3(0.0, -1000.0, 0.0), 1000.0,
+               lambertian_create_in(scene->arena, vec3(0.5, 0.5, 0.5)));
+    add_sphere(scene, vec3(-4.0, 1.0, 0.0), 1.0,
+               lambertian_create_in(scene->arena, vec3(0.4, 0.2, 0.1)));
+    add_sphere(scene, vec3(0.0, 1.0, 0.0), 1.0, dielectric_create_in(scene->arena, 1.5));
+    add_sphere(scene, vec3(4.0, 1.0, 0.0), 1.0,
+               metal_create_in(scene->arena, vec3(0.7, 0.6, 0.5), 0.0));
+
+    /* Lights hover over the field, clear of the ground and the large spheres */
+    double radius = LIGHTS_RADIUS * sqrt((double)SCENE_LIGHTS_DEFAULT / count);
+    for (int i = 0; i < count; i++) {
+        vec3_t center;
+        do {
+            center = vec3(random_double_range(-11.0, 11.0),
+                          radius + random_double_range(0.5, 3.0),
+                          random_double_range(-11.0, 11.0));
+        } while (fabs(center.e[2]) < 1.05 + radius && fabs(center.e[0]) < 5.05 + radius &&
+                 center.e[1] < 2.05 + radius);
+        vec3_t tint = vec3(0.3 + 0.7 * random_double(), 0.3 + 0.7 * random_double(),
+                           0.3 + 0.7 * random_double());
+        add_sphere(scene, center, radius,
+                   diffuse_light_create_in(scene->arena, vec3_mul(tint, LIGHTS_RADIANCE)));
+    }
+
+    if (scene_finalize(scene) != 0) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    return scene;
+}
+
+/* Build the field scene */
+scene_t *scene_create_field(unsigned int seed, int side) {
+    scene_t *scene = scene_create();
+    int threads = omp_get_max_threads();
+    arena_t **arenas = calloc(threads, sizeof(arena_t *));
+    /* The spheres go into the threads' arenas, so only the world is reserved */
+    if (!scene || side < 1 || !arenas ||
+        hittable_list_reserve(scene->world, side * side + 4) != 0) {
+        free(arenas);
+        scene_destroy(scene);
+        return NULL;
+    }
+
+    add_sphere(scene, vec3(0.0, -1000.0, 0.0), 1000.0,
+               lambertian_create_in(scene->arena, vec3(0.5, 0.5, 0.5)));
+    int first = scene->world->count;
+    hittable_t *slots = scene->world->objects + first;
+    int failed = 0;
+
+    /* Every sphere has a slot of its own, so threads fill the world directly;
+     * they are diffuse, so none needs to be noted as specular */
+    #if USE_OPENMP
+    #pragma omp parallel num_threads(threads) reduction(| : failed)
+    #endif
+    {
+        int rows = (side + threads - 1) / threads;
+        arena_t *arena = arena_create((size_t)rows * side * OBJECT_ARENA_BYTES);
+        arenas[omp_get_thread_num()] = arena;
+        #if USE_OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (int a = 0; a < side; a++) {
+            random_seed(sample_seed(seed, (uint64_t)a, 0));
+            for (int b = 0; b < side; b++) {
+                vec3_t center = vec3(a - side / 2 + 0.9 * random_double(), 0.2,
+                                     b - side / 2 + 0.9 * random_double());
+                vec3_t albedo = vec3(random_double() * random_double(),
+                                     random_double() * random_double(),
+                                     random_double() * random_double());
+                material_t *mat = arena ? arena_alloc(arena, sizeof(material_t),
+                                                      _Alignof(material_t))
+                                        : NULL;
+                if (mat) *mat = lambertian_create_in(arena, albedo);
+                hittable_t sphere = mat && mat->data
+                                        ? sphere_hittable_in(arena, center, 0.2, mat)
+                                        : (hittable_t){0};
+                failed |= !sphere.data;
+                slots[(size_t)a * side + b] = sphere;
+            }
+        }
+    }
+    for (int t = 0; t < threads; t++) arena_merge(scene->arena, arenas[t]);
+    free(arenas);
+    scene->world->count = first + side * side;
+
+    add_sphere(scene, vec3(-4.0, 1.0, 0.0), 1.0,
+               lambertian_create_in(scene->arena, vec3(0.4, 0.2, 0.1)));
+    add_sphere(scene, vec3(0.0, 1.0, 0.0), 1.0, dielectric_create_in(scene->arena, 1.5));
+    add_sphere(scene, vec3(4.0, 1.0, 0.0), 1.0,
+               metal_create_in(scene->arena, vec3(0.7, 0.6, 0.5), 0.0));
+
+    if (failed || scene_finalize(scene) != 0) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    return scene;
+}
+
+/* Extent of the glass scene's canopy and its skylight */
+#define CANOPY_HALF 30.0
+#define CANOPY_HEIGHT 5.0
+#define SKYLIGHT_HALF 0.6
+
+/* Build the glass scene */
+scene_t *scene_create_glass(unsigned int seed) {
+    (void)seed;
+    scene_t *scene = scene_create();
+    if (!scene) return NULL;
+
+    scene->lookfrom = vec3(0.0, 3.0, 5.0);
+    scene->lookat = vec3(0.0, 0.5, 0.0);
+    scene->vfov = 45.0;
+    scene->aperture = 0.0;
+    scene->focus_dist = 6.0;
+
+    add_sphere(scene, vec3(0.0, -1000.0, 0.0), 1000.0,
+               lambertian_create_in(scene->arena, vec3(0.6, 0.6, 0.6)));
+
+    /* A canopy with a skylight, as four quads around the opening */
+    const material_t *roof = scene_add_material(
+        scene, lambertian_create_in(scene->arena, vec3(0.5, 0.5, 0.5)));
+    float *positions = malloc(4 * 4 * 3 * sizeof(float));
+    uint32_t *indices = malloc(4 * 2 * 3 * sizeof(uint32_t));
+    if (!roof || !positions || !indices) {
+        free(positions);
+        free(indices);
+        scene_destroy(scene);
+        return NULL;
+    }
+    double h = CANOPY_HALF, y = CANOPY_HEIGHT, s = SKYLIGHT_HALF;
+    int vertices = 0, triangles = 0;
+    add_quad(positions, indices, &vertices, &triangles, vec3(-h, y, -h), vec3(h - s, 0, 0),
+             vec3(0, 0, 2 * h));
+    add_quad(positions, indices, &vertices, &triangles, vec3(s, y, -h), vec3(h - s, 0, 0),
+             vec3(0, 0, 2 * h));
+    add_quad(positions, indices, &vertices, &triangles, vec3(-s, y, -h), vec3(2 * s, 0, 0),
+             vec3(0, 0, h - s));
+    add_quad(positions, indices, &vertices, &triangles, vec3(-s, y, s), vec3(2 * s, 0, 0),
+             vec3(0, 0, h - s));
+    mesh_t *mesh = mesh_create(positions, vertices, indices, triangles, roof);
+    if (!mesh) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    hittable_list_add(scene->world, mesh_to_hittable(mesh));
+
+    /* A glass ball hanging under the skylight, two balls resting near it */
+    add_sphere(scene, vec3(0.0, 1.8, 0.0), 0.8, dielectric_create_in(scene->arena, 1.5));
+    add_sphere(scene, vec3(-1.3, 0.45, 0.6), 0.45, dielectric_create_in(scene->arena, 1.5));
+    add_sphere(scene, vec3(1.3, 0.45, 0.6), 0.45,
+               metal_create_in(scene->arena, vec3(0.9, 0.8, 0.6), 0.0));
+
+    if (scene_finalize(scene) != 0) {
+        scene_destroy(scene);
+        return NULL;
+    }
+    return scene;
+}
+
+/* Build a showcase scene by name */
+scene_t *scene_create_named(const char *name, unsigned int seed) {
+    if (strcmp(name, "random") == 0) return scene_create_random(seed);
+    if (strcmp(name, "bouncing") == 0) return scene_create_bouncing(seed);
+    if (strcmp(name, "forest") == 0) return scene_create_forest(seed);
+    if (strcmp(name, "room") == 0) return scene_create_room(seed);
+    if (strcmp(name, "glass") == 0) return scene_create_glass(seed);
+    if (strcmp(name, "lights") == 0) return scene_create_lights(seed, SCENE_LIGHTS_DEFAULT);
+    if (strcmp(name, "field") == 0) return scene_create_field(seed, SCENE_FIELD_SIDE);
+    return NULL;
+}
+
+/* Take ownership of an object outside the world */
+void scene_own(scene_t *scene, hittable_t object) {
+    hittable_list_add(scene->shared, object);
+}
+
+/* Load an OBJ mesh into the world */
+int scene_add_obj(scene_t *scene, const char *path, material_t material) {
+    const material_t *mat = scene_add_material(scene, material);
+    if (!mat) return -1;
+
+    mesh_t *mesh = mesh_load_obj(path, mat);
+    if (!mesh) return -1;
+    add_object(scene, mesh_to_hittable(mesh), mat);
+    return scene_finalize(scene);
+}
+
+/* Build the acceleration structure and light tree over the world */
+int scene_finalize(scene_t *scene) {
+    bvh_destroy(scene->bvh);
+    grid_destroy(scene->grid);
+    light_tree_destroy(scene->lights);
+    scene->bvh = NULL;
+    scene->grid = NULL;
+    scene->lights = light_tree_create(scene->world->objects, scene->world->count);
+    if (!scene->lights) return -1;
+    if (scene->lights->light_count == 0) {
+        light_tree_destroy(scene->lights);
+        scene->lights = NULL;
+    }
+    if (scene->accel == SCENE_ACCEL_GRID) {
+        scene->grid = grid_create(scene->world->objects, scene->world->count);
+        return scene->grid ? 0 : -1;
+    }
+    scene->bvh = bvh_create(scene->world->objects, scene->world->count);
+    return scene->bvh ? 0 : -1;
+}
+
+/* Switch to another acceleration structure */
+int scene_set_accelerator(scene_t *scene, scene_accel_t accel) {
+    scene->accel = accel;
+    return scene_finalize(scene);
+}
+
+/* Move the scene to an exposure interval and refit its BVH */
+int scene_set_shutter(scene_t *scene, double open, double close) {
+    scene->shutter.open = open;
+    scene->shutter.close = close > open ? close : open;
+    /* Moving objects' bounds cover the interval; the grid bins them anew */
+    if (scene->grid) return scene_finalize(scene);
+    if (!scene->bvh) return 0;
+    return bvh_refit(scene->bvh, scene->shutter.open, scene->shutter.close);
+}
+
+/* Light the scene with an environment map */
+void scene_set_environment(scene_t *scene, envmap_t *env) {
+    envmap_destroy(scene->environment);
+    scene->environment = env;
+}
+
+/* Camera looking at the scene for the given image aspect ratio */
+camera_t scene_camera(const scene_t *scene, double aspect_ratio) {
+    camera_t camera = camera_create(scene->lookfrom, scene->lookat, scene->vup,
+                                    scene->vfov, aspect_ratio, scene->aperture,
+                                    scene->focus_dist);
+    camera_set_shutter(&camera, scene->shutter.open, scene->shutter.close);
+    return camera;
+}
+
+/* Free the world, all owned materials and the scene */
+void scene_destroy(scene_t *scene) {
+    if (!scene) return;
+
+    bvh_destroy(scene->bvh);
+    grid_destroy(scene->grid);
+    light_tree_destroy(scene->lights);
+    envmap_destroy(scene->environment);
+    hittable_list_destroy(scene->world);
+    hittable_list_destroy(scene->shared);
+    for (int i = 0; i < scene->material_count; i++) {
+        material_t *mat = scene->materials[i];
+        mat->destroy(mat->data);
+    }
+    free(scene->materials);
+    free(scene->specular);
+    arena_destroy(scene->arena);
+    free(scene);
+}
@@ -0,0 +1,172 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "animation.h"
+#include "arena.h"
+#include "bvh.h"
+#include "camera.h"
+#include "envmap.h"
+#include "grid.h"
+#include "hittable.h"
+#include "lighttree.h"
+#include "material.h"
+#include "vec3.h"
+
+/* Seed of the showcase scene (the main thread's original RNG seed) */
+#define SCENE_DEFAULT_SEED 0x9e3779b9u
+
+/* Acceleration structure over a scene's world */
+typedef enum {
+    SCENE_ACCEL_BVH, /* bounding volume hierarchy (the default) */
+    SCENE_ACCEL_GRID /* uniform grid, for fields of similar-sized objects */
+} scene_accel_t;
+
+/* A world together with the materials it owns and its default viewpoint */
+typedef struct {
+    hittable_list_t *world;
+    scene_accel_t accel;      /* which structure scene_finalize builds */
+    bvh_t *bvh;               /* acceleration over world, built by scene_finalize */
+    grid_t *grid;             /* the same, with SCENE_ACCEL_GRID (bvh is then NULL) */
+    light_tree_t *lights;     /* the emissive spheres of world, sampled at diffuse
+                               * hits; NULL if there are none */
+    hittable_list_t *shared;  /* owned sub-scenes referenced by instances */
+    aabb_t *specular;         /* bounds of the world objects with non-diffuse
+                               * materials, where caustic photons are aimed */
+    int specular_count;
+    int specular_capacity;
+    shutter_t shutter;        /* exposure interval seen by moving objects */
+    envmap_t *environment;    /* optional light at infinity in place of the sky
+                               * gradient (owned) */
+    int unlit;                /* without an environment map, escaping rays see
+                               * black instead of the sky gradient */
+    arena_t *arena;           /* holds the builders' spheres and materials and
+                               * every material added, freed at once */
+    material_t **materials;   /* added materials with parameters to destroy */
+    int material_count;
+    int material_capacity;
+
+    /* Default camera placement */
+    vec3_t lookfrom;
+    vec3_t lookat;
+    vec3_t vup;
+    double vfov;
+    double aperture;
+    double focus_dist;
+} scene_t;
+
+/* Create an empty scene with the showcase camera placement */
+scene_t *scene_create(void);
+
+/* Build the showcase scene: ground, a jittered 22x22 field of small spheres and
+ * three large spheres. The layout depends only on seed, so separate processes
+ * build identical worlds. Returns NULL on allocation failure. */
+scene_t *scene_create_random(unsigned int seed);
+
+/* Build the showcase scene by name ("random", "bouncing", "forest", "room",
+ * "glass", "lights" or "field"); NULL if the name is unknown or allocation
+ * fails */
+scene_t *scene_create_named(const char *name, unsigned int seed);
+
+/* The showcase scene with its small diffuse spheres hopping along looping
+ * keyframed paths (a cycle of 8 frames, repeated for any frame number) */
+scene_t *scene_create_bouncing(unsigned int seed);
+
+/* A forest of instanced tree clusters: each tree is a small BVH of spheres,
+ * groves instance trees, and the world instances groves, so millions of
+ * effective spheres take a few megabytes */
+scene_t *scene_create_forest(unsigned int seed);
+
+/* A closed room lit only by the sky through a small skylight, holding a
+ * glass, a diffuse and a mirror sphere: nearly all light is indirect and
+ * arrives through a narrow opening (seed is unused) */
+scene_t *scene_create_room(unsigned int seed);
+
+/* A glass ball hanging under the small skylight of a wide canopy, focusing
+ * the sky it lets in onto the ground, next to a glass and a mirror ball on
+ * the ground: light reaches most of the floor only through glass (seed is
+ * unused) */
+scene_t *scene_create_glass(unsigned int seed);
+
+/* Lights of the night scene unless asked for another count */
+#define SCENE_LIGHTS_DEFAULT 400
+
+/* The showcase at night: under a black sky, count small emissive spheres of
+ * random colours scattered over the field light the ground and the three
+ * large spheres. The lights share a fixed total area and so power: scenes
+ * with 10 or 10,000 of them are lit alike. Returns NULL on allocation
+ * failure. */
+scene_t *scene_create_lights(unsigned int seed, int count);
+
+/* Spheres per side of the field scene */
+#define SCENE_FIELD_SIDE 1000
+
+/* A field for work on large scenes: the ground, a jittered side x side
+ * lattice of small diffuse spheres one unit apart, each with a colour of its
+ * own, and the showcase's three large spheres in the middle. Rows are built
+ * in parallel, each thread into an arena of its own, and every row draws from
+ * its own random stream, so the layout does not depend on the thread count.
+ * Returns NULL on allocation failure. */
+scene_t *scene_create_field(unsigned int seed, int side);
+
+/* Make room for objects more spheres, each with a material of its own, in
+ * the world and the scene's arena (a size hint for builders). Returns 0, or
+ * -1 on allocation failure. */
+int scene_reserve(scene_t *scene, int objects);
+
+/* Take ownership of a material (for materials made in scene->arena, just of
+ * their handle); the returned pointer stays valid until scene_destroy.
+ * Returns NULL if the material could not be stored. */
+const material_t *scene_add_material(scene_t *scene, material_t material);
+
+/* Take ownership of an object that is not itself in the world (e.g. a sub-scene
+ * list or BVH shared by instances); it is destroyed with the scene */
+void scene_own(scene_t *scene, hittable_t object);
+
+/* Light the scene with an environment map instead of the sky gradient, taking
+ * ownership of it (NULL restores the sky) */
+void scene_set_environment(scene_t *scene, envmap_t *env);
+
+/* Load an OBJ mesh with the given material into the world and rebuild the
+ * scene BVH. Returns 0 on success, -1 if the file could not be loaded. */
+int scene_add_obj(scene_t *scene, const char *path, material_t material);
+
+/* Build the acceleration structure and the light tree over the world. Called
+ * by the scene builders; must be called again after adding objects. Returns
+ * 0 on success. */
+int scene_finalize(scene_t *scene);
+
+/* Switch the scene to another acceleration structure, rebuilding it.
+ * Returns 0 on success, -1 on allocation failure. */
+int scene_set_accelerator(scene_t *scene, scene_accel_t accel);
+
+/* Find the closest intersection in the world */
+static inline int scene_hit(const scene_t *scene, const ray_t r, double t_min,
+                            double t_max, hit_record_t *rec) {
+    if (scene->grid) return grid_hit(scene->grid, r, t_min, t_max, rec);
+    if (scene->bvh) return bvh_hit(scene->bvh, r, t_min, t_max, rec);
+    return hittable_list_hit(scene->world, r, t_min, t_max, rec);
+}
+
+/* Whether anything in the world lies along r within (t_min, t_max). The
+ * BVH stops at the first hit it finds; a grid already stops in the first cell
+ * holding one. */
+static inline int scene_occluded(const scene_t *scene, const ray_t r, double t_min,
+                                 double t_max) {
+    hit_record_t rec;
+    if (scene->grid) return grid_hit(scene->grid, r, t_min, t_max, &rec);
+    if (scene->bvh) return bvh_occluded(scene->bvh, r, t_min, t_max);
+    return hittable_list_hit(scene->world, r, t_min, t_max, &rec);
+}
+
+/* Move the scene to the exposure interval [open, close] (in frames) and refit
+ * its BVH in place (a grid is rebuilt); open == close renders without motion
+ * blur. Returns 0 on success. */
+int scene_set_shutter(scene_t *scene, double open, double close);
+
+/* Camera looking at the scene for the given image aspect ratio */
+camera_t scene_camera(const scene_t *scene, double aspect_ratio);
+
+/* Free the world, all owned materials and the scene */
+void scene_destroy(scene_t *scene);
+
+#endif /* SCENE_H */
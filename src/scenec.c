@@ -0,0 +1,188 @@
+#include "bvh.h"
+#include "material.h"
+#include "scene.h"
+#include "sphere.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* vibe_scenec: the scene compiler. Builds a showcase scene and writes it out
+ * as C source for a renderer specialized to it (see compiled.h). Scenes of
+ * static spheres with Lambertian, metal and dielectric materials compile;
+ * others are rejected. */
+
+/* Index of material in materials, appending it if new; -1 if unsupported */
+static int material_index(const material_t *material, const material_t **materials,
+                          int *count) {
+    for (int i = 0; i < *count; i++) {
+        if (materials[i] == material) return i;
+    }
+    material_kind_t kind = material_params(material).kind;
+    if (kind == MATERIAL_OTHER || kind == MATERIAL_LIGHT) return -1;
+    materials[*count] = material;
+    return (*count)++;
+}
+
+/* Deepest stack bvh_hit-style traversal needs below node index */
+static int stack_depth(const bvh_t *bvh, int index) {
+    const bvh_node_t *node = &bvh->nodes[index];
+    if (node->count > 0) return 0;
+    int left = stack_depth(bvh, index + 1);
+    int right = stack_depth(bvh, node->start);
+    int deeper = left > right ? left : right;
+    return 1 + deeper;
+}
+
+/* Write a vec3 as an initializer of its components */
+static void write_vec3(FILE *out, vec3_t v) {
+    fprintf(out, "{%.17g, %.17g, %.17g}", v.e[0], v.e[1], v.e[2]);
+}
+
+/* Write the scene as C source; returns 0, or -1 if it cannot be compiled */
+static int compile_scene(FILE *out, const scene_t *scene, const char *name, unsigned int seed) {
+    const bvh_t *bvh = scene->bvh;
+    if (!bvh || bvh->unbounded_count > 0 || bvh->end_boxes || bvh->node_count == 0) {
+        fprintf(stderr, "Error: scene %s has unbounded, moving or no objects\n", name);
+        return -1;
+    }
+    const material_t **materials = malloc(bvh->object_count * sizeof(material_t *));
+    int *sphere_material = malloc(bvh->object_count * sizeof(int));
+    if (!materials || !sphere_material) {
+        free(materials);
+        free(sphere_material);
+        return -1;
+    }
+    int material_count = 0;
+    for (int i = 0; i < bvh->object_count; i++) {
+        const sphere_t *sphere = sphere_from_hittable(&bvh->objects[i]);
+        sphere_material[i] = sphere ? material_index(sphere->material, materials,
+                                                     &material_count)
+                                    : -1;
+        if (sphere_material[i] < 0) {
+            fprintf(stderr, "Error: scene %s has objects other than spheres of the "
+                            "built-in materials\n", name);
+            free(materials);
+            free(sphere_material);
+            return -1;
+        }
+    }
+
+    fprintf(out, "/* Generated by vibe_scenec from scene \"%s\", seed 0x%x. Do not edit. */\n\n",
+            name, seed);
+    fprintf(out, "#define KERNEL_NODES %d\n", bvh->node_count);
+    fprintf(out, "#define KERNEL_SPHERES %d\n", bvh->object_count);
+    fprintf(out, "#define KERNEL_STACK %d\n\n", stack_depth(bvh, 0) + 1);
+    fprintf(out, "#include \"compiled_kernel.h\"\n\n");
+    fprintf(out, "const char compiled_scene_name[] = \"%s\";\n", name);
+    fprintf(out, "const unsigned int compiled_scene_seed = 0x%xu;\n\n", seed);
+
+    fprintf(out, "static const kernel_view_t kernel_view = {\n    ");
+    write_vec3(out, scene->lookfrom);
+    fprintf(out, ",\n    ");
+    write_vec3(out, scene->lookat);
+    fprintf(out, ",\n    ");
+    write_vec3(out, scene->vup);
+    fprintf(out, ",\n    %.17g, %.17g, %.17g, %.17g, %.17g,\n};\n\n", scene->vfov,
+            scene->aperture, scene->focus_dist, scene->shutter.open, scene->shutter.close);
+
+    fprintf(out, "static const kernel_node_t kernel_nodes[KERNEL_NODES] = {\n");
+    for (int i = 0; i < bvh->node_count; i++) {
+        const bvh_node_t *node = &bvh->nodes[i];
+        fprintf(out, "    {{{");
+        write_vec3(out, node->box.min);
+        fprintf(out, "}, {");
+        write_vec3(out, node->box.max);
+        fprintf(out, "}}, %d, %d, %d},\n", node->start, node->count, node->axis);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const double kernel_spheres[KERNEL_SPHERES][4] = {\n");
+    for (int i = 0; i < bvh->object_count; i++) {
+        const sphere_t *sphere = sphere_from_hittable(&bvh->objects[i]);
+        fprintf(out, "    {%.17g, %.17g, %.17g, %.17g},\n", sphere->center.e[0],
+                sphere->center.e[1], sphere->center.e[2], sphere->radius);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const unsigned short kernel_sphere_material[KERNEL_SPHERES] = {\n");
+    for (int i = 0; i < bvh->object_count; i++) {
+        fprintf(out, "%s%d,%s", i % 16 == 0 ? "    " : " ", sphere_material[i],
+                i % 16 == 15 || i == bvh->object_count - 1 ? "\n" : "");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static int kernel_scatter(int material, const ray_t r_in, "
+                 "const kernel_hit_t *rec,\n"
+                 "                          vec3_t *attenuation, ray_t *scattered) {\n"
+                 "    switch (material) {\n");
+    for (int m = 0; m < material_count; m++) {
+        material_params_t params = material_params(materials[m]);
+        fprintf(out, "    case %d:\n        return ", m);
+        switch (params.kind) {
+        case MATERIAL_LAMBERTIAN:
+            fprintf(out, "kernel_lambertian(vec3(%.17g, %.17g, %.17g), ", params.albedo.e[0],
+                    params.albedo.e[1], params.albedo.e[2]);
+            break;
+        case MATERIAL_METAL:
+            fprintf(out, "kernel_metal(vec3(%.17g, %.17g, %.17g), %.17g, ", params.albedo.e[0],
+                    params.albedo.e[1], params.albedo.e[2], params.fuzz);
+            break;
+        default:
+            fprintf(out, "kernel_dielectric(%.17g, ", params.refraction_index);
+            break;
+        }
+        fprintf(out, "r_in, rec, attenuation, scattered);\n");
+    }
+    fprintf(out, "    }\n    return 0;\n}\n");
+
+    free(materials);
+    free(sphere_material);
+    return 0;
+}
+
+/* Print command line help */
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s SCENE [--seed N] OUTPUT.c\n"
+                    "Writes a renderer specialized to the named showcase scene.\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *name = NULL, *output = NULL;
+    unsigned int seed = SCENE_DEFAULT_SEED;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 0);
+        } else if (argv[i][0] != '-' && !name) {
+            name = argv[i];
+        } else if (argv[i][0] != '-' && !output) {
+            output = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!name || !output) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    scene_t *scene = scene_create_named(name, seed);
+    if (!scene) {
+        fprintf(stderr, "Error: unknown scene %s\n", name);
+        return 1;
+    }
+    FILE *out = fopen(output, "w");
+    if (!out) {
+        fprintf(stderr, "Error: cannot write %s\n", output);
+        scene_destroy(scene);
+        return 1;
+    }
+    int status = compile_scene(out, scene, name, seed);
+    status |= fclose(out);
+    scene_destroy(scene);
+    if (status != 0) {
+        remove(output);
+        return 1;
+    }
+    return 0;
+}
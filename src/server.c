@@ -0,0 +1,574 @@
+#define _POSIX_C_SOURCE 200809L
+#include "server.h"
+#include "image.h"
+#include "net.h"
+#include "vibe_private.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MAX_CLIENTS 256
+#define POLL_INTERVAL_MS 100
+#define CONNECT_RETRY_SECONDS 5.0
+#define PROGRESS_STEPS 16 /* progress messages per job (at most one per row) */
+#define CLIENT_BACKLOG (64 << 10) /* unsent reply bytes before a client is dropped */
+
+enum {
+    MSG_SUBMIT = 1,
+    MSG_SHUTDOWN = 2,
+    MSG_PROGRESS = 3,
+    MSG_DONE = 4,
+};
+
+/* A job waiting for the render thread */
+typedef struct {
+    server_job_t spec;
+    uint32_t client;  /* connection that submitted it */
+    uint32_t id;      /* the client's job id, echoed in replies */
+    uint64_t order;   /* submission order */
+    double submitted;
+} queued_job_t;
+
+/* Render thread to main loop: progress or completion of a job */
+typedef struct {
+    uint32_t type;
+    uint32_t client;
+    uint32_t id;
+    double fraction;
+    server_result_t result;
+} event_t;
+
+/* A built scene kept for later jobs */
+typedef struct {
+    server_job_t key; /* only scene, scene_seed and obj_path are compared */
+    vibe_scene_t *scene;
+    uint64_t last_used;
+} cache_entry_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    queued_job_t *queue; /* unordered; the render thread picks the best */
+    int queued;
+    int capacity;
+    uint64_t next_order;
+    int stopping;            /* no more jobs are accepted */
+    uint32_t running_client; /* submitter of the running job, 0 if idle */
+    atomic_int cancel;       /* cancels the running job */
+
+    int events[2]; /* socket pair: the render thread writes events[1] */
+
+    /* Owned by the render thread */
+    cache_entry_t *cache;
+    int cache_size;
+    int cached;
+    uint64_t tick;
+
+    const char *root; /* directory job paths are confined to */
+} server_t;
+
+/* A client connection. Its socket is non-blocking: requests are gathered
+ * across reads and replies are queued until the socket takes them, so a
+ * client that stalls mid-message or stops reading cannot hold up the daemon. */
+typedef struct {
+    int fd;
+    uint32_t id;
+    size_t received; /* bytes of the current request in request */
+    unsigned char request[sizeof(net_header_t) + sizeof(server_job_t)];
+    unsigned char *pending; /* replies the socket has not taken yet */
+    size_t pending_len;
+    size_t pending_cap;
+} client_t;
+
+static atomic_int stop_requested;
+
+static void on_signal(int sig) {
+    (void)sig;
+    atomic_store(&stop_requested, 1);
+}
+
+/* Post an event to the main loop */
+static void post(server_t *srv, const event_t *ev) {
+    net_send_all(srv->events[1], ev, sizeof(*ev));
+}
+
+/* Whether a cached scene was built from the job's scene description */
+static int same_scene(const server_job_t *a, const server_job_t *b) {
+    return a->scene_seed == b->scene_seed && strcmp(a->scene, b->scene) == 0 &&
+           strcmp(a->obj_path, b->obj_path) == 0;
+}
+
+/* The job's scene from the cache, building it (and evicting the least
+ * recently used scene) on a miss. Returns NULL if the scene cannot be built. */
+static vibe_scene_t *cached_scene(server_t *srv, const server_job_t *job, int *hit) {
+    srv->tick++;
+    for (int i = 0; i < srv->cached; i++) {
+        if (same_scene(&srv->cache[i].key, job)) {
+            srv->cache[i].last_used = srv->tick;
+            *hit = 1;
+            return srv->cache[i].scene;
+        }
+    }
+    *hit = 0;
+
+    vibe_scene_desc_t desc = {
+        .name = job->scene,
+        .seed = job->scene_seed,
+        .obj_path = job->obj_path[0] ? job->obj_path : NULL,
+    };
+    vibe_scene_t *scene = vibe_scene_load(&desc);
+    if (!scene) return NULL;
+
+    int slot = srv->cached;
+    if (srv->cached == srv->cache_size) {
+        slot = 0;
+        for (int i = 1; i < srv->cached; i++) {
+            if (srv->cache[i].last_used < srv->cache[slot].last_used) slot = i;
+        }
+        vibe_scene_destroy(srv->cache[slot].scene);
+    } else {
+        srv->cached++;
+    }
+    srv->cache[slot] = (cache_entry_t){*job, scene, srv->tick};
+    return scene;
+}
+
+/* Render one job in bands of rows, posting progress after each band */
+static void run_job(server_t *srv, const queued_job_t *q, double started) {
+    const server_job_t *job = &q->spec;
+    event_t done = {.type = MSG_DONE, .client = q->client, .id = q->id};
+    server_result_t *res = &done.result;
+    res->queued = started - q->submitted;
+    res->status = -1;
+
+    render_rect_t rect;
+    vibe_scene_t *scene = NULL;
+    accum_t *accum = NULL;
+    if (job->settings.width < 2 || job->settings.height < 2 ||
+        job->settings.samples_per_pixel < 1 || job->settings.max_depth < 1 ||
+        vibe_crop_rect(&job->settings, &rect) != 0) {
+        snprintf(res->message, sizeof(res->message), "invalid settings");
+    } else if (!(scene = cached_scene(srv, job, &res->scene_cached))) {
+        snprintf(res->message, sizeof(res->message), "%s", vibe_last_error());
+    } else if (!(accum = accum_create(rect.x1 - rect.x0, rect.y1 - rect.y0))) {
+        snprintf(res->message, sizeof(res->message), "out of memory");
+    } else {
+        vibe_view_t view = job->view;
+        if (job->default_view) vibe_scene_view(scene, &view);
+        camera_t camera = vibe_camera(scene, &view, &job->settings);
+        render_settings_t settings = vibe_render_settings(scene, &job->settings);
+        settings.cancel = &srv->cancel;
+
+        int rows = rect.y1 - rect.y0;
+        int band = (rows + PROGRESS_STEPS - 1) / PROGRESS_STEPS;
+        int cancelled = 0;
+        int progressive = job->settings.guiding || job->settings.caustic_photons > 0;
+        if (progressive) {
+            /* Passes cover the whole crop, so it is one band */
+            cancelled = render_progressive(vibe_scene_world(scene), &camera, &settings, rect,
+                                           job->settings.guiding, job->settings.caustic_photons,
+                                           accum) != 0;
+        }
+        for (int y = rect.y0; y < rect.y1 && !cancelled && !progressive; y += band) {
+            render_rect_t part = {rect.x0, y, rect.x1, y + band < rect.y1 ? y + band : rect.y1};
+            accum_t rows_out = {accum->width, part.y1 - part.y0,
+                                accum->pixels + (size_t)(y - rect.y0) * accum->width};
+            cancelled = render_region(vibe_scene_world(scene), &camera, &settings, part, 0,
+                                      job->settings.samples_per_pixel, &rows_out) != 0;
+            event_t progress = {.type = MSG_PROGRESS, .client = q->client, .id = q->id,
+                                .fraction = (double)(part.y1 - rect.y0) / rows};
+            if (!cancelled) post(srv, &progress);
+        }
+
+        /* Crops record their place in the frame for stitching */
+        char comment[64];
+        image_crop_comment(comment, sizeof(comment), rect, job->settings.width,
+                           job->settings.height);
+        if (cancelled) {
+            snprintf(res->message, sizeof(res->message), "cancelled");
+        } else if (image_write_ppm_comment(job->output, accum, comment) != 0) {
+            snprintf(res->message, sizeof(res->message), "could not write %.100s", job->output);
+        } else {
+            res->status = 0;
+        }
+    }
+    accum_destroy(accum);
+    res->render = net_now() - started;
+    post(srv, &done);
+}
+
+/* Run queued jobs in priority order until the queue drains after shutdown */
+static void *render_thread(void *arg) {
+    server_t *srv = arg;
+
+    pthread_mutex_lock(&srv->lock);
+    while (1) {
+        while (srv->queued == 0 && !srv->stopping) pthread_cond_wait(&srv->wake, &srv->lock);
+        if (srv->queued == 0) break;
+
+        int best = 0;
+        for (int i = 1; i < srv->queued; i++) {
+            const queued_job_t *a = &srv->queue[i], *b = &srv->queue[best];
+            if (a->spec.priority > b->spec.priority ||
+                (a->spec.priority == b->spec.priority && a->order < b->order)) {
+                best = i;
+            }
+        }
+        queued_job_t job = srv->queue[best];
+        srv->queue[best] = srv->queue[--srv->queued];
+        srv->running_client = job.client;
+        atomic_store(&srv->cancel, 0);
+        pthread_mutex_unlock(&srv->lock);
+
+        run_job(srv, &job, net_now());
+
+        pthread_mutex_lock(&srv->lock);
+        srv->running_client = 0;
+    }
+    pthread_mutex_unlock(&srv->lock);
+
+    for (int i = 0; i < srv->cached; i++) vibe_scene_destroy(srv->cache[i].scene);
+    event_t exit_event = {0};
+    post(srv, &exit_event);
+    return NULL;
+}
+
+/* Queue a job; returns -1 if the daemon is shutting down or out of memory */
+static int enqueue(server_t *srv, const server_job_t *spec, uint32_t client, uint32_t id) {
+    pthread_mutex_lock(&srv->lock);
+    int status = -1;
+    if (!srv->stopping && srv->queued == srv->capacity) {
+        int capacity = srv->capacity ? 2 * srv->capacity : 64;
+        queued_job_t *queue = realloc(srv->queue, capacity * sizeof(queued_job_t));
+        if (queue) {
+            srv->queue = queue;
+            srv->capacity = capacity;
+        }
+    }
+    if (!srv->stopping && srv->queued < srv->capacity) {
+        srv->queue[srv->queued++] =
+            (queued_job_t){*spec, client, id, srv->next_order++, net_now()};
+        pthread_cond_signal(&srv->wake);
+        status = 0;
+    }
+    pthread_mutex_unlock(&srv->lock);
+    return status;
+}
+
+/* Stop accepting jobs; the render thread exits once the queue is empty */
+static void begin_shutdown(server_t *srv) {
+    pthread_mutex_lock(&srv->lock);
+    srv->stopping = 1;
+    pthread_cond_signal(&srv->wake);
+    pthread_mutex_unlock(&srv->lock);
+}
+
+/* Close a client connection, dropping its queued jobs and cancelling its
+ * running one */
+static void drop_client(server_t *srv, client_t *c) {
+    pthread_mutex_lock(&srv->lock);
+    for (int i = 0; i < srv->queued;) {
+        if (srv->queue[i].client == c->id) {
+            srv->queue[i] = srv->queue[--srv->queued];
+        } else {
+            i++;
+        }
+    }
+    if (srv->running_client == c->id) atomic_store(&srv->cancel, 1);
+    pthread_mutex_unlock(&srv->lock);
+    close(c->fd);
+    free(c->pending);
+    *c = (client_t){.fd = -1};
+}
+
+/* Hand queued replies to the socket as far as it takes them; returns -1 if
+ * the connection failed */
+static int flush_client(client_t *c) {
+    size_t sent = 0;
+    while (sent < c->pending_len) {
+        ssize_t n = send(c->fd, c->pending + sent, c->pending_len - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) return -1;
+        sent += (size_t)n;
+    }
+    memmove(c->pending, c->pending + sent, c->pending_len - sent);
+    c->pending_len -= sent;
+    return 0;
+}
+
+/* Queue a reply and send what the socket takes; returns -1 if the connection
+ * failed or the client has left CLIENT_BACKLOG bytes unread */
+static int reply(client_t *c, uint32_t type, uint32_t id, const void *payload, uint32_t size) {
+    net_header_t h = {NET_MAGIC, type, id, size};
+    size_t needed = c->pending_len + sizeof(h) + size;
+    if (needed > CLIENT_BACKLOG) return -1;
+    if (needed > c->pending_cap) {
+        size_t cap = c->pending_cap ? 2 * c->pending_cap : 1024;
+        while (cap < needed) cap *= 2;
+        unsigned char *pending = realloc(c->pending, cap);
+        if (!pending) return -1;
+        c->pending = pending;
+        c->pending_cap = cap;
+    }
+    memcpy(c->pending + c->pending_len, &h, sizeof(h));
+    if (size) memcpy(c->pending + c->pending_len + sizeof(h), payload, size);
+    c->pending_len = needed;
+    return flush_client(c);
+}
+
+/* Resolve a job's path in place against the root. The path must be relative
+ * and have no ".." component; returns -1 if it is not, or does not fit. */
+static int confine_path(const char *root, char *path) {
+    if (path[0] == '\0' || path[0] == '/') return -1;
+    for (const char *p = path; *p;) {
+        size_t n = strcspn(p, "/");
+        if (n == 2 && p[0] == '.' && p[1] == '.') return -1;
+        p += n;
+        if (*p) p++;
+    }
+    char full[SERVER_PATH_SIZE];
+    int len = snprintf(full, sizeof(full), "%s/%s", root, path);
+    if (len < 0 || len >= (int)sizeof(full)) return -1;
+    memcpy(path, full, len + 1);
+    return 0;
+}
+
+/* Act on a complete request held in c->request */
+static int handle_request(server_t *srv, client_t *c, const net_header_t *h) {
+    if (h->type == MSG_SHUTDOWN) {
+        begin_shutdown(srv);
+        return 0;
+    }
+
+    server_job_t spec;
+    memcpy(&spec, c->request + sizeof(*h), sizeof(spec));
+    spec.scene[SERVER_NAME_SIZE - 1] = '\0';
+    spec.obj_path[SERVER_PATH_SIZE - 1] = '\0';
+    spec.output[SERVER_PATH_SIZE - 1] = '\0';
+    if (confine_path(srv->root, spec.output) != 0 ||
+        (spec.obj_path[0] && confine_path(srv->root, spec.obj_path) != 0)) {
+        server_result_t refused = {.status = -1,
+                                   .message = "paths must be relative and stay in the root"};
+        return reply(c, MSG_DONE, h->id, &refused, sizeof(refused));
+    }
+    if (enqueue(srv, &spec, c->id, h->id) != 0) {
+        server_result_t refused = {.status = -1, .message = "daemon is shutting down"};
+        return reply(c, MSG_DONE, h->id, &refused, sizeof(refused));
+    }
+    return 0;
+}
+
+/* Read what a client has sent and act on every request completed by it;
+ * returns -1 if the connection must close */
+static int read_requests(server_t *srv, client_t *c) {
+    while (1) {
+        net_header_t h;
+        size_t wanted = sizeof(h);
+        if (c->received >= sizeof(h)) {
+            memcpy(&h, c->request, sizeof(h));
+            if (h.magic != NET_MAGIC) return -1;
+            if (h.type == MSG_SUBMIT && h.payload == sizeof(server_job_t)) {
+                wanted += sizeof(server_job_t);
+            } else if (h.type != MSG_SHUTDOWN || h.payload != 0) {
+                return -1;
+            }
+            if (c->received == wanted) {
+                c->received = 0;
+                if (handle_request(srv, c, &h) != 0) return -1;
+                continue;
+            }
+        }
+
+        ssize_t n = recv(c->fd, c->request + c->received, wanted - c->received, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        if (n <= 0) return -1;
+        c->received += (size_t)n;
+    }
+}
+
+/* Serve jobs until shutdown */
+int server_run(const server_options_t *opts) {
+    /* Jobs write files, so the daemon is only reachable by local users that
+     * the socket's permissions let in */
+    if (strncmp(opts->address, "unix:", 5) != 0) {
+        fprintf(stderr, "Error: the daemon serves unix: addresses only, not %s\n",
+                opts->address);
+        return -1;
+    }
+    server_t srv = {.cache_size = opts->cache_size > 0 ? opts->cache_size : SERVER_DEFAULT_CACHE,
+                    .root = opts->root ? opts->root : "."};
+    client_t *clients = malloc(MAX_CLIENTS * sizeof(client_t));
+    struct pollfd *fds = malloc((MAX_CLIENTS + 2) * sizeof(struct pollfd));
+    srv.cache = malloc(srv.cache_size * sizeof(cache_entry_t));
+    int listen_fd = clients && fds && srv.cache ? net_listen(opts->address) : -1;
+    if (listen_fd < 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, srv.events) != 0) {
+        fprintf(stderr, "Error: could not serve %s\n", opts->address);
+        if (listen_fd >= 0) close(listen_fd);
+        free(clients);
+        free(fds);
+        free(srv.cache);
+        return -1;
+    }
+    pthread_mutex_init(&srv.lock, NULL);
+    pthread_cond_init(&srv.wake, NULL);
+    atomic_init(&srv.cancel, 0);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, render_thread, &srv) != 0) {
+        fprintf(stderr, "Error: could not start the render thread\n");
+        close(listen_fd);
+        close(srv.events[0]);
+        close(srv.events[1]);
+        free(clients);
+        free(fds);
+        free(srv.cache);
+        return -1;
+    }
+
+    atomic_store(&stop_requested, 0);
+    struct sigaction sa = {0};
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    for (int i = 0; i < MAX_CLIENTS; i++) clients[i] = (client_t){.fd = -1};
+    uint32_t next_client = 1;
+    fprintf(stderr, "Serving render jobs on %s\n", opts->address);
+
+    int running = 1;
+    while (running) {
+        if (atomic_load(&stop_requested)) begin_shutdown(&srv);
+
+        int nfds = 0;
+        fds[nfds++] = (struct pollfd){.fd = srv.events[0], .events = POLLIN};
+        fds[nfds++] = (struct pollfd){.fd = listen_fd, .events = POLLIN};
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].fd >= 0) {
+                short events = POLLIN | (clients[i].pending_len ? POLLOUT : 0);
+                fds[nfds++] = (struct pollfd){.fd = clients[i].fd, .events = events};
+            }
+        }
+        if (poll(fds, nfds, POLL_INTERVAL_MS) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        /* Forward progress and results to their clients */
+        if (fds[0].revents & POLLIN) {
+            event_t ev;
+            if (net_recv_all(srv.events[0], &ev, sizeof(ev)) != 0) break;
+            if (ev.type == 0) {
+                running = 0;
+                continue;
+            }
+            for (int i = 0; i < MAX_CLIENTS; i++) {
+                client_t *c = &clients[i];
+                if (c->fd < 0 || c->id != ev.client) continue;
+                int sent = ev.type == MSG_PROGRESS
+                               ? reply(c, MSG_PROGRESS, ev.id, &ev.fraction, sizeof(ev.fraction))
+                               : reply(c, MSG_DONE, ev.id, &ev.result, sizeof(ev.result));
+                if (sent != 0) drop_client(&srv, c);
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            int slot = -1;
+            for (int i = 0; fd >= 0 && i < MAX_CLIENTS; i++) {
+                if (clients[i].fd < 0) {
+                    slot = i;
+                    break;
+                }
+            }
+            if (slot >= 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0) {
+                clients[slot] = (client_t){.fd = fd, .id = next_client++};
+            } else if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        for (int f = 2; f < nfds; f++) {
+            if (!fds[f].revents) continue;
+            for (int i = 0; i < MAX_CLIENTS; i++) {
+                client_t *c = &clients[i];
+                if (c->fd != fds[f].fd) continue;
+                int ok = !(fds[f].revents & POLLOUT) || flush_client(c) == 0;
+                if (fds[f].revents & ~POLLOUT) ok = ok && read_requests(&srv, c) == 0;
+                if (!ok) drop_client(&srv, c);
+                break;
+            }
+        }
+    }
+
+    begin_shutdown(&srv);
+    pthread_join(thread, NULL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd < 0) continue;
+        flush_client(&clients[i]); /* best effort: replies still queued are lost */
+        close(clients[i].fd);
+        free(clients[i].pending);
+    }
+    close(listen_fd);
+    if (strncmp(opts->address, "unix:", 5) == 0) unlink(opts->address + 5);
+    close(srv.events[0]);
+    close(srv.events[1]);
+    pthread_mutex_destroy(&srv.lock);
+    pthread_cond_destroy(&srv.wake);
+    free(srv.queue);
+    free(srv.cache);
+    free(clients);
+    free(fds);
+    return 0;
+}
+
+/* Submit a job and wait for its result */
+int server_submit(const char *address, const server_job_t *job,
+                  server_progress_fn progress, void *user, server_result_t *result) {
+    int fd = net_connect(address, CONNECT_RETRY_SECONDS);
+    if (fd < 0) return -1;
+
+    int status = -1;
+    if (net_send_msg(fd, MSG_SUBMIT, 1, job, sizeof(*job)) == 0) {
+        net_header_t h;
+        while (net_recv_header(fd, &h) == 0) {
+            if (h.type == MSG_PROGRESS && h.payload == sizeof(double)) {
+                double fraction;
+                if (net_recv_all(fd, &fraction, sizeof(fraction)) != 0) break;
+                if (progress) progress(fraction, user);
+            } else if (h.type == MSG_DONE && h.payload == sizeof(server_result_t)) {
+                server_result_t res;
+                if (net_recv_all(fd, &res, sizeof(res)) != 0) break;
+                if (result) *result = res;
+                status = res.status;
+                break;
+            } else {
+                break;
+            }
+        }
+    }
+    close(fd);
+    return status;
+}
+
+/* Ask the daemon to exit */
+int server_shutdown(const char *address) {
+    int fd = net_connect(address, CONNECT_RETRY_SECONDS);
+    if (fd < 0) return -1;
+    int status = net_send_msg(fd, MSG_SHUTDOWN, 0, NULL, 0);
+    close(fd);
+    return status;
+}
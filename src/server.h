@@ -0,0 +1,62 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "vibe.h"
+#include <stdint.h>
+
+/* Long-lived render daemon. Clients submit jobs over a unix socket (see net.h
+ * for addresses and framing); a job's paths are relative to the daemon's root
+ * directory and may not leave it. The daemon renders one job at a time in
+ * priority order on its shared OpenMP team, keeps recently used scenes and
+ * their acceleration structures built in an LRU cache, and streams progress
+ * back to the client that submitted the job. A client that disconnects
+ * cancels its jobs. */
+
+#define SERVER_NAME_SIZE 32
+#define SERVER_PATH_SIZE 256
+#define SERVER_DEFAULT_CACHE 4
+
+/* A render job as sent over the socket */
+typedef struct {
+    char scene[SERVER_NAME_SIZE];    /* scene name (see scene_create_named) */
+    uint32_t scene_seed;             /* layout seed, 0 for the showcase layout */
+    char obj_path[SERVER_PATH_SIZE]; /* optional OBJ mesh under the root, empty for none */
+    char output[SERVER_PATH_SIZE];   /* PPM under the root the daemon writes (the crop) */
+    int32_t priority;                /* higher runs first, FIFO among equals */
+    int32_t default_view;            /* non-zero: the scene's own camera */
+    vibe_view_t view;
+    vibe_settings_t settings;
+} server_job_t;
+
+/* Outcome of a job */
+typedef struct {
+    int32_t status;       /* 0 on success */
+    int32_t scene_cached; /* the scene was already built */
+    double queued;        /* seconds spent waiting in the queue */
+    double render;        /* seconds spent building the scene and rendering */
+    char message[128];    /* error description when status != 0 */
+} server_result_t;
+
+typedef struct {
+    const char *address; /* unix:/path */
+    const char *root;    /* directory job paths are relative to, NULL for "." */
+    int cache_size; /* scenes kept built, 0 for SERVER_DEFAULT_CACHE */
+} server_options_t;
+
+/* Progress callback of a submitted job: fraction of its pixels done */
+typedef void (*server_progress_fn)(double fraction, void *user);
+
+/* Serve jobs until a client requests shutdown or SIGINT/SIGTERM arrives;
+ * queued jobs are finished first. Returns 0 on a clean shutdown, -1 if the
+ * address could not be served (only unix: addresses are). */
+int server_run(const server_options_t *opts);
+
+/* Submit a job and wait for it, calling progress (may be NULL) as it runs.
+ * Returns the job's status, or -1 if the daemon could not be reached. */
+int server_submit(const char *address, const server_job_t *job,
+                  server_progress_fn progress, void *user, server_result_t *result);
+
+/* Ask the daemon to finish its queue and exit; 0 if the request was sent */
+int server_shutdown(const char *address);
+
+#endif /* SERVER_H */
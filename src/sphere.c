@@ -1,15 +1,15 @@
 #include "sphere.h"
+#include "dispatch.h"
 #include <math.h>
 #include <stdlib.h>
 
 /* Ray-sphere intersection detection */
-static int sphere_hit(const void *obj, const ray_t r, double t_min, double t_max,
-                      hit_record_t *rec) {
-    const sphere_t *sphere = (const sphere_t *)obj;
-    vec3_t oc = vec3_sub(r.origin, sphere->center);
+static int hit_sphere(vec3_t center, double radius, const material_t *material,
+                      const ray_t r, double t_min, double t_max, hit_record_t *rec) {
+    vec3_t oc = vec3_sub(r.origin, center);
     double a = vec3_length_squared(r.direction);
     double half_b = vec3_dot(oc, r.direction);
-    double c = vec3_length_squared(oc) - sphere->radius * sphere->radius;
+    double c = vec3_length_squared(oc) - radius * radius;
     double discriminant = half_b * half_b - a * c;
 
     if (discriminant < 0) {
@@ -28,14 +28,34 @@ static int sphere_hit(const void *obj, const ray_t r, double t_min, double t_max
 
     rec->t = t;
     rec->point = ray_at(r, t);
-    vec3_t outward_normal =
-        vec3_div(vec3_sub(rec->point, sphere->center), sphere->radius);
+    vec3_t outward_normal = vec3_div(vec3_sub(rec->point, center), radius);
     set_face_normal(rec, r, outward_normal);
-    rec->material = sphere->material;
+    rec->material = material;
 
     return 1;
 }
 
+VIBE_KERNEL
+static int sphere_hit(const void *obj, const ray_t r, double t_min, double t_max,
+                      hit_record_t *rec) {
+    const sphere_t *sphere = (const sphere_t *)obj;
+    return hit_sphere(sphere->center, sphere->radius, sphere->material, r, t_min,
+                      t_max, rec);
+}
+
+/* Box around a sphere */
+static aabb_t sphere_box(vec3_t center, double radius) {
+    vec3_t r = vec3(radius, radius, radius);
+    return (aabb_t){vec3_sub(center, r), vec3_add(center, r)};
+}
+
+/* Bounding box of the sphere */
+static int sphere_bounding_box(const void *obj, aabb_t *box) {
+    const sphere_t *sphere = (const sphere_t *)obj;
+    *box = sphere_box(sphere->center, sphere->radius);
+    return 1;
+}
+
 /* Destroy sphere object */
 static void sphere_destroy(void *obj) {
     free(obj);
@@ -55,5 +75,103 @@ sphere_t *sphere_create(const vec3_t center, double radius,
 
 /* Create a hittable sphere object */
 hittable_t sphere_to_hittable(sphere_t *sphere) {
-    return (hittable_t){.data = sphere, .hit = sphere_hit, .destroy = sphere_destroy};
+    return (hittable_t){
+        .data = sphere,
+        .hit = sphere_hit,
+        .bounding_box = sphere_bounding_box,
+        .destroy = sphere_destroy,
+    };
+}
+
+/* Create a sphere in an arena as a hittable */
+hittable_t sphere_hittable_in(arena_t *arena, const vec3_t center, double radius,
+                              const material_t *material) {
+    sphere_t *sphere = arena_alloc(arena, sizeof(sphere_t), _Alignof(sphere_t));
+    if (!sphere) return (hittable_t){0};
+
+    *sphere = (sphere_t){center, radius, material};
+    hittable_t object = sphere_to_hittable(sphere);
+    object.destroy = NULL;
+    return object;
+}
+
+/* The sphere behind a hittable */
+const sphere_t *sphere_from_hittable(const hittable_t *object) {
+    return object->hit == sphere_hit ? (const sphere_t *)object->data : NULL;
+}
+
+/* Intersect the sphere where it is at the ray's time */
+VIBE_KERNEL
+static int moving_sphere_hit(const void *obj, const ray_t r, double t_min,
+                             double t_max, hit_record_t *rec) {
+    const moving_sphere_t *sphere = (const moving_sphere_t *)obj;
+    return hit_sphere(path_eval(sphere->path, r.time), sphere->radius,
+                      sphere->material, r, t_min, t_max, rec);
+}
+
+/* Bounds over the shutter interval: the path is linear between keys, so the
+ * boxes at the interval ends and at the keys inside it cover the motion. A
+ * looping path's interval is moved into its first period; keys of the next
+ * period are checked too, which covers every key of a longer interval. */
+static int moving_sphere_bounding_box(const void *obj, aabb_t *box) {
+    const moving_sphere_t *sphere = (const moving_sphere_t *)obj;
+    const path_t *path = sphere->path;
+    double open = path_wrap(path, sphere->shutter->open);
+    double close = open + (sphere->shutter->close - sphere->shutter->open);
+
+    *box = aabb_union(sphere_box(path_eval(path, open), sphere->radius),
+                      sphere_box(path_eval(path, close), sphere->radius));
+    for (int i = 0; i < path->count; i++) {
+        double key = path->times[i], next = key + path->period;
+        if ((key > open && key < close) || (path->period > 0.0 && next > open && next < close)) {
+            *box = aabb_union(*box, sphere_box(path->points[i], sphere->radius));
+        }
+    }
+    return 1;
+}
+
+/* Bounds at shutter open and close when the motion between them is linear */
+static int moving_sphere_motion_bounds(const void *obj, aabb_t *open, aabb_t *close) {
+    const moving_sphere_t *sphere = (const moving_sphere_t *)obj;
+    const shutter_t *shutter = sphere->shutter;
+    if (path_has_key_inside(sphere->path, shutter->open, shutter->close)) return 0;
+
+    *open = sphere_box(path_eval(sphere->path, shutter->open), sphere->radius);
+    *close = sphere_box(path_eval(sphere->path, shutter->close), sphere->radius);
+    return 1;
+}
+
+/* Destroy a moving sphere and its path */
+static void moving_sphere_destroy(void *obj) {
+    moving_sphere_t *sphere = (moving_sphere_t *)obj;
+    path_destroy(sphere->path);
+    free(sphere);
+}
+
+/* Create a moving sphere */
+moving_sphere_t *moving_sphere_create(path_t *path, double radius,
+                                      const material_t *material,
+                                      const shutter_t *shutter) {
+    moving_sphere_t *sphere = malloc(sizeof(moving_sphere_t));
+    if (!sphere) {
+        path_destroy(path);
+        return NULL;
+    }
+
+    sphere->path = path;
+    sphere->radius = radius;
+    sphere->material = material;
+    sphere->shutter = shutter;
+    return sphere;
+}
+
+/* Create a hittable moving sphere object */
+hittable_t moving_sphere_to_hittable(moving_sphere_t *sphere) {
+    return (hittable_t){
+        .data = sphere,
+        .hit = moving_sphere_hit,
+        .bounding_box = moving_sphere_bounding_box,
+        .motion_bounds = moving_sphere_motion_bounds,
+        .destroy = moving_sphere_destroy,
+    };
 }
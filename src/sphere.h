@@ -1,6 +1,8 @@
 #ifndef SPHERE_H
 #define SPHERE_H
 
+#include "animation.h"
+#include "arena.h"
 #include "hittable.h"
 #include "vec3.h"
 
@@ -18,4 +20,31 @@ sphere_t *sphere_create(const vec3_t center, double radius,
 /* Create a hittable sphere object */
 hittable_t sphere_to_hittable(sphere_t *sphere);
 
+/* Create a sphere in arena as a hittable without destroy: the arena frees
+ * it. Its data is NULL on allocation failure. */
+hittable_t sphere_hittable_in(arena_t *arena, const vec3_t center, double radius,
+                              const material_t *material);
+
+/* The sphere behind object, or NULL if it is not a (static) sphere */
+const sphere_t *sphere_from_hittable(const hittable_t *object);
+
+/* Sphere whose center follows a keyframed path. Rays hit it where it is at
+ * their time; its bounds cover the motion over the shared shutter interval,
+ * which the owner updates between frames (then refits any BVH above it). */
+typedef struct {
+    path_t *path;
+    double radius;
+    const material_t *material;
+    const shutter_t *shutter;
+} moving_sphere_t;
+
+/* Create a moving sphere that takes ownership of path; NULL on failure (the
+ * path is freed) */
+moving_sphere_t *moving_sphere_create(path_t *path, double radius,
+                                      const material_t *material,
+                                      const shutter_t *shutter);
+
+/* Create a hittable moving sphere object */
+hittable_t moving_sphere_to_hittable(moving_sphere_t *sphere);
+
 #endif /* SPHERE_H */
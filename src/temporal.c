@@ -0,0 +1,217 @@
+#include "temporal.h"
+#include "material.h"
+#include <math.h>
+#include <omp.h>
+#include <stdlib.h>
+
+#define USE_OPENMP 1
+#define DEPTH_TOLERANCE 0.03 /* relative depth change a surface may show */
+#define NORMAL_COS 0.9       /* least cosine between matching normals */
+
+/* Create an empty history */
+temporal_t *temporal_create(int width, int height) {
+    if (width < 2 || height < 2) return NULL;
+
+    temporal_t *t = calloc(1, sizeof(temporal_t));
+    if (!t) return NULL;
+    size_t pixels = (size_t)width * height;
+    t->width = width;
+    t->height = height;
+    t->surfaces = malloc(pixels * sizeof(temporal_surface_t));
+    t->next_surfaces = malloc(pixels * sizeof(temporal_surface_t));
+    t->rgb = malloc(pixels * 3 * sizeof(double));
+    t->next_rgb = malloc(pixels * 3 * sizeof(double));
+    t->history = malloc(pixels * sizeof(float));
+    t->next_history = malloc(pixels * sizeof(float));
+    if (!t->surfaces || !t->next_surfaces || !t->rgb || !t->next_rgb || !t->history ||
+        !t->next_history) {
+        temporal_destroy(t);
+        return NULL;
+    }
+    return t;
+}
+
+/* Free a history */
+void temporal_destroy(temporal_t *temporal) {
+    if (!temporal) return;
+    free(temporal->surfaces);
+    free(temporal->next_surfaces);
+    free(temporal->rgb);
+    free(temporal->next_rgb);
+    free(temporal->history);
+    free(temporal->next_history);
+    free(temporal);
+}
+
+/* Forget all history */
+void temporal_reset(temporal_t *temporal) {
+    temporal->frames = 0;
+}
+
+/* First surface through the centre of pixel (x, y); TEMPORAL_NONE for the sky
+ * and for materials whose look depends on the view */
+static temporal_surface_t first_surface(const scene_t *scene, const camera_t *camera,
+                                        int width, int height, int x, int y) {
+    double u = (x + 0.5) / (width - 1);
+    double v = (height - 1 - y + 0.5) / (height - 1);
+    vec3_t target = vec3_add(camera->lower_left_corner,
+                             vec3_add(vec3_mul(camera->horizontal, u),
+                                      vec3_mul(camera->vertical, v)));
+    ray_t r = ray_timed(camera->origin, vec3_sub(target, camera->origin), camera->time0);
+
+    temporal_surface_t surface = {.object = TEMPORAL_NONE, .edge = 0};
+    hit_record_t rec = {0};
+    if (!scene_hit(scene, r, 0.001, INFINITY, &rec)) return surface;
+    if (!rec.material || material_params(rec.material).kind != MATERIAL_LAMBERTIAN) {
+        return surface;
+    }
+    surface.point = rec.point;
+    surface.normal = rec.normal;
+    surface.depth = vec3_length(vec3_sub(rec.point, camera->origin));
+    surface.object = rec.object;
+    return surface;
+}
+
+/* Whether a 4-neighbour of pixel i of surfaces sees a different object */
+static int on_edge(const temporal_surface_t *surfaces, int width, int height, int i) {
+    int x = i % width, y = i / width;
+    int32_t object = surfaces[i].object;
+    return (x > 0 && surfaces[i - 1].object != object) ||
+           (x < width - 1 && surfaces[i + 1].object != object) ||
+           (y > 0 && surfaces[i - width].object != object) ||
+           (y < height - 1 && surfaces[i + width].object != object);
+}
+
+/* Whether the last frame saw surface at its pixel (x, y) */
+static int matches(const temporal_t *t, const temporal_surface_t *surface, int x, int y) {
+    if (x < 0 || y < 0 || x >= t->width || y >= t->height) return 0;
+    const temporal_surface_t *seen = &t->surfaces[(size_t)y * t->width + x];
+    if (seen->object != surface->object || seen->edge) return 0;
+    double depth = vec3_length(vec3_sub(surface->point, t->camera.origin));
+    return fabs(depth - seen->depth) <= DEPTH_TOLERANCE * seen->depth &&
+           vec3_dot(seen->normal, surface->normal) >= NORMAL_COS;
+}
+
+/* Bilinear reprojection of the last frame's radiance and history length at
+ * surface, over the neighbouring pixels that saw it; 0 if none did */
+static int reproject(const temporal_t *t, const temporal_surface_t *surface, vec3_t *radiance,
+                     double *history) {
+    double u, v;
+    if (surface->object == TEMPORAL_NONE || surface->edge ||
+        !camera_project(&t->camera, surface->point, &u, &v)) {
+        return 0;
+    }
+    double fx = u * (t->width - 1) - 0.5;
+    double fy = t->height - 0.5 - v * (t->height - 1);
+    int x0 = (int)floor(fx);
+    int y0 = (int)floor(fy);
+    double tx = fx - x0, ty = fy - y0;
+
+    double weight = 0.0, samples = 0.0;
+    vec3_t sum = vec3(0.0, 0.0, 0.0);
+    for (int k = 0; k < 4; k++) {
+        int x = x0 + (k & 1);
+        int y = y0 + (k >> 1);
+        if (!matches(t, surface, x, y)) continue;
+        double w = ((k & 1) ? tx : 1.0 - tx) * ((k >> 1) ? ty : 1.0 - ty);
+        const double *rgb = &t->rgb[3 * ((size_t)y * t->width + x)];
+        sum = vec3_add(sum, vec3_mul(vec3(rgb[0], rgb[1], rgb[2]), w));
+        samples += w * t->history[(size_t)y * t->width + x];
+        weight += w;
+    }
+    if (weight <= 0.0) return 0;
+    *radiance = vec3_div(sum, weight);
+    *history = samples / weight;
+    return 1;
+}
+
+/* Render the next frame of the sequence, reusing the last one */
+int temporal_render(temporal_t *temporal, const scene_t *scene, const camera_t *camera,
+                    const render_settings_t *settings, const temporal_options_t *options,
+                    double *rgb, temporal_stats_t *stats) {
+    temporal_t *t = temporal;
+    int spp = settings->samples_per_pixel;
+    if (settings->width != t->width || settings->height != t->height || spp < 1 ||
+        options->fresh_spp < 1 || options->max_history < 0) {
+        return -1;
+    }
+    int width = t->width;
+    int pixels = width * t->height;
+    int have_history = t->frames > 0;
+    int s0 = t->frames * spp; /* each frame its own random streams */
+    double cap = options->max_history > 0 ? options->max_history : INFINITY;
+    int reused = 0;
+    long samples = 0;
+    double history_sum = 0.0;
+
+    int threads = settings->threads > 0 ? settings->threads : omp_get_max_threads();
+
+    /* First hits of the whole frame, then where they change */
+    #if USE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 100) num_threads(threads)
+    #endif
+    for (int i = 0; i < pixels; i++) {
+        t->next_surfaces[i] = first_surface(scene, camera, width, t->height, i % width,
+                                            i / width);
+    }
+    #if USE_OPENMP
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    #endif
+    for (int i = 0; i < pixels; i++) {
+        t->next_surfaces[i].edge = on_edge(t->next_surfaces, width, t->height, i);
+    }
+
+    #if USE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 100) reduction(+ : reused, samples, history_sum) \
+        num_threads(threads)
+    #endif
+    for (int i = 0; i < pixels; i++) {
+        int x = i % width;
+        int y = i / width;
+        const temporal_surface_t surface = t->next_surfaces[i];
+
+        vec3_t past = vec3(0.0, 0.0, 0.0);
+        double history = 0.0;
+        int reuse = have_history && reproject(t, &surface, &past, &history);
+        int n = reuse ? options->fresh_spp : spp;
+        accum_pixel_t acc = {0};
+        render_pixel(scene, camera, settings, x, y, s0, s0 + n, &acc);
+        vec3_t fresh = accum_pixel_mean(&acc);
+
+        /* History weighs as many samples as it holds, up to the cap */
+        vec3_t color = fresh;
+        if (reuse) {
+            history = fmin(history, cap);
+            color = vec3_div(vec3_add(vec3_mul(past, history), vec3_mul(fresh, n)),
+                             history + n);
+            reused++;
+        }
+        double behind = fmin(history + n, cap);
+        for (int c = 0; c < 3; c++) t->next_rgb[3 * (size_t)i + c] = color.e[c];
+        t->next_history[i] = (float)behind;
+        samples += n;
+        history_sum += behind;
+    }
+
+    /* The frame becomes the history of the next */
+    temporal_surface_t *surfaces = t->surfaces;
+    t->surfaces = t->next_surfaces;
+    t->next_surfaces = surfaces;
+    double *last = t->rgb;
+    t->rgb = t->next_rgb;
+    t->next_rgb = last;
+    float *lengths = t->history;
+    t->history = t->next_history;
+    t->next_history = lengths;
+    t->camera = *camera;
+    t->frames++;
+
+    for (size_t k = 0; k < (size_t)pixels * 3; k++) rgb[k] = t->rgb[k];
+    if (stats) {
+        stats->reused = reused;
+        stats->fresh = pixels - reused;
+        stats->samples = samples;
+        stats->mean_history = history_sum / pixels;
+    }
+    return 0;
+}
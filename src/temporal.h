@@ -0,0 +1,82 @@
+#ifndef TEMPORAL_H
+#define TEMPORAL_H
+
+#include "camera.h"
+#include "render.h"
+#include "scene.h"
+#include <stdint.h>
+
+/* Temporal sample reuse for camera flythroughs of a static scene. Each frame
+ * records, per pixel, the surface its centre ray hits first. The next frame
+ * reprojects its own first hits into the previous camera and keeps the
+ * previous radiance where the surface found there is the same object at the
+ * expected depth with a similar normal, blending it with a few fresh samples
+ * in proportion to the samples behind each. Pixels without valid history
+ * (disoccluded or newly in view) get the full sample count, as do the sky,
+ * non-diffuse first hits, whose radiance depends on the view, and pixels on
+ * silhouettes, whose radiance mixes surfaces in proportions that change as
+ * the camera moves. */
+
+#define TEMPORAL_NONE (-1) /* surface of a pixel whose history is never reused */
+
+/* First surface seen through a pixel's centre */
+typedef struct {
+    vec3_t point;
+    vec3_t normal;
+    double depth;   /* distance from the camera origin */
+    int32_t object; /* top-level object (index into scene->world), or TEMPORAL_NONE */
+    int32_t edge;   /* a neighbour sees another surface: the pixel's samples mix
+                     * both, so its radiance does not reproject */
+} temporal_surface_t;
+
+/* History of a sequence; row 0 is the top of the image */
+typedef struct {
+    int width;
+    int height;
+    int frames;                   /* frames rendered so far */
+    camera_t camera;              /* camera of the last frame */
+    temporal_surface_t *surfaces; /* first hits of the last frame */
+    double *rgb;                  /* radiance of the last frame, linear RGB triples */
+    float *history;               /* samples each pixel of rgb stands for */
+    temporal_surface_t *next_surfaces; /* the frame being rendered */
+    double *next_rgb;
+    float *next_history;
+} temporal_t;
+
+/* How history is spent */
+typedef struct {
+    int fresh_spp;   /* samples of a pixel with valid history (the settings'
+                      * samples_per_pixel go to the others) */
+    int max_history; /* most samples history counts for, so it keeps
+                      * following the scene (0: no limit) */
+} temporal_options_t;
+
+/* What a frame reused */
+typedef struct {
+    int reused;          /* pixels blended with history */
+    int fresh;           /* pixels rendered from scratch */
+    long samples;        /* camera samples traced */
+    double mean_history; /* mean samples behind a pixel afterwards */
+} temporal_stats_t;
+
+/* Create an empty history for width x height frames; NULL on failure */
+temporal_t *temporal_create(int width, int height);
+
+/* Free a history */
+void temporal_destroy(temporal_t *temporal);
+
+/* Forget all history, e.g. at a cut: the next frame renders from scratch */
+void temporal_reset(temporal_t *temporal);
+
+/* Render the next frame of the sequence from camera into rgb (width x height
+ * linear RGB triples, top row first), reusing the previous frame where valid,
+ * and keep it as history. The settings must describe a full frame of the
+ * history's size. Each frame draws its samples from its own random streams;
+ * the first frame, and any after temporal_reset, is exactly the image
+ * render_region gives. stats may be NULL. Returns 0 on success, -1 on
+ * invalid settings. */
+int temporal_render(temporal_t *temporal, const scene_t *scene, const camera_t *camera,
+                    const render_settings_t *settings, const temporal_options_t *options,
+                    double *rgb, temporal_stats_t *stats);
+
+#endif /* TEMPORAL_H */
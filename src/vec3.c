@@ -8,58 +8,6 @@
 /* Thread-local random state, lazily initialized per thread */
 static __thread unsigned int seed = 0;
 
-/* Construct a vec3 from three doubles */
-inline vec3_t vec3(double x, double y, double z) {
-    return (vec3_t){{x, y, z}};
-}
-
-/* Add two vectors */
-inline vec3_t vec3_add(const vec3_t a, const vec3_t b) {
-    return vec3(a.e[0] + b.e[0], a.e[1] + b.e[1], a.e[2] + b.e[2]);
-}
-
-/* Subtract two vectors */
-inline vec3_t vec3_sub(const vec3_t a, const vec3_t b) {
-    return vec3(a.e[0] - b.e[0], a.e[1] - b.e[1], a.e[2] - b.e[2]);
-}
-
-/* Multiply vector by scalar */
-inline vec3_t vec3_mul(const vec3_t v, double t) {
-    return vec3(v.e[0] * t, v.e[1] * t, v.e[2] * t);
-}
-
-/* Divide vector by scalar */
-inline vec3_t vec3_div(const vec3_t v, double t) {
-    return vec3_mul(v, 1.0 / t);
-}
-
-/* Dot product */
-inline double vec3_dot(const vec3_t a, const vec3_t b) {
-    return a.e[0] * b.e[0] + a.e[1] * b.e[1] + a.e[2] * b.e[2];
-}
-
-/* Cross product */
-inline vec3_t vec3_cross(const vec3_t a, const vec3_t b) {
-    return vec3(a.e[1] * b.e[2] - a.e[2] * b.e[1],
-                a.e[2] * b.e[0] - a.e[0] * b.e[2],
-                a.e[0] * b.e[1] - a.e[1] * b.e[0]);
-}
-
-/* Length (magnitude) of vector */
-inline double vec3_length(const vec3_t v) {
-    return sqrt(vec3_length_squared(v));
-}
-
-/* Length squared (avoid sqrt when possible) */
-inline double vec3_length_squared(const vec3_t v) {
-    return vec3_dot(v, v);
-}
-
-/* Unit vector (normalized) */
-inline vec3_t vec3_normalize(const vec3_t v) {
-    return vec3_div(v, vec3_length(v));
-}
-
 /* Generate random double in [0, 1) */
 double random_double(void) {
     if (!seed) {
@@ -75,6 +23,21 @@ double random_double(void) {
     return rand_r(&seed) / (RAND_MAX + 1.0);
 }
 
+/* Reset the calling thread's random state (0 is remapped, like the lazy seed) */
+void random_seed(unsigned int s) {
+    seed = s ? s : 1u;
+}
+
+/* Current random state of the calling thread, to suspend a stream */
+unsigned int random_state(void) {
+    return seed;
+}
+
+/* Resume a stream suspended with random_state */
+void random_restore(unsigned int state) {
+    seed = state;
+}
+
 /* Generate random double in [min, max) */
 double random_double_range(double min, double max) {
     return min + (max - min) * random_double();
@@ -3,29 +3,125 @@
 
 #include <math.h>
 
-/* 3D vector type for points, colors, and directions */
+#ifndef VEC3_SIMD
+#define VEC3_SIMD 0
+#endif
+
+/* 3D vector type for points, colors, and directions. With VEC3_SIMD set
+ * (make OPTIONS=-DVEC3_SIMD=1) vectors are padded to four lanes, the fourth
+ * kept zero, and the arithmetic below compiles to packed SSE2/AVX operations
+ * through GCC vector extensions. Either layout gives identical results: the
+ * packed operations round lane by lane like the scalar ones, and dot products
+ * add their terms in the same order. The padding costs memory and code that
+ * reads single components pays for lane moves, so the scalar layout is the
+ * default; compare with `vibe_bench kernels`. */
+#if VEC3_SIMD
+/* Only double alignment is required, so vectors may live anywhere malloc
+ * puts them; the packed loads and stores are unaligned */
+typedef double vec3_lanes_t __attribute__((vector_size(32), aligned(8)));
+
+typedef union {
+    double e[4];
+    vec3_lanes_t v;
+} vec3_t;
+#else
 typedef struct {
     double e[3];
 } vec3_t;
+#endif
+
+/* The vector math is inline so the hot kernels (intersection, scatter,
+ * camera rays) never call across translation units for it */
+
+/* Construct a vec3 from three doubles */
+static inline vec3_t vec3(double x, double y, double z) {
+    return (vec3_t){{x, y, z}};
+}
+
+#if VEC3_SIMD
+/* Add two vectors */
+static inline vec3_t vec3_add(const vec3_t a, const vec3_t b) {
+    return (vec3_t){.v = a.v + b.v};
+}
+
+/* Subtract two vectors */
+static inline vec3_t vec3_sub(const vec3_t a, const vec3_t b) {
+    return (vec3_t){.v = a.v - b.v};
+}
+
+/* Multiply vector by scalar */
+static inline vec3_t vec3_mul(const vec3_t v, double t) {
+    return (vec3_t){.v = v.v * t};
+}
+
+/* Dot product */
+static inline double vec3_dot(const vec3_t a, const vec3_t b) {
+    vec3_lanes_t p = a.v * b.v;
+    return p[0] + p[1] + p[2];
+}
+
+/* Cross product */
+static inline vec3_t vec3_cross(const vec3_t a, const vec3_t b) {
+    typedef long long lane_index_t __attribute__((vector_size(32)));
+    const lane_index_t yzx = {1, 2, 0, 3};
+    const lane_index_t zxy = {2, 0, 1, 3};
+    return (vec3_t){.v = __builtin_shuffle(a.v, yzx) * __builtin_shuffle(b.v, zxy) -
+                         __builtin_shuffle(a.v, zxy) * __builtin_shuffle(b.v, yzx)};
+}
+#else
+/* Add two vectors */
+static inline vec3_t vec3_add(const vec3_t a, const vec3_t b) {
+    return vec3(a.e[0] + b.e[0], a.e[1] + b.e[1], a.e[2] + b.e[2]);
+}
+
+/* Subtract two vectors */
+static inline vec3_t vec3_sub(const vec3_t a, const vec3_t b) {
+    return vec3(a.e[0] - b.e[0], a.e[1] - b.e[1], a.e[2] - b.e[2]);
+}
+
+/* Multiply vector by scalar */
+static inline vec3_t vec3_mul(const vec3_t v, double t) {
+    return vec3(v.e[0] * t, v.e[1] * t, v.e[2] * t);
+}
+
+/* Dot product */
+static inline double vec3_dot(const vec3_t a, const vec3_t b) {
+    return a.e[0] * b.e[0] + a.e[1] * b.e[1] + a.e[2] * b.e[2];
+}
+
+/* Cross product */
+static inline vec3_t vec3_cross(const vec3_t a, const vec3_t b) {
+    return vec3(a.e[1] * b.e[2] - a.e[2] * b.e[1],
+                a.e[2] * b.e[0] - a.e[0] * b.e[2],
+                a.e[0] * b.e[1] - a.e[1] * b.e[0]);
+}
+#endif
+
+/* Divide vector by scalar */
+static inline vec3_t vec3_div(const vec3_t v, double t) {
+    return vec3_mul(v, 1.0 / t);
+}
 
-/* Basic vector operations */
-vec3_t vec3_add(const vec3_t a, const vec3_t b);
-vec3_t vec3_sub(const vec3_t a, const vec3_t b);
-vec3_t vec3_mul(const vec3_t v, double t);
-vec3_t vec3_div(const vec3_t v, double t);
+/* Length squared (avoid sqrt when possible) */
+static inline double vec3_length_squared(const vec3_t v) {
+    return vec3_dot(v, v);
+}
 
-/* Vector arithmetic */
-double vec3_dot(const vec3_t a, const vec3_t b);
-vec3_t vec3_cross(const vec3_t a, const vec3_t b);
-double vec3_length(const vec3_t v);
-double vec3_length_squared(const vec3_t v);
-vec3_t vec3_normalize(const vec3_t v);
+/* Length (magnitude) of vector */
+static inline double vec3_length(const vec3_t v) {
+    return sqrt(vec3_length_squared(v));
+}
 
-/* Utility constructors */
-vec3_t vec3(double x, double y, double z);
+/* Unit vector (normalized) */
+static inline vec3_t vec3_normalize(const vec3_t v) {
+    return vec3_div(v, vec3_length(v));
+}
 
 /* Random utilities */
 double random_double(void);
+void random_seed(unsigned int s);
+unsigned int random_state(void);
+void random_restore(unsigned int state);
 double random_double_range(double min, double max);
 vec3_t random_vec3(void);
 vec3_t random_vec3_range(double min, double max);
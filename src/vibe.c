@@ -0,0 +1,314 @@
+#include "vibe.h"
+#include "vibe_private.h"
+#include "affinity.h"
+#include "image.h"
+#include "query.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct vibe_scene {
+    scene_t *primary;  /* built by the loading thread */
+    scene_t **copies;  /* per NUMA node when replicated, else NULL */
+    int copy_count;
+};
+
+/* Topology of the machine, read on first use */
+static cpu_topology_t *topology = NULL;
+static int placed = 0; /* threads pinned by vibe_place_threads */
+
+static __thread char last_error[256];
+
+/* Record the calling thread's last error */
+static void set_error(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(last_error, sizeof(last_error), format, args);
+    va_end(args);
+}
+
+/* Description of the last error */
+const char *vibe_last_error(void) {
+    return last_error;
+}
+
+/* The machine's topology, or NULL if it could not be read */
+static const cpu_topology_t *machine(void) {
+    if (!topology) topology = topology_detect();
+    return topology;
+}
+
+/* Fill settings with the defaults */
+void vibe_settings_default(vibe_settings_t *settings) {
+    *settings = (vibe_settings_t){
+        .width = VIBE_DEFAULT_WIDTH,
+        .height = VIBE_DEFAULT_HEIGHT,
+        .samples_per_pixel = VIBE_DEFAULT_SPP,
+        .max_depth = VIBE_DEFAULT_DEPTH,
+        .seed = SCENE_DEFAULT_SEED,
+        .sort_rays = 1,
+    };
+}
+
+/* Pin the render threads */
+int vibe_place_threads(const char *policy, int threads) {
+    affinity_policy_t p;
+    if (affinity_parse(policy, &p) != 0) {
+        set_error("unknown placement policy '%s'", policy);
+        return -1;
+    }
+    if (!machine()) {
+        set_error("could not read the CPU topology");
+        return -1;
+    }
+    int team = affinity_apply(topology, p, threads);
+    if (team < 0) {
+        set_error("could not place threads with policy '%s'", policy);
+        return -1;
+    }
+    placed = p != AFFINITY_NONE;
+    return team;
+}
+
+/* Build one copy of the described scene */
+static scene_t *build(const vibe_scene_desc_t *desc) {
+    const char *name = desc->name ? desc->name : "random";
+    scene_t *scene = scene_create_named(name, desc->seed ? desc->seed : SCENE_DEFAULT_SEED);
+    if (!scene) {
+        set_error("could not create scene '%s'", name);
+        return NULL;
+    }
+    if (desc->obj_path &&
+        scene_add_obj(scene, desc->obj_path, lambertian_create(vec3(0.6, 0.6, 0.6))) != 0) {
+        set_error("could not load mesh '%s'", desc->obj_path);
+        scene_destroy(scene);
+        return NULL;
+    }
+    if (desc->env_path) {
+        envmap_t *env = envmap_load_pfm(desc->env_path);
+        if (!env) {
+            set_error("could not load environment map '%s'", desc->env_path);
+            scene_destroy(scene);
+            return NULL;
+        }
+        scene_set_environment(scene, env);
+    }
+    if (desc->accel == VIBE_ACCEL_GRID && scene_set_accelerator(scene, SCENE_ACCEL_GRID) != 0) {
+        set_error("out of memory");
+        scene_destroy(scene);
+        return NULL;
+    }
+    return scene;
+}
+
+/* Build a copy of the scene for every node the placed threads run on, each
+ * by a thread of that node so its pages are allocated there. The loading
+ * thread's node keeps the primary copy. */
+static int replicate(vibe_scene_t *vs, const vibe_scene_desc_t *desc) {
+    int nodes = topology->node_count;
+    vs->copies = calloc(nodes, sizeof(scene_t *));
+    atomic_int *claimed = calloc(nodes, sizeof(atomic_int));
+    if (!vs->copies || !claimed) {
+        free(claimed);
+        set_error("out of memory");
+        return -1;
+    }
+    vs->copy_count = nodes;
+    vs->copies[affinity_thread_node()] = vs->primary;
+    claimed[affinity_thread_node()] = 1;
+
+    int failed = 0;
+    #pragma omp parallel reduction(|:failed)
+    {
+        int node = affinity_thread_node();
+        if (!atomic_exchange(&claimed[node], 1)) {
+            vs->copies[node] = build(desc);
+            failed |= vs->copies[node] == NULL;
+        }
+    }
+    free(claimed);
+    return failed ? -1 : 0;
+}
+
+/* Build a scene */
+vibe_scene_t *vibe_scene_load(const vibe_scene_desc_t *desc) {
+    vibe_scene_t *vs = calloc(1, sizeof(vibe_scene_t));
+    if (!vs) {
+        set_error("out of memory");
+        return NULL;
+    }
+
+    int interleave = desc->memory == VIBE_MEMORY_INTERLEAVE && machine();
+    if (interleave) affinity_interleave(topology, 1);
+    vs->primary = build(desc);
+    if (interleave) affinity_interleave(topology, 0);
+
+    if (vs->primary && desc->memory == VIBE_MEMORY_REPLICATE && placed &&
+        topology->node_count > 1 && replicate(vs, desc) != 0) {
+        vibe_scene_destroy(vs);
+        return NULL;
+    }
+    if (!vs->primary) {
+        free(vs);
+        return NULL;
+    }
+    return vs;
+}
+
+/* Open the shutter on every copy */
+int vibe_scene_set_shutter(vibe_scene_t *scene, double open, double close) {
+    int failed = scene_set_shutter(scene->primary, open, close) != 0;
+    for (int n = 0; n < scene->copy_count; n++) {
+        if (scene->copies[n] && scene->copies[n] != scene->primary) {
+            failed |= scene_set_shutter(scene->copies[n], open, close) != 0;
+        }
+    }
+    if (failed) set_error("could not refit the scene");
+    return failed ? -1 : 0;
+}
+
+/* The scene's default camera placement */
+void vibe_scene_view(const vibe_scene_t *scene, vibe_view_t *view) {
+    const scene_t *s = scene->primary;
+    for (int i = 0; i < 3; i++) {
+        view->lookfrom[i] = s->lookfrom.e[i];
+        view->lookat[i] = s->lookat.e[i];
+        view->vup[i] = s->vup.e[i];
+    }
+    view->vfov = s->vfov;
+    view->aperture = s->aperture;
+    view->focus_dist = s->focus_dist;
+}
+
+/* Free a scene and its copies */
+void vibe_scene_destroy(vibe_scene_t *scene) {
+    if (!scene) return;
+    for (int n = 0; n < scene->copy_count; n++) {
+        if (scene->copies[n] != scene->primary) scene_destroy(scene->copies[n]);
+    }
+    free(scene->copies);
+    scene_destroy(scene->primary);
+    free(scene);
+}
+
+/* Internal scene of a handle */
+const scene_t *vibe_scene_world(const vibe_scene_t *scene) {
+    return scene->primary;
+}
+
+/* Internal render settings equivalent to settings */
+render_settings_t vibe_render_settings(const vibe_scene_t *scene,
+                                       const vibe_settings_t *settings) {
+    return (render_settings_t){
+        .width = settings->width,
+        .height = settings->height,
+        .samples_per_pixel = settings->samples_per_pixel,
+        .max_depth = settings->max_depth,
+        .threads = settings->threads,
+        .chunk_size = settings->chunk_size,
+        .seed = settings->seed,
+        .batch_size = settings->batch_size,
+        .sort_rays = settings->sort_rays,
+        .replicas = scene && scene->copies ? (const scene_t *const *)scene->copies : NULL,
+    };
+}
+
+/* Camera of view for the full frame */
+camera_t vibe_camera(const vibe_scene_t *scene, const vibe_view_t *view,
+                     const vibe_settings_t *settings) {
+    camera_t camera = camera_create(
+        vec3(view->lookfrom[0], view->lookfrom[1], view->lookfrom[2]),
+        vec3(view->lookat[0], view->lookat[1], view->lookat[2]),
+        vec3(view->vup[0], view->vup[1], view->vup[2]), view->vfov,
+        (double)settings->width / settings->height, view->aperture, view->focus_dist);
+    camera_set_shutter(&camera, scene->primary->shutter.open, scene->primary->shutter.close);
+    return camera;
+}
+
+/* The crop window as a render rectangle */
+int vibe_crop_rect(const vibe_settings_t *settings, render_rect_t *rect) {
+    vibe_rect_t crop = settings->crop;
+    if (crop.x0 == 0 && crop.y0 == 0 && crop.x1 == 0 && crop.y1 == 0) {
+        crop = (vibe_rect_t){0, 0, settings->width, settings->height};
+    }
+    if (crop.x0 < 0 || crop.y0 < 0 || crop.x1 > settings->width ||
+        crop.y1 > settings->height || crop.x0 >= crop.x1 || crop.y0 >= crop.y1) {
+        return -1;
+    }
+    *rect = (render_rect_t){crop.x0, crop.y0, crop.x1, crop.y1};
+    return 0;
+}
+
+/* Render the crop window */
+int vibe_render(const vibe_scene_t *scene, const vibe_view_t *view,
+                const vibe_settings_t *settings, double *rgb) {
+    if (settings->width < 2 || settings->height < 2 || settings->samples_per_pixel < 1 ||
+        settings->max_depth < 1) {
+        set_error("invalid image size, sample count or depth");
+        return -1;
+    }
+    render_rect_t rect;
+    if (vibe_crop_rect(settings, &rect) != 0) {
+        set_error("crop window outside the frame");
+        return -1;
+    }
+    camera_t camera = vibe_camera(scene, view, settings);
+
+    accum_t *accum = accum_create(rect.x1 - rect.x0, rect.y1 - rect.y0);
+    if (!accum) {
+        set_error("out of memory");
+        return -1;
+    }
+    render_settings_t rs = vibe_render_settings(scene, settings);
+    int status = settings->guiding || settings->caustic_photons > 0
+                     ? render_progressive(scene->primary, &camera, &rs, rect, settings->guiding,
+                                          settings->caustic_photons, accum)
+                     : render_region(scene->primary, &camera, &rs, rect, 0,
+                                     settings->samples_per_pixel, accum);
+    if (status != 0) {
+        set_error("out of memory");
+        accum_destroy(accum);
+        return -1;
+    }
+
+    for (int i = 0; i < accum->width * accum->height; i++) {
+        vec3_t mean = accum_pixel_mean(&accum->pixels[i]);
+        for (int c = 0; c < 3; c++) rgb[3 * i + c] = mean.e[c];
+    }
+    accum_destroy(accum);
+    return 0;
+}
+
+/* Closest hits of a batch of rays */
+int vibe_query_closest(const vibe_scene_t *scene, const vibe_rays_t *rays, int count,
+                       vibe_hits_t *hits) {
+    if (count < 0 || (count > 0 && (!query_rays_valid(rays) || !hits || !hits->t ||
+                                    !hits->primitive))) {
+        set_error("query without rays or result arrays");
+        return -1;
+    }
+    query_closest(scene->primary, (const scene_t *const *)scene->copies, rays, count, hits);
+    return 0;
+}
+
+/* Occlusion of a batch of rays */
+int vibe_query_occluded(const vibe_scene_t *scene, const vibe_rays_t *rays, int count,
+                        unsigned char *occluded) {
+    if (count < 0 || (count > 0 && (!query_rays_valid(rays) || !occluded))) {
+        set_error("query without rays or result array");
+        return -1;
+    }
+    query_occluded(scene->primary, (const scene_t *const *)scene->copies, rays, count,
+                   occluded);
+    return 0;
+}
+
+/* Write linear RGB as a PPM */
+int vibe_write_ppm(const char *path, const double *rgb, int width, int height) {
+    if (image_write_ppm_rgb(path, rgb, width, height, NULL) != 0) {
+        set_error("could not write %s", path);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+#ifndef VIBE_H
+#define VIBE_H
+
+/* libvibe: the renderer as an embeddable library (libvibe.a / libvibe.so).
+ * A scene is built once and can then be rendered any number of times with
+ * different views and settings. The render threads start on the first render
+ * and later renders reuse them. Only this header is public; the rest of src/
+ * is internal to the library and the vibe_tracing CLI. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define VIBE_API __attribute__((visibility("default")))
+#else
+#define VIBE_API
+#endif
+
+/* Defaults of vibe_settings_default */
+#define VIBE_DEFAULT_WIDTH 1200
+#define VIBE_DEFAULT_HEIGHT 800
+#define VIBE_DEFAULT_SPP 500
+#define VIBE_DEFAULT_DEPTH 50
+
+/* A built scene with its acceleration structures (opaque) */
+typedef struct vibe_scene vibe_scene_t;
+
+/* Where scene memory lives on NUMA machines */
+typedef enum {
+    VIBE_MEMORY_LOCAL,      /* pages on the node of the thread building the scene */
+    VIBE_MEMORY_INTERLEAVE, /* pages spread round-robin over all nodes */
+    VIBE_MEMORY_REPLICATE   /* an identical copy per node of the placed threads */
+} vibe_memory_t;
+
+/* Acceleration structure over a scene's objects; both find the same hits */
+typedef enum {
+    VIBE_ACCEL_BVH, /* bounding volume hierarchy (default) */
+    VIBE_ACCEL_GRID /* uniform grid: cheapest to build and traverse for fields
+                     * of many similar-sized objects */
+} vibe_accel_t;
+
+/* What to build */
+typedef struct {
+    const char *name;     /* showcase scene: "random", "bouncing", "forest", "room",
+                           * "glass", "lights" or "field" */
+    unsigned int seed;    /* layout seed, 0 for the standard showcase layout */
+    const char *obj_path; /* optional Wavefront OBJ mesh added to the scene */
+    const char *env_path; /* optional PFM latitude-longitude environment map
+                           * lighting the scene in place of the sky */
+    vibe_memory_t memory;
+    vibe_accel_t accel;
+} vibe_scene_desc_t;
+
+/* Pixel rectangle [x0, x1) x [y0, y1) of the full frame */
+typedef struct {
+    int x0, y0;
+    int x1, y1;
+} vibe_rect_t;
+
+/* Per-render parameters */
+typedef struct {
+    int width;             /* full frame resolution */
+    int height;
+    int samples_per_pixel;
+    int max_depth;
+    int threads;           /* 0: one per CPU, or the team of vibe_place_threads */
+    int chunk_size;        /* pixels per thread work item, 0: the default */
+    vibe_rect_t crop;      /* pixels to render; all zero renders the full frame */
+    unsigned int seed;     /* sampling seed */
+    int batch_size;        /* > 0: trace paths in batches, bounce by bounce */
+    int sort_rays;         /* batched mode: sort secondary rays for coherence */
+    int guiding;           /* learn a path guide over progressive passes and sample
+                            * diffuse bounces from it; the guide is trained on
+                            * the crop alone, so crops no longer match the frame */
+    int caustic_photons;   /* > 0: caustics from progressive photon maps of this
+                            * many photons each instead of from the paths */
+} vibe_settings_t;
+
+/* Camera placement */
+typedef struct {
+    double lookfrom[3];
+    double lookat[3];
+    double vup[3];
+    double vfov;       /* vertical field of view in degrees */
+    double aperture;   /* lens diameter, 0 for a pinhole */
+    double focus_dist;
+} vibe_view_t;
+
+/* A batch of rays for the query functions, as structure-of-arrays: ray i
+ * starts at (ox[i], oy[i], oz[i]) and runs along (dx[i], dy[i], dz[i]), whose
+ * length is the unit of t; hits count for t in (t_min[i], t_max[i]) */
+typedef struct {
+    const double *ox, *oy, *oz;
+    const double *dx, *dy, *dz;
+    const double *t_min; /* optional: NULL for 0 */
+    const double *t_max; /* optional: NULL for unbounded */
+    double time;         /* when all rays are cast, for moving objects */
+} vibe_rays_t;
+
+/* Closest hits of a batch, one entry per ray */
+typedef struct {
+    double *t;          /* INFINITY where nothing was hit */
+    int *primitive;     /* index of the scene's top-level object hit (a sphere or
+                         * a whole mesh), -1 where nothing was hit */
+    double *nx, *ny, *nz; /* optional (all or none): outward unit surface
+                           * normal at the hit, 0 where nothing was hit */
+} vibe_hits_t;
+
+/* Fill settings with the defaults (full frame, all CPUs, showcase seed) */
+VIBE_API void vibe_settings_default(vibe_settings_t *settings);
+
+/* Pin the render threads with a placement policy: "none", "compact",
+ * "scatter" or "cores" (see affinity.h). threads > 0 limits the team. Call
+ * before building scenes so their memory follows the placement. Returns the
+ * team size, or -1 on error. */
+VIBE_API int vibe_place_threads(const char *policy, int threads);
+
+/* Build a scene. VIBE_MEMORY_REPLICATE makes one copy per NUMA node of the
+ * threads placed by vibe_place_threads (a single copy without placement).
+ * Returns NULL on error; see vibe_last_error. */
+VIBE_API vibe_scene_t *vibe_scene_load(const vibe_scene_desc_t *desc);
+
+/* Open the shutter over [open, close] for moving objects, refitting the
+ * acceleration structures (open == close: a still exposure at that time).
+ * Returns 0 on success, -1 on error. */
+VIBE_API int vibe_scene_set_shutter(vibe_scene_t *scene, double open, double close);
+
+/* The scene's default camera placement */
+VIBE_API void vibe_scene_view(const vibe_scene_t *scene, vibe_view_t *view);
+
+/* Free a scene and all its copies */
+VIBE_API void vibe_scene_destroy(vibe_scene_t *scene);
+
+/* Render the crop window of the frame described by settings from view into
+ * rgb: crop width x crop height linear RGB triples, top row first. Pixels get
+ * the same samples as in a full-frame render, whatever the crop and thread
+ * count (with guiding: whatever the thread count). Returns 0 on success, -1
+ * on invalid settings or allocation failure. */
+VIBE_API int vibe_render(const vibe_scene_t *scene, const vibe_view_t *view,
+                         const vibe_settings_t *settings, double *rgb);
+
+/* Find the closest hit of each of count rays, spread over the render
+ * threads; nothing is allocated per ray or per call, so batches of millions
+ * of rays cost no more than their traversals. Results do not depend on the
+ * thread count. Returns 0 on success, -1 if a required array is missing. */
+VIBE_API int vibe_query_closest(const vibe_scene_t *scene, const vibe_rays_t *rays,
+                                int count, vibe_hits_t *hits);
+
+/* Set occluded[i] to 1 if anything lies along ray i within its t range, else
+ * 0, for line-of-sight tests. Cheaper than vibe_query_closest: traversal stops
+ * at the first hit found. Returns 0 on success, -1 if an array is missing. */
+VIBE_API int vibe_query_occluded(const vibe_scene_t *scene, const vibe_rays_t *rays,
+                                 int count, unsigned char *occluded);
+
+/* Write linear RGB triples as a gamma-corrected plain PPM; 0 on success */
+VIBE_API int vibe_write_ppm(const char *path, const double *rgb, int width, int height);
+
+/* Description of the last error of the calling thread */
+VIBE_API const char *vibe_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VIBE_H */
@@ -0,0 +1,28 @@
+#ifndef VIBE_PRIVATE_H
+#define VIBE_PRIVATE_H
+
+#include "camera.h"
+#include "render.h"
+#include "scene.h"
+#include "vibe.h"
+
+/* Internal view of libvibe handles, for the CLI modes that drive the
+ * renderer directly (progressive preview, distributed rendering, the daemon) */
+
+/* The scene built by the loading thread */
+const scene_t *vibe_scene_world(const vibe_scene_t *scene);
+
+/* Render settings equivalent to settings, reading the scene's per-node copies
+ * when it has them (scene may be NULL) */
+render_settings_t vibe_render_settings(const vibe_scene_t *scene,
+                                       const vibe_settings_t *settings);
+
+/* Camera of view for the full frame of settings, with the scene's shutter */
+camera_t vibe_camera(const vibe_scene_t *scene, const vibe_view_t *view,
+                     const vibe_settings_t *settings);
+
+/* The crop window of settings as a render rectangle; -1 if it lies outside
+ * the frame */
+int vibe_crop_rect(const vibe_settings_t *settings, render_rect_t *rect);
+
+#endif /* VIBE_PRIVATE_H */
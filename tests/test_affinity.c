@@ -0,0 +1,90 @@
+#include "../src/affinity.h"
+#include "../src/render.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+/* Compare a plan with the expected CPU order */
+static int plan_is(const cpu_topology_t *topo, affinity_policy_t policy, const int *expected,
+                   int count) {
+    int cpus[16];
+    return affinity_plan(topo, policy, cpus, 16) == count &&
+           memcmp(cpus, expected, count * sizeof(int)) == 0;
+}
+
+int main(void) {
+    /* Two nodes of two cores with two hardware threads each, numbered the way
+     * Linux usually does: CPU n and n + 4 are siblings, node 1 is 2-3, 6-7 */
+    cpu_info_t cpus[8];
+    for (int i = 0; i < 8; i++) {
+        cpus[i] = (cpu_info_t){.cpu = i, .core = i % 4, .smt = i / 4, .node = i % 4 / 2};
+    }
+    int node_ids[2] = {0, 1};
+    cpu_topology_t topo = {cpus, 8, 4, 2, node_ids};
+
+    check("compact fills a node's cores and siblings first",
+          plan_is(&topo, AFFINITY_COMPACT, (int[]){0, 4, 1, 5, 2, 6, 3, 7}, 8));
+    check("scatter alternates nodes, then cores, then siblings",
+          plan_is(&topo, AFFINITY_SCATTER, (int[]){0, 2, 1, 3, 4, 6, 5, 7}, 8));
+    check("cores places one thread per physical core",
+          plan_is(&topo, AFFINITY_CORES, (int[]){0, 2, 1, 3}, 4));
+    int few[3];
+    check("plan is cut to max", affinity_plan(&topo, AFFINITY_SCATTER, few, 3) == 3 && few[2] == 1);
+
+    affinity_policy_t policy;
+    check("policy names parse", affinity_parse("scatter", &policy) == 0 &&
+                                    policy == AFFINITY_SCATTER &&
+                                    strcmp(affinity_name(AFFINITY_CORES), "cores") == 0);
+    check("unknown policy is rejected", affinity_parse("spread", &policy) != 0);
+
+    /* The machine we run on */
+    cpu_topology_t *local = topology_detect();
+    check("topology detected", local && local->cpu_count >= 1 && local->core_count >= 1 &&
+                                   local->core_count <= local->cpu_count &&
+                                   local->node_count >= 1);
+    int consistent = local != NULL;
+    for (int i = 0; local && i < local->cpu_count; i++) {
+        const cpu_info_t *c = &local->cpus[i];
+        if (c->core >= local->core_count || c->node >= local->node_count || c->smt < 0) {
+            consistent = 0;
+        }
+    }
+    check("detected cpus have valid cores and nodes", consistent);
+
+    check("compact pins the team", local && affinity_apply(local, AFFINITY_COMPACT, 0) ==
+                                               local->cpu_count);
+    check("main thread runs on its node",
+          local && affinity_thread_node() == local->cpus[0].node);
+    check("thread count can be limited", local && affinity_apply(local, AFFINITY_CORES, 1) == 1);
+    check("interleaving toggles", local && affinity_interleave(local, 1) == 0 &&
+                                      affinity_interleave(local, 0) == 0);
+
+    /* Buffers zeroed by the pinned team start out empty */
+    accum_t *accum = accum_create(512, 256);
+    int zero = accum != NULL;
+    for (int i = 0; accum && i < 512 * 256; i++) {
+        if (accum->pixels[i].samples || accum->pixels[i].sum[0]) zero = 0;
+    }
+    check("first-touched buffer is zeroed", zero);
+    accum_destroy(accum);
+
+    check("none restores the process mask", local && affinity_apply(local, AFFINITY_NONE, 0) ==
+                                                         local->cpu_count &&
+                                                     affinity_thread_node() == 0);
+    topology_destroy(local);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed == 0 ? 0 : 1;
+}
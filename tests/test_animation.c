@@ -0,0 +1,190 @@
+#include "../src/animation.h"
+#include "../src/bvh.h"
+#include "../src/material.h"
+#include "../src/scene.h"
+#include "../src/sphere.h"
+#include "../src/vec3.h"
+#include "../src/ray.h"
+#include <stdio.h>
+#include <math.h>
+
+#define EPSILON 1e-9
+#define SPHERES 300
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+static int vec3_near(vec3_t a, vec3_t b) {
+    return fabs(a.e[0] - b.e[0]) < EPSILON && fabs(a.e[1] - b.e[1]) < EPSILON &&
+           fabs(a.e[2] - b.e[2]) < EPSILON;
+}
+
+/* Whether the BVH finds the same closest hits as a linear scan for rays with
+ * times drawn from [t0, t1] */
+static int bvh_matches_list(const bvh_t *bvh, const hittable_list_t *list, double t0,
+                            double t1, int *hits) {
+    int agree = 1;
+    *hits = 0;
+    for (int i = 0; i < 3000; i++) {
+        ray_t r = ray_timed(random_vec3_range(-12.0, 12.0), random_vec3_range(-1.0, 1.0),
+                            random_double_range(t0, t1));
+        hit_record_t a = {0}, b = {0};
+        int ha = bvh_hit(bvh, r, 0.001, INFINITY, &a);
+        int hb = hittable_list_hit(list, r, 0.001, INFINITY, &b);
+        if (ha != hb || (ha && fabs(a.t - b.t) > EPSILON)) agree = 0;
+        *hits += ha;
+    }
+    return agree;
+}
+
+int main(void) {
+    material_t dummy_mat = {0};
+
+    /* Keyframed paths */
+    double times[3] = {0.0, 2.0, 4.0};
+    vec3_t points[3] = {vec3(0.0, 0.0, 0.0), vec3(2.0, 0.0, 0.0), vec3(2.0, 4.0, 0.0)};
+    path_t *path = path_create(times, points, 3);
+    check("path created", path != NULL);
+    check("path at a key", vec3_near(path_eval(path, 2.0), vec3(2.0, 0.0, 0.0)));
+    check("path between keys", vec3_near(path_eval(path, 3.0), vec3(2.0, 2.0, 0.0)));
+    check("path held before first key", vec3_near(path_eval(path, -1.0), points[0]));
+    check("path held after last key", vec3_near(path_eval(path, 9.0), points[2]));
+    check("key inside interval", path_has_key_inside(path, 1.0, 3.0) &&
+                                     !path_has_key_inside(path, 2.0, 3.0));
+    double bad_times[2] = {1.0, 1.0};
+    check("non-increasing times rejected", path_create(bad_times, points, 2) == NULL);
+
+    /* Looping paths repeat with the span of their keys */
+    vec3_t hop[3] = {vec3(0.0, 0.0, 0.0), vec3(0.0, 2.0, 0.0), vec3(0.0, 0.0, 0.0)};
+    path_t *loop = path_create_loop(times, hop, 3);
+    check("loop must close", path_create_loop(times, points, 3) == NULL);
+    check("loop repeats", loop && vec3_near(path_eval(loop, 1.0), vec3(0.0, 1.0, 0.0)) &&
+                              vec3_near(path_eval(loop, 401.0), vec3(0.0, 1.0, 0.0)) &&
+                              vec3_near(path_eval(loop, -7.0), vec3(0.0, 1.0, 0.0)));
+    check("loop keys repeat", loop && path_has_key_inside(loop, 101.0, 103.0) &&
+                                  !path_has_key_inside(loop, 102.5, 103.5) &&
+                                  path_has_key_inside(loop, 3.5, 4.5));
+    path_destroy(loop);
+
+    /* A moving sphere is hit where it is at the ray's time */
+    shutter_t shutter = {0.0, 0.0};
+    moving_sphere_t *ms = moving_sphere_create(path, 0.5, &dummy_mat, &shutter);
+    hittable_t obj = moving_sphere_to_hittable(ms);
+    hit_record_t rec = {0};
+    check("moving sphere hit at time 0",
+          obj.hit(obj.data, ray_timed(vec3(0.0, 0.0, 5.0), vec3(0.0, 0.0, -1.0), 0.0),
+                  0.001, INFINITY, &rec) && fabs(rec.t - 4.5) < EPSILON);
+    check("moving sphere gone at time 2",
+          !obj.hit(obj.data, ray_timed(vec3(0.0, 0.0, 5.0), vec3(0.0, 0.0, -1.0), 2.0),
+                   0.001, INFINITY, &rec));
+    check("moving sphere hit at time 3",
+          obj.hit(obj.data, ray_timed(vec3(2.0, 2.0, 5.0), vec3(0.0, 0.0, -1.0), 3.0),
+                  0.001, INFINITY, &rec));
+
+    aabb_t box, open, close;
+    shutter = (shutter_t){1.0, 3.0};
+    obj.bounding_box(obj.data, &box);
+    check("bounds cover the key inside the shutter",
+          fabs(box.min.e[0] - 0.5) < EPSILON && fabs(box.max.e[0] - 2.5) < EPSILON &&
+              fabs(box.max.e[1] - 2.5) < EPSILON && fabs(box.min.e[1] + 0.5) < EPSILON);
+    check("no linear motion bounds across a key", !obj.motion_bounds(obj.data, &open, &close));
+    shutter = (shutter_t){2.0, 3.0};
+    check("linear motion bounds", obj.motion_bounds(obj.data, &open, &close) &&
+                                      fabs(open.max.e[1] - 0.5) < EPSILON &&
+                                      fabs(close.max.e[1] - 2.5) < EPSILON);
+    obj.destroy(obj.data);
+
+    /* Refitting a BVH built at time 0 follows the spheres */
+    random_seed(5);
+    shutter = (shutter_t){0.0, 0.0};
+    hittable_list_t *list = hittable_list_create();
+    for (int i = 0; i < SPHERES; i++) {
+        double key_times[3] = {0.0, 1.0, 2.0};
+        vec3_t keys[3];
+        keys[0] = random_vec3_range(-8.0, 8.0);
+        keys[1] = vec3_add(keys[0], random_vec3_range(-3.0, 3.0));
+        keys[2] = vec3_add(keys[1], random_vec3_range(-3.0, 3.0));
+        moving_sphere_t *s = moving_sphere_create(path_create(key_times, keys, 3),
+                                                  random_double_range(0.1, 0.5),
+                                                  &dummy_mat, &shutter);
+        hittable_list_add(list, moving_sphere_to_hittable(s));
+    }
+    bvh_t *bvh = bvh_create(list->objects, list->count);
+    int hits;
+    check("bvh matches list at build time", bvh_matches_list(bvh, list, 0.0, 0.0, &hits) &&
+                                                hits > 100);
+
+    shutter = (shutter_t){1.5, 1.5};
+    bvh_refit(bvh, shutter.open, shutter.close);
+    check("refit bvh matches list at a new time",
+          bvh_matches_list(bvh, list, 1.5, 1.5, &hits) && hits > 100);
+    check("static refit keeps no end boxes", bvh->end_boxes == NULL);
+
+    /* Motion blur with linear motion inside the shutter interpolates bounds */
+    shutter = (shutter_t){1.2, 1.8};
+    check("motion refit succeeds", bvh_refit(bvh, shutter.open, shutter.close) == 0 &&
+                                       bvh->end_boxes != NULL);
+    check("interpolated bounds match list", bvh_matches_list(bvh, list, 1.2, 1.8, &hits) &&
+                                                hits > 100);
+
+    /* A key inside the shutter falls back to bounds over the whole interval */
+    shutter = (shutter_t){0.5, 1.5};
+    bvh_refit(bvh, shutter.open, shutter.close);
+    check("bounds across keys match list", bvh_matches_list(bvh, list, 0.5, 1.5, &hits) &&
+                                               hits > 100);
+
+    aabb_t root;
+    bvh_bounding_box(bvh, &root);
+    int contained = 1;
+    for (int i = 0; i < list->count; i++) {
+        list->objects[i].bounding_box(list->objects[i].data, &box);
+        for (int a = 0; a < 3; a++) {
+            if (box.min.e[a] < root.min.e[a] || box.max.e[a] > root.max.e[a]) contained = 0;
+        }
+    }
+    check("root bounds contain all motion", contained);
+    bvh_destroy(bvh);
+    hittable_list_destroy(list);
+
+    /* The bouncing scene moves between frames */
+    scene_t *scene = scene_create_bouncing(SCENE_DEFAULT_SEED);
+    check("bouncing scene created", scene != NULL);
+    int moved = 0;
+    for (int i = 0; i < scene->world->count && !moved; i++) {
+        hittable_t *o = &scene->world->objects[i];
+        if (!o->motion_bounds) continue;
+        aabb_t a, b;
+        scene_set_shutter(scene, 0.0, 0.0);
+        o->bounding_box(o->data, &a);
+        scene_set_shutter(scene, 2.0, 2.0);
+        o->bounding_box(o->data, &b);
+        moved = fabs(a.min.e[1] - b.min.e[1]) > EPSILON;
+    }
+    check("bouncing spheres move", moved);
+    int repeats = 1;
+    for (int i = 0; i < scene->world->count; i++) {
+        hittable_t *o = &scene->world->objects[i];
+        if (!o->motion_bounds) continue;
+        aabb_t a, b;
+        scene_set_shutter(scene, 3.0, 3.5);
+        o->bounding_box(o->data, &a);
+        scene_set_shutter(scene, 3.0 + 8.0 * 50, 3.5 + 8.0 * 50);
+        o->bounding_box(o->data, &b);
+        repeats &= fabs(a.min.e[1] - b.min.e[1]) < EPSILON &&
+                   fabs(a.max.e[1] - b.max.e[1]) < EPSILON;
+    }
+    check("bouncing repeats every 8 frames", repeats);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed == 0 ? 0 : 1;
+}
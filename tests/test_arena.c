@@ -0,0 +1,118 @@
+#include "../src/arena.h"
+#include "../src/scene.h"
+#include "../src/sphere.h"
+#include <math.h>
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+#define SIDE 60
+
+/* Whether two field scenes hold the same spheres in the same order */
+static int same_field(const scene_t *a, const scene_t *b) {
+    if (a->world->count != b->world->count) return 0;
+    for (int i = 0; i < a->world->count; i++) {
+        const sphere_t *x = sphere_from_hittable(&a->world->objects[i]);
+        const sphere_t *y = sphere_from_hittable(&b->world->objects[i]);
+        if (!x || !y || memcmp(&x->center, &y->center, sizeof(vec3_t)) != 0 ||
+            x->radius != y->radius)
+            return 0;
+        const vec3_t *p = x->material->diffuse, *q = y->material->diffuse;
+        if ((p == NULL) != (q == NULL) || (p && memcmp(p, q, sizeof(vec3_t)) != 0)) return 0;
+    }
+    return 1;
+}
+
+int main(void) {
+    /* Allocations are aligned and bump through one block */
+    arena_t *arena = arena_create(0);
+    char *a = arena_alloc(arena, 3, 1);
+    double *d = arena_alloc(arena, sizeof(double), _Alignof(double));
+    void *line = arena_alloc(arena, 10, ARENA_BLOCK_ALIGN);
+    check("allocations are aligned", (uintptr_t)d % _Alignof(double) == 0 &&
+                                         (uintptr_t)line % ARENA_BLOCK_ALIGN == 0);
+    check("allocations follow each other", (char *)d > a && (char *)d - a < 16 &&
+                                               arena->reserved == ARENA_MIN_BLOCK);
+
+    /* Large requests start blocks of their own, and blocks grow */
+    char *big = arena_alloc(arena, 3 * ARENA_MIN_BLOCK, 8);
+    memset(big, 1, 3 * ARENA_MIN_BLOCK);
+    size_t grown = arena->reserved;
+    char *small = arena_alloc(arena, 16, 8);
+    check("blocks grow with requests", big && small && grown >= 4 * ARENA_MIN_BLOCK &&
+                                           arena->reserved - grown >= 4 * ARENA_MIN_BLOCK);
+
+    /* Reserving keeps the next allocations in one block */
+    size_t before = arena->reserved;
+    check("reserve makes room", arena_reserve(arena, 1 << 20) == 0 && arena->reserved > before);
+    before = arena->reserved;
+    char *first = arena_alloc(arena, 1000, 8), *last = first;
+    for (int i = 0; i < 1000; i++) last = arena_alloc(arena, 1000, 8);
+    check("reserved room is used", arena->reserved == before && last == first + 1000 * 1000);
+
+    /* Merged arenas keep their allocations */
+    arena_t *other = arena_create(1 << 16);
+    int *values = arena_alloc(other, 100 * sizeof(int), _Alignof(int));
+    for (int i = 0; i < 100; i++) values[i] = i;
+    size_t used = arena->used + other->used;
+    arena_merge(arena, other);
+    int intact = arena->used == used;
+    int *after = arena_alloc(arena, 100 * sizeof(int), _Alignof(int));
+    for (int i = 0; i < 100; i++) after[i] = -1;
+    for (int i = 0; i < 100; i++) intact &= values[i] == i;
+    check("merge keeps allocations", intact);
+    arena_destroy(arena);
+
+    /* The field's layout does not depend on the thread count */
+    omp_set_num_threads(1);
+    scene_t *serial = scene_create_field(SCENE_DEFAULT_SEED, SIDE);
+    omp_set_num_threads(3);
+    scene_t *parallel = scene_create_field(SCENE_DEFAULT_SEED, SIDE);
+    check("field is built", serial && parallel && serial->world->count == SIDE * SIDE + 4);
+    check("field layout is thread independent",
+          serial && parallel && same_field(serial, parallel));
+    scene_destroy(serial);
+
+    /* Adjacent seeds give unrelated fields, not copies shifted by a row */
+    scene_t *next = scene_create_field(SCENE_DEFAULT_SEED + 1, SIDE);
+    int shifted = 0;
+    for (int b = 0; next && parallel && b < SIDE; b++) {
+        const sphere_t *x = sphere_from_hittable(&parallel->world->objects[1 + SIDE + b]);
+        const sphere_t *y = sphere_from_hittable(&next->world->objects[1 + b]);
+        shifted += fabs(x->center.e[0] - 1.0 - y->center.e[0]) < 1e-9 &&
+                   x->center.e[2] == y->center.e[2];
+    }
+    check("seeds give independent fields", next && shifted == 0);
+    scene_destroy(next);
+
+    /* Rays straight down land on small spheres or the ground, alike with
+     * either accelerator */
+    int hits[2] = {0, 0};
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) scene_set_accelerator(parallel, SCENE_ACCEL_GRID);
+        for (int i = 0; i < 200; i++) {
+            ray_t r = ray_timed(vec3(-10.0 + 0.1 * i, 5.0, 7.5), vec3(0.0, -1.0, 0.0), 0.0);
+            hit_record_t rec;
+            hits[pass] += scene_hit(parallel, r, 0.001, INFINITY, &rec) && rec.t < 4.9;
+        }
+    }
+    printf("  %d of 200 rays hit a small sphere\n", hits[0]);
+    check("small spheres are hit", hits[0] > 10 && hits[0] < 200 && hits[0] == hits[1]);
+    scene_destroy(parallel);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+#include "../src/autotune.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include <omp.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+int main(void) {
+    char host[320];
+    autotune_host(host, sizeof(host));
+    printf("  host: %s\n", host);
+    check("host key is one line", host[0] && !strchr(host, '\n'));
+
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    int size_class = autotune_size_class(scene);
+    printf("  %d objects, size class %d\n", scene->world->count, size_class);
+    check("size class counts digits", size_class == (scene->world->count >= 100 ? 3 : 2));
+
+    /* Chunk sizes only change how the frame is shared out */
+    render_settings_t settings = {.width = 48, .height = 32, .samples_per_pixel = 4,
+                                  .max_depth = 8, .seed = 9};
+    render_rect_t full = {0, 0, 48, 32};
+    camera_t camera = scene_camera(scene, 1.5);
+    accum_t *a = accum_create(48, 32);
+    accum_t *b = accum_create(48, 32);
+    render_region(scene, &camera, &settings, full, 0, 4, a);
+    settings.chunk_size = 7;
+    render_region(scene, &camera, &settings, full, 0, 4, b);
+    check("chunk size leaves the image unchanged",
+          memcmp(a->pixels, b->pixels, 48 * 32 * sizeof(accum_pixel_t)) == 0);
+    accum_destroy(a);
+    accum_destroy(b);
+
+    autotune_config_t best;
+    int renders = autotune_run(scene, &camera, &settings, full, &best);
+    printf("  %d renders: %d threads, chunk %d, %.0f samples/s\n", renders, best.threads,
+           best.chunk, best.rate);
+    check("tuning picks a configuration", renders > 1 && best.rate > 0.0 && best.chunk > 0 &&
+          best.threads >= 1 && best.threads <= omp_get_max_threads());
+    scene_destroy(scene);
+
+    /* Cache entries are kept per host and size class */
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/test_autotune_%d/cache", (int)getpid());
+    autotune_config_t loaded;
+    check("missing cache has no entry", autotune_load(path, host, 3, &loaded) != 0);
+    autotune_config_t small = {2, 16, 1000.0}, large = {4, 256, 50.0}, other = {8, 64, 9.0};
+    int saved = autotune_save(path, host, 2, &small) == 0 &&
+                autotune_save(path, host, 5, &large) == 0 &&
+                autotune_save(path, "Other CPU, 8 CPUs", 2, &other) == 0;
+    check("entries saved", saved);
+    check("entry read back", autotune_load(path, host, 5, &loaded) == 0 &&
+          loaded.threads == 4 && loaded.chunk == 256 && loaded.rate == 50.0);
+    check("hosts kept apart", autotune_load(path, "Other CPU, 8 CPUs", 2, &loaded) == 0 &&
+          loaded.threads == 8 && autotune_load(path, "Other CPU", 2, &loaded) != 0);
+
+    autotune_config_t retuned = {3, 4, 1200.0};
+    autotune_save(path, host, 2, &retuned);
+    int lines = 0;
+    char line[512];
+    FILE *f = fopen(path, "r");
+    while (f && fgets(line, sizeof(line), f)) lines++;
+    if (f) fclose(f);
+    check("saving replaces the entry", autotune_load(path, host, 2, &loaded) == 0 &&
+          loaded.threads == 3 && loaded.chunk == 4 && lines == 3);
+
+    remove(path);
+    *strrchr(path, '/') = '\0';
+    rmdir(path);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
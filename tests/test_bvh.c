@@ -0,0 +1,94 @@
+#include "../src/bvh.h"
+#include "../src/hittable.h"
+#include "../src/material.h"
+#include "../src/sphere.h"
+#include "../src/vec3.h"
+#include "../src/ray.h"
+#include <stdio.h>
+#include <math.h>
+
+#define EPSILON 1e-9
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+/* A hittable with no bounds that every ray hits at t = 100 */
+static int wall_hit(const void *obj, const ray_t r, double t_min, double t_max,
+                    hit_record_t *rec) {
+    (void)obj;
+    if (100.0 < t_min || 100.0 > t_max) return 0;
+    rec->t = 100.0;
+    rec->point = ray_at(r, 100.0);
+    rec->normal = vec3(0.0, 0.0, 1.0);
+    return 1;
+}
+
+int main(void) {
+    material_t dummy_mat = {0};
+    hittable_list_t *list = hittable_list_create();
+
+    /* Random field of spheres */
+    random_seed(42);
+    for (int i = 0; i < 500; i++) {
+        vec3_t c = random_vec3_range(-10.0, 10.0);
+        sphere_t *s = sphere_create(c, random_double_range(0.05, 0.6), &dummy_mat);
+        hittable_list_add(list, sphere_to_hittable(s));
+    }
+
+    bvh_t *bvh = bvh_create(list->objects, list->count);
+    check("bvh created", bvh != NULL);
+    check("all objects bounded", bvh->object_count == 500 && bvh->unbounded_count == 0);
+    check("node count within 2n-1", bvh->node_count > 0 && bvh->node_count < 1000);
+
+    aabb_t list_box, bvh_box;
+    hittable_list_bounding_box(list, &list_box);
+    check("root box equals list box",
+          bvh_bounding_box(bvh, &bvh_box) &&
+          fabs(bvh_box.min.e[0] - list_box.min.e[0]) < EPSILON &&
+          fabs(bvh_box.max.e[2] - list_box.max.e[2]) < EPSILON);
+
+    /* The BVH finds the same closest hits as a linear scan */
+    int agree = 1, hits = 0;
+    for (int i = 0; i < 2000; i++) {
+        ray_t r = ray(random_vec3_range(-15.0, 15.0), random_unit_vector());
+        hit_record_t a = {0}, b = {0};
+        int ha = hittable_list_hit(list, r, 0.001, INFINITY, &a);
+        int hb = bvh_hit(bvh, r, 0.001, INFINITY, &b);
+        hits += ha;
+        if (ha != hb || (ha && fabs(a.t - b.t) > EPSILON)) agree = 0;
+    }
+    check("bvh agrees with linear scan", agree);
+    check("test rays hit something", hits > 100);
+
+    /* Unbounded objects are kept aside and still tested */
+    hittable_t objects[2] = {list->objects[0],
+                             {.data = NULL, .hit = wall_hit, .bounding_box = NULL}};
+    bvh_t *mixed = bvh_create(objects, 2);
+    check("unbounded object set aside", mixed->unbounded_count == 1);
+    hit_record_t rec = {0};
+    ray_t away = ray(vec3(100.0, 100.0, 100.0), vec3(1.0, 0.0, 0.0));
+    check("unbounded object hit", bvh_hit(mixed, away, 0.001, INFINITY, &rec) &&
+                                  fabs(rec.t - 100.0) < EPSILON);
+    check("unbounded bvh has no box", !bvh_bounding_box(mixed, &bvh_box));
+    bvh_destroy(mixed);
+
+    /* Empty BVH */
+    bvh_t *empty = bvh_create(NULL, 0);
+    check("empty bvh misses", !bvh_hit(empty, away, 0.001, INFINITY, &rec));
+    bvh_destroy(empty);
+
+    bvh_destroy(bvh);
+    hittable_list_destroy(list);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed == 0 ? 0 : 1;
+}
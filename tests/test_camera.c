@@ -77,6 +77,22 @@ int main(void) {
     );
     check_double("dof lens radius = 1.0", cam_dof.lens_radius, 1.0);
 
+    /* Closed shutter: every ray samples the frame time */
+    check_double("default ray time = 0", center_ray.time, 0.0);
+    camera_set_shutter(&cam, 3.0, 3.0);
+    check_double("closed shutter ray time", camera_get_ray(&cam, 0.5, 0.5).time, 3.0);
+
+    /* Open shutter: ray times spread over the interval */
+    camera_set_shutter(&cam, 3.0, 3.5);
+    double tmin = 10.0, tmax = -10.0;
+    for (int i = 0; i < 200; i++) {
+        double t = camera_get_ray(&cam, 0.5, 0.5).time;
+        if (t < tmin) tmin = t;
+        if (t > tmax) tmax = t;
+    }
+    check("open shutter ray times within interval", tmin >= 3.0 && tmax <= 3.5);
+    check("open shutter ray times spread", tmax - tmin > 0.4);
+
     printf("\n%d/%d tests passed\n", passed, passed + failed);
     return failed == 0 ? 0 : 1;
 }
@@ -0,0 +1,91 @@
+#include "../src/compiled.h"
+#include "../src/scene.h"
+#include <stdio.h>
+#include <string.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+#define WIDTH 48
+#define HEIGHT 27
+
+/* Whether two frames hold the same sums and counts */
+static int same_frame(const accum_t *a, const accum_t *b) {
+    return a->width == b->width && a->height == b->height &&
+           memcmp(a->pixels, b->pixels, (size_t)a->width * a->height * sizeof(accum_pixel_t)) == 0;
+}
+
+int main(void) {
+    /* The compiled-in scene is the one the Makefile names */
+    check("compiled scene is random", strcmp(compiled_scene_name, "random") == 0);
+    scene_t *scene = scene_create_named(compiled_scene_name, compiled_scene_seed);
+    check("compiled scene can be rebuilt", scene != NULL);
+    if (!scene) {
+        printf("\n%d/%d tests passed\n", passed, passed + failed);
+        return 1;
+    }
+
+    double aspect = (double)WIDTH / HEIGHT;
+    camera_t generic_camera = scene_camera(scene, aspect);
+    camera_t camera = compiled_camera(aspect);
+    check("camera matches the scene's", memcmp(&camera, &generic_camera, sizeof(camera)) == 0);
+
+    /* Same image as the generic renderer, bit for bit */
+    render_settings_t settings = {
+        .width = WIDTH,
+        .height = HEIGHT,
+        .samples_per_pixel = 4,
+        .max_depth = 10,
+        .seed = 11,
+        .threads = 2,
+    };
+    render_rect_t full = {0, 0, WIDTH, HEIGHT};
+    accum_t *expected = accum_create(WIDTH, HEIGHT);
+    accum_t *frame = accum_create(WIDTH, HEIGHT);
+    render_region(scene, &generic_camera, &settings, full, 0, 4, expected);
+    int status = compiled_render(&camera, &settings, full, 0, 4, frame);
+    check("full frame matches the generic renderer", status == 0 && same_frame(frame, expected));
+
+    /* Sample ranges add up, and threads do not matter */
+    accum_clear(frame);
+    settings.threads = 1;
+    compiled_render(&camera, &settings, full, 0, 1, frame);
+    settings.threads = 3;
+    compiled_render(&camera, &settings, full, 1, 4, frame);
+    check("split samples and thread counts give the same frame", same_frame(frame, expected));
+
+    /* A crop holds the same pixels as the full frame */
+    render_rect_t crop = {10, 5, 30, 20};
+    accum_t *part = accum_create(crop.x1 - crop.x0, crop.y1 - crop.y0);
+    compiled_render(&camera, &settings, crop, 0, 4, part);
+    int crop_same = 1;
+    for (int y = crop.y0; y < crop.y1; y++) {
+        crop_same &= memcmp(&part->pixels[(y - crop.y0) * part->width],
+                            &expected->pixels[y * WIDTH + crop.x0],
+                            part->width * sizeof(accum_pixel_t)) == 0;
+    }
+    check("crop matches the full frame", crop_same);
+
+    /* Cancellation stops the render */
+    atomic_int cancel = 1;
+    settings.cancel = &cancel;
+    check("cancelled render reports it",
+          compiled_render(&camera, &settings, full, 0, 4, frame) == -1);
+
+    accum_destroy(part);
+    accum_destroy(frame);
+    accum_destroy(expected);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+#include "../src/deadline.h"
+#include "../src/image.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+/* Every pixel of out (covering rect) equals render_pixel over its own samples */
+static int matches_render_pixel(const scene_t *scene, const camera_t *camera,
+                                const render_settings_t *settings, render_rect_t rect,
+                                const accum_t *out) {
+    for (int y = rect.y0; y < rect.y1; y++) {
+        for (int x = rect.x0; x < rect.x1; x++) {
+            const accum_pixel_t *p = &out->pixels[(y - rect.y0) * out->width + (x - rect.x0)];
+            accum_pixel_t ref = {0};
+            render_pixel(scene, camera, settings, x, y, 0, (int)p->samples, &ref);
+            if (memcmp(&ref, p, sizeof(ref)) != 0) return 0;
+        }
+    }
+    return 1;
+}
+
+int main(void) {
+    render_settings_t settings = {
+        .width = 32,
+        .height = 24,
+        .samples_per_pixel = 10000,
+        .max_depth = 8,
+        .seed = 3,
+    };
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    camera_t camera = scene_camera(scene, 32.0 / 24.0);
+    render_rect_t full = {0, 0, settings.width, settings.height};
+
+    /* A short budget, far below the sample cap */
+    accum_t *out = accum_create(settings.width, settings.height);
+    deadline_stats_t stats;
+    int status = deadline_render(scene, &camera, &settings, full, 0.3, out, &stats);
+    check("deadline render succeeds", status == 0);
+    check("render stops at the deadline", stats.elapsed < 0.35);
+    check("render uses most of the budget", stats.elapsed > 0.2);
+    check("every pixel reaches the minimum sample count", stats.min_spp >= DEADLINE_MIN_SPP);
+    check("noisy pixels get more samples", stats.max_spp > 2 * stats.min_spp);
+    uint64_t total = 0;
+    for (int i = 0; i < settings.width * settings.height; i++) total += out->pixels[i].samples;
+    check("stats count every sample", total == stats.samples && stats.passes > 2 &&
+                                      stats.rate > 0.0);
+    check("pixels hold their first samples exactly",
+          matches_render_pixel(scene, &camera, &settings, full, out));
+
+    /* A generous budget ends once every pixel reaches the cap */
+    render_settings_t capped = settings;
+    capped.samples_per_pixel = 8;
+    render_rect_t crop = {8, 4, 20, 14};
+    accum_t *small = accum_create(12, 10);
+    deadline_render(scene, &camera, &capped, crop, 30.0, small, &stats);
+    check("capped render finishes early", stats.elapsed < 10.0);
+    check("capped render gives every pixel the cap",
+          stats.min_spp == 8 && stats.max_spp == 8);
+    accum_t *ref = accum_create(12, 10);
+    render_region(scene, &camera, &capped, crop, 0, 8, ref);
+    check("capped crop equals a uniform render",
+          memcmp(ref->pixels, small->pixels, 12 * 10 * sizeof(accum_pixel_t)) == 0);
+
+    /* No time at all */
+    accum_clear(out);
+    status = deadline_render(scene, &camera, &settings, full, 0.0, out, &stats);
+    check("zero budget traces nothing", status == 0 && stats.samples == 0);
+
+    /* The achieved sample counts go into the image header */
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/test_deadline_%d.ppm", (int)getpid());
+    image_write_ppm_comment(path, small, "deadline 30.000 s\nspp mean 8.00 min 8 max 8");
+    char line[4][64] = {{0}};
+    FILE *f = fopen(path, "r");
+    for (int i = 0; f && i < 4; i++) {
+        if (!fgets(line[i], sizeof(line[i]), f)) break;
+    }
+    if (f) fclose(f);
+    remove(path);
+    check("metadata is written as header comments",
+          strcmp(line[0], "P3\n") == 0 && strcmp(line[1], "# deadline 30.000 s\n") == 0 &&
+              strcmp(line[2], "# spp mean 8.00 min 8 max 8\n") == 0 &&
+              strcmp(line[3], "12 10\n") == 0);
+
+    accum_destroy(ref);
+    accum_destroy(small);
+    accum_destroy(out);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
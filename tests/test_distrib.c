@@ -0,0 +1,148 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../src/distrib.h"
+#include "../src/net.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+/* Fork a worker that takes one job, sends the header of its result and then
+ * stalls until killed */
+static pid_t spawn_staller(const char *address) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = net_connect(address, 10.0);
+        net_header_t h;
+        uint32_t job[64]; /* msg_job_t (see distrib.c): x0, y0, x1, y1 at 5..8 */
+        if (fd < 0 || net_recv_header(fd, &h) != 0 || h.payload > sizeof(job) ||
+            net_recv_all(fd, job, h.payload) != 0) {
+            _exit(1);
+        }
+        uint32_t pixels = (job[7] - job[5]) * (job[8] - job[6]);
+        net_header_t result = {NET_MAGIC, 2, h.id, pixels * (uint32_t)sizeof(accum_pixel_t)};
+        net_send_all(fd, &result, sizeof(result));
+        while (1) pause();
+    }
+    return pid;
+}
+
+/* Fork a worker process that serves at most max_jobs jobs */
+static pid_t spawn_worker(const char *address, int max_jobs) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(distrib_work(address, max_jobs) == 0 ? 0 : 1);
+    }
+    return pid;
+}
+
+int main(void) {
+    render_settings_t settings = {
+        .width = 40,
+        .height = 24,
+        .samples_per_pixel = 4,
+        .max_depth = 6,
+        .seed = 11,
+    };
+    char address[64];
+    snprintf(address, sizeof(address), "unix:/tmp/vibe_test_%d.sock", (int)getpid());
+
+    /* Distributed render first: the workers are forked before this process
+     * starts any OpenMP threads. One worker quits after two jobs, so its
+     * third job has to be reassigned. */
+    pid_t workers[3];
+    workers[0] = spawn_worker(address, 0);
+    workers[1] = spawn_worker(address, 0);
+    workers[2] = spawn_worker(address, 2);
+
+    distrib_options_t opts = {
+        .address = address,
+        .local_workers = 0,
+        .tile_size = 16,
+        .sample_splits = 2,
+        .min_workers = 3,
+    };
+    accum_t *dist = accum_create(settings.width, settings.height);
+    int status = distrib_coordinate(&opts, "random", SCENE_DEFAULT_SEED, &settings, dist);
+    check("coordinator completes all jobs", status == 0);
+
+    int clean_exits = 0;
+    for (int i = 0; i < 3; i++) {
+        int ws = 0;
+        waitpid(workers[i], &ws, 0);
+        clean_exits += WIFEXITED(ws) && WEXITSTATUS(ws) == 0;
+    }
+    check("workers exit cleanly", clean_exits == 3);
+
+    /* A coordinator whose only worker drops out gives up instead of waiting
+     * forever */
+    snprintf(address, sizeof(address), "unix:/tmp/vibe_test_%d_lost.sock", (int)getpid());
+    pid_t quitter = spawn_worker(address, 1);
+    distrib_options_t lone = {
+        .address = address,
+        .tile_size = 16,
+        .min_workers = 1,
+        .worker_wait = 0.5,
+    };
+    accum_t *partial = accum_create(settings.width, settings.height);
+    status = distrib_coordinate(&lone, "random", SCENE_DEFAULT_SEED, &settings, partial);
+    waitpid(quitter, NULL, 0);
+    check("coordinator fails once every worker is gone", status == -1);
+    accum_destroy(partial);
+
+    /* A worker stalled halfway through its result neither freezes the
+     * coordinator nor keeps its job from being reassigned */
+    snprintf(address, sizeof(address), "unix:/tmp/vibe_test_%d_stall.sock", (int)getpid());
+    pid_t staller = spawn_staller(address);
+    pid_t helper = spawn_worker(address, 0);
+    distrib_options_t stall = {
+        .address = address,
+        .tile_size = 16,
+        .min_workers = 2,
+        .job_timeout = 0.2,
+    };
+    accum_t *stalled = accum_create(settings.width, settings.height);
+    status = distrib_coordinate(&stall, "random", SCENE_DEFAULT_SEED, &settings, stalled);
+    kill(staller, SIGKILL);
+    waitpid(staller, NULL, 0);
+    waitpid(helper, NULL, 0);
+    check("stalled result is rendered elsewhere", status == 0 &&
+          memcmp(stalled->pixels, dist->pixels,
+                 (size_t)settings.width * settings.height * sizeof(accum_pixel_t)) == 0);
+    accum_destroy(stalled);
+
+    /* Reference: the same frame in one process at full spp */
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    camera_t camera = scene_camera(scene, (double)settings.width / settings.height);
+    accum_t *ref = accum_create(settings.width, settings.height);
+    render_rect_t full = {0, 0, settings.width, settings.height};
+    render_region(scene, &camera, &settings, full, 0, settings.samples_per_pixel, ref);
+
+    check("every pixel has all samples",
+          dist->pixels[0].samples == 4 &&
+          dist->pixels[settings.width * settings.height - 1].samples == 4);
+    check("distributed result matches single process exactly",
+          memcmp(dist->pixels, ref->pixels,
+                 (size_t)settings.width * settings.height * sizeof(accum_pixel_t)) == 0);
+
+    accum_destroy(dist);
+    accum_destroy(ref);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+#include "../src/envmap.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include "../src/sphere.h"
+#include "../src/utils.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+#define MAP_WIDTH 16
+#define MAP_HEIGHT 8
+#define TEXELS (MAP_WIDTH * MAP_HEIGHT)
+#define SAMPLES 400000
+
+/* A map with one bright texel (the sun) at row sun_row, column sun_column
+ * over a sky of the given radiance */
+static envmap_t *sun_map(int width, int height, int sun_row, int sun_column, float sun,
+                         float sky) {
+    float *rgb = malloc((size_t)width * height * 3 * sizeof(float));
+    for (int i = 0; i < width * height; i++) {
+        float value = i == sun_row * width + sun_column ? sun : sky;
+        for (int c = 0; c < 3; c++) rgb[3 * i + c] = value;
+    }
+    envmap_t *env = envmap_create(width, height, rgb);
+    free(rgb);
+    return env;
+}
+
+/* Mean luminance of the pixels of a frame's centre box, and the largest
+ * relative deviation of one from it */
+static double centre_mean(const accum_t *frame, int margin, double *deviation) {
+    double sum = 0.0;
+    int count = 0;
+    for (int y = margin; y < frame->height - margin; y++) {
+        for (int x = margin; x < frame->width - margin; x++) {
+            sum += accum_pixel_mean(&frame->pixels[y * frame->width + x]).e[1];
+            count++;
+        }
+    }
+    double mean = sum / count;
+    *deviation = 0.0;
+    for (int y = margin; y < frame->height - margin; y++) {
+        for (int x = margin; x < frame->width - margin; x++) {
+            double v = accum_pixel_mean(&frame->pixels[y * frame->width + x]).e[1];
+            *deviation = fmax(*deviation, fabs(v - mean) / mean);
+        }
+    }
+    return mean;
+}
+
+/* A scene of one Lambertian sphere of albedo under env */
+static scene_t *sphere_scene(envmap_t *env, vec3_t center, double radius, double albedo) {
+    scene_t *scene = scene_create();
+    const material_t *mat = scene_add_material(scene, lambertian_create(vec3(albedo, albedo,
+                                                                             albedo)));
+    hittable_list_add(scene->world, sphere_to_hittable(sphere_create(center, radius, mat)));
+    scene_finalize(scene);
+    scene_set_environment(scene, env);
+    return scene;
+}
+
+int main(void) {
+    /* Texels are drawn in proportion to luminance times solid angle */
+    float rgb[TEXELS * 3];
+    for (int i = 0; i < TEXELS; i++) {
+        for (int c = 0; c < 3; c++) rgb[3 * i + c] = (float)(1 + (i * 7) % 5);
+    }
+    envmap_t *env = envmap_create(MAP_WIDTH, MAP_HEIGHT, rgb);
+    check("map is created", env != NULL);
+    int counts[TEXELS] = {0};
+    int pdf_match = 1;
+    random_seed(9);
+    for (int n = 0; n < SAMPLES; n++) {
+        double pdf;
+        vec3_t d = envmap_sample(env, random_double(), random_double(), random_double(),
+                                 random_double(), &pdf);
+        double theta = acos(d.e[1]);
+        double phi = atan2(d.e[2], d.e[0]);
+        int x = (int)((phi + PI) / (2.0 * PI) * MAP_WIDTH);
+        int y = (int)(theta / PI * MAP_HEIGHT);
+        counts[y * MAP_WIDTH + x]++;
+        pdf_match &= fabs(pdf - envmap_pdf(env, d)) <= 1e-4 * pdf;
+    }
+    double worst = 0.0;
+    for (int i = 0; i < TEXELS; i++) {
+        double expected = env->density[i] / TEXELS;
+        worst = fmax(worst, fabs(counts[i] / (double)SAMPLES - expected) / expected);
+    }
+    check("samples follow luminance times solid angle", worst < 0.1);
+    check("sampled densities match envmap_pdf", pdf_match);
+
+    /* The density integrates to one over the sphere */
+    double integral = 0.0;
+    for (int n = 0; n < SAMPLES; n++) {
+        integral += envmap_pdf(env, random_unit_vector()) * 4.0 * PI;
+    }
+    check("density integrates to one", fabs(integral / SAMPLES - 1.0) < 0.02);
+
+    /* Orientation: row 0 is up, column 0 faces -x */
+    check("lookups follow the lat-long layout",
+          envmap_lookup(env, vec3(0.0, 1.0, 0.0)).e[0] == rgb[3 * (MAP_WIDTH / 2)] &&
+          envmap_lookup(env, vec3(-1.0, -0.01, -0.01)).e[0] ==
+              rgb[3 * (MAP_HEIGHT / 2 * MAP_WIDTH)] &&
+          envmap_lookup(env, vec3(0.01, 0.0, -1.0)).e[0] ==
+              rgb[3 * (MAP_HEIGHT / 2 * MAP_WIDTH + MAP_WIDTH / 4)]);
+
+    /* PFM round trip, and a big-endian grey map */
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/test_envmap_%d.pfm", (int)getpid());
+    envmap_t *loaded = envmap_write_pfm(env, path) == 0 ? envmap_load_pfm(path) : NULL;
+    check("PFM round trip keeps every texel", loaded &&
+          memcmp(loaded->rgb, env->rgb, sizeof(rgb)) == 0);
+    envmap_destroy(loaded);
+    FILE *f = fopen(path, "wb");
+    fprintf(f, "Pf\n2 1\n1.0\n");
+    unsigned char grey[8] = {0x3f, 0x80, 0, 0, 0x40, 0x40, 0, 0}; /* 1.0, 3.0 */
+    fwrite(grey, 1, 8, f);
+    fclose(f);
+    loaded = envmap_load_pfm(path);
+    check("big-endian grey PFM loads", loaded && loaded->rgb[0] == 1.0f &&
+          loaded->rgb[2] == 1.0f && loaded->rgb[3] == 3.0f);
+    envmap_destroy(loaded);
+    remove(path);
+    check("missing files are rejected", envmap_load_pfm("/nonexistent/map.pfm") == NULL);
+    rgb[5] = -1.0f;
+    check("negative texels are rejected", envmap_create(MAP_WIDTH, MAP_HEIGHT, rgb) == NULL);
+    envmap_destroy(env);
+
+    /* Furnace: a lone diffuse sphere under uniform light reflects its albedo */
+    scene_t *scene = sphere_scene(sun_map(32, 16, 0, 0, 1.0f, 1.0f), vec3(0.0, 0.0, 0.0),
+                                  1.0, 0.5);
+    camera_t camera = camera_create(vec3(0.0, 0.0, 5.0), vec3(0.0, 0.0, 0.0),
+                                    vec3(0.0, 1.0, 0.0), 10.0, 1.0, 0.0, 5.0);
+    render_settings_t settings = {.width = 24, .height = 24, .samples_per_pixel = 64,
+                                  .max_depth = 10, .seed = 3};
+    accum_t *frame = accum_create(24, 24);
+    render_region(scene, &camera, &settings, (render_rect_t){0, 0, 24, 24}, 0, 64, frame);
+    double deviation;
+    double mean = centre_mean(frame, 8, &deviation);
+    printf("  furnace %.4f\n", mean);
+    check("furnace sphere reflects its albedo", fabs(mean - 0.5) < 0.005);
+    accum_destroy(frame);
+    scene_destroy(scene);
+
+    /* A small sun over the ground: irradiance L (2 pi / W) (sin^2 t1 - sin^2 t0) / 2 */
+    int width = 64, height = 32, row = 8;
+    double t0 = PI * row / height, t1 = PI * (row + 1) / height;
+    double sun = 1000.0, albedo = 0.8;
+    double expected = albedo / PI * sun * (2.0 * PI / width) *
+                      (sin(t1) * sin(t1) - sin(t0) * sin(t0)) / 2.0;
+    scene = sphere_scene(sun_map(width, height, row, 20, (float)sun, 0.0f),
+                         vec3(0.0, -1000.0, 0.0), 1000.0, albedo);
+    camera = camera_create(vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 0.0), vec3(0.0, 0.0, -1.0),
+                           30.0, 1.0, 0.0, 1.0);
+    settings.samples_per_pixel = 16;
+    frame = accum_create(24, 24);
+    render_region(scene, &camera, &settings, (render_rect_t){0, 0, 24, 24}, 0, 16, frame);
+    mean = centre_mean(frame, 0, &deviation);
+    printf("  sun-lit ground %.4f, expected %.4f, worst pixel off by %.1f%%\n", mean, expected,
+           100.0 * deviation);
+    check("sun-lit ground has the expected radiance", fabs(mean / expected - 1.0) < 0.02);
+    check("sun sampling keeps every pixel close", deviation < 0.15);
+    accum_destroy(frame);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
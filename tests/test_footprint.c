@@ -0,0 +1,165 @@
+#include "../src/footprint.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include "../src/sphere.h"
+#include "../src/utils.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+#define WIDTH 40
+#define HEIGHT 24
+#define PIXELS (WIDTH * HEIGHT)
+
+/* Number of pixels that differ between two frames */
+static int differing(const accum_t *a, const accum_t *b) {
+    int count = 0;
+    for (int i = 0; i < PIXELS; i++) {
+        count += memcmp(&a->pixels[i], &b->pixels[i], sizeof(accum_pixel_t)) != 0;
+    }
+    return count;
+}
+
+int main(void) {
+    /* Filters hold what was added */
+    footprint_pixel_t pixel;
+    footprint_pixel_reset(&pixel);
+    int all = 1, none = 1;
+    for (int object = 0; object < 200; object++) none &= !footprint_touches(&pixel, object);
+    for (int object = 0; object < 10; object++) footprint_add(&pixel, 3 * object);
+    for (int object = 0; object < 10; object++) all &= footprint_touches(&pixel, 3 * object);
+    int false_positives = 0;
+    for (int object = 1000; object < 2000; object++) {
+        false_positives += footprint_touches(&pixel, object);
+    }
+    check("empty filter holds nothing", none && pixel.first_hit == FOOTPRINT_UNSET);
+    check("filter holds every added object", all);
+    check("filter has few false positives", false_positives < 50);
+
+    /* Hits name the scene's top-level object, with or without the BVH */
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    random_seed(4);
+    int same = 1, hits = 0;
+    for (int i = 0; i < 2000; i++) {
+        ray_t r = ray(vec3(13.0, 2.0, 3.0), vec3_sub(random_vec3_range(-5.0, 5.0),
+                                                     vec3(13.0, 2.0, 3.0)));
+        hit_record_t a = {0}, b = {0};
+        int ha = bvh_hit(scene->bvh, r, 0.001, INFINITY, &a);
+        int hb = hittable_list_hit(scene->world, r, 0.001, INFINITY, &b);
+        hits += ha;
+        if (ha != hb || (ha && a.object != b.object)) same = 0;
+    }
+    check("bvh and list report the same object", same && hits > 1000);
+
+    /* Recording footprints does not change the image */
+    camera_t camera = scene_camera(scene, (double)WIDTH / HEIGHT);
+    footprint_t *footprint = footprint_create(WIDTH, HEIGHT);
+    render_settings_t settings = {
+        .width = WIDTH,
+        .height = HEIGHT,
+        .samples_per_pixel = 4,
+        .max_depth = 10,
+        .seed = 5,
+        .threads = 2,
+    };
+    render_rect_t full = {0, 0, WIDTH, HEIGHT};
+    accum_t *plain = accum_create(WIDTH, HEIGHT);
+    accum_t *frame = accum_create(WIDTH, HEIGHT);
+    accum_t *fresh = accum_create(WIDTH, HEIGHT);
+    render_region(scene, &camera, &settings, full, 0, 4, plain);
+    settings.footprint = footprint;
+    render_region(scene, &camera, &settings, full, 0, 4, frame);
+    check("recording keeps the image", differing(plain, frame) == 0);
+    check("first hits name the ground and the sky",
+          footprint->pixels[PIXELS - WIDTH].first_hit == 0 &&
+          footprint->pixels[WIDTH / 2].first_hit == FOOTPRINT_SKY);
+    int touched_ground = 1;
+    for (int i = 0; i < PIXELS; i++) {
+        touched_ground &= footprint->pixels[i].first_hit != 0 ||
+                          footprint_touches(&footprint->pixels[i], 0);
+    }
+    check("pixels touch their first hit", touched_ground);
+
+    /* New material on the large diffuse sphere: exact, and partial */
+    int large = scene->world->count - 3;
+    sphere_t *sphere = scene->world->objects[large].data;
+    sphere->material = scene_add_material(scene, metal_create(vec3(0.9, 0.9, 0.9), 0.1));
+    int redone = render_edit(scene, &camera, &settings, &large, 1, frame);
+    render_region(scene, &camera, &settings, full, 0, 4, fresh);
+    check("material edit re-renders part of the frame", redone > 0 && redone < PIXELS);
+    check("material edit matches a full re-render", differing(frame, fresh) == 0);
+
+    /* Moving a small sphere into view */
+    int small = 1;
+    sphere = scene->world->objects[small].data;
+    sphere->center = vec3(2.0, 1.6, 2.5);
+    scene_set_shutter(scene, scene->shutter.open, scene->shutter.close);
+    redone = render_edit(scene, &camera, &settings, &small, 1, frame);
+    accum_clear(fresh);
+    render_region(scene, &camera, &settings, full, 0, 4, fresh);
+    int shown = 0, shown_fresh = 1;
+    for (int i = 0; i < PIXELS; i++) {
+        if (footprint->pixels[i].first_hit != small) continue;
+        shown++;
+        shown_fresh &= memcmp(&frame->pixels[i], &fresh->pixels[i], sizeof(accum_pixel_t)) == 0;
+    }
+    check("moved object is re-rendered where it is now seen", redone > 0 && shown > 0 &&
+          shown_fresh);
+    check("move leaves few pixels stale", differing(frame, fresh) < PIXELS / 20);
+
+    int bad = PIXELS;
+    check("edit of an unknown object is rejected",
+          render_edit(scene, &camera, &settings, &bad, 1, frame) == -1);
+
+    scene_destroy(scene);
+
+    /* A brighter light changes every pixel that sampled the light tree, and
+     * pixels that saw it directly */
+    scene = scene_create_lights(SCENE_DEFAULT_SEED, 20);
+    camera = scene_camera(scene, (double)WIDTH / HEIGHT);
+    settings.max_depth = 6;
+    accum_clear(frame);
+    render_region(scene, &camera, &settings, full, 0, 4, frame);
+    int light = scene->lights->lights[3].object;
+    sphere = scene->world->objects[light].data;
+    sphere->material = scene_add_material(scene, diffuse_light_create(vec3(40.0, 30.0, 20.0)));
+    scene_finalize(scene);
+    redone = render_edit(scene, &camera, &settings, &light, 1, frame);
+    accum_clear(fresh);
+    render_region(scene, &camera, &settings, full, 0, 4, fresh);
+    check("light edit re-renders the lit pixels", redone > PIXELS / 2);
+    check("light edit matches a full re-render", differing(frame, fresh) == 0);
+
+    /* Edits that leave the lights as they were keep the lit pixels */
+    int ground = 0;
+    sphere = scene->world->objects[ground].data;
+    sphere->material = scene_add_material(scene, lambertian_create(vec3(0.5, 0.5, 0.5)));
+    scene_finalize(scene);
+    redone = render_edit(scene, &camera, &settings, &ground, 1, frame);
+    accum_clear(fresh);
+    render_region(scene, &camera, &settings, full, 0, 4, fresh);
+    check("edit keeping the lights spares some pixels", redone > 0 && redone < PIXELS);
+    check("edit beside the lights matches a full re-render", differing(frame, fresh) == 0);
+
+    accum_destroy(plain);
+    accum_destroy(frame);
+    accum_destroy(fresh);
+    footprint_destroy(footprint);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
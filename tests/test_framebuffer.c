@@ -0,0 +1,87 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../src/framebuffer.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+int main(void) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/vibe_test_fb_%d", (int)getpid());
+
+    framebuffer_t *fb = framebuffer_create(path, 5, 3);
+    check("framebuffer created", fb != NULL);
+    check("stride is 4 bytes per pixel", fb->header->stride == 20);
+
+    /* A viewer mapping the same file sees nothing published yet */
+    framebuffer_t *view = framebuffer_open(path);
+    check("viewer maps the file", view != NULL);
+    check("viewer sees matching size", view->header->width == 5 && view->header->height == 3);
+    check("no frame published yet", atomic_load(&view->header->generation) == 0);
+
+    /* First frame goes to image 1, the back image of generation 0 */
+    uint8_t *back = framebuffer_back(fb);
+    check("first back image is image 1", back == fb->images[1]);
+    memset(back, 200, 20 * 3);
+    framebuffer_publish(fb, 1, 8);
+
+    uint64_t gen = atomic_load(&view->header->generation);
+    check("generation advanced", gen == 1);
+    check("viewer reads published pixels", view->images[gen & 1][7] == 200);
+    check("viewer reads coarse block size", view->header->block_size[gen & 1] == 8);
+
+    /* Second frame alternates back to image 0 and leaves image 1 intact */
+    back = framebuffer_back(fb);
+    check("second back image is image 0", back == fb->images[0]);
+    memset(back, 50, 20 * 3);
+    framebuffer_publish(fb, 4, 1);
+    gen = atomic_load(&view->header->generation);
+    check("viewer sees second frame", view->images[gen & 1][0] == 50 &&
+                                      view->header->samples[gen & 1] == 4);
+    check("previous frame untouched", view->images[(gen - 1) & 1][0] == 200);
+
+    /* A copy is only whole if nothing was published while it was taken */
+    uint64_t g = framebuffer_read_begin(view);
+    uint8_t copy[20 * 3];
+    memcpy(copy, view->images[g & 1], sizeof(copy));
+    check("undisturbed copy is accepted", framebuffer_read_valid(view, g));
+
+    /* Two publishes during a copy: the second back image is the one being
+     * copied, so the copy may be torn even though g + 2 is not past g + 1 */
+    g = framebuffer_read_begin(view);
+    memcpy(copy, view->images[g & 1], 10);
+    back = framebuffer_back(fb);
+    memset(back, 80, 20 * 3);
+    framebuffer_publish(fb, 5, 1);
+    back = framebuffer_back(fb);
+    check("writer reuses the image being copied", back == fb->images[g & 1]);
+    memset(back, 90, 20 * 3);
+    framebuffer_publish(fb, 6, 1);
+    memcpy(copy + 10, view->images[g & 1] + 10, sizeof(copy) - 10);
+    check("torn copy is rejected", copy[0] == 50 && copy[10] == 90 &&
+                                       !framebuffer_read_valid(view, g));
+
+    /* One publish during a copy is rejected too */
+    g = framebuffer_read_begin(view);
+    framebuffer_publish(fb, 7, 1);
+    check("copy across one publish is rejected", !framebuffer_read_valid(view, g));
+
+    framebuffer_close(view);
+    framebuffer_close(fb);
+    check("open rejects missing file", framebuffer_open("/nonexistent/fb") == NULL);
+    unlink(path);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed == 0 ? 0 : 1;
+}
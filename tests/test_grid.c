@@ -0,0 +1,137 @@
+#include "../src/grid.h"
+#include "../src/bvh.h"
+#include "../src/hittable.h"
+#include "../src/material.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include "../src/sphere.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+/* A hittable with no bounds that every ray hits at t = 100 */
+static int wall_hit(const void *obj, const ray_t r, double t_min, double t_max,
+                    hit_record_t *rec) {
+    (void)obj;
+    if (100.0 < t_min || 100.0 > t_max) return 0;
+    rec->t = 100.0;
+    rec->point = ray_at(r, 100.0);
+    rec->normal = vec3(0.0, 0.0, 1.0);
+    return 1;
+}
+
+/* Whether grid and BVH over the same objects report the same hits for n
+ * random rays from inside and outside the field, at random times in [t0, t1),
+ * counting the rays that hit something other than object 0 (the ground) */
+static int same_hits(const grid_t *grid, const bvh_t *bvh, int n, double t0, double t1,
+                     int *hits) {
+    int agree = 1;
+    *hits = 0;
+    for (int i = 0; i < n; i++) {
+        vec3_t origin = random_vec3_range(-14.0, 14.0);
+        origin.e[1] = random_double_range(0.05, 4.0);
+        ray_t r = ray_timed(origin, random_unit_vector(), random_double_range(t0, t1));
+        hit_record_t a = {0}, b = {0};
+        int ha = grid_hit(grid, r, 0.001, INFINITY, &a);
+        int hb = bvh_hit(bvh, r, 0.001, INFINITY, &b);
+        agree &= ha == hb && (!ha || (a.t == b.t && a.object == b.object));
+        *hits += ha && a.object != 0;
+    }
+    return agree;
+}
+
+int main(void) {
+    /* The showcase: a ground sphere far wider than the field on it */
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    const hittable_list_t *world = scene->world;
+    grid_t *grid = grid_create(world->objects, world->count);
+    check("grid created", grid != NULL);
+    check("ground kept out of the grid", grid->large_count == 1 && grid->large_ids[0] == 0 &&
+          grid->object_count == world->count - 1);
+    int cells = grid->res[0] * grid->res[1] * grid->res[2];
+    check("a few objects per cell", cells >= grid->object_count &&
+          cells <= 4 * GRID_DENSITY * grid->object_count);
+
+    random_seed(7);
+    int hits;
+    check("grid agrees with the BVH", same_hits(grid, scene->bvh, 20000, 0.0, 0.0, &hits));
+    printf("  %d of 20000 rays hit the field\n", hits);
+    check("test rays hit the field", hits > 1000);
+
+    grid_t *again = grid_create(world->objects, world->count);
+    int refs = grid->cell_start[cells];
+    check("builds repeat exactly", again && again->cell_start[cells] == refs &&
+          memcmp(again->refs, grid->refs, refs * sizeof(int)) == 0);
+    grid_destroy(again);
+
+    aabb_t grid_box, bvh_box;
+    check("bounds cover the large objects too",
+          grid_bounding_box(grid, &grid_box) && bvh_bounding_box(scene->bvh, &bvh_box) &&
+          memcmp(&grid_box, &bvh_box, sizeof(aabb_t)) == 0);
+    grid_destroy(grid);
+
+    /* The scene renders the same image through either structure */
+    render_settings_t settings = {.width = 48, .height = 32, .samples_per_pixel = 2,
+                                  .max_depth = 8, .seed = 5};
+    render_rect_t full = {0, 0, 48, 32};
+    camera_t camera = scene_camera(scene, 1.5);
+    accum_t *with_bvh = accum_create(48, 32);
+    accum_t *with_grid = accum_create(48, 32);
+    render_region(scene, &camera, &settings, full, 0, 2, with_bvh);
+    int switched = scene_set_accelerator(scene, SCENE_ACCEL_GRID) == 0 && scene->grid &&
+                   !scene->bvh;
+    render_region(scene, &camera, &settings, full, 0, 2, with_grid);
+    check("scene switches to the grid", switched);
+    check("grid renders the BVH's image",
+          memcmp(with_bvh->pixels, with_grid->pixels, 48 * 32 * sizeof(accum_pixel_t)) == 0);
+    accum_destroy(with_bvh);
+    accum_destroy(with_grid);
+    scene_destroy(scene);
+
+    /* Moving spheres are binned over the whole shutter interval */
+    scene_t *bouncing = scene_create_bouncing(SCENE_DEFAULT_SEED);
+    scene_set_shutter(bouncing, 2.0, 2.75);
+    bvh_t *moving_bvh = bouncing->bvh;
+    bouncing->bvh = NULL;
+    scene_set_accelerator(bouncing, SCENE_ACCEL_GRID);
+    int moving_hits;
+    int moving = same_hits(bouncing->grid, moving_bvh, 20000, 2.0, 2.75,
+                           &moving_hits);
+    check("motion-blurred hits agree", moving && moving_hits > 1000);
+    bvh_destroy(moving_bvh);
+    scene_destroy(bouncing);
+
+    /* Unbounded objects are tested by every ray */
+    material_t dummy = {0};
+    hittable_t objects[2] = {
+        sphere_to_hittable(sphere_create(vec3(0, 0, -5), 1.0, &dummy)),
+        {.hit = wall_hit},
+    };
+    grid_t *mixed = grid_create(objects, 2);
+    hit_record_t rec;
+    ray_t away = ray_timed(vec3(0, 0, 0), vec3(0, 0, 1), 0.0);
+    check("unbounded object hit", mixed && mixed->large_count == 1 &&
+          grid_hit(mixed, away, 0.001, INFINITY, &rec) && rec.t == 100.0 && rec.object == 1);
+    check("unbounded grid has no box", !grid_bounding_box(mixed, &grid_box));
+    grid_destroy(mixed);
+    objects[0].destroy(objects[0].data);
+
+    grid_t *empty = grid_create(NULL, 0);
+    check("empty grid misses", empty && !grid_hit(empty, away, 0.001, INFINITY, &rec));
+    grid_destroy(empty);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
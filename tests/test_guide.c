@@ -0,0 +1,164 @@
+#include "../src/guide.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include "../src/utils.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+#define GRID 64
+
+/* Integral of the cell's density over the sphere, on an equal-area grid */
+static double pdf_integral(const guide_cell_t *cell) {
+    double sum = 0.0;
+    for (int i = 0; i < GRID; i++) {
+        for (int j = 0; j < GRID; j++) {
+            double cos_theta = -1.0 + 2.0 * (i + 0.5) / GRID;
+            double phi = -PI + 2.0 * PI * (j + 0.5) / GRID;
+            double sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+            vec3_t d = vec3(sin_theta * cos(phi), cos_theta, sin_theta * sin(phi));
+            sum += guide_pdf(cell, d) * 4.0 * PI / (GRID * GRID);
+        }
+    }
+    return sum;
+}
+
+/* Mean luminance and root mean square luminance error against ref */
+static void compare(const accum_t *a, const accum_t *ref, double *mean, double *rmse) {
+    int n = a->width * a->height;
+    double sum = 0.0, error = 0.0;
+    for (int i = 0; i < n; i++) {
+        vec3_t x = accum_pixel_mean(&a->pixels[i]);
+        vec3_t y = accum_pixel_mean(&ref->pixels[i]);
+        double lx = 0.2126 * x.e[0] + 0.7152 * x.e[1] + 0.0722 * x.e[2];
+        double ly = 0.2126 * y.e[0] + 0.7152 * y.e[1] + 0.0722 * y.e[2];
+        sum += lx;
+        error += (lx - ly) * (lx - ly);
+    }
+    *mean = sum / n;
+    *rmse = sqrt(error / n);
+}
+
+/* Mean luminance of an image */
+static double mean_luminance(const accum_t *a) {
+    double mean, rmse;
+    compare(a, a, &mean, &rmse);
+    return mean;
+}
+
+int main(void) {
+    aabb_t bounds = {vec3(-1, -1, -1), vec3(1, 1, 1)};
+    guide_t *guide = guide_create(bounds);
+    vec3_t up = vec3(0, 1, 0);
+    guide_cell_t *cell = guide_lookup(guide, vec3(0.5, 0.5, 0.5), up);
+
+    check("untrained guide is uniform",
+          !cell->trained && fabs(guide_pdf(cell, up) - 1.0 / (4.0 * PI)) < 1e-9);
+    check("surfaces facing apart use separate leaves",
+          guide_lookup(guide, vec3(0.5, 0.5, 0.5), vec3(0, -1, 0)) != cell &&
+          guide_lookup(guide, vec3(-0.5, 0.5, 0.5), vec3(0.1, 0.9, 0.2)) == cell);
+
+    /* Light from near straight up, with a little from the side */
+    random_seed(5);
+    for (int i = 0; i < 1000; i++) {
+        vec3_t d = vec3_normalize(vec3(0.1 * (random_double() - 0.5), 1.0,
+                                  0.1 * (random_double() - 0.5)));
+        guide_record(cell, d, 1.0);
+        guide_record(cell, vec3(1, 0.05, 0), 0.1);
+        guide_record(cell, vec3(0, -1, 0), 0.0);
+    }
+    check("update succeeds", guide_update(guide) == 0);
+    check("cell is trained", cell->trained);
+    check("learned density peaks where the light came from",
+          guide_pdf(cell, up) > 4.0 / (4.0 * PI) &&
+          guide_pdf(cell, vec3(0, -1, 0)) == 0.0);
+    check("learned density integrates to one", fabs(pdf_integral(cell) - 1.0) < 1e-4);
+
+    /* Samples follow the density: share landing in the top bin row */
+    int top = 0, count = 20000, unit = 1;
+    double expected = 0.0;
+    for (int j = 0; j < GUIDE_PHI_BINS; j++) {
+        double phi = -PI + 2.0 * PI * (j + 0.5) / GUIDE_PHI_BINS;
+        double cos_theta = 1.0 - 1.0 / GUIDE_THETA_BINS;
+        double sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+        vec3_t d = vec3(sin_theta * cos(phi), cos_theta, sin_theta * sin(phi));
+        expected += guide_pdf(cell, d) * 4.0 * PI / GUIDE_BINS;
+    }
+    for (int i = 0; i < count; i++) {
+        vec3_t d = guide_sample(cell);
+        unit &= fabs(vec3_length(d) - 1.0) < 1e-9;
+        top += d.e[1] >= 1.0 - 2.0 / GUIDE_THETA_BINS;
+    }
+    check("samples are unit directions", unit);
+    check("samples follow the density", fabs((double)top / count - expected) < 0.02);
+
+    /* Busy leaves split, and their children keep the learned density */
+    int cells = guide->cell_count;
+    for (int i = 0; i < 20000; i++) {
+        guide_record(guide_lookup(guide, vec3(0.5, 0.5, 0.5), up), up, 1.0);
+    }
+    guide_update(guide);
+    guide_cell_t *child = guide_lookup(guide, vec3(0.5, 0.5, 0.5), up);
+    check("busy leaf splits", guide->cell_count > cells);
+    check("children inherit the distribution",
+          child->trained && guide_pdf(child, up) > 4.0 / (4.0 * PI));
+    guide_destroy(guide);
+
+    /* Guided renders of the room, where light enters through a skylight */
+    scene_t *scene = scene_create_room(0);
+    camera_t camera = scene_camera(scene, 24.0 / 18.0);
+    render_settings_t settings = {
+        .width = 24,
+        .height = 18,
+        .samples_per_pixel = 16,
+        .max_depth = 50,
+        .seed = 3,
+        .threads = 1,
+    };
+    render_rect_t rect = {0, 0, 24, 18};
+    accum_t *one = accum_create(24, 18);
+    accum_t *three = accum_create(24, 18);
+    accum_t *plain = accum_create(24, 18);
+    accum_t *reference = accum_create(24, 18);
+
+    check("guided render completes",
+          render_progressive(scene, &camera, &settings, rect, 1, 0, one) == 0);
+    settings.threads = 3;
+    render_progressive(scene, &camera, &settings, rect, 1, 0, three);
+    check("guided render is independent of the thread count",
+          memcmp(one->pixels, three->pixels, 24 * 18 * sizeof(accum_pixel_t)) == 0);
+
+    render_region(scene, &camera, &settings, rect, 0, 16, plain);
+    settings.samples_per_pixel = 256;
+    settings.seed = 99;
+    render_region(scene, &camera, &settings, rect, 0, 256, reference);
+    double guided_mean, guided_rmse, plain_mean, plain_rmse;
+    compare(one, reference, &guided_mean, &guided_rmse);
+    compare(plain, reference, &plain_mean, &plain_rmse);
+    double reference_mean = mean_luminance(reference);
+    check("guiding keeps the image unbiased",
+          fabs(guided_mean - reference_mean) < 0.05 * reference_mean);
+    check("guided error is in line with unguided", guided_rmse < 1.5 * plain_rmse);
+
+    accum_destroy(one);
+    accum_destroy(three);
+    accum_destroy(plain);
+    accum_destroy(reference);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+#include "../src/image.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+/* Whole contents of a file (NULL if unreadable); caller frees */
+static char *slurp(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = calloc(size + 1, 1);
+    if (data && fread(data, 1, size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+/* The two files have identical contents */
+static int same_file(const char *a, const char *b) {
+    char *da = slurp(a), *db = slurp(b);
+    int same = da && db && strcmp(da, db) == 0;
+    free(da);
+    free(db);
+    return same;
+}
+
+/* Render rect of the frame and write it as a crop */
+static void write_crop(const char *path, const scene_t *scene, const camera_t *camera,
+                       const render_settings_t *settings, render_rect_t rect) {
+    accum_t *accum = accum_create(rect.x1 - rect.x0, rect.y1 - rect.y0);
+    render_region(scene, camera, settings, rect, 0, settings->samples_per_pixel, accum);
+    char comment[64];
+    image_crop_comment(comment, sizeof(comment), rect, settings->width, settings->height);
+    image_write_ppm_comment(path, accum, comment);
+    accum_destroy(accum);
+}
+
+int main(void) {
+    render_settings_t settings = {
+        .width = 30,
+        .height = 20,
+        .samples_per_pixel = 3,
+        .max_depth = 8,
+        .seed = 11,
+    };
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    camera_t camera = scene_camera(scene, 30.0 / 20.0);
+
+    char full[64], a[64], b[64], c[64], other[64], out[64];
+    int pid = (int)getpid();
+    snprintf(full, sizeof(full), "/tmp/test_image_%d_full.ppm", pid);
+    snprintf(a, sizeof(a), "/tmp/test_image_%d_a.ppm", pid);
+    snprintf(b, sizeof(b), "/tmp/test_image_%d_b.ppm", pid);
+    snprintf(c, sizeof(c), "/tmp/test_image_%d_c.ppm", pid);
+    snprintf(other, sizeof(other), "/tmp/test_image_%d_other.ppm", pid);
+    snprintf(out, sizeof(out), "/tmp/test_image_%d_out.ppm", pid);
+
+    char comment[64];
+    image_crop_comment(comment, sizeof(comment), (render_rect_t){0, 0, 30, 20}, 30, 20);
+    check("whole frame needs no crop comment", comment[0] == '\0');
+    image_crop_comment(comment, sizeof(comment), (render_rect_t){3, 4, 10, 20}, 30, 20);
+    check("crop comment records window and frame", strcmp(comment, "crop 3 4 10 20 of 30 20") == 0);
+
+    /* Full frame, and three crops of it rendered independently */
+    write_crop(full, scene, &camera, &settings, (render_rect_t){0, 0, 30, 20});
+    write_crop(a, scene, &camera, &settings, (render_rect_t){0, 0, 17, 9});
+    write_crop(b, scene, &camera, &settings, (render_rect_t){17, 0, 30, 9});
+    write_crop(c, scene, &camera, &settings, (render_rect_t){0, 9, 30, 20});
+
+    const char *crops[] = {c, a, b};
+    check("crops stitch", image_stitch(out, crops, 3) == 0);
+    check("stitched frame is byte-identical to the full render", same_file(out, full));
+
+    const char *overlapping[] = {a, full, b};
+    check("agreeing overlaps stitch", image_stitch(out, overlapping, 3) == 0 &&
+                                      same_file(out, full));
+
+    const char *gap[] = {a, c};
+    check("a missing crop is an error", image_stitch(out, gap, 2) != 0);
+
+    /* A crop rendered with other samples conflicts where it overlaps */
+    render_settings_t reseeded = settings;
+    reseeded.seed = 12;
+    write_crop(other, scene, &camera, &reseeded, (render_rect_t){10, 5, 20, 15});
+    const char *conflict[] = {full, other};
+    check("disagreeing overlaps are an error", image_stitch(out, conflict, 2) != 0);
+
+    /* Crops of a different frame size do not mix */
+    render_settings_t larger = settings;
+    larger.width = 40;
+    write_crop(other, scene, &camera, &larger, (render_rect_t){0, 0, 17, 9});
+    const char *mixed[] = {c, other, b};
+    check("crops of another frame are an error", image_stitch(out, mixed, 3) != 0);
+
+    const char *missing[] = {"/nonexistent/crop.ppm"};
+    check("unreadable crop is an error", image_stitch(out, missing, 1) != 0);
+
+    /* Float images keep every bit */
+    float rgb[3 * 5 * 3];
+    for (int i = 0; i < 3 * 5 * 3; i++) rgb[i] = (float)(i * 0.37 + 1e-3 / (i + 1));
+    int pfm_width = 0, pfm_height = 0;
+    snprintf(other, sizeof(other), "/tmp/test_image_%d.pfm", pid);
+    float *read = image_write_pfm(other, rgb, 5, 3) == 0
+                      ? image_read_pfm(other, &pfm_width, &pfm_height)
+                      : NULL;
+    check("PFM round trip is exact", read && pfm_width == 5 && pfm_height == 3 &&
+                                     memcmp(read, rgb, sizeof(rgb)) == 0);
+    free(read);
+
+    remove(full);
+    remove(a);
+    remove(b);
+    remove(c);
+    remove(other);
+    remove(out);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
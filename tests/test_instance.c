@@ -0,0 +1,113 @@
+#include "../src/bvh.h"
+#include "../src/instance.h"
+#include "../src/material.h"
+#include "../src/scene.h"
+#include "../src/sphere.h"
+#include "../src/vec3.h"
+#include "../src/ray.h"
+#include <stdio.h>
+#include <math.h>
+
+#define EPSILON 1e-6
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+static void check_vec3(const char *name, vec3_t got, vec3_t exp) {
+    if (fabs(got.e[0] - exp.e[0]) < EPSILON &&
+        fabs(got.e[1] - exp.e[1]) < EPSILON &&
+        fabs(got.e[2] - exp.e[2]) < EPSILON) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s (got [%f,%f,%f] expected [%f,%f,%f])\n",
+               name, got.e[0], got.e[1], got.e[2],
+               exp.e[0], exp.e[1], exp.e[2]);
+        failed++;
+    }
+}
+
+int main(void) {
+    /* Transforms */
+    transform_t move = transform_translate(vec3(1.0, 2.0, 3.0));
+    transform_t spin = transform_rotate_y(90.0);
+    transform_t scale = transform_scale(2.0);
+    check_vec3("rotate_y maps +x to -z", transform_vector(&spin, vec3(1.0, 0.0, 0.0)),
+               vec3(0.0, 0.0, -1.0));
+    transform_t a = transform_compose(&spin, &scale);
+    transform_t xf = transform_compose(&move, &a);
+    transform_t inv = transform_inverse(&xf);
+    vec3_t p = vec3(0.3, -1.2, 4.0);
+    check_vec3("inverse round-trips a point",
+               transform_point(&inv, transform_point(&xf, p)), p);
+
+    /* Unit sphere at the origin, instanced twice the size at (0, 0, -5) */
+    material_t dummy_mat = {0};
+    sphere_t *s = sphere_create(vec3(0.0, 0.0, 0.0), 1.0, &dummy_mat);
+    hittable_t sphere = sphere_to_hittable(s);
+    transform_t place = transform_translate(vec3(0.0, 0.0, -5.0));
+    transform_t big = transform_compose(&place, &scale);
+    instance_t *inst = instance_create(sphere, &big);
+    hittable_t h = instance_to_hittable(inst);
+
+    ray_t r = ray(vec3(0.0, 0.0, 0.0), vec3(0.0, 0.0, -1.0));
+    hit_record_t rec = {0};
+    check("instance hit", h.hit(h.data, r, 0.001, INFINITY, &rec));
+    check("world-space t", fabs(rec.t - 3.0) < EPSILON);
+    check_vec3("world-space point", rec.point, vec3(0.0, 0.0, -3.0));
+    check_vec3("normal is unit after scaling", rec.normal, vec3(0.0, 0.0, 1.0));
+    check("front face kept", rec.front_face == 1);
+
+    aabb_t box;
+    check("instance box transformed",
+          h.bounding_box(h.data, &box) && fabs(box.min.e[2] + 7.0) < EPSILON &&
+          fabs(box.max.e[0] - 2.0) < EPSILON);
+
+    /* Two levels: a BVH of two instances, instanced again with an offset */
+    transform_t left = transform_translate(vec3(-3.0, 0.0, 0.0));
+    transform_t right = transform_translate(vec3(3.0, 0.0, 0.0));
+    hittable_t pair[2] = {instance_to_hittable(instance_create(sphere, &left)),
+                          instance_to_hittable(instance_create(sphere, &right))};
+    bvh_t *group = bvh_create(pair, 2);
+    transform_t lift = transform_translate(vec3(0.0, 10.0, 0.0));
+    instance_t *outer = instance_create(bvh_to_hittable(group), &lift);
+    hittable_t o = instance_to_hittable(outer);
+
+    ray_t down = ray(vec3(3.0, 20.0, 0.0), vec3(0.0, -1.0, 0.0));
+    hit_record_t rec2 = {0};
+    check("nested instance hit", o.hit(o.data, down, 0.001, INFINITY, &rec2));
+    check_vec3("nested hit point", rec2.point, vec3(3.0, 11.0, 0.0));
+    ray_t gap = ray(vec3(0.0, 20.0, 0.0), vec3(0.0, -1.0, 0.0));
+    check("nested instance miss between copies", !o.hit(o.data, gap, 0.001, INFINITY, &rec2));
+
+    transform_t singular = transform_scale(0.0);
+    check("singular transform rejected", instance_create(sphere, &singular) == NULL);
+
+    o.destroy(o.data);
+    bvh_destroy(group);
+    pair[0].destroy(pair[0].data);
+    pair[1].destroy(pair[1].data);
+    h.destroy(h.data);
+    sphere.destroy(sphere.data);
+
+    /* The forest scene builds millions of effective spheres from few objects */
+    scene_t *forest = scene_create_forest(SCENE_DEFAULT_SEED);
+    check("forest created", forest != NULL && forest->bvh != NULL);
+    check("forest world holds groves, not spheres", forest->world->count < 2400);
+    ray_t look = ray(forest->lookfrom, vec3_sub(forest->lookat, forest->lookfrom));
+    hit_record_t rec3 = {0};
+    check("forest is visible", scene_hit(forest, look, 0.001, INFINITY, &rec3));
+    scene_destroy(forest);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed == 0 ? 0 : 1;
+}
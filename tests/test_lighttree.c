@@ -0,0 +1,162 @@
+#include "../src/lighttree.h"
+#include "../src/material.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include "../src/sphere.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+#define LIGHTS 200
+#define DRAWS 200000
+
+/* Mean luminance of a frame rendered at spp samples per pixel */
+static double mean_luminance(const scene_t *scene, int spp, unsigned int seed) {
+    render_settings_t settings = {.width = 24, .height = 16, .samples_per_pixel = spp,
+                                  .max_depth = 6, .seed = seed};
+    camera_t camera = scene_camera(scene, 1.5);
+    accum_t *image = accum_create(24, 16);
+    render_region(scene, &camera, &settings, (render_rect_t){0, 0, 24, 16}, 0, spp, image);
+    double sum = 0.0;
+    for (int i = 0; i < 24 * 16; i++) {
+        vec3_t c = accum_pixel_mean(&image->pixels[i]);
+        sum += 0.2126 * c.e[0] + 0.7152 * c.e[1] + 0.0722 * c.e[2];
+    }
+    accum_destroy(image);
+    return sum / (24 * 16);
+}
+
+int main(void) {
+    /* Lights of varied power scattered over a box, among plain spheres */
+    material_t plain = lambertian_create(vec3(0.5, 0.5, 0.5));
+    material_t glow[4];
+    hittable_t objects[LIGHTS + 10];
+    random_seed(3);
+    for (int k = 0; k < 4; k++) glow[k] = diffuse_light_create(vec3(k + 1.0, 1.0, 0.5 * k));
+    int count = 0;
+    for (int i = 0; i < LIGHTS + 10; i++) {
+        vec3_t center = random_vec3_range(-10.0, 10.0);
+        const material_t *mat = i % 21 == 0 ? &plain : &glow[i % 4];
+        objects[count++] = sphere_to_hittable(sphere_create(center, 0.05 + 0.2 * random_double(),
+                                                            mat));
+    }
+    light_tree_t *tree = light_tree_create(objects, count);
+    check("tree holds the emissive spheres only", tree && tree->light_count == LIGHTS &&
+          tree->node_count == 2 * LIGHTS - 1 && light_tree_light_of(tree, 0) == -1 &&
+          light_tree_light_of(tree, 1) == 0 && tree->lights[0].object == 1);
+
+    /* Probabilities over all lights sum to at most one (a walk can end in a
+     * subtree whose lights all turn out to be below the horizon) and match
+     * sampling */
+    vec3_t point = vec3(0.5, -3.0, 1.0);
+    vec3_t normal = vec3_normalize(vec3(0.2, 1.0, -0.1));
+    double total = 0.0;
+    int below_zero = 1, above_positive = 1;
+    for (int l = 0; l < LIGHTS; l++) {
+        double p = light_tree_pmf(tree, point, normal, l);
+        total += p;
+        /* Spheres wholly below the horizon are never picked, any above it can be */
+        vec3_t to = vec3_sub(tree->lights[l].center, point);
+        double height = vec3_dot(to, normal);
+        if (height < -tree->lights[l].radius * sqrt(3.0)) below_zero &= p == 0.0;
+        if (height > tree->lights[l].radius) above_positive &= p > 0.0;
+    }
+    check("lights below the horizon are skipped", below_zero);
+    check("lights above the horizon can be picked", above_positive);
+
+    int *hits = calloc(LIGHTS, sizeof(int));
+    int consistent = 1, misses = 0;
+    for (int i = 0; i < DRAWS; i++) {
+        double pmf;
+        int l = light_tree_sample(tree, point, normal, random_double(), &pmf);
+        if (l < 0) {
+            misses++;
+            continue;
+        }
+        hits[l]++;
+        consistent &= fabs(pmf - light_tree_pmf(tree, point, normal, l)) <= 1e-12 * pmf;
+    }
+    check("sampling reports the light's probability", consistent);
+    printf("  probabilities sum to %.4f, %.4f of draws find no light\n", total,
+           (double)misses / DRAWS);
+    check("probabilities sum to the draws that find a light",
+          total <= 1.0 + 1e-12 && fabs(total + (double)misses / DRAWS - 1.0) < 0.005);
+    double worst = 0.0;
+    for (int l = 0; l < LIGHTS; l++) {
+        double expected = DRAWS * light_tree_pmf(tree, point, normal, l);
+        if (expected > 100.0) {
+            worst = fmax(worst, fabs(hits[l] - expected) / sqrt(expected));
+        }
+    }
+    printf("  worst deviation %.2f sigma\n", worst);
+    check("lights are drawn in proportion", worst < 5.0);
+    free(hits);
+
+    /* Near lights are favoured over far ones of the same power */
+    light_tree_t *pair = NULL;
+    {
+        hittable_t two[2] = {
+            sphere_to_hittable(sphere_create(vec3(1, 0, 0), 0.1, &glow[0])),
+            sphere_to_hittable(sphere_create(vec3(9, 0, 0), 0.1, &glow[0])),
+        };
+        pair = light_tree_create(two, 2);
+        double near = light_tree_pmf(pair, vec3(0, 0, 0), vec3(1, 0, 0), 0);
+        check("near light is favoured", fabs(near - 81.0 / 82.0) < 0.01);
+        light_tree_destroy(pair);
+        for (int k = 0; k < 2; k++) two[k].destroy(two[k].data);
+    }
+
+    /* Directions drawn toward a light hit it, with the density reported */
+    const light_t *light = &tree->lights[7];
+    int on_sphere = 1;
+    for (int i = 0; i < 1000; i++) {
+        double pdf;
+        vec3_t d = light_sample_direction(light, point, random_double(), random_double(), &pdf);
+        hit_record_t rec;
+        on_sphere &= objects[light->object].hit(objects[light->object].data,
+                                                ray_timed(point, d, 0.0), 0.001, INFINITY,
+                                                &rec) &&
+                     pdf == light_direction_pdf(light, point);
+    }
+    check("sampled directions reach the light", on_sphere);
+    check("no directions from inside a light",
+          light_direction_pdf(light, light->center) == 0.0);
+    light_tree_destroy(tree);
+    for (int i = 0; i < count; i++) objects[i].destroy(objects[i].data);
+    plain.destroy(plain.data);
+    for (int k = 0; k < 4; k++) glow[k].destroy(glow[k].data);
+
+    /* Scenes without emissive spheres keep no tree */
+    scene_t *showcase = scene_create_random(SCENE_DEFAULT_SEED);
+    check("no tree without lights", showcase && !showcase->lights);
+    scene_destroy(showcase);
+
+    /* Sampling lights changes the noise, not the mean: compare with paths
+     * that find the lights only by hitting them */
+    scene_t *night = scene_create_lights(5, 60);
+    check("night scene has its lights", night && night->lights &&
+          night->lights->light_count == 60 && night->specular_count == 2);
+    double sampled = mean_luminance(night, 1024, 1);
+    light_tree_t *lights = night->lights;
+    night->lights = NULL;
+    double hit_only = mean_luminance(night, 4096, 2);
+    night->lights = lights;
+    printf("  mean %.4f with light sampling, %.4f without\n", sampled, hit_only);
+    check("light sampling is unbiased", fabs(sampled - hit_only) < 0.03 * hit_only);
+    scene_destroy(night);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
@@ -87,6 +87,19 @@ int main(void) {
 
     if (glass.destroy) glass.destroy(glass.data);
 
+    /* --- Diffuse light --- */
+    material_t lamp = diffuse_light_create(vec3(4.0, 3.0, 2.0));
+    hit_record_t rec_l = make_rec(vec3(0.0, 1.0, 0.0));
+    rec_l.material = &lamp;
+    ray_t scattered_l = {0};
+    vec3_t attenuation_l = {0};
+    check("light absorbs", !lamp.scatter(lamp.data, r_glass, &rec_l, &attenuation_l,
+                                         &scattered_l) && !lamp.diffuse);
+    material_params_t lamp_params = material_params(&lamp);
+    check("light emits its radiance", lamp.emission && lamp.emission->e[1] == 3.0 &&
+          lamp_params.kind == MATERIAL_LIGHT && lamp_params.emission.e[0] == 4.0);
+    if (lamp.destroy) lamp.destroy(lamp.data);
+
     printf("\n%d/%d tests passed\n", passed, passed + failed);
     return failed == 0 ? 0 : 1;
 }
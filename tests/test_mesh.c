@@ -0,0 +1,216 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../src/mesh.h"
+#include "../src/material.h"
+#include "../src/vec3.h"
+#include "../src/ray.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define EPSILON 1e-9
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+/* Write text to a temporary OBJ file and load it */
+static mesh_t *load_text(const char *text, const material_t *mat) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/vibe_test_%d.obj", (int)getpid());
+    FILE *f = fopen(path, "w");
+    if (!f) return NULL;
+    fputs(text, f);
+    fclose(f);
+    mesh_t *mesh = mesh_load_obj(path, mat);
+    remove(path);
+    return mesh;
+}
+
+int main(void) {
+    material_t dummy_mat = {0};
+
+    /* OBJ features: comments, unused attributes, quads, slashes, negative indices */
+    mesh_t *mesh = load_text("# unit square and a triangle\n"
+                             "o square\n"
+                             "v 0 0 0\n"
+                             "v 1.0 0 0 1.0\n"
+                             "v\t1 1e0 0\n"
+                             "v 0 1 0\r\n"
+                             "vt 0 0\n"
+                             "vn 0 0 1\n"
+                             "f 1/1/1 2/1/1 3/1/1 4/1/1\n"
+                             "v 0 0 -2\n"
+                             "v 1 0 -2\n"
+                             "v 0 1 -2\n"
+                             "usemtl none\n"
+                             "f -3//1 -2//1 -1//1 # behind the square\n",
+                             &dummy_mat);
+    check("obj loads", mesh != NULL);
+    check("obj vertex and triangle counts",
+          mesh && mesh->vertex_count == 7 && mesh->triangle_count == 3);
+
+    hittable_t obj = mesh_to_hittable(mesh);
+    hit_record_t rec = {0};
+    ray_t down = ray(vec3(0.25, 0.6, 1.0), vec3(0.0, 0.0, -1.0));
+    check("ray hits the quad", obj.hit(obj.data, down, 0.001, INFINITY, &rec) &&
+                                   fabs(rec.t - 1.0) < EPSILON &&
+                                   fabs(rec.normal.e[2] - 1.0) < EPSILON && rec.front_face);
+    check("hit material is the mesh's", rec.material == &dummy_mat);
+    check("t_max excludes the quad", !obj.hit(obj.data, down, 0.001, 0.5, &rec));
+    check("negative indices resolve", obj.hit(obj.data, down, 1.5, INFINITY, &rec) &&
+                                          fabs(rec.t - 3.0) < EPSILON);
+    check("ray beside the mesh misses",
+          !obj.hit(obj.data, ray(vec3(2.0, 2.0, 1.0), vec3(0.0, 0.0, -1.0)), 0.001,
+                   INFINITY, &rec));
+
+    aabb_t box;
+    check("bounding box", obj.bounding_box(obj.data, &box) && box.min.e[2] == -2.0 &&
+                              box.max.e[0] == 1.0 && box.max.e[2] == 0.0);
+
+    /* Watertightness: rays through the shared diagonal edge of the quad never
+     * fall through (the outer corners are skipped, where rounding of the ray
+     * origin may legitimately miss the mesh) */
+    int watertight = 1;
+    for (int i = 1; i < 1000; i++) {
+        double s = i / 1000.0;
+        ray_t r = ray(vec3(s + 0.3, s - 0.2, 1.0), vec3(-0.3, 0.2, -1.0));
+        if (!obj.hit(obj.data, r, 0.001, 1.5, &rec)) watertight = 0;
+    }
+    check("rays along the shared edge all hit", watertight);
+    obj.destroy(obj.data);
+
+    /* Fan of triangles around a shared center vertex */
+    mesh = load_text("v 0.1 0.2 0.3\n"
+                     "v 1 0 0\nv 0.5 0.866 0\nv -0.5 0.866 0\n"
+                     "v -1 0 0\nv -0.5 -0.866 0\nv 0.5 -0.866 0\n"
+                     "f 1 2 3 4 5 6 7 2\n",
+                     &dummy_mat);
+    check("polygon is fan triangulated", mesh && mesh->triangle_count == 6);
+    obj = mesh_to_hittable(mesh);
+    ray_t at_vertex = ray(vec3(0.3, -0.4, 2.3), vec3(-0.2, 0.6, -2.0));
+    check("ray through the shared vertex hits", obj.hit(obj.data, at_vertex, 0.001,
+                                                        INFINITY, &rec) &&
+                                                    fabs(rec.t - 1.0) < 1e-6);
+    obj.destroy(obj.data);
+
+    /* Malformed input */
+    check("missing file fails", mesh_load_obj("/nonexistent/mesh.obj", &dummy_mat) == NULL);
+    check("out of range index fails", load_text("v 0 0 0\nv 1 0 0\nf 1 2 3\n", &dummy_mat) == NULL);
+    check("file without faces fails", load_text("v 0 0 0\n", &dummy_mat) == NULL);
+
+    /* The four-wide test agrees with the scalar one */
+    random_seed(7);
+    float tri[4][3][3];
+    int simd_agrees = 1;
+    for (int iter = 0; iter < 2000; iter++) {
+        for (int l = 0; l < 4; l++) {
+            for (int k = 0; k < 3; k++) {
+                for (int a = 0; a < 3; a++) tri[l][k][a] = (float)random_double_range(-1.0, 1.0);
+            }
+        }
+        ray_t r = ray(random_vec3_range(-2.0, 2.0), random_vec3_range(-1.0, 1.0));
+        tri_ray_t tr = tri_ray_prepare(r);
+        const float *v[4][3];
+        int best = -1;
+        double best_t = INFINITY, t;
+        for (int l = 0; l < 4; l++) {
+            for (int k = 0; k < 3; k++) v[l][k] = tri[l][k];
+            if (triangle_intersect(&tr, tri[l][0], tri[l][1], tri[l][2], 0.0, INFINITY, &t) &&
+                t < best_t) {
+                best_t = t;
+                best = l;
+            }
+        }
+        double t4 = INFINITY;
+        int lane = triangle_intersect4(&tr, (const float *const(*)[3])v, 4, 0.0, INFINITY, &t4);
+        if (lane != best || (best >= 0 && fabs(t4 - best_t) > EPSILON)) simd_agrees = 0;
+    }
+    check("simd test matches scalar test", simd_agrees);
+
+    /* The per-mesh BVH finds the same closest hits as a linear scan */
+    int tri_count = 500;
+    float *positions = malloc(9 * tri_count * sizeof(float));
+    uint32_t *indices = malloc(3 * tri_count * sizeof(uint32_t));
+    for (int i = 0; i < tri_count; i++) {
+        vec3_t c = random_vec3_range(-5.0, 5.0);
+        for (int k = 0; k < 3; k++) {
+            vec3_t p = vec3_add(c, random_vec3_range(-0.5, 0.5));
+            for (int a = 0; a < 3; a++) positions[9 * i + 3 * k + a] = (float)p.e[a];
+            indices[3 * i + k] = 3 * i + k;
+        }
+    }
+    mesh = mesh_create(positions, 3 * tri_count, indices, tri_count, &dummy_mat);
+    check("mesh created from buffers", mesh != NULL && mesh->node_count > 0);
+    obj = mesh_to_hittable(mesh);
+    int agree = 1, hits = 0;
+    for (int i = 0; i < 2000; i++) {
+        ray_t r = ray(random_vec3_range(-8.0, 8.0), random_vec3_range(-1.0, 1.0));
+        tri_ray_t tr = tri_ray_prepare(r);
+        double brute = INFINITY, t;
+        for (int j = 0; j < mesh->triangle_count; j++) {
+            const uint32_t *idx = &mesh->indices[3 * j];
+            if (triangle_intersect(&tr, &mesh->positions[3 * idx[0]],
+                                   &mesh->positions[3 * idx[1]],
+                                   &mesh->positions[3 * idx[2]], 0.001, brute, &t)) {
+                brute = t;
+            }
+        }
+        int hit = obj.hit(obj.data, r, 0.001, INFINITY, &rec);
+        if (hit != (brute < INFINITY) || (hit && fabs(rec.t - brute) > EPSILON)) agree = 0;
+        hits += hit;
+    }
+    check("bvh agrees with linear scan", agree && hits > 100);
+    obj.destroy(obj.data);
+
+    /* A multi-megabyte grid is split into several parse chunks */
+    int n = 250;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/vibe_test_grid_%d.obj", (int)getpid());
+    FILE *f = fopen(path, "w");
+    for (int y = 0; y <= n; y++) {
+        for (int x = 0; x <= n; x++) fprintf(f, "v %.6f %.6f 0.0\n", x / (double)n, y / (double)n);
+    }
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            int a = y * (n + 1) + x + 1;
+            if ((x + y) % 2) {
+                fprintf(f, "f %d %d %d %d\n", a, a + 1, a + n + 2, a + n + 1);
+            } else {
+                int total = (n + 1) * (n + 1);
+                fprintf(f, "f %d %d %d\nf %d %d %d\n", a - total - 1, a - total, a + n + 1 - total,
+                        a - total - 1, a + n + 1 - total, a + n - total);
+            }
+        }
+    }
+    fclose(f);
+    mesh = mesh_load_obj(path, &dummy_mat);
+    remove(path);
+    check("large obj loads", mesh && mesh->vertex_count == (n + 1) * (n + 1) &&
+                                 mesh->triangle_count == 2 * n * n);
+    int grid_tight = mesh != NULL;
+    if (mesh) {
+        obj = mesh_to_hittable(mesh);
+        for (int i = 0; i < 5000; i++) {
+            ray_t r = ray(vec3(random_double_range(0.001, 0.999),
+                               random_double_range(0.001, 0.999), 1.0),
+                          vec3(0.0, 0.0, -1.0));
+            if (!obj.hit(obj.data, r, 0.001, INFINITY, &rec) || fabs(rec.t - 1.0) > EPSILON) {
+                grid_tight = 0;
+            }
+        }
+        obj.destroy(obj.data);
+    }
+    check("every ray into the grid hits", grid_tight);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+#include "../src/multiview.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+#define VIEWS 3
+
+/* What the callbacks saw */
+typedef struct {
+    accum_t *reference[VIEWS];
+    int calls[VIEWS];
+    int order[VIEWS];
+    int finished;
+    int matching;
+    int fail_at; /* view whose callback fails, or -1 */
+} record_t;
+
+/* Compare a finished view with its reference render */
+static int record_view(int view, const accum_t *image, void *user) {
+    record_t *record = user;
+    const accum_t *ref = record->reference[view];
+    int same = image->width == ref->width && image->height == ref->height &&
+               memcmp(image->pixels, ref->pixels,
+                      (size_t)ref->width * ref->height * sizeof(accum_pixel_t)) == 0;
+    #pragma omp critical(record)
+    {
+        record->calls[view]++;
+        if (record->finished < VIEWS) record->order[record->finished] = view;
+        record->finished++;
+        record->matching += same;
+    }
+    return view == record->fail_at ? -1 : 0;
+}
+
+/* Cancel the job once the first view is handed over */
+static int cancel_after_first(int view, const accum_t *image, void *user) {
+    (void)view;
+    (void)image;
+    atomic_store((atomic_int *)user, 1);
+    return 0;
+}
+
+int main(void) {
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    render_settings_t settings = {
+        .samples_per_pixel = 4,
+        .max_depth = 8,
+        .seed = 11,
+        .threads = 2,
+    };
+
+    /* Three cameras around the scene at different resolutions */
+    const int sizes[VIEWS][2] = {{40, 30}, {24, 24}, {33, 17}};
+    const vec3_t from[VIEWS] = {vec3(13, 2, 3), vec3(-3, 2, 13), vec3(0, 12, 1)};
+    multiview_view_t views[VIEWS];
+    record_t record = {.fail_at = -1};
+    for (int v = 0; v < VIEWS; v++) {
+        views[v].width = sizes[v][0];
+        views[v].height = sizes[v][1];
+        views[v].camera = camera_create(from[v], vec3(0, 0, 0), vec3(0, 1, 0), 25.0,
+                                        (double)sizes[v][0] / sizes[v][1], 0.0, 10.0);
+        render_settings_t frame = settings;
+        frame.width = sizes[v][0];
+        frame.height = sizes[v][1];
+        record.reference[v] = accum_create(sizes[v][0], sizes[v][1]);
+        render_region(scene, &views[v].camera, &frame,
+                      (render_rect_t){0, 0, sizes[v][0], sizes[v][1]}, 0, 4,
+                      record.reference[v]);
+    }
+
+    int status = multiview_render(scene, views, VIEWS, &settings, 8, record_view, &record);
+    check("batch succeeds", status == 0);
+    check("every view is handed over once", record.calls[0] == 1 && record.calls[1] == 1 &&
+          record.calls[2] == 1);
+    check("views match separate renders", record.matching == VIEWS);
+
+    /* One thread drains the queue in order */
+    memset(record.calls, 0, sizeof(record.calls));
+    record.finished = record.matching = 0;
+    settings.threads = 1;
+    multiview_render(scene, views, VIEWS, &settings, 16, record_view, &record);
+    check("views finish in queue order", record.order[0] == 0 && record.order[1] == 1 &&
+          record.order[2] == 2 && record.matching == VIEWS);
+
+    /* A failing callback stops the job */
+    memset(record.calls, 0, sizeof(record.calls));
+    record.finished = record.matching = 0;
+    record.fail_at = 0;
+    status = multiview_render(scene, views, VIEWS, &settings, 16, record_view, &record);
+    check("failed callback stops the job", status == -1 && record.finished == 1);
+
+    atomic_int cancel = 0;
+    settings.cancel = &cancel;
+    status = multiview_render(scene, views, VIEWS, &settings, 16, cancel_after_first, &cancel);
+    check("cancellation stops the job", status == -1);
+    settings.cancel = NULL;
+
+    multiview_view_t tiny = views[0];
+    tiny.width = 1;
+    check("invalid arguments are rejected",
+          multiview_render(scene, views, 0, &settings, 16, record_view, &record) == -1 &&
+          multiview_render(scene, views, VIEWS, &settings, 0, record_view, &record) == -1 &&
+          multiview_render(scene, &tiny, 1, &settings, 16, record_view, &record) == -1);
+
+    for (int v = 0; v < VIEWS; v++) accum_destroy(record.reference[v]);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+#include "../src/photon.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include "../src/utils.h"
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+/* Irradiance at p summed over every photon, without the grid */
+static vec3_t brute_irradiance(const photon_map_t *map, vec3_t p) {
+    vec3_t sum = vec3(0.0, 0.0, 0.0);
+    for (int i = 0; i < map->count; i++) {
+        const photon_t *ph = &map->photons[i];
+        double dx = ph->position[0] - p.e[0];
+        double dy = ph->position[1] - p.e[1];
+        double dz = ph->position[2] - p.e[2];
+        if (dx * dx + dy * dy + dz * dz > map->radius * map->radius) continue;
+        for (int c = 0; c < 3; c++) sum.e[c] += ph->power[c];
+    }
+    return vec3_mul(sum, 1.0 / (PI * map->radius * map->radius));
+}
+
+/* Mean luminance of an image */
+static double mean_luminance(const accum_t *a) {
+    int n = a->width * a->height;
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        vec3_t x = accum_pixel_mean(&a->pixels[i]);
+        sum += 0.2126 * x.e[0] + 0.7152 * x.e[1] + 0.0722 * x.e[2];
+    }
+    return sum / n;
+}
+
+int main(void) {
+    /* Only diffuse objects: nothing to make caustics */
+    scene_t *plain = scene_create();
+    scene_finalize(plain);
+    photon_map_t *empty = photon_map_build(plain, 1000, 0.1, 1, 8);
+    check("scene without glass or metal has no targets",
+          plain->specular_count == 0 && photon_initial_radius(plain) == 0.0);
+    check("its photon map is empty", empty && empty->count == 0 &&
+          photon_map_irradiance(empty, vec3(0, 0, 0)).e[0] == 0.0);
+    photon_map_destroy(empty);
+    scene_destroy(plain);
+
+    /* Radii of progressive passes shrink, each by (k + alpha) / (k + 1) */
+    int shrinking = photon_pass_radius(0.2, 0) == 0.2;
+    for (int k = 1; k < 50; k++) {
+        shrinking &= photon_pass_radius(0.2, k) < photon_pass_radius(0.2, k - 1);
+    }
+    check("pass radii shrink from the initial radius", shrinking);
+    check("pass radii shrink slowly enough to keep gathering",
+          photon_pass_radius(0.2, 1000) > 0.2 * 0.05);
+
+    /* The glass scene: a ball focusing the skylight onto the ground */
+    scene_t *scene = scene_create_glass(0);
+    double radius = photon_initial_radius(scene);
+    check("glass and metal balls are targets", scene->specular_count == 3 && radius > 0.0);
+
+    omp_set_num_threads(1);
+    photon_map_t *one = photon_map_build(scene, 20000, radius, 7, 50);
+    omp_set_num_threads(3);
+    photon_map_t *three = photon_map_build(scene, 20000, radius, 7, 50);
+    check("photons land", one && one->count > 0);
+    check("map is independent of the thread count",
+          one && three && one->count == three->count &&
+          memcmp(one->photons, three->photons, one->count * sizeof(photon_t)) == 0 &&
+          memcmp(one->cells, three->cells, (one->mask + 2) * sizeof(uint32_t)) == 0);
+
+    /* Diffuse surfaces are the ground sphere and the canopy at y = 5 */
+    int on_diffuse = 1;
+    for (int i = 0; one && i < one->count; i++) {
+        const float *p = one->photons[i].position;
+        double ground = vec3_length(vec3(p[0], p[1] + 1000.0, p[2]));
+        on_diffuse &= fabs(ground - 1000.0) < 0.01 || fabs(p[1] - 5.0) < 0.01;
+    }
+    check("photons rest on diffuse surfaces", on_diffuse);
+
+    /* The grid gather finds exactly the photons within the radius */
+    int exact = 1;
+    double brightest = 0.0;
+    for (int i = 0; one && i < 200; i++) {
+        vec3_t p = vec3(-2.0 + 0.02 * i, 0.0, 0.3 * sin(i));
+        vec3_t grid = photon_map_irradiance(one, p);
+        vec3_t brute = brute_irradiance(one, p);
+        for (int c = 0; c < 3; c++) {
+            exact &= fabs(grid.e[c] - brute.e[c]) <= 1e-9 * (1.0 + brute.e[c]);
+        }
+        if (grid.e[1] > brightest) brightest = grid.e[1];
+    }
+    check("gather matches a search of every photon", exact);
+    check("caustic under the hanging ball is lit",
+          one && photon_map_irradiance(one, vec3(0.0, 0.0, 0.0)).e[1] > 0.0 && brightest > 0.0);
+    photon_map_destroy(one);
+    photon_map_destroy(three);
+
+    /* Caustic renders: photons replace the paths that reach the sky
+     * through glass, so the image keeps its brightness */
+    camera_t camera = scene_camera(scene, 24.0 / 18.0);
+    render_settings_t settings = {
+        .width = 24,
+        .height = 18,
+        .samples_per_pixel = 8,
+        .max_depth = 50,
+        .seed = 3,
+        .threads = 1,
+    };
+    render_rect_t rect = {0, 0, 24, 18};
+    accum_t *a = accum_create(24, 18);
+    accum_t *b = accum_create(24, 18);
+    accum_t *reference = accum_create(24, 18);
+
+    check("caustic render completes",
+          render_progressive(scene, &camera, &settings, rect, 0, 20000, a) == 0);
+    settings.threads = 3;
+    render_progressive(scene, &camera, &settings, rect, 0, 20000, b);
+    check("caustic render is independent of the thread count",
+          memcmp(a->pixels, b->pixels, 24 * 18 * sizeof(accum_pixel_t)) == 0);
+
+    settings.samples_per_pixel = 128;
+    settings.seed = 99;
+    render_region(scene, &camera, &settings, rect, 0, 128, reference);
+    double mean = mean_luminance(a), reference_mean = mean_luminance(reference);
+    check("caustics keep the image's brightness",
+          fabs(mean - reference_mean) < 0.05 * reference_mean);
+
+    accum_destroy(a);
+    accum_destroy(b);
+    accum_destroy(reference);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+#include "../src/query.h"
+#include "../src/scene.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+#define RAYS 20000
+
+/* Rays over the showcase field and their results, as separate arrays */
+typedef struct {
+    double o[3][RAYS], d[3][RAYS], t_min[RAYS], t_max[RAYS];
+    double t[RAYS], n[3][RAYS];
+    int primitive[RAYS];
+    unsigned char occluded[RAYS];
+} batch_t;
+
+int main(void) {
+    batch_t *b = malloc(sizeof(batch_t));
+    random_seed(11);
+    for (int i = 0; i < RAYS; i++) {
+        vec3_t origin = random_vec3_range(-12.0, 12.0);
+        origin.e[1] = random_double_range(0.05, 3.0);
+        vec3_t direction = vec3_mul(random_unit_vector(), random_double_range(0.5, 2.0));
+        for (int a = 0; a < 3; a++) {
+            b->o[a][i] = origin.e[a];
+            b->d[a][i] = direction.e[a];
+        }
+        b->t_min[i] = 0.001;
+    }
+    vibe_rays_t rays = {b->o[0], b->o[1], b->o[2], b->d[0], b->d[1], b->d[2], b->t_min, NULL,
+                        0.0};
+    vibe_hits_t hits = {b->t, b->primitive, b->n[0], b->n[1], b->n[2]};
+    check("rays are complete", query_rays_valid(&rays));
+
+    /* Closest hits are the renderer's */
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    query_closest(scene, NULL, &rays, RAYS, &hits);
+    int agree = 1, outward = 1, inside = 0, hit_count = 0;
+    for (int i = 0; i < RAYS; i++) {
+        ray_t r = ray_timed(vec3(b->o[0][i], b->o[1][i], b->o[2][i]),
+                            vec3(b->d[0][i], b->d[1][i], b->d[2][i]), 0.0);
+        hit_record_t rec;
+        if (!scene_hit(scene, r, 0.001, INFINITY, &rec)) {
+            agree &= b->primitive[i] == -1 && isinf(b->t[i]) && b->n[0][i] == 0.0;
+            continue;
+        }
+        hit_count++;
+        agree &= b->t[i] == rec.t && b->primitive[i] == rec.object;
+        /* The normal faces out of the surface, against rays from outside */
+        double facing = b->n[0][i] * r.direction.e[0] + b->n[1][i] * r.direction.e[1] +
+                        b->n[2][i] * r.direction.e[2];
+        outward &= rec.front_face ? facing < 0.0 : facing > 0.0;
+        inside += !rec.front_face;
+    }
+    printf("  %d of %d rays hit, %d from inside an object\n", hit_count, RAYS, inside);
+    check("closest hits match scene_hit", agree && hit_count > RAYS / 2);
+    check("normals point outward", outward && inside > 0);
+
+    /* Occlusion agrees, and t_max cuts rays short of their hits */
+    query_occluded(scene, NULL, &rays, RAYS, b->occluded);
+    int same = 1;
+    for (int i = 0; i < RAYS; i++) same &= b->occluded[i] == (b->primitive[i] >= 0);
+    check("occluded where something is hit", same);
+
+    for (int i = 0; i < RAYS; i++) b->t_max[i] = isinf(b->t[i]) ? 1e9 : 0.5 * b->t[i];
+    rays.t_max = b->t_max;
+    query_occluded(scene, NULL, &rays, RAYS, b->occluded);
+    int cut = 1, misses = 0;
+    for (int i = 0; i < RAYS; i++) cut &= !b->occluded[i] || b->primitive[i] < 0;
+    vibe_hits_t plain = {b->t, b->primitive, NULL, NULL, NULL};
+    query_closest(scene, NULL, &rays, RAYS, &plain);
+    for (int i = 0; i < RAYS; i++) misses += b->primitive[i] < 0;
+    check("t_max limits both queries", cut && misses == RAYS);
+    rays.t_max = NULL;
+
+    /* The grid answers the same */
+    int bvh_hits[RAYS];
+    query_closest(scene, NULL, &rays, RAYS, &plain);
+    for (int i = 0; i < RAYS; i++) bvh_hits[i] = b->primitive[i];
+    scene_set_accelerator(scene, SCENE_ACCEL_GRID);
+    query_closest(scene, NULL, &rays, RAYS, &plain);
+    int same_grid = 1;
+    for (int i = 0; i < RAYS; i++) same_grid &= bvh_hits[i] == b->primitive[i];
+    check("grid finds the same hits", same_grid);
+    scene_destroy(scene);
+
+    /* Moving spheres are queried at the batch's time */
+    scene_t *bouncing = scene_create_bouncing(SCENE_DEFAULT_SEED);
+    scene_set_shutter(bouncing, 0.0, 1.0);
+    rays.time = 0.75;
+    query_closest(bouncing, NULL, &rays, RAYS, &plain);
+    int timed = 1;
+    for (int i = 0; i < RAYS; i++) {
+        ray_t r = ray_timed(vec3(b->o[0][i], b->o[1][i], b->o[2][i]),
+                            vec3(b->d[0][i], b->d[1][i], b->d[2][i]), 0.75);
+        hit_record_t rec;
+        int hit = scene_hit(bouncing, r, 0.001, INFINITY, &rec);
+        timed &= hit ? b->primitive[i] == rec.object : b->primitive[i] == -1;
+    }
+    check("rays cast at the batch's time", timed);
+    scene_destroy(bouncing);
+    free(b);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
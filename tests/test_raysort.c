@@ -0,0 +1,114 @@
+#include "../src/raysort.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include "../src/vec3.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+int main(void) {
+    aabb_t bounds = {vec3(-1.0, -1.0, -1.0), vec3(1.0, 1.0, 1.0)};
+
+    /* Keys fit the documented width and separate origins before directions */
+    random_seed(3);
+    int in_range = 1;
+    for (int i = 0; i < 1000; i++) {
+        ray_t r = ray(random_vec3_range(-1.0, 1.0), random_vec3_range(-1.0, 1.0));
+        if (ray_sort_key(&r, &bounds) >> RAYSORT_KEY_BITS) in_range = 0;
+    }
+    check("keys fit in RAYSORT_KEY_BITS", in_range);
+
+    ray_t near_a = ray(vec3(-0.9, -0.9, -0.9), vec3(1.0, 1.0, 1.0));
+    ray_t near_b = ray(vec3(-0.9, -0.9, -0.9), vec3(-1.0, -1.0, -1.0));
+    ray_t far = ray(vec3(0.9, 0.9, 0.9), vec3(1.0, 1.0, 1.0));
+    uint64_t ka = ray_sort_key(&near_a, &bounds);
+    uint64_t kb = ray_sort_key(&near_b, &bounds);
+    uint64_t kf = ray_sort_key(&far, &bounds);
+    check("opposite directions get different keys", ka != kb);
+    check("origin dominates direction", ka < kf && kb < kf);
+
+    ray_t scaled = ray(near_a.origin, vec3(3.0, 3.0, 3.0));
+    check("key ignores direction length", ray_sort_key(&scaled, &bounds) == ka);
+    ray_t outside = ray(vec3(5.0, -5.0, 0.0), vec3(0.0, 1.0, 0.0));
+    check("origins outside the bounds are clamped",
+          (ray_sort_key(&outside, &bounds) >> RAYSORT_KEY_BITS) == 0);
+
+    /* Radix sort orders keys and keeps equal keys in input order */
+    int n = 5000;
+    uint64_t *keys = malloc(2 * n * sizeof(uint64_t));
+    uint32_t *values = malloc(2 * n * sizeof(uint32_t));
+    uint64_t *original = malloc(n * sizeof(uint64_t));
+    for (int i = 0; i < n; i++) {
+        keys[i] = original[i] = (uint64_t)(random_double() * 64.0) << (i % 5 * 8);
+        values[i] = (uint32_t)i;
+    }
+    ray_sort(keys, values, n, keys + n, values + n);
+    int sorted = 1, stable = 1, permuted = 1;
+    for (int i = 0; i < n; i++) {
+        if (keys[i] != original[values[i]]) permuted = 0;
+        if (i > 0 && keys[i - 1] > keys[i]) sorted = 0;
+        if (i > 0 && keys[i - 1] == keys[i] && values[i - 1] > values[i]) stable = 0;
+    }
+    check("radix sort orders keys", sorted);
+    check("values follow their keys", permuted);
+    check("radix sort is stable", stable);
+    ray_sort(keys, values, 0, keys + n, values + n);
+    check("empty sort is a no-op", keys[0] <= keys[1]);
+    free(keys);
+    free(values);
+    free(original);
+
+    /* Batched rendering: sorting only changes the trace order, never the image */
+    render_settings_t settings = {
+        .width = 24,
+        .height = 16,
+        .samples_per_pixel = 4,
+        .max_depth = 8,
+        .seed = 7,
+    };
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    camera_t camera = scene_camera(scene, 24.0 / 16.0);
+    render_rect_t full = {0, 0, settings.width, settings.height};
+    size_t bytes = (size_t)settings.width * settings.height * sizeof(accum_pixel_t);
+
+    accum_t *recursive = accum_create(settings.width, settings.height);
+    render_region(scene, &camera, &settings, full, 0, 4, recursive);
+
+    settings.batch_size = 256;
+    accum_t *unsorted = accum_create(settings.width, settings.height);
+    render_region(scene, &camera, &settings, full, 0, 4, unsorted);
+    settings.sort_rays = 1;
+    accum_t *batched = accum_create(settings.width, settings.height);
+    render_region(scene, &camera, &settings, full, 0, 4, batched);
+    check("sorted batches match unsorted exactly",
+          memcmp(batched->pixels, unsorted->pixels, bytes) == 0);
+
+    double worst = 0.0;
+    for (int i = 0; i < settings.width * settings.height; i++) {
+        vec3_t a = accum_pixel_mean(&recursive->pixels[i]);
+        vec3_t b = accum_pixel_mean(&batched->pixels[i]);
+        for (int c = 0; c < 3; c++) worst = fmax(worst, fabs(a.e[c] - b.e[c]));
+    }
+    check("batched render matches recursive render", worst < 1e-6);
+
+    accum_destroy(recursive);
+    accum_destroy(unsorted);
+    accum_destroy(batched);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+#include "../src/render.h"
+#include "../src/scene.h"
+#include "../src/vec3.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define EPSILON 1e-6
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+/* Compare two accumulation buffers bit for bit */
+static int accum_equal(const accum_t *a, const accum_t *b) {
+    return a->width == b->width && a->height == b->height &&
+           memcmp(a->pixels, b->pixels,
+                  (size_t)a->width * a->height * sizeof(accum_pixel_t)) == 0;
+}
+
+int main(void) {
+    render_settings_t settings = {
+        .width = 24,
+        .height = 16,
+        .samples_per_pixel = 6,
+        .max_depth = 8,
+        .seed = 7,
+    };
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    check("scene created", scene != NULL);
+    check("scene has ground, field and three large spheres",
+          scene->world->count > 400 && scene->world->count < 490);
+    camera_t camera = scene_camera(scene, 24.0 / 16.0);
+    render_rect_t full = {0, 0, settings.width, settings.height};
+
+    /* Reference: one render of all samples */
+    accum_t *ref = accum_create(settings.width, settings.height);
+    render_region(scene, &camera, &settings, full, 0, 6, ref);
+    check("every pixel got all samples",
+          ref->pixels[0].samples == 6 &&
+          ref->pixels[settings.width * settings.height - 1].samples == 6);
+
+    /* Same samples split into three ranges merge to identical sums */
+    accum_t *split = accum_create(settings.width, settings.height);
+    accum_t *part = accum_create(settings.width, settings.height);
+    for (int k = 0; k < 3; k++) {
+        accum_clear(part);
+        render_region(scene, &camera, &settings, full, 2 * k, 2 * k + 2, part);
+        accum_merge(split, part, 0, 0);
+    }
+    check("sample-range split merges exactly", accum_equal(ref, split));
+
+    /* Tiles rendered independently and merged at their offsets */
+    accum_t *tiled = accum_create(settings.width, settings.height);
+    for (int ty = 0; ty < settings.height; ty += 5) {
+        for (int tx = 0; tx < settings.width; tx += 7) {
+            render_rect_t rect = {tx, ty, tx + 7, ty + 5};
+            if (rect.x1 > settings.width) rect.x1 = settings.width;
+            if (rect.y1 > settings.height) rect.y1 = settings.height;
+            accum_t *tile = accum_create(rect.x1 - rect.x0, rect.y1 - rect.y0);
+            render_region(scene, &camera, &settings, rect, 0, 6, tile);
+            accum_merge(tiled, tile, tx, ty);
+            accum_destroy(tile);
+        }
+    }
+    check("tile split merges exactly", accum_equal(ref, tiled));
+
+    /* A different seed gives a different image */
+    render_settings_t other = settings;
+    other.seed = 8;
+    accum_clear(part);
+    render_region(scene, &camera, &other, full, 0, 6, part);
+    check("seed changes the samples", !accum_equal(ref, part));
+
+    /* Fixed-point mean round-trips a constant radiance */
+    accum_pixel_t px = {{0}, 0, 0};
+    check("empty pixel is black", accum_pixel_mean(&px).e[0] == 0.0);
+    px.sum[0] = 3ull << ACCUM_FRACTION_BITS;
+    px.samples = 4;
+    check("pixel mean", fabs(accum_pixel_mean(&px).e[0] - 0.75) < EPSILON);
+
+    accum_destroy(ref);
+    accum_destroy(split);
+    accum_destroy(part);
+    accum_destroy(tiled);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed == 0 ? 0 : 1;
+}
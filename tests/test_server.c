@@ -0,0 +1,210 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../src/net.h"
+#include "../src/server.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+/* Message types of the daemon's protocol (see server.c) */
+#define MSG_SUBMIT 1
+#define MSG_DONE 4
+
+static char address[64];
+
+#define ROOT "/tmp"
+
+static void *serve(void *arg) {
+    server_options_t opts = {.address = address, .root = ROOT, .cache_size = 1};
+    *(int *)arg = server_run(&opts);
+    return NULL;
+}
+
+/* A small render of scene into the temporary file number n, under ROOT */
+static server_job_t make_job(const char *scene, int n, int size, int spp) {
+    server_job_t job = {.default_view = 1};
+    vibe_settings_default(&job.settings);
+    job.settings.width = size;
+    job.settings.height = size * 2 / 3;
+    job.settings.samples_per_pixel = spp;
+    job.settings.max_depth = 6;
+    strcpy(job.scene, scene);
+    snprintf(job.output, sizeof(job.output), "vibe_test_%d_%d.ppm", (int)getpid(), n);
+    return job;
+}
+
+/* Read a whole file into a malloc'd string */
+static char *slurp(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    char *text = calloc(1, 1 << 20);
+    if (text) fread(text, 1, (1 << 20) - 1, f);
+    fclose(f);
+    return text;
+}
+
+typedef struct {
+    double last;
+    int calls;
+    int monotonic;
+} progress_t;
+
+static void on_progress(double fraction, void *user) {
+    progress_t *p = user;
+    if (fraction < p->last) p->monotonic = 0;
+    p->last = fraction;
+    p->calls++;
+}
+
+/* Job submitted from its own thread; finish order is recorded */
+typedef struct {
+    server_job_t job;
+    int status;
+    int finished;
+} async_job_t;
+
+static atomic_int finish_counter;
+
+static void *submit_async(void *arg) {
+    async_job_t *a = arg;
+    a->status = server_submit(address, &a->job, NULL, NULL, NULL);
+    a->finished = atomic_fetch_add(&finish_counter, 1);
+    return NULL;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec t = {0, ms * 1000000L};
+    nanosleep(&t, NULL);
+}
+
+int main(void) {
+    /* The daemon only serves unix: addresses */
+    server_options_t remote = {.address = "tcp::0"};
+    check("tcp address is refused", server_run(&remote) != 0);
+
+    snprintf(address, sizeof(address), "unix:/tmp/vibe_test_%d.sock", (int)getpid());
+    int server_status = -1;
+    pthread_t server;
+    pthread_create(&server, NULL, serve, &server_status);
+
+    /* A job renders the same image as the library */
+    server_job_t job = make_job("random", 0, 48, 4);
+    server_result_t result;
+    progress_t progress = {0.0, 0, 1};
+    int status = server_submit(address, &job, on_progress, &progress, &result);
+    check("job succeeds", status == 0 && result.status == 0 && !result.scene_cached);
+    check("progress is streamed up to completion",
+          progress.calls > 1 && progress.monotonic && progress.last == 1.0);
+
+    vibe_scene_desc_t desc = {.name = "random"};
+    vibe_scene_t *scene = vibe_scene_load(&desc);
+    vibe_view_t view;
+    vibe_scene_view(scene, &view);
+    double *rgb = malloc(48 * 32 * 3 * sizeof(double));
+    char reference[64];
+    snprintf(reference, sizeof(reference), "/tmp/vibe_test_%d_ref.ppm", (int)getpid());
+    vibe_render(scene, &view, &job.settings, rgb);
+    vibe_write_ppm(reference, rgb, 48, 32);
+    char written[SERVER_PATH_SIZE + 8];
+    snprintf(written, sizeof(written), ROOT "/%s", job.output);
+    char *a = slurp(written), *b = slurp(reference);
+    check("daemon output matches a library render", a && b && strcmp(a, b) == 0);
+    free(a);
+    free(b);
+    free(rgb);
+    vibe_scene_destroy(scene);
+    remove(reference);
+
+    /* LRU cache of one scene */
+    server_submit(address, &job, NULL, NULL, &result);
+    check("second job reuses the built scene", result.status == 0 && result.scene_cached);
+    server_job_t other = make_job("bouncing", 1, 32, 2);
+    server_submit(address, &other, NULL, NULL, &result);
+    check("other scene is built", result.status == 0 && !result.scene_cached);
+    server_submit(address, &job, NULL, NULL, &result);
+    check("least recently used scene was evicted", result.status == 0 && !result.scene_cached);
+
+    /* A client stalled halfway through a request, and one that submits in
+     * small pieces, do not hold up others */
+    int stalled = net_connect(address, 1.0);
+    net_header_t partial = {NET_MAGIC, MSG_SUBMIT, 9, sizeof(server_job_t)};
+    net_send_all(stalled, &partial, 6);
+    int slow = net_connect(address, 1.0);
+    server_job_t pieces = make_job("random", 6, 32, 2);
+    net_send_all(slow, &partial, sizeof(partial));
+    net_send_all(slow, &pieces, 100);
+    check("others are served meanwhile",
+          server_submit(address, &job, NULL, NULL, &result) == 0 && result.status == 0);
+    net_send_all(slow, (const char *)&pieces + 100, sizeof(pieces) - 100);
+    net_header_t h;
+    int done = 0;
+    while (!done && net_recv_header(slow, &h) == 0) {
+        char payload[sizeof(server_result_t)];
+        if (h.payload > sizeof(payload) || net_recv_all(slow, payload, h.payload) != 0) break;
+        done = h.type == MSG_DONE && ((server_result_t *)payload)->status == 0;
+    }
+    check("request sent in pieces is served", done);
+    close(slow);
+    close(stalled);
+
+    /* Errors are reported to the client */
+    server_job_t bad = make_job("nowhere", 2, 32, 2);
+    check("unknown scene fails", server_submit(address, &bad, NULL, NULL, &result) != 0 &&
+                                     strstr(result.message, "nowhere") != NULL);
+    bad = make_job("random", 2, 32, 2);
+    bad.settings.crop = (vibe_rect_t){0, 0, 64, 64};
+    check("crop outside the frame fails", server_submit(address, &bad, NULL, NULL, &result) != 0);
+
+    /* Paths may not leave the daemon's root */
+    bad = make_job("random", 2, 32, 2);
+    strcpy(bad.output, "/tmp/vibe_escape.ppm");
+    check("absolute output is refused", server_submit(address, &bad, NULL, NULL, &result) != 0 &&
+                                            access("/tmp/vibe_escape.ppm", F_OK) != 0);
+    bad = make_job("random", 2, 32, 2);
+    strcpy(bad.obj_path, "../etc/passwd");
+    check("mesh outside the root is refused",
+          server_submit(address, &bad, NULL, NULL, &result) != 0 && strstr(result.message, "root"));
+
+    /* While a long job runs, a later high-priority job overtakes a low one */
+    async_job_t jobs[3] = {{make_job("random", 3, 200, 48), -1, -1},
+                           {make_job("random", 4, 32, 2), -1, -1},
+                           {make_job("random", 5, 32, 2), -1, -1}};
+    jobs[2].job.priority = 5;
+    pthread_t threads[3];
+    for (int i = 0; i < 3; i++) {
+        pthread_create(&threads[i], NULL, submit_async, &jobs[i]);
+        sleep_ms(100);
+    }
+    for (int i = 0; i < 3; i++) pthread_join(threads[i], NULL);
+    check("queued jobs all succeed", jobs[0].status == 0 && jobs[1].status == 0 &&
+                                         jobs[2].status == 0);
+    check("higher priority runs first", jobs[0].finished == 0 && jobs[2].finished == 1 &&
+                                            jobs[1].finished == 2);
+
+    check("shutdown request is delivered", server_shutdown(address) == 0);
+    pthread_join(server, NULL);
+    check("daemon exits cleanly", server_status == 0);
+
+    for (int i = 0; i < 7; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/vibe_test_%d_%d.ppm", (int)getpid(), i);
+        remove(path);
+    }
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+#include "../src/temporal.h"
+#include "../src/render.h"
+#include "../src/scene.h"
+#include "../src/utils.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+#define WIDTH 48
+#define HEIGHT 27
+#define PIXELS (WIDTH * HEIGHT)
+#define SPP 16
+
+/* Camera of the scene's view turned by degrees about the vertical through lookat */
+static camera_t orbit_camera(const scene_t *scene, double degrees) {
+    double a = degrees * PI / 180.0;
+    vec3_t d = vec3_sub(scene->lookfrom, scene->lookat);
+    vec3_t from = vec3_add(scene->lookat, vec3(d.e[0] * cos(a) + d.e[2] * sin(a), d.e[1],
+                                               d.e[2] * cos(a) - d.e[0] * sin(a)));
+    return camera_create(from, scene->lookat, scene->vup, scene->vfov,
+                         (double)WIDTH / HEIGHT, scene->aperture, scene->focus_dist);
+}
+
+/* Luminance RMS error of rgb against a reference frame */
+static double rmse(const double *rgb, const accum_t *reference) {
+    double error = 0.0;
+    for (int i = 0; i < PIXELS; i++) {
+        vec3_t q = accum_pixel_mean(&reference->pixels[i]);
+        double d = 0.2126 * (rgb[3 * i] - q.e[0]) + 0.7152 * (rgb[3 * i + 1] - q.e[1]) +
+                   0.0722 * (rgb[3 * i + 2] - q.e[2]);
+        error += d * d;
+    }
+    return sqrt(error / PIXELS);
+}
+
+int main(void) {
+    scene_t *scene = scene_create_random(SCENE_DEFAULT_SEED);
+    camera_t camera = scene_camera(scene, (double)WIDTH / HEIGHT);
+
+    /* Projection inverts the centre ray */
+    random_seed(3);
+    int inverts = 1;
+    for (int i = 0; i < 100; i++) {
+        double u = random_double(), v = random_double(), pu, pv;
+        vec3_t target = vec3_add(camera.lower_left_corner,
+                                 vec3_add(vec3_mul(camera.horizontal, u),
+                                          vec3_mul(camera.vertical, v)));
+        vec3_t point = vec3_add(camera.origin,
+                                vec3_mul(vec3_sub(target, camera.origin), 0.1 + 3.0 * i / 100));
+        inverts &= camera_project(&camera, point, &pu, &pv) && fabs(pu - u) < 1e-9 &&
+                   fabs(pv - v) < 1e-9;
+    }
+    double pu, pv;
+    vec3_t behind = vec3_add(camera.origin, camera.w);
+    check("projection inverts camera rays", inverts);
+    check("points behind the camera do not project", !camera_project(&camera, behind, &pu, &pv));
+
+    /* The first frame is the plain render */
+    render_settings_t settings = {
+        .width = WIDTH,
+        .height = HEIGHT,
+        .samples_per_pixel = SPP,
+        .max_depth = 10,
+        .seed = 7,
+        .threads = 2,
+    };
+    temporal_options_t options = {.fresh_spp = 2, .max_history = 64};
+    temporal_t *temporal = temporal_create(WIDTH, HEIGHT);
+    double *rgb = malloc(PIXELS * 3 * sizeof(double));
+    double *other = malloc(PIXELS * 3 * sizeof(double));
+    accum_t *plain = accum_create(WIDTH, HEIGHT);
+    temporal_stats_t stats;
+    render_region(scene, &camera, &settings, (render_rect_t){0, 0, WIDTH, HEIGHT}, 0, SPP,
+                  plain);
+    temporal_render(temporal, scene, &camera, &settings, &options, rgb, &stats);
+    int same = 1;
+    for (int i = 0; i < PIXELS; i++) {
+        vec3_t mean = accum_pixel_mean(&plain->pixels[i]);
+        for (int c = 0; c < 3; c++) same &= rgb[3 * i + c] == mean.e[c];
+    }
+    check("first frame is the plain render", same && stats.reused == 0 &&
+          stats.samples == (long)PIXELS * SPP);
+
+    /* A still camera reuses every diffuse pixel, never the sky */
+    temporal_render(temporal, scene, &camera, &settings, &options, rgb, &stats);
+    int reusable = 0, interior = -1;
+    for (int i = 0; i < PIXELS; i++) {
+        if (temporal->surfaces[i].object == TEMPORAL_NONE || temporal->surfaces[i].edge) continue;
+        reusable++;
+        interior = i;
+    }
+    check("still camera reuses every diffuse interior pixel", reusable > PIXELS / 10 &&
+          stats.reused == reusable);
+    check("sky is rendered afresh", temporal->history[WIDTH / 2] == SPP);
+    check("history grows", interior >= 0 &&
+          temporal->history[interior] == SPP + options.fresh_spp);
+
+    /* An orbiting camera disoccludes some pixels, and the result does not
+     * depend on the thread count */
+    temporal_t *threaded = temporal_create(WIDTH, HEIGHT);
+    int same_threads = 1, disoccluded = 1, reuses = 1;
+    for (int f = 0; f < 6; f++) {
+        camera_t moved = orbit_camera(scene, 2.0 * f);
+        temporal_render(threaded, scene, &moved, &settings, &options,
+                        other, NULL);
+    }
+    temporal_reset(temporal);
+    settings.threads = 1;
+    for (int f = 0; f < 6; f++) {
+        camera_t moved = orbit_camera(scene, 2.0 * f);
+        temporal_render(temporal, scene, &moved, &settings, &options, rgb, &stats);
+        reusable = 0;
+        for (int i = 0; i < PIXELS; i++) {
+            const temporal_surface_t *surface = &temporal->surfaces[i];
+            reusable += surface->object != TEMPORAL_NONE && !surface->edge;
+        }
+        if (f > 0) {
+            disoccluded &= stats.fresh > PIXELS - reusable;
+            reuses &= stats.reused > reusable * 3 / 4;
+        }
+    }
+    same_threads = memcmp(rgb, other, PIXELS * 3 * sizeof(double)) == 0;
+    check("orbit disocclusions are rendered afresh", disoccluded);
+    check("orbit reuses most diffuse interior pixels", reuses);
+    check("frames do not depend on the thread count", same_threads);
+
+    /* Reuse beats fresh samples alone, at far fewer than the full count */
+    camera_t last = orbit_camera(scene, 10.0);
+    accum_t *reference = accum_create(WIDTH, HEIGHT);
+    accum_t *cheap = accum_create(WIDTH, HEIGHT);
+    settings.threads = 0;
+    render_region(scene, &last, &settings, (render_rect_t){0, 0, WIDTH, HEIGHT}, 1000, 1256,
+                  reference);
+    int cheap_spp = (int)(stats.samples / PIXELS + 1);
+    render_region(scene, &last, &settings, (render_rect_t){0, 0, WIDTH, HEIGHT}, 2000,
+                  2000 + cheap_spp, cheap);
+    double *cheap_rgb = malloc(PIXELS * 3 * sizeof(double));
+    for (int i = 0; i < PIXELS; i++) {
+        vec3_t mean = accum_pixel_mean(&cheap->pixels[i]);
+        for (int c = 0; c < 3; c++) cheap_rgb[3 * i + c] = mean.e[c];
+    }
+    double reuse_error = rmse(rgb, reference), cheap_error = rmse(cheap_rgb, reference);
+    printf("  reuse %.4f at %.1f spp, plain %.4f at %d spp\n", reuse_error,
+           (double)stats.samples / PIXELS, cheap_error, cheap_spp);
+    check("reuse is more accurate than its samples alone", reuse_error < cheap_error);
+
+    settings.width = WIDTH + 1;
+    check("mismatched settings are rejected",
+          temporal_render(temporal, scene, &camera, &settings, &options, rgb, NULL) == -1);
+
+    free(cheap_rgb);
+    accum_destroy(cheap);
+    accum_destroy(reference);
+    accum_destroy(plain);
+    free(other);
+    free(rgb);
+    temporal_destroy(threaded);
+    temporal_destroy(temporal);
+    scene_destroy(scene);
+
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed > 0 ? 1 : 0;
+}
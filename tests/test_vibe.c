@@ -0,0 +1,118 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../src/vibe.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Built against the shared library: only the public API is visible */
+
+static int passed = 0, failed = 0;
+
+static void check(const char *name, int condition) {
+    if (condition) {
+        printf("✓ %s\n", name);
+        passed++;
+    } else {
+        printf("✗ %s\n", name);
+        failed++;
+    }
+}
+
+int main(void) {
+    vibe_settings_t settings;
+    vibe_settings_default(&settings);
+    check("defaults", settings.width == VIBE_DEFAULT_WIDTH &&
+                          settings.samples_per_pixel == VIBE_DEFAULT_SPP &&
+                          settings.threads == 0 && settings.crop.x1 == 0);
+    settings.width = 32;
+    settings.height = 20;
+    settings.samples_per_pixel = 3;
+    settings.max_depth = 6;
+
+    vibe_scene_desc_t desc = {.name = "random"};
+    vibe_scene_t *scene = vibe_scene_load(&desc);
+    check("scene loads", scene != NULL);
+    vibe_scene_desc_t bad = {.name = "nowhere"};
+    check("unknown scene fails with a message",
+          vibe_scene_load(&bad) == NULL && strstr(vibe_last_error(), "nowhere") != NULL);
+
+    vibe_view_t view;
+    vibe_scene_view(scene, &view);
+    check("default view", view.vfov > 0.0 && view.lookfrom[0] != view.lookat[0]);
+
+    size_t pixels = (size_t)settings.width * settings.height;
+    double *full = malloc(3 * pixels * sizeof(double));
+    double *again = malloc(3 * pixels * sizeof(double));
+    check("full frame renders", vibe_render(scene, &view, &settings, full) == 0);
+    check("scene is reusable and deterministic",
+          vibe_render(scene, &view, &settings, again) == 0 &&
+              memcmp(full, again, 3 * pixels * sizeof(double)) == 0);
+
+    /* Thread count and crop window do not change any pixel */
+    settings.threads = 1;
+    settings.crop = (vibe_rect_t){5, 4, 17, 13};
+    double crop[3 * 12 * 9];
+    int same = vibe_render(scene, &view, &settings, crop) == 0;
+    for (int y = 0; y < 9; y++) {
+        same &= memcmp(&crop[3 * 12 * y], &full[3 * ((4 + y) * settings.width + 5)],
+                       3 * 12 * sizeof(double)) == 0;
+    }
+    check("crop matches the full frame on one thread", same);
+
+    settings.crop = (vibe_rect_t){0, 0, 40, 10};
+    check("crop outside the frame is rejected", vibe_render(scene, &view, &settings, crop) != 0);
+    settings.crop = (vibe_rect_t){0};
+    settings.samples_per_pixel = 0;
+    check("invalid sample count is rejected", vibe_render(scene, &view, &settings, again) != 0);
+    settings.samples_per_pixel = 3;
+
+    /* A different view of the same scene */
+    view.lookfrom[1] += 3.0;
+    check("other views render", vibe_render(scene, &view, &settings, again) == 0 &&
+                                    memcmp(full, again, 3 * pixels * sizeof(double)) != 0);
+
+    /* Rays straight down onto the curved ground (object 0), the second cut
+     * short of it */
+    double ox[2] = {0.0, 1.0}, oy[2] = {0.5, 0.5}, oz[2] = {13.0, 13.0};
+    double dx[2] = {0.0, 0.0}, dy[2] = {-1.0, -1.0}, dz[2] = {0.0, 0.0};
+    double t_max[2] = {10.0, 0.4}, t[2], nx[2], ny[2], nz[2];
+    int primitive[2];
+    unsigned char occluded[2];
+    vibe_rays_t rays = {ox, oy, oz, dx, dy, dz, NULL, t_max, 0.0};
+    vibe_hits_t hits = {t, primitive, nx, ny, nz};
+    check("query finds the ground", vibe_query_closest(scene, &rays, 2, &hits) == 0 &&
+          primitive[0] == 0 && t[0] > 0.5 && t[0] < 0.6 && ny[0] > 0.99 &&
+          primitive[1] == -1);
+    check("occlusion query", vibe_query_occluded(scene, &rays, 2, occluded) == 0 &&
+          occluded[0] == 1 && occluded[1] == 0);
+    rays.dz = NULL;
+    check("queries need every ray array", vibe_query_occluded(scene, &rays, 2, occluded) != 0);
+
+    check("shutter opens", vibe_scene_set_shutter(scene, 0.0, 0.5) == 0);
+    vibe_scene_destroy(scene);
+
+    check("placement policy is validated", vibe_place_threads("diagonal", 0) < 0);
+    check("threads can be placed", vibe_place_threads("compact", 0) >= 1 &&
+                                       vibe_place_threads("none", 0) >= 1);
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/vibe_test_%d.ppm", (int)getpid());
+    double grey[3 * 4] = {0.25, 0.25, 0.25, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 4.0, 4.0, 4.0};
+    char text[64] = {0};
+    FILE *f = NULL;
+    if (vibe_write_ppm(path, grey, 2, 2) == 0 && (f = fopen(path, "r"))) {
+        size_t n = fread(text, 1, sizeof(text) - 1, f);
+        text[n] = '\0';
+        fclose(f);
+    }
+    remove(path);
+    check("ppm output is gamma corrected",
+          strcmp(text, "P3\n2 2\n255\n127 127 127\n255 0 0\n0 0 0\n255 255 255\n") == 0);
+
+    free(full);
+    free(again);
+    printf("\n%d/%d tests passed\n", passed, passed + failed);
+    return failed == 0 ? 0 : 1;
+}